@@ -2667,6 +2667,28 @@ int32_t ISM330DHCX_FIFO_Get_Data_Word(ISM330DHCX_Object_t *pObj, int16_t *data_r
   return ISM330DHCX_OK;
 }
 
+/**
+ * @brief  Read a block of ISM330DHCX FIFO tagged words in a single bus transaction
+ * @note   Each word is ISM330DHCX_FIFO_WORD_LEN bytes: FIFO_DATA_OUT_TAG followed
+ *         by the X/Y/Z low/high bytes. The address pointer rolls back from
+ *         FIFO_DATA_OUT_Z_H to FIFO_DATA_OUT_TAG, so the whole block is drained
+ *         by one burst read.
+ * @param  pObj the device pObj
+ * @param  pBuff the buffer to be filled, NumWords * ISM330DHCX_FIFO_WORD_LEN bytes
+ * @param  NumWords number of FIFO words to read
+ * @retval 0 in case of success, an error code otherwise
+ */
+int32_t ISM330DHCX_FIFO_Read_Block(ISM330DHCX_Object_t *pObj, uint8_t *pBuff, uint16_t NumWords)
+{
+  if (ism330dhcx_read_reg(&(pObj->Ctx), ISM330DHCX_FIFO_DATA_OUT_TAG, pBuff,
+                          (uint16_t)(NumWords * ISM330DHCX_FIFO_WORD_LEN)) != ISM330DHCX_OK)
+  {
+    return ISM330DHCX_ERROR;
+  }
+
+  return ISM330DHCX_OK;
+}
+
 /**
  * @brief  Get the ISM330DHCX FIFO gyro single sample (16-bit data) and calculate angular velocity [mDPS]
  * @param  pObj the device pObj
@@ -201,6 +201,8 @@ typedef union{
 #define ISM330DHCX_GYRO_SENSITIVITY_FS_2000DPS  70.000f
 #define ISM330DHCX_GYRO_SENSITIVITY_FS_4000DPS 140.000f
 
+#define ISM330DHCX_FIFO_WORD_LEN           7U  /* TAG + X/Y/Z 16-bit */
+
 /**
  * @}
  */
@@ -300,6 +302,7 @@ int32_t ISM330DHCX_FIFO_GYRO_Get_Axes(ISM330DHCX_Object_t *pObj, ISM330DHCX_Axes
 int32_t ISM330DHCX_FIFO_Full_Set_INT1(ISM330DHCX_Object_t *pObj, uint8_t Status);
 int32_t ISM330DHCX_FIFO_Set_INT2_Drdy(ISM330DHCX_Object_t *pObj, uint8_t Status);
 int32_t ISM330DHCX_FIFO_Get_Data_Word(ISM330DHCX_Object_t *pObj, int16_t *data_raw);
+int32_t ISM330DHCX_FIFO_Read_Block(ISM330DHCX_Object_t *pObj, uint8_t *pBuff, uint16_t NumWords);
 int32_t ISM330DHCX_FIFO_ACC_Get_Axis(ISM330DHCX_Object_t *pObj, ISM330DHCX_Axes_t *Acceleration);
 int32_t ISM330DHCX_FIFO_GYRO_Get_Axis(ISM330DHCX_Object_t *pObj, ISM330DHCX_Axes_t *AngularVelocity);
 
@@ -57,6 +57,25 @@ static SPI_HandleTypeDef hbusspi1;
 static SPI_HandleTypeDef hbusspi2;
 static SPI_HandleTypeDef hbusspi3;	
 static UART_HandleTypeDef huart3;	
+static DMA_HandleTypeDef hdma_i2c2_rx;
+static DMA_HandleTypeDef hdma_i2c2_tx;
+static DMA_HandleTypeDef hdma_spi2_rx;
+static DMA_HandleTypeDef hdma_spi2_tx;
+static DMA_HandleTypeDef hdma_spi3_rx;
+static DMA_HandleTypeDef hdma_spi3_tx;
+
+/* Transfer queue of one asynchronous bus */
+typedef struct
+{
+  BSP_BUS_Xfer_t *pHead;    /* Next transfer to start */
+  BSP_BUS_Xfer_t *pTail;
+  BSP_BUS_Xfer_t *pActive;  /* Transfer running on DMA/IT */
+  uint8_t Claimed;          /* Bus owned by a polling transfer */
+  uint8_t CmdPhase;         /* SPI command byte of pActive on the bus, payload next */
+  uint8_t Cmd;              /* SPI command byte sent by interrupt */
+} BUS_Queue_t;
+
+static BUS_Queue_t BusQueue[BSP_BUS_NUMBER];
 		
 #if (USE_HAL_I2C_REGISTER_CALLBACKS == 1)
 static uint32_t IsI2C1MspCbValid = 0;
@@ -90,6 +109,18 @@ static void SPI3_MspInit(SPI_HandleTypeDef* spiHandle);
 static void SPI3_MspDeInit(SPI_HandleTypeDef* spiHandle);
 static void USART3_MspInit(UART_HandleTypeDef *huart);
 static void USART3_MspDeInit(UART_HandleTypeDef *huart);
+static void BUS_DmaInit(DMA_HandleTypeDef *hdma, DMA_Channel_TypeDef *Channel,
+                        uint32_t Request, uint32_t Direction, IRQn_Type IRQn);
+static int32_t BUS_SpiRun(BSP_BUS_Id_t Bus, SPI_HandleTypeDef *hspi, BSP_BUS_Xfer_t *Xfer, uint8_t Poll);
+static HAL_StatusTypeDef BUS_SpiPayload(SPI_HandleTypeDef *hspi, BSP_BUS_Xfer_t *Xfer, uint8_t Poll);
+static int32_t BUS_I2cRun(I2C_HandleTypeDef *hi2c, BSP_BUS_Xfer_t *Xfer, uint8_t Poll);
+static int32_t BUS_Run(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer, uint8_t Poll);
+static void BUS_Finish(BSP_BUS_Id_t Bus, int32_t Status);
+static void BUS_StartNext(BSP_BUS_Id_t Bus);
+static void BUS_Complete(BSP_BUS_Id_t Bus, int32_t Status);
+static uint8_t BUS_CanWait(void);
+static void BUS_SpiComplete(SPI_HandleTypeDef *hspi, int32_t Status);
+static void BUS_I2cComplete(I2C_HandleTypeDef *hi2c, int32_t Status);
 
 /**
   * @}
@@ -396,16 +427,21 @@ int32_t BSP_I2C2_IsReady(void) {
   * @retval BSP status
   */
 int32_t BSP_I2C2_WriteReg(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16_t len) {
-  int32_t ret = BSP_ERROR_BUS_FAILURE;
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE,
+    .DevAddr = DevAddr,
+    .Reg = Reg,
+    .RegLen = 1U,
+    .pTxData = pData,
+    .Len = len
+  };
 
-  if(HAL_I2C_Mem_Write(&hi2c2, (uint8_t)DevAddr,
-                       (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT,
-                       (uint8_t *)pData, len, TIMEOUT_DURATION) == HAL_OK)
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
   {
-    ret = BSP_ERROR_NONE;
+    return BSP_ERROR_BUS_FAILURE;
   }
 
-  return ret;
+  return BSP_ERROR_NONE;
 }
 
 /**
@@ -415,16 +451,21 @@ int32_t BSP_I2C2_WriteReg(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16
   * @retval BSP status
   */
 int32_t  BSP_I2C2_ReadReg(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16_t len) {
-  int32_t ret = BSP_ERROR_BUS_FAILURE;
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_READ,
+    .DevAddr = DevAddr,
+    .Reg = Reg,
+    .RegLen = 1U,
+    .pRxData = pData,
+    .Len = len
+  };
 
-  if (HAL_I2C_Mem_Read(&hi2c2, DevAddr, (uint16_t)Reg,
-                       I2C_MEMADD_SIZE_8BIT, pData,
-                       len, TIMEOUT_DURATION) == HAL_OK)
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
   {
-    ret = (int32_t)HAL_OK;
+    return BSP_ERROR_BUS_FAILURE;
   }
 
-  return ret;
+  return (int32_t)HAL_OK;
 }
 
 /**
@@ -435,16 +476,21 @@ int32_t  BSP_I2C2_ReadReg(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16
   * @retval BSP status
   */
 int32_t BSP_I2C2_WriteReg16(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16_t len) {
-  int32_t ret = BSP_ERROR_BUS_FAILURE;
-  
-  if(HAL_I2C_Mem_Write(&hi2c2, (uint8_t)DevAddr,
-                       (uint16_t)Reg, I2C_MEMADD_SIZE_16BIT,
-                       (uint8_t *)pData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE,
+    .DevAddr = DevAddr,
+    .Reg = Reg,
+    .RegLen = 2U,
+    .pTxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
   {
-    ret = BSP_ERROR_NONE;
+    return BSP_ERROR_BUS_FAILURE;
   }
- 
-  return ret;
+
+  return BSP_ERROR_NONE;
 }
 
 /**
@@ -454,16 +500,21 @@ int32_t BSP_I2C2_WriteReg16(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint
   * @retval BSP status
   */
 int32_t  BSP_I2C2_ReadReg16(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16_t len) {
-  int32_t ret = BSP_ERROR_BUS_FAILURE;
-  
-  if (HAL_I2C_Mem_Read(&hi2c2, DevAddr, (uint16_t)Reg,
-                       I2C_MEMADD_SIZE_16BIT, pData,
-                       len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_READ,
+    .DevAddr = DevAddr,
+    .Reg = Reg,
+    .RegLen = 2U,
+    .pRxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
   {
-    ret = BSP_ERROR_NONE;
+    return BSP_ERROR_BUS_FAILURE;
   }
-  
-  return ret;
+
+  return BSP_ERROR_NONE;
 }
 
 /**
@@ -474,13 +525,19 @@ int32_t  BSP_I2C2_ReadReg16(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint
   * @retval BSP status
   */
 int32_t BSP_I2C2_Send(uint16_t DevAddr, uint8_t *pData, uint16_t len) {
-	int32_t ret = BSP_ERROR_BUS_FAILURE;
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE,
+    .DevAddr = DevAddr,
+    .pTxData = pData,
+    .Len = len
+  };
 
-	if (HAL_I2C_Master_Transmit (&hi2c2, DevAddr, pData, len, TIMEOUT_DURATION) == HAL_OK) {
-		ret = (int32_t)len;
-	}
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_BUS_FAILURE;
+  }
 
-	return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -491,13 +548,19 @@ int32_t BSP_I2C2_Send(uint16_t DevAddr, uint8_t *pData, uint16_t len) {
   * @retval BSP status
   */
 int32_t BSP_I2C2_Recv(uint16_t DevAddr, uint8_t *pData, uint16_t len) {
-	int32_t ret = BSP_ERROR_BUS_FAILURE;
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_READ,
+    .DevAddr = DevAddr,
+    .pRxData = pData,
+    .Len = len
+  };
 
-	if (HAL_I2C_Master_Receive (&hi2c2, DevAddr, pData, len, TIMEOUT_DURATION) == HAL_OK) {
-		ret = (int32_t)len;
-	}
+  if (BSP_BUS_Transfer(BSP_BUS_I2C2, &xfer) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_BUS_FAILURE;
+  }
 
-	return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -909,13 +972,17 @@ int32_t BSP_SPI2_DeInit(void)
   */
 int32_t BSP_SPI2_Send(uint8_t *pData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_Transmit(&hbusspi2, pData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE,
+    .pTxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI2, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -926,13 +993,17 @@ int32_t BSP_SPI2_Send(uint8_t *pData, uint16_t len)
   */
 int32_t BSP_SPI2_Recv(uint8_t *pData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_Receive(&hbusspi2, pData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_READ,
+    .pRxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI2, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -943,13 +1014,18 @@ int32_t BSP_SPI2_Recv(uint8_t *pData, uint16_t len)
   */
 int32_t BSP_SPI2_SendRecv(uint8_t *pTxData, uint8_t *pRxData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_TransmitReceive(&hbusspi2, pTxData, pRxData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE_READ,
+    .pTxData = pTxData,
+    .pRxData = pRxData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI2, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -1013,13 +1089,17 @@ int32_t BSP_SPI3_DeInit(void) {
   */
 int32_t BSP_SPI3_Send(uint8_t *pData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_Transmit(&hbusspi3, pData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE,
+    .pTxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -1030,13 +1110,17 @@ int32_t BSP_SPI3_Send(uint8_t *pData, uint16_t len)
   */
 int32_t  BSP_SPI3_Recv(uint8_t *pData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_Receive(&hbusspi3, pData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_READ,
+    .pRxData = pData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /**
@@ -1047,13 +1131,18 @@ int32_t  BSP_SPI3_Recv(uint8_t *pData, uint16_t len)
   */
 int32_t BSP_SPI3_SendRecv(uint8_t *pTxData, uint8_t *pRxData, uint16_t len)
 {
-  int32_t ret = BSP_ERROR_UNKNOWN_FAILURE;
-  
-  if(HAL_SPI_TransmitReceive(&hbusspi3, pTxData, pRxData, len, TIMEOUT_DURATION) == HAL_OK)
+  BSP_BUS_Xfer_t xfer = {
+    .Type = BSP_BUS_XFER_WRITE_READ,
+    .pTxData = pTxData,
+    .pRxData = pRxData,
+    .Len = len
+  };
+
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
-      ret = (int32_t)len;
+    return BSP_ERROR_UNKNOWN_FAILURE;
   }
-  return ret;
+  return (int32_t)len;
 }
 
 /* BUS IO driver over USART Peripheral */
@@ -1437,6 +1526,681 @@ int32_t BSP_GetTick(void) {
   return (int32_t)HAL_GetTick();
 }
 
+/*******************************************************************************
+                       ASYNCHRONOUS TRANSFERS OVER I2C2/SPI2/SPI3
+*******************************************************************************/
+/**
+  * @brief  Queue a transfer on a bus.
+  *         The transfer starts as soon as the bus is free, its payload is moved
+  *         by DMA (or by interrupts below BSP_BUS_DMA_MIN_LEN) and Callback is
+  *         invoked at the end. Buses are arbitrated independently, so transfers
+  *         on different buses overlap.
+  * @note   Transfers with CsPort == NULL leave the chip select to the caller:
+  *         submit them only from the context that owns that chip select
+  * @param  Bus: bus to use
+  * @param  Xfer: transfer descriptor, it must stay valid until Status != BSP_ERROR_BUSY
+  * @retval BSP status
+  */
+int32_t BSP_BUS_Submit(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer)
+{
+  BUS_Queue_t *pQueue;
+  uint32_t primask;
+
+  if ((Bus >= BSP_BUS_NUMBER) || (Xfer == NULL) || (Xfer->Len == 0U))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+
+  if ((Bus == BSP_BUS_I2C2) && (Xfer->Type == BSP_BUS_XFER_WRITE_READ))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+
+  pQueue = &BusQueue[Bus];
+  Xfer->Status = BSP_ERROR_BUSY;
+  Xfer->pNext = NULL;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (pQueue->pTail != NULL)
+  {
+    pQueue->pTail->pNext = Xfer;
+  }
+  else
+  {
+    pQueue->pHead = Xfer;
+  }
+  pQueue->pTail = Xfer;
+
+  BUS_StartNext(Bus);
+
+  __set_PRIMASK(primask);
+
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Wait the end of a submitted transfer.
+  *         On timeout the transfer is aborted and removed from the queue
+  * @note   The end of the transfer is signaled by the bus interrupts: with
+  *         interrupts masked, or from an interrupt that the buses cannot
+  *         preempt, nothing is waited and BSP_ERROR_BUSY is returned while the
+  *         transfer is still queued or running
+  * @param  Bus: bus used for the transfer
+  * @param  Xfer: transfer descriptor
+  * @param  Timeout: timeout in ms
+  * @retval BSP status of the transfer
+  */
+int32_t BSP_BUS_Wait(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer, uint32_t Timeout)
+{
+  BUS_Queue_t *pQueue = &BusQueue[Bus];
+  BSP_BUS_Xfer_t *pPrev;
+  BSP_BUS_Xfer_t *pCur;
+  uint32_t tickstart = HAL_GetTick();
+  uint32_t primask;
+
+  if (BUS_CanWait() == 0U)
+  {
+    return Xfer->Status;
+  }
+
+  while (Xfer->Status == BSP_ERROR_BUSY)
+  {
+    if ((HAL_GetTick() - tickstart) > Timeout)
+    {
+      primask = __get_PRIMASK();
+      __disable_irq();
+
+      if (pQueue->pActive == Xfer)
+      {
+        if (Bus == BSP_BUS_I2C2)
+        {
+          (void)HAL_DMA_Abort(&hdma_i2c2_rx);
+          (void)HAL_DMA_Abort(&hdma_i2c2_tx);
+          (void)HAL_I2C_DeInit(&hi2c2);
+          (void)BSP_I2C2_Init();
+        }
+        else
+        {
+          (void)HAL_SPI_Abort((Bus == BSP_BUS_SPI2) ? &hbusspi2 : &hbusspi3);
+        }
+        BUS_Finish(Bus, BSP_ERROR_BUS_FAILURE);
+        BUS_StartNext(Bus);
+      }
+      else if (Xfer->Status == BSP_ERROR_BUSY)
+      {
+        /* Still queued: unlink it */
+        pPrev = NULL;
+        pCur = pQueue->pHead;
+        while ((pCur != NULL) && (pCur != Xfer))
+        {
+          pPrev = pCur;
+          pCur = pCur->pNext;
+        }
+        if (pCur != NULL)
+        {
+          if (pPrev == NULL)
+          {
+            pQueue->pHead = pCur->pNext;
+          }
+          else
+          {
+            pPrev->pNext = pCur->pNext;
+          }
+          if (pQueue->pTail == pCur)
+          {
+            pQueue->pTail = pPrev;
+          }
+        }
+        Xfer->Status = BSP_ERROR_BUS_FAILURE;
+      }
+
+      __set_PRIMASK(primask);
+    }
+  }
+
+  return Xfer->Status;
+}
+
+/**
+  * @brief  Run a transfer and wait its end.
+  *         Short transfers on a free bus are executed in polling mode without
+  *         queueing, the others are queued and waited
+  * @note   Interrupts of lower priority than the buses (BSP_BUS_IRQ_PRIORITY)
+  *         wait in the queue like the thread mode. With interrupts masked, or
+  *         from an interrupt that the buses cannot preempt, the transfer is
+  *         executed in polling mode if the bus is free and BSP_ERROR_BUSY is
+  *         returned otherwise
+  * @param  Bus: bus to use
+  * @param  Xfer: transfer descriptor
+  * @retval BSP status
+  */
+int32_t BSP_BUS_Transfer(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer)
+{
+  BUS_Queue_t *pQueue;
+  uint32_t primask;
+  uint8_t canwait = BUS_CanWait();
+  int32_t ret;
+
+  if ((Bus >= BSP_BUS_NUMBER) || (Xfer == NULL))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+
+  pQueue = &BusQueue[Bus];
+  Xfer->Callback = NULL;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  if ((pQueue->pActive == NULL) && (pQueue->pHead == NULL) && (pQueue->Claimed == 0U) &&
+      ((Xfer->Len < BSP_BUS_DMA_MIN_LEN) || (canwait == 0U)))
+  {
+    pQueue->Claimed = 1U;
+    __set_PRIMASK(primask);
+
+    ret = BUS_Run(Bus, Xfer, 1U);
+
+    __disable_irq();
+    pQueue->Claimed = 0U;
+    BUS_StartNext(Bus);
+    __set_PRIMASK(primask);
+
+    return ret;
+  }
+
+  __set_PRIMASK(primask);
+
+  /* The bus interrupts cannot preempt the caller */
+  if (canwait == 0U)
+  {
+    return BSP_ERROR_BUSY;
+  }
+
+  ret = BSP_BUS_Submit(Bus, Xfer);
+  if (ret == BSP_ERROR_NONE)
+  {
+    ret = BSP_BUS_Wait(Bus, Xfer, TIMEOUT_DURATION);
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  Return the status of the asynchronous bus
+  * @param  Bus: bus to check
+  * @retval 1 if nothing is queued or running on the bus
+  */
+int32_t BSP_BUS_IsIdle(BSP_BUS_Id_t Bus)
+{
+  BUS_Queue_t *pQueue = &BusQueue[Bus];
+
+  return (int32_t)((pQueue->pActive == NULL) && (pQueue->pHead == NULL) && (pQueue->Claimed == 0U));
+}
+
+/**
+  * @brief  Start or execute a transfer on a SPI bus.
+  *         Started transfers send the command byte by interrupt first, the
+  *         payload is started from the completion of the command byte
+  * @param  Bus: bus of the SPI handle
+  * @param  hspi: SPI handle
+  * @param  Xfer: transfer descriptor
+  * @param  Poll: 1 for executing the transfer in polling mode
+  * @retval BSP status
+  */
+static int32_t BUS_SpiRun(BSP_BUS_Id_t Bus, SPI_HandleTypeDef *hspi, BSP_BUS_Xfer_t *Xfer, uint8_t Poll)
+{
+  BUS_Queue_t *pQueue = &BusQueue[Bus];
+  HAL_StatusTypeDef status = HAL_OK;
+  uint8_t cmd = (uint8_t)Xfer->Reg;
+
+  if (Xfer->CsPort != NULL)
+  {
+    HAL_GPIO_WritePin(Xfer->CsPort, Xfer->CsPin, GPIO_PIN_RESET);
+  }
+
+  if (Poll != 0U)
+  {
+    if (Xfer->RegLen != 0U)
+    {
+      status = HAL_SPI_Transmit(hspi, &cmd, 1U, TIMEOUT_DURATION);
+    }
+    if (status == HAL_OK)
+    {
+      status = BUS_SpiPayload(hspi, Xfer, 1U);
+    }
+  }
+  else if (Xfer->RegLen != 0U)
+  {
+    /* The command byte is too short for DMA */
+    pQueue->Cmd = cmd;
+    pQueue->CmdPhase = 1U;
+    status = HAL_SPI_Transmit_IT(hspi, &pQueue->Cmd, 1U);
+    if (status != HAL_OK)
+    {
+      pQueue->CmdPhase = 0U;
+    }
+  }
+  else
+  {
+    status = BUS_SpiPayload(hspi, Xfer, 0U);
+  }
+
+  if ((Xfer->CsPort != NULL) && ((Poll != 0U) || (status != HAL_OK)))
+  {
+    HAL_GPIO_WritePin(Xfer->CsPort, Xfer->CsPin, GPIO_PIN_SET);
+  }
+
+  return (status == HAL_OK) ? BSP_ERROR_NONE : BSP_ERROR_BUS_FAILURE;
+}
+
+/**
+  * @brief  Start or execute the payload of a SPI transfer
+  * @param  hspi: SPI handle
+  * @param  Xfer: transfer descriptor
+  * @param  Poll: 1 for executing the payload in polling mode
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef BUS_SpiPayload(SPI_HandleTypeDef *hspi, BSP_BUS_Xfer_t *Xfer, uint8_t Poll)
+{
+  HAL_StatusTypeDef status;
+  uint8_t dma = (Xfer->Len >= BSP_BUS_DMA_MIN_LEN) ? 1U : 0U;
+
+  switch (Xfer->Type)
+  {
+    case BSP_BUS_XFER_WRITE:
+      if (Poll != 0U)
+      {
+        status = HAL_SPI_Transmit(hspi, Xfer->pTxData, Xfer->Len, TIMEOUT_DURATION);
+      }
+      else
+      {
+        status = (dma != 0U) ? HAL_SPI_Transmit_DMA(hspi, Xfer->pTxData, Xfer->Len) :
+                               HAL_SPI_Transmit_IT(hspi, Xfer->pTxData, Xfer->Len);
+      }
+      break;
+
+    case BSP_BUS_XFER_READ:
+      if (Poll != 0U)
+      {
+        status = HAL_SPI_Receive(hspi, Xfer->pRxData, Xfer->Len, TIMEOUT_DURATION);
+      }
+      else
+      {
+        status = (dma != 0U) ? HAL_SPI_Receive_DMA(hspi, Xfer->pRxData, Xfer->Len) :
+                               HAL_SPI_Receive_IT(hspi, Xfer->pRxData, Xfer->Len);
+      }
+      break;
+
+    default:
+      if (Poll != 0U)
+      {
+        status = HAL_SPI_TransmitReceive(hspi, Xfer->pTxData, Xfer->pRxData, Xfer->Len, TIMEOUT_DURATION);
+      }
+      else
+      {
+        status = (dma != 0U) ? HAL_SPI_TransmitReceive_DMA(hspi, Xfer->pTxData, Xfer->pRxData, Xfer->Len) :
+                               HAL_SPI_TransmitReceive_IT(hspi, Xfer->pTxData, Xfer->pRxData, Xfer->Len);
+      }
+      break;
+  }
+
+  return status;
+}
+
+/**
+  * @brief  Start or execute a transfer on an I2C bus
+  * @param  hi2c: I2C handle
+  * @param  Xfer: transfer descriptor
+  * @param  Poll: 1 for executing the transfer in polling mode
+  * @retval BSP status
+  */
+static int32_t BUS_I2cRun(I2C_HandleTypeDef *hi2c, BSP_BUS_Xfer_t *Xfer, uint8_t Poll)
+{
+  HAL_StatusTypeDef status;
+  uint16_t memadd = (Xfer->RegLen == 2U) ? I2C_MEMADD_SIZE_16BIT : I2C_MEMADD_SIZE_8BIT;
+  uint8_t dma = (Xfer->Len >= BSP_BUS_DMA_MIN_LEN) ? 1U : 0U;
+
+  if (Xfer->Type == BSP_BUS_XFER_READ)
+  {
+    if (Xfer->RegLen == 0U)
+    {
+      status = (Poll != 0U) ? HAL_I2C_Master_Receive(hi2c, Xfer->DevAddr, Xfer->pRxData, Xfer->Len, TIMEOUT_DURATION) :
+               (dma != 0U)  ? HAL_I2C_Master_Receive_DMA(hi2c, Xfer->DevAddr, Xfer->pRxData, Xfer->Len) :
+                              HAL_I2C_Master_Receive_IT(hi2c, Xfer->DevAddr, Xfer->pRxData, Xfer->Len);
+    }
+    else
+    {
+      status = (Poll != 0U) ? HAL_I2C_Mem_Read(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pRxData, Xfer->Len, TIMEOUT_DURATION) :
+               (dma != 0U)  ? HAL_I2C_Mem_Read_DMA(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pRxData, Xfer->Len) :
+                              HAL_I2C_Mem_Read_IT(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pRxData, Xfer->Len);
+    }
+  }
+  else
+  {
+    if (Xfer->RegLen == 0U)
+    {
+      status = (Poll != 0U) ? HAL_I2C_Master_Transmit(hi2c, Xfer->DevAddr, Xfer->pTxData, Xfer->Len, TIMEOUT_DURATION) :
+               (dma != 0U)  ? HAL_I2C_Master_Transmit_DMA(hi2c, Xfer->DevAddr, Xfer->pTxData, Xfer->Len) :
+                              HAL_I2C_Master_Transmit_IT(hi2c, Xfer->DevAddr, Xfer->pTxData, Xfer->Len);
+    }
+    else
+    {
+      status = (Poll != 0U) ? HAL_I2C_Mem_Write(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pTxData, Xfer->Len, TIMEOUT_DURATION) :
+               (dma != 0U)  ? HAL_I2C_Mem_Write_DMA(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pTxData, Xfer->Len) :
+                              HAL_I2C_Mem_Write_IT(hi2c, Xfer->DevAddr, Xfer->Reg, memadd, Xfer->pTxData, Xfer->Len);
+    }
+  }
+
+  return (status == HAL_OK) ? BSP_ERROR_NONE : BSP_ERROR_BUS_FAILURE;
+}
+
+/**
+  * @brief  Start or execute a transfer on a bus
+  * @param  Bus: bus to use
+  * @param  Xfer: transfer descriptor
+  * @param  Poll: 1 for executing the transfer in polling mode
+  * @retval BSP status
+  */
+static int32_t BUS_Run(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer, uint8_t Poll)
+{
+  int32_t ret;
+
+  switch (Bus)
+  {
+    case BSP_BUS_I2C2:
+      ret = BUS_I2cRun(&hi2c2, Xfer, Poll);
+      break;
+    case BSP_BUS_SPI2:
+      ret = BUS_SpiRun(Bus, &hbusspi2, Xfer, Poll);
+      break;
+    case BSP_BUS_SPI3:
+      ret = BUS_SpiRun(Bus, &hbusspi3, Xfer, Poll);
+      break;
+    default:
+      ret = BSP_ERROR_WRONG_PARAM;
+      break;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  Release the bus from the running transfer and notify its owner.
+  *         Called with interrupts masked
+  * @param  Bus: bus of the transfer
+  * @param  Status: BSP status of the transfer
+  * @retval None
+  */
+static void BUS_Finish(BSP_BUS_Id_t Bus, int32_t Status)
+{
+  BSP_BUS_Xfer_t *pXfer = BusQueue[Bus].pActive;
+
+  BusQueue[Bus].pActive = NULL;
+  BusQueue[Bus].CmdPhase = 0U;
+
+  if (pXfer->CsPort != NULL)
+  {
+    HAL_GPIO_WritePin(pXfer->CsPort, pXfer->CsPin, GPIO_PIN_SET);
+  }
+
+  pXfer->Status = Status;
+
+  if (pXfer->Callback != NULL)
+  {
+    pXfer->Callback(pXfer);
+  }
+}
+
+/**
+  * @brief  Start the queued transfers while the bus is free.
+  *         Called with interrupts masked
+  * @param  Bus: bus to serve
+  * @retval None
+  */
+static void BUS_StartNext(BSP_BUS_Id_t Bus)
+{
+  BUS_Queue_t *pQueue = &BusQueue[Bus];
+
+  while ((pQueue->pActive == NULL) && (pQueue->Claimed == 0U) && (pQueue->pHead != NULL))
+  {
+    pQueue->pActive = pQueue->pHead;
+    pQueue->pHead = pQueue->pHead->pNext;
+    if (pQueue->pHead == NULL)
+    {
+      pQueue->pTail = NULL;
+    }
+
+    if (BUS_Run(Bus, pQueue->pActive, 0U) != BSP_ERROR_NONE)
+    {
+      BUS_Finish(Bus, BSP_ERROR_BUS_FAILURE);
+    }
+  }
+}
+
+/**
+  * @brief  End of the running transfer, from the HAL callbacks
+  * @param  Bus: bus of the transfer
+  * @param  Status: BSP status of the transfer
+  * @retval None
+  */
+static void BUS_Complete(BSP_BUS_Id_t Bus, int32_t Status)
+{
+  BUS_Queue_t *pQueue = &BusQueue[Bus];
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  if (pQueue->pActive != NULL)
+  {
+    if (pQueue->CmdPhase != 0U)
+    {
+      /* Command byte sent: go on with the payload in the same chip select window */
+      pQueue->CmdPhase = 0U;
+      if ((Status == BSP_ERROR_NONE) &&
+          (BUS_SpiPayload((Bus == BSP_BUS_SPI2) ? &hbusspi2 : &hbusspi3, pQueue->pActive, 0U) == HAL_OK))
+      {
+        __set_PRIMASK(primask);
+        return;
+      }
+      Status = BSP_ERROR_BUS_FAILURE;
+    }
+
+    BUS_Finish(Bus, Status);
+    BUS_StartNext(Bus);
+  }
+
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Check if the caller can wait the end of a queued transfer.
+  *         Waiting needs the bus interrupts and the tick to preempt the caller
+  * @retval 1 from thread mode or from an interrupt of lower priority than the
+  *         buses, 0 otherwise
+  */
+static uint8_t BUS_CanWait(void)
+{
+  uint32_t isr = __get_IPSR();
+  uint32_t basepri = __get_BASEPRI() >> (8U - __NVIC_PRIO_BITS);
+
+  if ((__get_PRIMASK() != 0U) || ((basepri != 0U) && (basepri <= BSP_BUS_IRQ_PRIORITY)))
+  {
+    return 0U;
+  }
+
+  if (isr == 0U)
+  {
+    return 1U;
+  }
+
+  return (NVIC_GetPriority((IRQn_Type)((int32_t)isr - 16)) > BSP_BUS_IRQ_PRIORITY) ? 1U : 0U;
+}
+
+/**
+  * @brief  Configure one DMA channel of an asynchronous bus
+  * @param  hdma: DMA handle
+  * @param  Channel: DMA channel
+  * @param  Request: DMAMUX request
+  * @param  Direction: DMA_PERIPH_TO_MEMORY or DMA_MEMORY_TO_PERIPH
+  * @param  IRQn: DMA channel interrupt
+  * @retval None
+  */
+static void BUS_DmaInit(DMA_HandleTypeDef *hdma, DMA_Channel_TypeDef *Channel,
+                        uint32_t Request, uint32_t Direction, IRQn_Type IRQn)
+{
+  __HAL_RCC_DMAMUX1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  hdma->Instance                 = Channel;
+  hdma->Init.Request             = Request;
+  hdma->Init.Direction           = Direction;
+  hdma->Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma->Init.MemInc              = DMA_MINC_ENABLE;
+  hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma->Init.Mode                = DMA_NORMAL;
+  hdma->Init.Priority            = DMA_PRIORITY_HIGH;
+  (void)HAL_DMA_Init(hdma);
+
+  HAL_NVIC_SetPriority(IRQn, BSP_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(IRQn);
+}
+
+/**
+  * @brief  End of a transfer on a SPI handle
+  * @param  hspi: SPI handle
+  * @param  Status: BSP status of the transfer
+  * @retval None
+  */
+static void BUS_SpiComplete(SPI_HandleTypeDef *hspi, int32_t Status)
+{
+  if (hspi == &hbusspi2)
+  {
+    BUS_Complete(BSP_BUS_SPI2, Status);
+  }
+  else if (hspi == &hbusspi3)
+  {
+    BUS_Complete(BSP_BUS_SPI3, Status);
+  }
+}
+
+/**
+  * @brief  End of a transfer on an I2C handle
+  * @param  hi2c: I2C handle
+  * @param  Status: BSP status of the transfer
+  * @retval None
+  */
+static void BUS_I2cComplete(I2C_HandleTypeDef *hi2c, int32_t Status)
+{
+  if (hi2c == &hi2c2)
+  {
+    BUS_Complete(BSP_BUS_I2C2, Status);
+  }
+}
+
+/**
+  * @brief  HAL callbacks routed to the bus queues
+  */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  BUS_SpiComplete(hspi, BSP_ERROR_NONE);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  BUS_SpiComplete(hspi, BSP_ERROR_NONE);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  BUS_SpiComplete(hspi, BSP_ERROR_NONE);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  BUS_SpiComplete(hspi, BSP_ERROR_BUS_FAILURE);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  BUS_I2cComplete(hi2c, BSP_ERROR_NONE);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  BUS_I2cComplete(hi2c, BSP_ERROR_NONE);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  BUS_I2cComplete(hi2c, BSP_ERROR_NONE);
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  BUS_I2cComplete(hi2c, BSP_ERROR_NONE);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  BUS_I2cComplete(hi2c, BSP_ERROR_BUS_FAILURE);
+}
+
+/**
+  * @brief  Interrupt handlers of the asynchronous buses
+  */
+void BSP_I2C2_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&hi2c2);
+}
+
+void BSP_I2C2_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&hi2c2);
+}
+
+void BSP_I2C2_DMA_RX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_i2c2_rx);
+}
+
+void BSP_I2C2_DMA_TX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_i2c2_tx);
+}
+
+void BSP_SPI2_IRQHandler(void)
+{
+  HAL_SPI_IRQHandler(&hbusspi2);
+}
+
+void BSP_SPI2_DMA_RX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi2_rx);
+}
+
+void BSP_SPI2_DMA_TX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi2_tx);
+}
+
+void BSP_SPI3_IRQHandler(void)
+{
+  HAL_SPI_IRQHandler(&hbusspi3);
+}
+
+void BSP_SPI3_DMA_RX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi3_rx);
+}
+
+void BSP_SPI3_DMA_TX_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_spi3_tx);
+}
+
 /* SPI1 init function */ 
 
 __weak HAL_StatusTypeDef MX_SPI1_Init(SPI_HandleTypeDef* hspi)
@@ -1556,6 +2320,17 @@ static void SPI2_MspInit(SPI_HandleTypeDef* spiHandle)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
   GPIO_InitStruct.Alternate = GPIO_AF5_SPI2;  
   HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+  /* DMA and interrupts for the asynchronous transfers */
+  BUS_DmaInit(&hdma_spi2_rx, BSP_SPI2_DMA_RX_CHANNEL, DMA_REQUEST_SPI2_RX,
+              DMA_PERIPH_TO_MEMORY, BSP_SPI2_DMA_RX_IRQn);
+  __HAL_LINKDMA(spiHandle, hdmarx, hdma_spi2_rx);
+  BUS_DmaInit(&hdma_spi2_tx, BSP_SPI2_DMA_TX_CHANNEL, DMA_REQUEST_SPI2_TX,
+              DMA_MEMORY_TO_PERIPH, BSP_SPI2_DMA_TX_IRQn);
+  __HAL_LINKDMA(spiHandle, hdmatx, hdma_spi2_tx);
+
+  HAL_NVIC_SetPriority(SPI2_IRQn, BSP_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(SPI2_IRQn);
 }
 
 static void SPI2_MspDeInit(SPI_HandleTypeDef* spiHandle)
@@ -1572,6 +2347,10 @@ static void SPI2_MspDeInit(SPI_HandleTypeDef* spiHandle)
   */
   HAL_GPIO_DeInit(GPIOD, GPIO_PIN_1|GPIO_PIN_3);
   HAL_GPIO_DeInit(GPIOC, GPIO_PIN_3);
+
+  HAL_NVIC_DisableIRQ(SPI2_IRQn);
+  (void)HAL_DMA_DeInit(&hdma_spi2_rx);
+  (void)HAL_DMA_DeInit(&hdma_spi2_tx);
 }
 
 /* SPI3 init function */
@@ -1622,6 +2401,17 @@ static void SPI3_MspInit(SPI_HandleTypeDef* spiHandle)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
   GPIO_InitStruct.Alternate = GPIO_AF6_SPI3;
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  /* DMA and interrupts for the asynchronous transfers */
+  BUS_DmaInit(&hdma_spi3_rx, BSP_SPI3_DMA_RX_CHANNEL, DMA_REQUEST_SPI3_RX,
+              DMA_PERIPH_TO_MEMORY, BSP_SPI3_DMA_RX_IRQn);
+  __HAL_LINKDMA(spiHandle, hdmarx, hdma_spi3_rx);
+  BUS_DmaInit(&hdma_spi3_tx, BSP_SPI3_DMA_TX_CHANNEL, DMA_REQUEST_SPI3_TX,
+              DMA_MEMORY_TO_PERIPH, BSP_SPI3_DMA_TX_IRQn);
+  __HAL_LINKDMA(spiHandle, hdmatx, hdma_spi3_tx);
+
+  HAL_NVIC_SetPriority(SPI3_IRQn, BSP_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(SPI3_IRQn);
 }
 
 static void SPI3_MspDeInit(SPI_HandleTypeDef* spiHandle)
@@ -1635,6 +2425,10 @@ static void SPI3_MspDeInit(SPI_HandleTypeDef* spiHandle)
   PB5     ------> SPI3_MOSI
   */
   HAL_GPIO_DeInit(GPIOB, GPIO_PIN_3|GPIO_PIN_5);
+
+  HAL_NVIC_DisableIRQ(SPI3_IRQn);
+  (void)HAL_DMA_DeInit(&hdma_spi3_rx);
+  (void)HAL_DMA_DeInit(&hdma_spi3_tx);
 }
 
 /* I2C2 init function */ 
@@ -1770,6 +2564,14 @@ static void I2C2_MspInit(I2C_HandleTypeDef* i2cHandle)
   /* Enable and set I2C_STWIN Interrupt to the highest priority */
   HAL_NVIC_SetPriority(I2C2_ER_IRQn, 0, 0);
   HAL_NVIC_EnableIRQ(I2C2_ER_IRQn);
+
+  /* DMA for the asynchronous transfers */
+  BUS_DmaInit(&hdma_i2c2_rx, BSP_I2C2_DMA_RX_CHANNEL, DMA_REQUEST_I2C2_RX,
+              DMA_PERIPH_TO_MEMORY, BSP_I2C2_DMA_RX_IRQn);
+  __HAL_LINKDMA(i2cHandle, hdmarx, hdma_i2c2_rx);
+  BUS_DmaInit(&hdma_i2c2_tx, BSP_I2C2_DMA_TX_CHANNEL, DMA_REQUEST_I2C2_TX,
+              DMA_MEMORY_TO_PERIPH, BSP_I2C2_DMA_TX_IRQn);
+  __HAL_LINKDMA(i2cHandle, hdmatx, hdma_i2c2_tx);
 }
 
 static void I2C2_MspDeInit(I2C_HandleTypeDef* i2cHandle)
@@ -1784,6 +2586,9 @@ static void I2C2_MspDeInit(I2C_HandleTypeDef* i2cHandle)
     PF0     ------> I2C2_SDA 
     */
     HAL_GPIO_DeInit(GPIOF, GPIO_PIN_1|GPIO_PIN_0);
+
+    (void)HAL_DMA_DeInit(&hdma_i2c2_rx);
+    (void)HAL_DMA_DeInit(&hdma_i2c2_tx);
 }
 
 
@@ -48,6 +48,65 @@ typedef struct
   pSPI_CallbackTypeDef  pMspSpiDeInitCb;
 }BSP_SPI_Cb_t;
 #endif /* (USE_HAL_SPI_REGISTER_CALLBACKS == 1) */
+
+/* Asynchronous bus transfers ------------------------------------------------*/
+/* Payloads shorter than this run on interrupts instead of DMA */
+#define BSP_BUS_DMA_MIN_LEN              8U
+#define BSP_BUS_IRQ_PRIORITY             1U
+
+/* DMAMUX routing of the asynchronous buses.
+   The DMA2 channel IRQ handlers must call the matching BSP_xxx_DMA_xx_IRQHandler */
+#define BSP_SPI3_DMA_RX_CHANNEL          DMA2_Channel1
+#define BSP_SPI3_DMA_RX_IRQn             DMA2_Channel1_IRQn
+#define BSP_SPI3_DMA_TX_CHANNEL          DMA2_Channel2
+#define BSP_SPI3_DMA_TX_IRQn             DMA2_Channel2_IRQn
+#define BSP_SPI2_DMA_RX_CHANNEL          DMA2_Channel3
+#define BSP_SPI2_DMA_RX_IRQn             DMA2_Channel3_IRQn
+#define BSP_SPI2_DMA_TX_CHANNEL          DMA2_Channel4
+#define BSP_SPI2_DMA_TX_IRQn             DMA2_Channel4_IRQn
+#define BSP_I2C2_DMA_RX_CHANNEL          DMA2_Channel5
+#define BSP_I2C2_DMA_RX_IRQn             DMA2_Channel5_IRQn
+#define BSP_I2C2_DMA_TX_CHANNEL          DMA2_Channel6
+#define BSP_I2C2_DMA_TX_IRQn             DMA2_Channel6_IRQn
+
+/* Buses served by the transfer queues */
+typedef enum
+{
+  BSP_BUS_I2C2 = 0,  /* HTS221, LPS22HH, IIS2MDC */
+  BSP_BUS_SPI2,      /* BlueNRG-2 */
+  BSP_BUS_SPI3,      /* ISM330DHCX, IIS2DH, IIS3DWB */
+  BSP_BUS_NUMBER
+} BSP_BUS_Id_t;
+
+typedef enum
+{
+  BSP_BUS_XFER_WRITE = 0,  /* Reg (if any) then pTxData */
+  BSP_BUS_XFER_READ,       /* Reg (if any) then pRxData */
+  BSP_BUS_XFER_WRITE_READ  /* SPI only: pTxData and pRxData clocked together */
+} BSP_BUS_XferType_t;
+
+typedef struct BSP_BUS_Xfer_s BSP_BUS_Xfer_t;
+
+/* Completion callback: runs in interrupt context with interrupts masked */
+typedef void (*BSP_BUS_XferCb_t)(BSP_BUS_Xfer_t *Xfer);
+
+/* Transfer descriptor, owned by the caller until Status leaves BSP_ERROR_BUSY */
+struct BSP_BUS_Xfer_s
+{
+  BSP_BUS_XferType_t Type;
+  uint16_t DevAddr;             /* I2C device address */
+  uint16_t Reg;                 /* Register address or SPI command byte */
+  uint8_t RegLen;               /* 0 no register phase, 1 8 bit, 2 16 bit (I2C only) */
+  GPIO_TypeDef *CsPort;         /* SPI chip select driven by the bus, NULL if driven by the caller */
+  uint16_t CsPin;
+  uint8_t *pTxData;
+  uint8_t *pRxData;
+  uint16_t Len;
+  BSP_BUS_XferCb_t Callback;    /* May be NULL */
+  void *pUser;
+  volatile int32_t Status;      /* BSP_ERROR_BUSY while queued or running */
+  BSP_BUS_Xfer_t *pNext;
+};
  
 
 /* BUS IO driver over I2C Peripheral */
@@ -103,6 +162,22 @@ int32_t BSP_USART3_DeInit(void);
 
 int32_t BSP_GetTick(void);
 
+/* Asynchronous bus transfers */
+int32_t BSP_BUS_Submit(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer);
+int32_t BSP_BUS_Wait(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer, uint32_t Timeout);
+int32_t BSP_BUS_Transfer(BSP_BUS_Id_t Bus, BSP_BUS_Xfer_t *Xfer);
+int32_t BSP_BUS_IsIdle(BSP_BUS_Id_t Bus);
+void BSP_I2C2_EV_IRQHandler(void);
+void BSP_I2C2_ER_IRQHandler(void);
+void BSP_I2C2_DMA_RX_IRQHandler(void);
+void BSP_I2C2_DMA_TX_IRQHandler(void);
+void BSP_SPI2_IRQHandler(void);
+void BSP_SPI2_DMA_RX_IRQHandler(void);
+void BSP_SPI2_DMA_TX_IRQHandler(void);
+void BSP_SPI3_IRQHandler(void);
+void BSP_SPI3_DMA_RX_IRQHandler(void);
+void BSP_SPI3_DMA_TX_IRQHandler(void);
+
 #if (USE_HAL_SPI_REGISTER_CALLBACKS == 1)
 int32_t BSP_SPI1_RegisterDefaultMspCallbacks (void);
 int32_t BSP_SPI1_RegisterMspCallbacks (BSP_SPI_Cb_t *Callbacks);
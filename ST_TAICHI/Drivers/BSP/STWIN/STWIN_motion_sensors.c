@@ -763,28 +763,27 @@ static int32_t BSP_IIS2DH_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata,
   UNUSED(Addr);
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_WRITE};
 
   if (len > 1U)
   {
     dataReg |= 0x40U;
   }
   
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_IIS2DH_CS_PORT, BSP_IIS2DH_CS_PIN, GPIO_PIN_RESET);
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_IIS2DH_CS_PORT;
+  xfer.CsPin = BSP_IIS2DH_CS_PIN;
+  xfer.pTxData = pdata;
+  xfer.pRxData = NULL;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  if (BSP_SPI3_Send(pdata, len) != (int32_t)len)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
-
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_IIS2DH_CS_PORT, BSP_IIS2DH_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 
@@ -793,6 +792,7 @@ static int32_t BSP_IIS2DH_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, u
   UNUSED(Addr);
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_READ};
 
   dataReg |= 0x80U;
   
@@ -801,22 +801,20 @@ static int32_t BSP_IIS2DH_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, u
     dataReg |= 0x40U;
   }
 
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_IIS2DH_CS_PORT, BSP_IIS2DH_CS_PIN, GPIO_PIN_RESET);
-
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_IIS2DH_CS_PORT;
+  xfer.CsPin = BSP_IIS2DH_CS_PIN;
+  xfer.pTxData = NULL;
+  xfer.pRxData = pdata;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Recv(pdata, len) != (int32_t)len)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_IIS2DH_CS_PORT, BSP_IIS2DH_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 #endif
@@ -1061,23 +1059,22 @@ static int32_t BSP_IIS3DWB_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata,
 {
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_WRITE};
 
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_IIS3DWB_CS_PORT, BSP_IIS3DWB_CS_PIN, GPIO_PIN_RESET);
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_IIS3DWB_CS_PORT;
+  xfer.CsPin = BSP_IIS3DWB_CS_PIN;
+  xfer.pTxData = pdata;
+  xfer.pRxData = NULL;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  if (BSP_SPI3_Send(pdata, len) != len)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
-
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_IIS3DWB_CS_PORT, BSP_IIS3DWB_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 
@@ -1085,25 +1082,24 @@ static int32_t BSP_IIS3DWB_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata,
 {
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_READ};
 
   dataReg |= 0x80;
 
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_IIS3DWB_CS_PORT, BSP_IIS3DWB_CS_PIN, GPIO_PIN_RESET);
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_IIS3DWB_CS_PORT;
+  xfer.CsPin = BSP_IIS3DWB_CS_PIN;
+  xfer.pTxData = NULL;
+  xfer.pRxData = pdata;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  if (BSP_SPI3_Recv(pdata, len) != len)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
-
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_IIS3DWB_CS_PORT, BSP_IIS3DWB_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 #endif
@@ -1231,23 +1227,22 @@ static int32_t BSP_ISM330DHCX_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pda
   UNUSED(Addr);
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_WRITE};
 
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_ISM330DHCX_CS_PORT, BSP_ISM330DHCX_CS_PIN, GPIO_PIN_RESET);
-
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_ISM330DHCX_CS_PORT;
+  xfer.CsPin = BSP_ISM330DHCX_CS_PIN;
+  xfer.pTxData = pdata;
+  xfer.pRxData = NULL;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Send(pdata, len) != (int32_t)len)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_ISM330DHCX_CS_PORT, BSP_ISM330DHCX_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 
@@ -1256,25 +1251,24 @@ static int32_t BSP_ISM330DHCX_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdat
   UNUSED(Addr);
   int32_t ret = BSP_ERROR_NONE;
   uint8_t dataReg = (uint8_t)Reg;
+  BSP_BUS_Xfer_t xfer = {.Type = BSP_BUS_XFER_READ};
 
   dataReg |= 0x80U;
 
-  /* CS Enable */
-  HAL_GPIO_WritePin(BSP_ISM330DHCX_CS_PORT, BSP_ISM330DHCX_CS_PIN, GPIO_PIN_RESET);
+  /* Command and data in the same chip select window */
+  xfer.Reg = dataReg;
+  xfer.RegLen = 1U;
+  xfer.CsPort = BSP_ISM330DHCX_CS_PORT;
+  xfer.CsPin = BSP_ISM330DHCX_CS_PIN;
+  xfer.pTxData = NULL;
+  xfer.pRxData = pdata;
+  xfer.Len = len;
 
-  if (BSP_SPI3_Send(&dataReg, 1) != 1)
+  if (BSP_BUS_Transfer(BSP_BUS_SPI3, &xfer) != BSP_ERROR_NONE)
   {
     ret = BSP_ERROR_UNKNOWN_FAILURE;
   }
 
-  if (BSP_SPI3_Recv(pdata, len) != (int32_t)len)
-  {
-    ret = BSP_ERROR_UNKNOWN_FAILURE;
-  }
-
-  /* CS Disable */
-  HAL_GPIO_WritePin(BSP_ISM330DHCX_CS_PORT, BSP_ISM330DHCX_CS_PIN, GPIO_PIN_SET);
-
   return ret;
 }
 #endif
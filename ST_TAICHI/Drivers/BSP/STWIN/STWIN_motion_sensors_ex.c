@@ -468,6 +468,40 @@ int32_t BSP_MOTION_SENSOR_FIFO_Get_Data_Word(uint32_t Instance,
   return ret;
 }
 
+/**
+ * @brief  Read a block of tagged FIFO words with a single bus transfer
+ * @param  Instance the device instance
+ * @param  pBuff the buffer to be filled with NumWords tagged words (7 bytes each)
+ * @param  NumWords number of FIFO words to read
+ * @retval BSP status
+ */
+int32_t BSP_MOTION_SENSOR_FIFO_Read_Block(uint32_t Instance, uint8_t *pBuff, uint16_t NumWords)
+{
+  int32_t ret;
+
+  switch (Instance)
+  {
+#if (USE_MOTION_SENSOR_ISM330DHCX_0 == 1)
+    case ISM330DHCX_0:
+      if (ISM330DHCX_FIFO_Read_Block(MotionCompObj[Instance], pBuff, NumWords) != BSP_ERROR_NONE)
+      {
+        ret = BSP_ERROR_COMPONENT_FAILURE;
+      }
+      else
+      {
+        ret = BSP_ERROR_NONE;
+      }
+      break;
+#endif
+
+    default:
+      ret = BSP_ERROR_WRONG_PARAM;
+      break;
+  }
+
+  return ret;
+}
+
 
 /**
  * @brief  Enable the wake up detection (available only for IIS2DH sensor)
@@ -79,6 +79,7 @@ int32_t BSP_MOTION_SENSOR_FIFO_Set_INT2_FIFO_Full(uint32_t Instance, uint8_t Sta
 int32_t BSP_MOTION_SENSOR_FIFO_Set_Watermark_Level(uint32_t Instance, uint16_t Watermark);
 int32_t BSP_MOTION_SENSOR_FIFO_Set_Stop_On_Fth(uint32_t Instance, uint8_t Status);
 int32_t BSP_MOTION_SENSOR_FIFO_Get_Data_Word(uint32_t Instance, uint32_t Function, int16_t *Data);
+int32_t BSP_MOTION_SENSOR_FIFO_Read_Block(uint32_t Instance, uint8_t *pBuff, uint16_t NumWords);
 int32_t BSP_MOTION_SENSOR_FIFO_Get_Num_Samples(uint32_t Instance, uint16_t *NumSamples);
 
 #if (USE_MOTION_SENSOR_IIS3DWB_0 == 1)
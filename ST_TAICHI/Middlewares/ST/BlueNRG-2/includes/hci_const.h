@@ -20,7 +20,9 @@
  * Maximum payload of HCI commands that can be sent. Change this value if needed.
  * This value can be up to 255.
  */
+#ifndef HCI_MAX_PAYLOAD_SIZE
 #define HCI_MAX_PAYLOAD_SIZE 128
+#endif
 
 /* HCI Packet types */
 #define HCI_COMMAND_PKT		0x01
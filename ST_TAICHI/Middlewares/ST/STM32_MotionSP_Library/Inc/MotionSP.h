@@ -93,11 +93,20 @@ typedef enum
   TD_BOTH_TAU   = (uint16_t)0x02, //!< Time Domain ANALYSIS: Speed and both RMS Moving AVERAGE TAU
 } Td_Type_t;
 
+/**
+  * @brief  Accelerometer sample stored inside the circular buffer
+  */
+#ifdef MOTIONSP_USE_Q15
+typedef q15_t MotionSP_Sample_t;      //!< Acceleration without DC in sensor LSB (see MotionSP_Context_t SampleScale)
+#else /* MOTIONSP_USE_Q15 */
+typedef float MotionSP_Sample_t;      //!< Acceleration without DC in m/s^2
+#endif /* MOTIONSP_USE_Q15 */
+
 typedef struct
 {
-  float AXIS_X[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing X accelero values
-  float AXIS_Y[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing Y accelero values
-  float AXIS_Z[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing Z accelero values
+  MotionSP_Sample_t AXIS_X[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing X accelero values
+  MotionSP_Sample_t AXIS_Y[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing Y accelero values
+  MotionSP_Sample_t AXIS_Z[CIRC_BUFFER_SIZE_MAX];   //!< Circular arrays for storing Z accelero values
 } sAccAxesCircBufferData_t;
 
 /**
@@ -157,6 +166,11 @@ typedef struct
 #ifdef USE_SUBRANGE  
   uint16_t subrange_num;  //!< Number of Subrange to evaluate FFT threshold
 #endif /* USE_SUBRANGE */
+#ifdef MOTIONSP_USE_ENVELOPE
+  uint16_t env_band_low;  //!< Low cut-off of the envelope band-pass in Hz
+  uint16_t env_band_high; //!< High cut-off of the envelope band-pass in Hz
+  uint16_t env_dec;       //!< Decimation factor of the envelope
+#endif /* MOTIONSP_USE_ENVELOPE */
 } sMotionSP_Parameter_t;
 
 /**
@@ -169,6 +183,18 @@ typedef struct
   float AXIS_Z;         //!< Generic Z Value in float
 } SensorVal_f_t;
 
+#ifdef MOTIONSP_USE_Q15
+/**
+  * @brief  X-Y-Z Generic Value in Q15
+  */
+typedef struct
+{
+  q15_t AXIS_X;         //!< Generic X Value in Q15
+  q15_t AXIS_Y;         //!< Generic Y Value in Q15
+  q15_t AXIS_Z;         //!< Generic Z Value in Q15
+} SensorVal_q15_t;
+#endif /* MOTIONSP_USE_Q15 */
+
 /**
   * @brief  Structure for actual accelero ODR info
   */
@@ -201,6 +227,29 @@ typedef struct
   SensorVal_f_t Speed_noDC; //!< X-Y-Z Speed from acceleration without DC
 } sTimeDomainData_t;
 
+/**
+  * @brief  Time domain block engine state of one axis
+  */
+typedef struct
+{
+  float AccPre;         //!< Last acceleration of the previous block
+  float Speed;          //!< Speed integrated from the acceleration
+  float SpeedPre;       //!< Last speed at the input of the DC filter
+  float SpeedNoDC;      //!< Speed without DC
+  float SpeedMs;        //!< Moving mean square of the speed without DC
+  float AccMs;          //!< Moving mean square of the acceleration
+} sTdAxisState_t;
+
+/**
+  * @brief  Time domain block engine state
+  */
+typedef struct
+{
+  sTdAxisState_t Axis[NUM_AXES];  //!< X-Y-Z state
+  float WN;                       //!< Weight of the moving RMS filters, 1/WN is the gain of the new sample
+  uint8_t WnSteady;               //!< WN has reached its steady value
+} sTdBlockState_t;
+
 /**
   * @brief  Board Parameters structure for storing in MCU flash
   */
@@ -285,6 +334,171 @@ typedef struct {
 } sSubrange_t; 
 #endif /* USE_SUBRANGE */
 
+#ifdef MOTIONSP_USE_SDFT
+#ifndef USE_SUBRANGE
+#error "MOTIONSP_USE_SDFT needs USE_SUBRANGE in MotionSP_Config.h"
+#endif /* USE_SUBRANGE */
+#if (SDFT_BLOCK_LEN > TD_BLOCK_LEN)
+#error "SDFT_BLOCK_LEN must not be greater than TD_BLOCK_LEN in MotionSP_Config.h"
+#endif /* SDFT_BLOCK_LEN > TD_BLOCK_LEN */
+
+/**
+  * @brief  Sliding DFT of one axis: the peak bin of each subrange with its two neighbours,
+  *         needed to apply the window in the frequency domain
+  */
+typedef struct
+{
+  uint16_t Bin[SDFT_SUBRANGE_MAX];      //!< Bin followed in each subrange
+  float Cos[SDFT_SUBRANGE_MAX][3];      //!< Damped twiddle of bins Bin-1, Bin and Bin+1, real part
+  float Sin[SDFT_SUBRANGE_MAX][3];      //!< Damped twiddle of bins Bin-1, Bin and Bin+1, imaginary part
+  float Re[SDFT_SUBRANGE_MAX][3];       //!< DFT of bins Bin-1, Bin and Bin+1, real part
+  float Im[SDFT_SUBRANGE_MAX][3];       //!< DFT of bins Bin-1, Bin and Bin+1, imaginary part
+} sSdftAxis_t;
+
+/**
+  * @brief  Sliding DFT over the last FftSize samples of the circular buffer
+  */
+typedef struct
+{
+  sSdftAxis_t Axis[NUM_AXES];   //!< X-Y-Z bins
+  uint16_t SubrangeNum;         //!< Number of subranges followed, 0 if no bin is followed
+  uint16_t FftSize;             //!< Number of samples inside the DFT
+  uint32_t SampleCnt;           //!< Samples added since the reset, the DFT is complete after FftSize samples
+  float DampingN;               //!< SDFT_DAMPING^FftSize, weight of the sample leaving the DFT
+  float WinA0;                  //!< Window coefficient of the bin
+  float WinA1;                  //!< Window coefficient of the two neighbours
+  float Scale;                  //!< From the windowed DFT to the amplitude of the averaged FFT
+} sSdft_t;
+#endif /* MOTIONSP_USE_SDFT */
+
+#ifdef MOTIONSP_USE_ENVELOPE
+#if ((ENV_BLOCK_LEN % ENV_DEC_MAX) != 0)
+#error "ENV_DEC_MAX must divide ENV_BLOCK_LEN in MotionSP_Config.h"
+#endif /* ENV_BLOCK_LEN % ENV_DEC_MAX */
+
+#define ENV_BP_STAGES         2             //!< Biquad stages of the envelope band-pass: high-pass and low-pass
+
+/**
+  * @brief  Envelope (demodulation) analysis: band-pass, full wave rectification,
+  *         low-pass and decimation, then the FFT average of the decimated envelope
+  */
+typedef struct
+{
+  arm_biquad_casd_df1_inst_f32 BandPass[NUM_AXES];          //!< X-Y-Z band-pass instances
+  float BandPassCoeffs[5 * ENV_BP_STAGES];                  //!< Band-pass coefficients, shared by the axes
+  float BandPassState[NUM_AXES][4 * ENV_BP_STAGES];         //!< X-Y-Z band-pass state
+  arm_fir_decimate_instance_f32 Decim[NUM_AXES];            //!< X-Y-Z low-pass and decimation instances
+  float DecimCoeffs[ENV_LPF_TAPS_MAX];                      //!< Low-pass coefficients, shared by the axes
+  float DecimState[NUM_AXES][ENV_LPF_TAPS_MAX + ENV_BLOCK_LEN - 1]; //!< X-Y-Z low-pass state
+  float Rect[NUM_AXES][ENV_BLOCK_LEN];                      //!< X-Y-Z rectified samples waiting for the decimation
+  float Frame[NUM_AXES][ENV_FFT_SIZE];                      //!< X-Y-Z decimated envelope waiting for the FFT
+  float Window[ENV_FFT_SIZE];                               //!< Hanning window of the envelope FFT
+  float Tmp[ENV_BLOCK_LEN];                                 //!< Block scratch array
+  float FftIn[ENV_FFT_SIZE];                                //!< Windowed envelope of one axis
+  float FftOut[ENV_FFT_SIZE];                               //!< Complex FFT output of one axis
+  arm_rfft_fast_instance_f32 fftS;                          //!< Envelope RFFT instance
+  float AvgMag[NUM_AXES][ENV_MAG_SIZE];                     //!< X-Y-Z envelope spectrum, amplitude in m/s^2 when done
+  sAxesMagResults_t MagResults;                             //!< Peaks of the envelope spectrum
+  float Frequency;                                          //!< Sampling frequency of the decimated envelope [Hz]
+  float Scale;                                              //!< From the sum of the FFT magnitudes to the envelope amplitude
+  uint16_t RectCnt;                                         //!< Rectified samples inside Rect
+  uint16_t FrameCnt;                                        //!< Envelope samples inside Frame
+  uint16_t SumCnt;                                          //!< Spectra inside AvgMag
+  uint8_t IsEnabled;                                        //!< The band-pass and the decimation fit the accelerometer ODR
+} sEnvelope_t;
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+/**
+  * @brief  Filter state and scratch arrays of a MotionSP context, private to the library
+  */
+typedef struct
+{
+  SensorVal_f_t AccDstPre;                    //!< Previous output of the accelerometer DC filter
+  SensorVal_f_t AccSrcPre;                    //!< Previous input of the accelerometer DC filter
+#ifdef MOTIONSP_USE_Q15
+  q31_t AccDstPre_q15[NUM_AXES];              //!< Previous output of the fixed point accelerometer DC filter
+  q15_t AccSrcPre_q15[NUM_AXES];              //!< Previous input of the fixed point accelerometer DC filter
+#endif /* MOTIONSP_USE_Q15 */
+  SensorVal_f_t Speed;                        //!< Speed integrated by MotionSP_TimeDomainProcess
+  SensorVal_f_t SpeedPre;                     //!< Previous integrated speed
+  SensorVal_f_t SpeedNoDC;                    //!< Speed without DC of MotionSP_TimeDomainProcess
+  SensorVal_f_t SpeedDstPre;                  //!< Previous output of the speed DC filter
+  SensorVal_f_t SpeedSrcPre;                  //!< Previous input of the speed DC filter
+  float SpeedWN;                              //!< Weight of the speed moving RMS filter
+  float AccWN;                                //!< Weight of the accelerometer moving RMS filter
+  sTdBlockState_t TdProcess;                  //!< Block engine state of MotionSP_TimeDomainProcessBlock
+  sTdBlockState_t TdEval;                     //!< Block engine state of MotionSP_TimeDomainEvalFromCircBuff
+  float TdAcc[NUM_AXES][TD_BLOCK_LEN];        //!< X-Y-Z accelerations of the time domain block in m/s^2
+  float TdTmp[TD_BLOCK_LEN];                  //!< Time domain block scratch array
+  float TdTmp2[TD_BLOCK_LEN];                 //!< Time domain block scratch array
+  float TdGain[TD_BLOCK_LEN];                 //!< Gain of each block sample in the moving RMS filters
+  union
+  {
+    struct
+    {
+      sAccAxesArray_t In;                     //!< Windowed X-Y-Z input values of the fused FFT pass (24 KB at 2048 points)
+      float Cmplx[FFT_SIZE_MAX];              //!< Complex FFT output
+      float Mag[FFT_SIZE_MAX];                //!< FFT magnitude
+    } f32;
+    struct
+    {
+      q31_t In[FFT_SIZE_MAX];                 //!< Windowed input values of one axis, then its magnitude
+      q31_t Out[2 * FFT_SIZE_MAX];            //!< Complex Q31 RFFT output
+    } q31;
+  } Fft;                                      //!< FFT scratch arrays, used only inside a single call
+  uint16_t FftCnt[NUM_AXES];                  //!< Sum counter of MotionSP_fftExecution
+  uint8_t FftAvgRdy[NUM_AXES];                //!< MotionSP_fftExecution average has been done
+#ifdef MOTIONSP_USE_SDFT
+  sSdft_t Sdft;                               //!< Sliding DFT of the subrange peak bins
+#endif /* MOTIONSP_USE_SDFT */
+} sMotionSP_State_t;
+
+/**
+  * @brief  MotionSP context: parameters, results and state of the analysis of one accelerometer stream
+  *         Each context is independent, the library functions can run on different contexts in parallel
+  */
+typedef struct
+{
+  sMotionSP_Parameter_t Parameters;           //!< Algorithm Parameters
+  sAcceleroODR_t AcceleroODR;                 //!< Real Accelerometer ODR evaluated
+  sCircBuffer_t AccCircBuffer;                //!< Circular buffer for storing input values for FFT
+  uint16_t accCircBuffIndexForFft;            //!< Position index in circular buffer to perform FFT
+  uint16_t magSize;                           //!< to store the actual size of the FFT magnitude elements
+  uint8_t FinishAvgFlag;                      //!< Flag to monitor the FFT Timing
+  uint8_t fftIsEnabled;                       //!< Flag to enable FFT computation
+  arm_rfft_fast_instance_f32 fftS;            //!< Instance structure for the floating-point RFFT/RIFFT function
+  float Filter_Params[FFT_SIZE_MAX];          //!< Array of window filter parameters
+  float Window_Scale_Factor;                  //!< Scale factor to correct amplitude
+  float Window_PowerSum;                      //!< Sum of the squared window coefficients
+  float Window_Enbw;                          //!< Equivalent noise bandwidth of the window in bins
+  uint16_t WindowSize;                        //!< Size of the window inside Filter_Params, 0 if not computed yet
+  uint16_t WindowType;                        //!< Type of the window inside Filter_Params
+#ifdef MOTIONSP_USE_Q15
+  float SampleScale;                          //!< m/s^2 for each LSB of the circular buffer samples
+  q15_t Filter_Params_q15[FFT_SIZE_MAX];      //!< Array of window filter parameters in Q15
+  arm_rfft_instance_q31 fftS_q31;             //!< Instance structure for the Q31 RFFT function
+#endif /* MOTIONSP_USE_Q15 */
+  sAcceleroParam_t TimeDomain;                //!< Time Domain Structure with parameters to use
+  sSumCnt_t AccSumCnt;                        //!< Sum counter for FFT during averaging
+#ifdef MOTIONSP_USE_PSD
+  sAxesMagBuff_t AccAxesAvgMagBuff;           //!< Array for storing accelerometer power spectral density in g^2/Hz (Welch)
+#else /* MOTIONSP_USE_PSD */
+  sAxesMagBuff_t AccAxesAvgMagBuff;           //!< Array for storing accelerometer magnitude average values
+#endif /* MOTIONSP_USE_PSD */
+  sAxesMagResults_t AccAxesMagResults;        //!< Peaks of the FFT average
+#ifdef USE_SUBRANGE
+  sSubrange_t SRAmplitude;                    //!< X-Y-Z Threshold Amplitude Subrange Arrays
+  sSubrange_t SRBinVal;                       //!< X-Y-Z Threshold Bin Frequency Subrange Arrays
+#endif /* USE_SUBRANGE */
+  sMotionSP_Data_t Data;                      //!< Algorithm Data of MotionSP_fftExecution
+  sTimeDomainData_t TimeDomainData;           //!< Time Domain Structure of MotionSP_TimeDomainEvalFromCircBuff
+  sAccMagResults_t AccMagResults;             //!< FFT magnitude data of MotionSP_fftExecution
+  sMotionSP_State_t State;                    //!< Filter state and scratch arrays
+#ifdef MOTIONSP_USE_ENVELOPE
+  sEnvelope_t Envelope;                       //!< Envelope (demodulation) analysis
+#endif /* MOTIONSP_USE_ENVELOPE */
+} MotionSP_Context_t;
+
 /**
   * @}
   */
@@ -293,60 +507,48 @@ typedef struct {
   * @{
   */
 
-void MotionSP_accDelOffset(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint16_t Restart);
+uint8_t MotionSP_ContextInit(MotionSP_Context_t *pCtx);
+void MotionSP_accDelOffset(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint16_t Restart);
 void MotionSP_CreateAccCircBuffer(sCircBuffer_t *pCircBuff, SensorVal_f_t buffType);
-void MotionSP_TimeDomainProcess(sAcceleroParam_t *sTimeDomain, Td_Type_t td_type, uint8_t Restart);
-
-void MotionSP_fftCalc(arm_rfft_fast_instance_f32 *pfftS, float *pfftIn, float *pfftOut);
-void MotionSP_fftAdapt(sAxesMagBuff_t *pfftCmplxMag, uint16_t size);
+#ifdef MOTIONSP_USE_Q15
+void MotionSP_accDelOffset_q15(MotionSP_Context_t *pCtx, SensorVal_q15_t *pDstArr, SensorVal_q15_t *pSrcArr, q15_t Smooth, uint16_t Restart);
+void MotionSP_CreateAccCircBuffer_q15(sCircBuffer_t *pCircBuff, SensorVal_q15_t buffType);
+#endif /* MOTIONSP_USE_Q15 */
+void MotionSP_TimeDomainProcess(MotionSP_Context_t *pCtx, Td_Type_t td_type, uint8_t Restart);
+void MotionSP_TimeDomainProcessBlock(MotionSP_Context_t *pCtx, Td_Type_t td_type, uint16_t NewSamples, uint8_t Restart);
+
+void MotionSP_fftCalc(MotionSP_Context_t *pCtx, float *pfftIn, float *pfftOut);
+void MotionSP_fftAdapt(sAxesMagBuff_t *pfftCmplxMag, uint16_t size, float WSF);
 void MotionSP_fftFindPeak(sAxesMagBuff_t *pfftCmplxMag, uint16_t size, sAxesMagResults_t *AccAxesMagResults);
-void MotionSP_SetWindFiltArray(float *Filter_Params, uint16_t size, Filt_Type_t Ftype);
+void MotionSP_SetWindFiltArray(MotionSP_Context_t *pCtx, uint16_t size, Filt_Type_t Ftype);
 void motionSP_fftUseWindow(float *pDstArr, float *pSrcArr, uint16_t SizeArr, float *Window_Params);
 uint8_t MotionSP_fftInBuild(float *pDst, uint16_t DstSize, float *pSrc, uint16_t SrcSize, uint16_t SrcLastPos);
 uint8_t MotionSP_fftAverageCalcSamples(float *pDstArr, float *pSrcArr, uint16_t LenArr, uint16_t *pSumCnt, uint8_t MaxSumCnt);
 uint8_t MotionSP_fftAverageCalcTime(float *pDstArr, float *pSrcArr, uint16_t LenArr, uint16_t *pSumCnt, uint8_t FinishAvg);
-void MotionSP_FrequencyDomainProcess(void);
-void MotionSP_evalMaxAmplitudeRange(float *pfftCmplxMagAxis, uint16_t subrange, float *SR_Amplitude, float *SR_Bin_Value);
-
-void MotionSP_TimeDomainEvalFromCircBuff(sTimeDomainData_t *pTimeDomainData, sCircBuff_t *pAccCircBuff, uint16_t NewDataSamples, Td_Type_t td_type, sAcceleroODR_t  AccOdr, uint8_t Rst);
+void MotionSP_FrequencyDomainProcess(MotionSP_Context_t *pCtx);
+void MotionSP_evalMaxAmplitudeRange(MotionSP_Context_t *pCtx, float *pfftCmplxMagAxis, uint16_t subrange, float *SR_Amplitude, float *SR_Bin_Value);
+#ifdef MOTIONSP_USE_SDFT
+void MotionSP_SdftInit(MotionSP_Context_t *pCtx, uint16_t FftSize, Filt_Type_t Ftype);
+void MotionSP_SdftSetBins(MotionSP_Context_t *pCtx, const sSubrange_t *pBinVal, uint16_t SubrangeNum);
+uint8_t MotionSP_SdftIsSeeded(MotionSP_Context_t *pCtx);
+void MotionSP_SdftUpdateBlock(MotionSP_Context_t *pCtx, uint16_t Len);
+uint8_t MotionSP_SdftEvalAmplitude(MotionSP_Context_t *pCtx, sSubrange_t *pAmplitude);
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_ENVELOPE
+uint8_t MotionSP_EnvelopeInit(MotionSP_Context_t *pCtx);
+void MotionSP_EnvelopeProcessBlock(MotionSP_Context_t *pCtx, uint16_t NewSamples);
+uint8_t MotionSP_EnvelopeDone(MotionSP_Context_t *pCtx);
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+void MotionSP_TimeDomainEvalFromCircBuff(MotionSP_Context_t *pCtx, sTimeDomainData_t *pTimeDomainData, sCircBuff_t *pAccCircBuff, uint16_t NewDataSamples, Td_Type_t td_type, sAcceleroODR_t  AccOdr, uint8_t Rst);
 void MotionSP_fftAdapting(sAccMagResults_t *pAccMagResults, float WSF);
 void MotionSP_fftPeakFinding(sAccMagResults_t *pAccMagResults);
-void MotionSP_fftExecution(uint8_t avg);
-
-sAcceleroODR_t *MotionSP_GetRealAcceleroOdr(void);
-sMotionSP_Parameter_t *MotionSP_GetParameters(void);
-sAccMagResults_t *MotionSP_GetAccMagResults(void);
-sTimeDomainData_t *MotionSP_GetTimeDomainData(void);
-
-/**
-  * @}
-  */
+void MotionSP_fftExecution(MotionSP_Context_t *pCtx, uint8_t avg);
 
-/** @addtogroup STM32_MOTIONSP_LIB_EXPORTED_VARIABLES STM32 Motion Signal Processing Library Exported Variables
-  * @{
-  */
-
-extern sCircBuffer_t AccCircBuffer;
-extern uint8_t fftIsEnabled;
-extern sMotionSP_Parameter_t MotionSP_Parameters;
-extern sAcceleroParam_t sTimeDomain;
-extern sAxesMagResults_t AccAxesMagResults;
-extern uint8_t FinishAvgFlag;
-extern uint16_t magSize;
-extern sAcceleroODR_t AcceleroODR;
-extern uint16_t accCircBuffIndexForFft;
-extern sSumCnt_t AccSumCnt;
-extern float Filter_Params[FFT_SIZE_MAX];
-extern arm_rfft_fast_instance_f32 fftS;
-
-extern sMotionSP_Data_t MotionSP_Data;
-extern sTimeDomainData_t TimeDomainData;
-extern sAccMagResults_t AccMagResults;
-
-#ifdef USE_SUBRANGE
-extern sSubrange_t SRAmplitude;
-extern sSubrange_t SRBinVal;
-#endif /* USE_SUBRANGE */
+sAcceleroODR_t *MotionSP_GetRealAcceleroOdr(MotionSP_Context_t *pCtx);
+sMotionSP_Parameter_t *MotionSP_GetParameters(MotionSP_Context_t *pCtx);
+sAccMagResults_t *MotionSP_GetAccMagResults(MotionSP_Context_t *pCtx);
+sTimeDomainData_t *MotionSP_GetTimeDomainData(MotionSP_Context_t *pCtx);
 
 /**
   * @}
@@ -69,6 +69,10 @@ extern "C" {
   */
 
 /* #define USE_SUBRANGE */                        //!< Uncomment this define for enabling subrange
+/* #define MOTIONSP_USE_Q15 */                    //!< Uncomment this define for Q15 samples and Q31 FFT in the vibration analysis (half the circular buffer RAM, slower FFT)
+/* #define MOTIONSP_USE_SDFT */                   //!< Uncomment this define for the sliding DFT monitoring of the subrange peak bins (needs USE_SUBRANGE)
+/* #define MOTIONSP_USE_PSD */                    //!< Uncomment this define for the Welch power spectral density in g^2/Hz instead of the FFT magnitude average
+/* #define MOTIONSP_USE_ENVELOPE */               //!< Uncomment this define for the envelope (demodulation) spectrum used to detect the bearing faults
 
 #define NUM_AXES              3             //!< Number of sensor axes
 
@@ -92,7 +96,9 @@ extern "C" {
 #define CIRC_BUFFER_SIZE_MAX  (uint16_t)((FFT_SIZE_MAX*CIRC_BUFFER_RATIO_NUM)/CIRC_BUFFER_RATIO_DEN) //!< Max circular buffer for storing input values for FFT
 
 #define DC_SMOOTH             0.975f        //!< Smooth parameter used for DC filtering  
+#define DC_SMOOTH_Q15         ((int16_t)((DC_SMOOTH * 32768.0f) + 0.5f)) //!< Smooth parameter used for DC filtering in Q15
 #define GAMMA                 0.5f          //!< GAMMA parameter used for Integration Algorithm               
+#define TD_BLOCK_LEN          64            //!< Samples processed together by the time domain block engine
   
 #define G_CONST               9.80665f                //!< in m/s^2
 #define G_CONV                (float)(G_CONST/1000.0) //!< CONSTANT for conversion from mm/s^2 to m/s^2
@@ -102,6 +108,27 @@ extern "C" {
   #define SUBRANGE_MAX          64          //!< Default value for MAX Subranges to analyze
 #endif /* USE_SUBRANGE */
 
+#ifdef MOTIONSP_USE_SDFT
+  #define SDFT_SUBRANGE_MAX     16          //!< Max subranges followed by the sliding DFT, more subranges use the FFT only
+  #define SDFT_DAMPING          0.99999f    //!< Sliding DFT damping factor, keeps the recursion stable
+  #define SDFT_RESEED_DEFAULT   10          //!< Acquisitions monitored by the sliding DFT only before a new FFT average
+  #define SDFT_BLOCK_LEN        32          //!< Samples slid together, below the circular buffer margin of the 256 points FFT (51)
+#endif /* MOTIONSP_USE_SDFT */
+
+#ifdef MOTIONSP_USE_ENVELOPE
+  #define ENV_BAND_LOW_DEFAULT  1000        //!< Default low cut-off of the envelope band-pass in Hz
+  #define ENV_BAND_HIGH_DEFAULT 2500        //!< Default high cut-off of the envelope band-pass in Hz
+  #define ENV_DEC_DEFAULT       8           //!< Default decimation factor of the envelope
+  #define ENV_DEC_MAX           16          //!< Max decimation factor of the envelope, it must divide ENV_BLOCK_LEN
+  #define ENV_BLOCK_LEN         64          //!< Rectified samples low-pass filtered and decimated together
+  #define ENV_LPF_TAPS_PER_DEC  16          //!< Taps of the envelope low-pass for each unit of the decimation factor
+  #define ENV_LPF_TAPS_MAX      (ENV_LPF_TAPS_PER_DEC*ENV_DEC_MAX) //!< Max taps of the envelope low-pass
+  #define ENV_LPF_CUTOFF        0.6f        //!< Envelope low-pass cut-off, fraction of the decimated Nyquist frequency
+  #define ENV_FFT_SIZE          512u        //!< Envelope FFT size
+  #define ENV_MAG_SIZE          (uint16_t)(ENV_FFT_SIZE/2) //!< Envelope spectrum size
+  #define ENV_PEAK_BIN_MIN      2           //!< First bin of the envelope peak search, the lower ones hold the residual mean
+#endif /* MOTIONSP_USE_ENVELOPE */
+
 /**
   * @}
   */
@@ -55,44 +55,16 @@
   * @{
   */
 
-/** @addtogroup STM32_MOTIONSP_LIB_PUBLIC_VARIABLES STM32 Motion Signal Processing Library Public Variables
+/** @addtogroup STM32_MOTIONSP_LIB_PRIVATE_DEFINES STM32 Motion Signal Processing Library Private Defines
   * @{
   */
 
-sMotionSP_Parameter_t MotionSP_Parameters;      //!< Algorithm Parameters
-sCircBuffer_t AccCircBuffer;                    //!< Circular buffer for storing input values for FFT
-arm_rfft_fast_instance_f32 fftS;                //!< Instance structure for the floating-point RFFT/RIFFT function
-uint16_t magSize = 0;                           //!< to store the actual size of the FFT magnitude elements
-uint16_t accCircBuffIndexForFft;                //!< Position index in circular buffer to perform FFT
-sAcceleroParam_t sTimeDomain;                   //!< Time Domain Structure with parameters to use
-sAcceleroODR_t AcceleroODR;                     //!< Real Accelerometer ODR evaluated
-uint8_t FinishAvgFlag;                          //!< Flag to monitor the FFT Timing
-uint8_t fftIsEnabled;                           //!< Flag to enable FFT computation
-float Filter_Params[FFT_SIZE_MAX];              //!< Array of window filter parameters
-float Window_Scale_Factor;                      //!< Scale factor to correct amplitude
-sSumCnt_t AccSumCnt;                            //!< Sum counter for FFT during averaging
-sAxesMagResults_t AccAxesMagResults;
-
-sMotionSP_Data_t MotionSP_Data;                 //!< Algorithm Data
-sTimeDomainData_t TimeDomainData;               //!< Time Domain Structure with parameters to use
-sAccMagResults_t AccMagResults;                 //!< FFT magnitude data
-
-#ifdef USE_SUBRANGE
-sSubrange_t SRAmplitude;                        //!< X-Y-Z Threshold Amplitude Subrange Arrays
-sSubrange_t SRBinVal;                           //!< X-Y-Z Threshold Bin Frequency Subrange Arrays
-#endif /* USE_SUBRANGE */
-
-/**
-  * @}
-  */
-
-/** @addtogroup STM32_MOTIONSP_LIB_PRIVATE_VARIABLES STM32 Motion Signal Processing Library Private Variables
-  * @{
-  */
-
-sAxesMagBuff_t AccAxesAvgMagBuff;               //!< Array for storing accelerometer magnitude average values
-static SensorVal_f_t SpeedTimeDomain;           //!< Time Domain Speed Arrays to use during integration
-static SensorVal_f_t SpeedTimeDomain_noDC;      //!< Time Domain Speed Arrays without DC Offset to use during integration
+#ifdef MOTIONSP_USE_Q15
+#define DC_Q15_FRAC_BITS      8                                         //!< Fractional bits kept by the DC filter output in Q15
+#define CIRC_SAMPLE(pCtx, s)  ((float)(s) * (pCtx)->SampleScale)       //!< Circular buffer sample in m/s^2
+#else /* MOTIONSP_USE_Q15 */
+#define CIRC_SAMPLE(pCtx, s)  (s)                                       //!< Circular buffer sample in m/s^2
+#endif /* MOTIONSP_USE_Q15 */
 
 /**
   * @}
@@ -102,71 +74,112 @@ static SensorVal_f_t SpeedTimeDomain_noDC;      //!< Time Domain Speed Arrays wi
   * @{
   */
 
-static void MotionSP_speedDelOffset(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint8_t Restart);
-static void MotionSP_evalSpeedFromAccelero(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcArr, uint8_t Restart);
-static void MotionSP_SwSpeedRmsFilter(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float ExpTau, uint8_t start);
-static void MotionSP_SwAccRmsFilter(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcArr, float Lambda, uint8_t start);
-static void MotionSP_SwAccPkEval(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcArr);
-
-static void MotionSP_TD_PeakEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId);
-static void MotionSP_TD_SpeedEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId, sAcceleroODR_t  AccOdr, uint8_t Rst);
-static void MotionSP_TD_AccRmsEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId, sAcceleroODR_t  AccOdr, uint8_t Rst);
+static void MotionSP_speedDelOffset(sMotionSP_State_t *pState, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint8_t Restart);
+static void MotionSP_evalSpeedFromAccelero(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr, uint8_t Restart);
+static void MotionSP_SwSpeedRmsFilter(float *pWN, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float ExpTau, uint8_t start);
+static void MotionSP_SwAccRmsFilter(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr, float Lambda, uint8_t start);
+static void MotionSP_SwAccPkEval(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr);
+
+static void MotionSP_TD_CopyFromCirc(float *pDst, const float *pSrc, uint16_t SrcSize, uint16_t SrcId, uint16_t Len);
+#ifdef MOTIONSP_USE_Q15
+static void MotionSP_TD_CopyFromCirc_q15(float *pDst, const q15_t *pSrc, uint16_t SrcSize, uint16_t SrcId, uint16_t Len, float Scale);
+#endif /* MOTIONSP_USE_Q15 */
+static void MotionSP_TD_Block(sMotionSP_State_t *pScratch, sTdBlockState_t *pState, uint16_t Len, Td_Type_t td_type,
+                              float Period, float Lambda, uint8_t Restart, SensorVal_f_t *pPeak);
+static void MotionSP_TD_BlockRms(const sTdBlockState_t *pState, Td_Type_t td_type,
+                                 SensorVal_f_t *pSpeedRms, SensorVal_f_t *pAccRms);
+
+#ifdef MOTIONSP_USE_Q15
+static q15_t MotionSP_accDelOffsetAxis_q15(q31_t *pDstPre, q15_t *pSrcPre, q15_t Src, q15_t Smooth);
+static uint8_t MotionSP_fftWindowFromCircBuff_q15(q31_t *pDst, uint16_t DstSize, const q15_t *pSrc, uint16_t SrcSize, uint16_t SrcLastPos, const q15_t *pWin);
+static void MotionSP_fftWindow_q15(q31_t *pDst, const q15_t *pSrc, const q15_t *pWin, uint16_t Len);
+#ifdef MOTIONSP_USE_PSD
+static void MotionSP_fftPowerAccumulate_q31(float *pSum, const q31_t *pCmplx, uint16_t MagSize, uint8_t Reset);
+#else /* MOTIONSP_USE_PSD */
+static void MotionSP_fftMag_q31(const q31_t *pCmplx, q31_t *pMag, uint16_t MagSize);
+static void MotionSP_fftMagAccumulate_q31(float *pAvg, const q31_t *pMag, uint16_t MagSize, uint8_t Reset);
+#endif /* MOTIONSP_USE_PSD */
+#else /* MOTIONSP_USE_Q15 */
+static uint8_t MotionSP_fftWindowFromCircBuff(sAccAxesArray_t *pDst, uint16_t DstSize, sCircBuffer_t *pSrc, uint16_t SrcLastPos, const float *pWin);
+static void MotionSP_fftWindow3Axes(float *pDstX, float *pDstY, float *pDstZ,
+                                    const float *pSrcX, const float *pSrcY, const float *pSrcZ,
+                                    const float *pWin, uint16_t Len);
+#ifdef MOTIONSP_USE_PSD
+static void MotionSP_fftPowerAccumulate(float *pSum, const float *pCmplx, float *pPow, uint16_t MagSize, uint8_t Reset);
+#else /* MOTIONSP_USE_PSD */
+static void MotionSP_fftMagAccumulate(float *pAvg, const float *pCmplx, uint16_t MagSize, uint8_t Reset);
+#endif /* MOTIONSP_USE_PSD */
+#endif /* MOTIONSP_USE_Q15 */
+#ifdef MOTIONSP_USE_PSD
+static void MotionSP_fftPsdDone(MotionSP_Context_t *pCtx, float PowerScale);
+static void MotionSP_fftPsdToAmplitude(MotionSP_Context_t *pCtx);
+#endif /* MOTIONSP_USE_PSD */
+static void MotionSP_fftAverageDone(MotionSP_Context_t *pCtx);
+#ifdef MOTIONSP_USE_SDFT
+static void MotionSP_SdftReset(sSdft_t *pSdft);
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_ENVELOPE
+static void MotionSP_EnvelopeBiquad(float *pCoeffs, float Freq, float Fs, uint8_t HighPass);
+static void MotionSP_EnvelopeFrame(sEnvelope_t *pEnv);
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 /**
   *  @brief  High Pass Filter to delete Speed Offset
+  *  @param  pState pointer to the context state
   *  @param  pDstArr pointer to Speed Array without offset
   *  @param  pSrcArr pointer to Speed Array with offset
   *  @param  Smooth constant
   *  @param  Restart flag to reInit internal value
   *  @return none
   */
-static void MotionSP_speedDelOffset(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint8_t Restart)
+static void MotionSP_speedDelOffset(sMotionSP_State_t *pState, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint8_t Restart)
 {
-  static SensorVal_f_t DstArrPre;
-  static SensorVal_f_t SrcArrPre;
+  SensorVal_f_t *pDstArrPre = &pState->SpeedDstPre;
+  SensorVal_f_t *pSrcArrPre = &pState->SpeedSrcPre;
   
   if (Restart == 1)
   {
     pDstArr->AXIS_X = 0.0;
     pDstArr->AXIS_Y = 0.0;
     pDstArr->AXIS_Z = 0.0;
-    DstArrPre.AXIS_X = pSrcArr->AXIS_X;
-    DstArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    DstArrPre.AXIS_Z = pSrcArr->AXIS_Z;
-    SrcArrPre.AXIS_X = pSrcArr->AXIS_X;
-    SrcArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    SrcArrPre.AXIS_Z = pSrcArr->AXIS_Z;
+    pDstArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pDstArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pDstArrPre->AXIS_Z = pSrcArr->AXIS_Z;
+    pSrcArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pSrcArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pSrcArrPre->AXIS_Z = pSrcArr->AXIS_Z;
   }
   else
   {
-    pDstArr->AXIS_X = (Smooth * DstArrPre.AXIS_X) + Smooth * (pSrcArr->AXIS_X - SrcArrPre.AXIS_X);
-    pDstArr->AXIS_Y = (Smooth * DstArrPre.AXIS_Y) + Smooth * (pSrcArr->AXIS_Y - SrcArrPre.AXIS_Y);
-    pDstArr->AXIS_Z = (Smooth * DstArrPre.AXIS_Z) + Smooth * (pSrcArr->AXIS_Z - SrcArrPre.AXIS_Z);
-    DstArrPre.AXIS_X = pDstArr->AXIS_X;
-    DstArrPre.AXIS_Y = pDstArr->AXIS_Y;
-    DstArrPre.AXIS_Z = pDstArr->AXIS_Z;
-    SrcArrPre.AXIS_X = pSrcArr->AXIS_X;
-    SrcArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    SrcArrPre.AXIS_Z = pSrcArr->AXIS_Z;
+    pDstArr->AXIS_X = (Smooth * pDstArrPre->AXIS_X) + Smooth * (pSrcArr->AXIS_X - pSrcArrPre->AXIS_X);
+    pDstArr->AXIS_Y = (Smooth * pDstArrPre->AXIS_Y) + Smooth * (pSrcArr->AXIS_Y - pSrcArrPre->AXIS_Y);
+    pDstArr->AXIS_Z = (Smooth * pDstArrPre->AXIS_Z) + Smooth * (pSrcArr->AXIS_Z - pSrcArrPre->AXIS_Z);
+    pDstArrPre->AXIS_X = pDstArr->AXIS_X;
+    pDstArrPre->AXIS_Y = pDstArr->AXIS_Y;
+    pDstArrPre->AXIS_Z = pDstArr->AXIS_Z;
+    pSrcArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pSrcArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pSrcArrPre->AXIS_Z = pSrcArr->AXIS_Z;
   }
 }
 
 /**
   *  @brief  Integration Algorithm to evaluate Speed starting from Accelerometer data
+  *  @param  pCtx pointer to the MotionSP context, accelero values from its circular buffer
   *  @param  pDstArr speed value output
-  *  @param  pSrcArr accelero value from external circular buffer
   *  @param  Restart flag to reInit internal value
   *  @return none
   */
-static void MotionSP_evalSpeedFromAccelero(SensorVal_f_t *pDstArr,
-                                           sCircBuffer_t *pSrcArr,
+static void MotionSP_evalSpeedFromAccelero(MotionSP_Context_t *pCtx,
+                                           SensorVal_f_t *pDstArr,
                                            uint8_t Restart)
 {
+  sCircBuffer_t *pSrcArr = &pCtx->AccCircBuffer;
+  SensorVal_f_t *pDstArrPre = &pCtx->State.SpeedPre;
   uint16_t IndexCurr, IndexPre;
   float DeltaT;
-  static SensorVal_f_t DstArrPre;
   
-  DeltaT = AcceleroODR.Period;
+  DeltaT = pCtx->AcceleroODR.Period;
   IndexCurr = pSrcArr->IdPos;
   IndexPre  = IndexCurr-1;
   
@@ -176,25 +189,25 @@ static void MotionSP_evalSpeedFromAccelero(SensorVal_f_t *pDstArr,
   if (Restart == 1) 
   {  
     memset((void *)pDstArr, 0, sizeof(SensorVal_f_t));
-    memset((void *)&DstArrPre, 0, sizeof(SensorVal_f_t));
+    memset((void *)pDstArrPre, 0, sizeof(SensorVal_f_t));
   }
   
   else
   {     // vi+1 = vi +[(1-GAMMA)*DELTA_T]*ai + (GAMMA*DELTA_T)*ai+1 /* in mm/s
 
-    pDstArr->AXIS_X = DstArrPre.AXIS_X +
-                      (((1-GAMMA)*DeltaT)*(pSrcArr->Data.AXIS_X[IndexPre]))+
-                      (GAMMA*DeltaT*(pSrcArr->Data.AXIS_X[IndexCurr]));
+    pDstArr->AXIS_X = pDstArrPre->AXIS_X +
+                      (((1-GAMMA)*DeltaT)*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_X[IndexPre]))+
+                      (GAMMA*DeltaT*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_X[IndexCurr]));
 
-    pDstArr->AXIS_Y = DstArrPre.AXIS_Y +
-                      (((1-GAMMA)*DeltaT)*(pSrcArr->Data.AXIS_Y[IndexPre]))+
-                      (GAMMA*DeltaT*(pSrcArr->Data.AXIS_Y[IndexCurr]));
+    pDstArr->AXIS_Y = pDstArrPre->AXIS_Y +
+                      (((1-GAMMA)*DeltaT)*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Y[IndexPre]))+
+                      (GAMMA*DeltaT*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Y[IndexCurr]));
  
-    pDstArr->AXIS_Z = DstArrPre.AXIS_Z +
-                      (((1-GAMMA)*DeltaT)*(pSrcArr->Data.AXIS_Z[IndexPre]))+
-                      (GAMMA*DeltaT*(pSrcArr->Data.AXIS_Z[IndexCurr]));
+    pDstArr->AXIS_Z = pDstArrPre->AXIS_Z +
+                      (((1-GAMMA)*DeltaT)*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Z[IndexPre]))+
+                      (GAMMA*DeltaT*CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Z[IndexCurr]));
     
-    memcpy((void *)&DstArrPre, (void *)pDstArr, sizeof(SensorVal_f_t));
+    memcpy((void *)pDstArrPre, (void *)pDstArr, sizeof(SensorVal_f_t));
   }
 }
 
@@ -206,8 +219,81 @@ static void MotionSP_evalSpeedFromAccelero(SensorVal_f_t *pDstArr,
   * @{
   */
 
+/**
+  * @brief  Initialize a MotionSP context for a new acquisition with its Parameters
+  * @param  pCtx pointer to the MotionSP context
+  * @retval 0 in case of success
+  * @retval 1 if the FFT size is out of range
+  *
+  * @details The context has to be zeroed before its first initialization (static storage),
+  *          each context is independent so that several accelerometers can be analyzed in parallel.
+  */
+uint8_t MotionSP_ContextInit(MotionSP_Context_t *pCtx)
+{
+  uint16_t FftSize = pCtx->Parameters.FftSize;
+
+  if (FftSize > FFT_SIZE_MAX)
+  {
+    return 1;
+  }
+
+  // Reset the accelero circular buffer
+  memset((void *)(&pCtx->AccCircBuffer), 0x00, sizeof(sCircBuffer_t));
+
+  // Set the initial position of the accelero circular buffer
+  pCtx->AccCircBuffer.IdPos = (uint16_t)(-1);
+
+  /* Create circular buffer and initialize result variables */
+  pCtx->AccCircBuffer.Size = (uint16_t)((FftSize * CIRC_BUFFER_RATIO_NUM)/CIRC_BUFFER_RATIO_DEN);
+
+  pCtx->magSize = FftSize / 2;
+
+  /* Set the mag size to be used */
+  pCtx->AccMagResults.MagSizeTBU = pCtx->magSize;
+
+  // Reset the TimeDomain parameter values
+  memset((void *)(&pCtx->TimeDomain), 0x00, sizeof(sAcceleroParam_t));
+
+  // Reset the counters of the number of sums about the calculation of the average
+  memset((void *)(&pCtx->AccSumCnt), 0x00, sizeof(sSumCnt_t));
+
+  /* The window and its normalizations are computed again only if the FFT size or the window type change */
+  if ((pCtx->WindowSize != FftSize) || (pCtx->WindowType != pCtx->Parameters.window))
+  {
+    MotionSP_SetWindFiltArray(pCtx, FftSize, (Filt_Type_t)pCtx->Parameters.window);
+  }
+
+  /* Reset the flag to enable FFT computation */
+  pCtx->fftIsEnabled = 0;
+
+  arm_rfft_fast_init_f32(&pCtx->fftS, FftSize);
+
+#ifdef MOTIONSP_USE_Q15
+  /* RFFT for the fixed point analysis */
+  arm_rfft_init_q31(&pCtx->fftS_q31, FftSize, 0, 1);
+#endif /* MOTIONSP_USE_Q15 */
+
+#ifdef MOTIONSP_USE_SDFT
+  /* Sliding DFT of the subrange peaks found by the last FFT average */
+  MotionSP_SdftInit(pCtx, FftSize, (Filt_Type_t)pCtx->Parameters.window);
+#endif /* MOTIONSP_USE_SDFT */
+
+#ifdef MOTIONSP_USE_ENVELOPE
+  /* The envelope stays disabled when its band does not fit the accelerometer ODR */
+  MotionSP_EnvelopeInit(pCtx);
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+  /* It is the minimum value to do the first FFT */
+  pCtx->accCircBuffIndexForFft = FftSize - 1;
+
+  pCtx->FinishAvgFlag = 0;
+
+  return 0;
+}
+
 /**
   * @brief  Filter to estimate the Speed Moving RMS Values using FAST Lambda
+  * @param  pWN pointer to the filter weight
   * @param  pDstArr pointer to RMS Output Arrays
   * @param  pSrcArr pointer to Input Speed Values
   * @param  Lambda  smoothing factor
@@ -217,12 +303,12 @@ static void MotionSP_evalSpeedFromAccelero(SensorVal_f_t *pDstArr,
   * @details More details
   * Reference by MATLAB DSP Toolbox modified with Y(n-1)^2
   */
-static void MotionSP_SwSpeedRmsFilter(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Lambda, uint8_t start)
+static void MotionSP_SwSpeedRmsFilter(float *pWN, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Lambda, uint8_t start)
 {
   SensorVal_f_t SquareData = {0, 0, 0};
   SensorVal_f_t PrevSquareData  = {0, 0, 0};
-  static float WN = 0.0;
-  static float WN_1 = 0.0;
+  float WN = *pWN;
+  float WN_1 = 0.0;
 
   if (start == 1)
   {
@@ -248,38 +334,45 @@ static void MotionSP_SwSpeedRmsFilter(SensorVal_f_t *pDstArr, SensorVal_f_t *pSr
     WN_1 =  WN;
     WN =  Lambda * WN_1 + 1;
   }
+
+  *pWN = WN;
 }
 
 /**
   * @brief  Filter to estimate the Accelerometer Moving RMS Values using FAST Lambda
+  * @param  pCtx pointer to the MotionSP context, accelero values from its circular buffer
   * @param  pDstArr pointer to related RMS Output
-  * @param  pSrcArr pointer to accelerometer circular buffer
   * @param  Lambda fast smoothing factor
   * @param  start flag to Re-Init first value
   * @return none
   */
-static void MotionSP_SwAccRmsFilter(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcArr, float Lambda, uint8_t start)
+static void MotionSP_SwAccRmsFilter(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr, float Lambda, uint8_t start)
 {
+  sCircBuffer_t *pSrcArr = &pCtx->AccCircBuffer;
   uint16_t Index = 0;
+  SensorVal_f_t Acc;
   SensorVal_f_t SquareData = {0, 0, 0};
   SensorVal_f_t PrevSquareData  = {0, 0, 0};
-  static float WN = 0.0;
-  static float WN_1 = 0.0;
+  float WN = pCtx->State.AccWN;
+  float WN_1 = 0.0;
 
   Index = pSrcArr->IdPos;
+  Acc.AXIS_X = CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_X[Index]);
+  Acc.AXIS_Y = CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Y[Index]);
+  Acc.AXIS_Z = CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Z[Index]);
   
   if (start == 1)
   {
-    pDstArr->AXIS_X = pSrcArr->Data.AXIS_X[Index];
-    pDstArr->AXIS_Y = pSrcArr->Data.AXIS_Y[Index];
-    pDstArr->AXIS_Z = pSrcArr->Data.AXIS_Z[Index];
+    pDstArr->AXIS_X = Acc.AXIS_X;
+    pDstArr->AXIS_Y = Acc.AXIS_Y;
+    pDstArr->AXIS_Z = Acc.AXIS_Z;
     WN = 1;
   }
   else
   {
-    SquareData.AXIS_X = pSrcArr->Data.AXIS_X[Index] * pSrcArr->Data.AXIS_X[Index];
-    SquareData.AXIS_Y = pSrcArr->Data.AXIS_Y[Index] * pSrcArr->Data.AXIS_Y[Index];;
-    SquareData.AXIS_Z = pSrcArr->Data.AXIS_Z[Index] * pSrcArr->Data.AXIS_Z[Index];;
+    SquareData.AXIS_X = Acc.AXIS_X * Acc.AXIS_X;
+    SquareData.AXIS_Y = Acc.AXIS_Y * Acc.AXIS_Y;
+    SquareData.AXIS_Z = Acc.AXIS_Z * Acc.AXIS_Z;
 
     PrevSquareData.AXIS_X = pDstArr->AXIS_X * pDstArr->AXIS_X;
     PrevSquareData.AXIS_Y = pDstArr->AXIS_Y * pDstArr->AXIS_Y;
@@ -292,169 +385,275 @@ static void MotionSP_SwAccRmsFilter(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcA
     WN_1 =  WN;
     WN =  Lambda * WN_1 + 1;
   }
+
+  pCtx->State.AccWN = WN;
 }
 
 /**
   * @brief  Peak evaluation for Accelerometer Value stored inside the Circular Buffer
+  * @param  pCtx pointer to the MotionSP context, accelero values from its circular buffer
   * @param  pDstArr pointer to AccPeak Output
-  * @param  pSrcArr pointer to input accelero circular buffer
   * @return none
   */
-static void MotionSP_SwAccPkEval(SensorVal_f_t *pDstArr, sCircBuffer_t *pSrcArr)
+static void MotionSP_SwAccPkEval(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr)
 {
+  sCircBuffer_t *pSrcArr = &pCtx->AccCircBuffer;
   uint16_t Index = 0;
 
   Index = pSrcArr->IdPos;
 
-  if (pDstArr->AXIS_X < fabsf(pSrcArr->Data.AXIS_X[Index]))
+  if (pDstArr->AXIS_X < fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_X[Index])))
   {
-    pDstArr->AXIS_X = fabsf(pSrcArr->Data.AXIS_X[Index]);
+    pDstArr->AXIS_X = fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_X[Index]));
   }
-  if (pDstArr->AXIS_Y < fabsf(pSrcArr->Data.AXIS_Y[Index]))
+  if (pDstArr->AXIS_Y < fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Y[Index])))
   {
-    pDstArr->AXIS_Y = fabsf(pSrcArr->Data.AXIS_Y[Index]);
+    pDstArr->AXIS_Y = fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Y[Index]));
   }
-  if (pDstArr->AXIS_Z < fabsf(pSrcArr->Data.AXIS_Z[Index]))
+  if (pDstArr->AXIS_Z < fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Z[Index])))
   {
-    pDstArr->AXIS_Z = fabsf(pSrcArr->Data.AXIS_Z[Index]);
+    pDstArr->AXIS_Z = fabsf(CIRC_SAMPLE(pCtx, pSrcArr->Data.AXIS_Z[Index]));
   }
 }
 
 /**
-  * @brief  Peak evaluation for accelerometer value stored inside the circular buffer
-  * @param  pDst Time Domain Data as destination
-  * @param  pSrc Circular Buffer as source
-  * @param  SrcId Actual Circular Buffer index
+  * @brief  Copy a segment of a float circular buffer to a linear array
+  * @param  pDst Destination array of Len elements
+  * @param  pSrc Circular buffer array
+  * @param  SrcSize Circular buffer size
+  * @param  SrcId Circular buffer index of the first element to copy
+  * @param  Len Number of elements to copy, not greater than SrcSize
   * @return none
   */
-static void MotionSP_TD_PeakEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId)
+static void MotionSP_TD_CopyFromCirc(float *pDst, const float *pSrc, uint16_t SrcSize, uint16_t SrcId, uint16_t Len)
 {
-  if (pDst->AccPeak.AXIS_X < fabsf(pSrc->Array.X[SrcId]))
-    pDst->AccPeak.AXIS_X = fabsf(pSrc->Array.X[SrcId]);
-  if (pDst->AccPeak.AXIS_Y < fabsf(pSrc->Array.Y[SrcId]))
-    pDst->AccPeak.AXIS_Y = fabsf(pSrc->Array.Y[SrcId]);
-  if (pDst->AccPeak.AXIS_Z < fabsf(pSrc->Array.Z[SrcId]))
-    pDst->AccPeak.AXIS_Z = fabsf(pSrc->Array.Z[SrcId]);      
+  uint16_t Len1 = SrcSize - SrcId;
+
+  if (Len1 >= Len)
+  {
+    memcpy((void *)pDst, (const void *)&pSrc[SrcId], Len * sizeof(float));
+  }
+  else
+  {
+    memcpy((void *)pDst, (const void *)&pSrc[SrcId], Len1 * sizeof(float));
+    memcpy((void *)&pDst[Len1], (const void *)pSrc, (Len - Len1) * sizeof(float));
+  }
 }
 
+#ifdef MOTIONSP_USE_Q15
 /**
-  * @brief  Speed evaluation for accelerometer value stored inside the circular buffer
-  * @param  pDst Time Domain Data as destination
-  * @param  pSrc Circular Buffer as source
-  * @param  SrcId Actual Circular Buffer index
-  * @param AccOdr Accelerometer ODR info
-  * @param Rst Restart flag
+  * @brief  Copy a segment of a Q15 circular buffer to a linear array in m/s^2
+  * @param  pDst Destination array of Len elements
+  * @param  pSrc Circular buffer array
+  * @param  SrcSize Circular buffer size
+  * @param  SrcId Circular buffer index of the first element to copy
+  * @param  Len Number of elements to copy, not greater than SrcSize
+  * @param  Scale Q15 LSB value [m/s^2]
   * @return none
   */
-static void MotionSP_TD_SpeedEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId, sAcceleroODR_t  AccOdr, uint8_t Rst)
+static void MotionSP_TD_CopyFromCirc_q15(float *pDst, const q15_t *pSrc, uint16_t SrcSize, uint16_t SrcId, uint16_t Len, float Scale)
 {
-  uint16_t previd = 0;
-  
-  if (Rst)
+  uint16_t Len1 = SrcSize - SrcId;
+
+  if (Len1 >= Len)
   {
-    pDst->Speed.AXIS_X = 0.0;
-    pDst->Speed.AXIS_Y = 0.0;
-    pDst->Speed.AXIS_Z = 0.0;
+    arm_q15_to_float((q15_t *)&pSrc[SrcId], pDst, Len);
   }
   else
   {
-    if (SrcId == 0)
-      previd = (pSrc->Size)-1;
-    else
-      previd = SrcId-1;
-    
-    /* vi = vi-1 +[(1-GAMMA)*DELTA_T]*ai-1 + (GAMMA*DELTA_T)*ai (in mm/s) */
-    pDst->Speed.AXIS_X = pDst->Speed.AXIS_X +\
-      (((1-GAMMA)*AccOdr.Period)*(pSrc->Array.X[previd]))+\
-        (GAMMA*AccOdr.Period*(pSrc->Array.X[SrcId]));
-    pDst->Speed.AXIS_Y = pDst->Speed.AXIS_Y +\
-      (((1-GAMMA)*AccOdr.Period)*(pSrc->Array.Y[previd]))+\
-        (GAMMA*AccOdr.Period*(pSrc->Array.Y[SrcId]));
-    pDst->Speed.AXIS_Z = pDst->Speed.AXIS_Z +\
-      (((1-GAMMA)*AccOdr.Period)*(pSrc->Array.Z[previd]))+\
-        (GAMMA*AccOdr.Period*(pSrc->Array.Z[SrcId]));
+    arm_q15_to_float((q15_t *)&pSrc[SrcId], pDst, Len1);
+    arm_q15_to_float((q15_t *)pSrc, &pDst[Len1], Len - Len1);
   }
+
+  /* arm_q15_to_float divides by 32768 */
+  arm_scale_f32(pDst, Scale * 32768.0f, pDst, Len);
 }
+#endif /* MOTIONSP_USE_Q15 */
 
 /**
-  * @brief  Acceleration RMS evaluation for accelerometer value stored inside the circular buffer
-  * @param  pDst Time Domain Data as destination
-  * @param  pSrc Circular Buffer as source
-  * @param  SrcId Actual Circular Buffer index
-  * @param AccOdr Accelerometer ODR info
-  * @param Rst Restart flag
+  * @brief  Time domain evaluation of a block of accelerations stored in pScratch->TdAcc
+  * @param  pScratch Library state holding the block scratch arrays
+  * @param  pState Block engine state
+  * @param  Len Number of samples of the block, not greater than TD_BLOCK_LEN
+  * @param  td_type Time domain analysis type
+  * @param  Period Accelerometer sampling period [s]
+  * @param  Lambda Smoothing factor of the moving RMS filters
+  * @param  Restart Flag to re-init the state with the first sample of the block
+  * @param  pPeak X-Y-Z acceleration peaks to update
   * @return none
+  *
+  * @details The moving RMS filters keep the mean square and the square root is
+  *          evaluated only by MotionSP_TD_BlockRms: Y(n)^2 = (1-1/WN)*Y(n-1)^2 + (1/WN)*X(n)^2
+  *          is written as MS(n) = MS(n-1) + (1/WN)*(X(n)^2 - MS(n-1)).
   */
-static void MotionSP_TD_AccRmsEvalFromCircBuff(sTimeDomainData_t *pDst, sCircBuff_t *pSrc, uint16_t SrcId, sAcceleroODR_t  AccOdr, uint8_t Rst)
+static void MotionSP_TD_Block(sMotionSP_State_t *pScratch, sTdBlockState_t *pState, uint16_t Len, Td_Type_t td_type,
+                              float Period, float Lambda, uint8_t Restart, SensorVal_f_t *pPeak)
 {
-  SensorVal_f_t SquareData = {0, 0, 0};
-  SensorVal_f_t PrevSquareData = {0, 0, 0};
-  static float WN = 0.0;
-  static float WN_1 = 0.0;
-  
-  if (Rst)
+  float *pPk[NUM_AXES] = {&pPeak->AXIS_X, &pPeak->AXIS_Y, &pPeak->AXIS_Z};
+  float *TdTmp = pScratch->TdTmp;
+  float *TdTmp2 = pScratch->TdTmp2;
+  float *TdGain = pScratch->TdGain;
+  sTdAxisState_t *pAx;
+  const float *pA;
+  const float *pG;
+  float WnNext;
+  float Max;
+  uint32_t MaxId;
+  uint16_t First = 0;
+  uint16_t N;
+  uint16_t i;
+  uint8_t axis;
+
+  if (Restart == 1)
   {
-    pDst->AccRms.AXIS_X = pSrc->Array.X[SrcId];
-    pDst->AccRms.AXIS_Y = pSrc->Array.Y[SrcId];
-    pDst->AccRms.AXIS_Z = pSrc->Array.Z[SrcId];
-    
-    WN = 1;
+    for (axis = 0; axis < NUM_AXES; axis++)
+    {
+      pAx = &pState->Axis[axis];
+      pAx->AccPre = pScratch->TdAcc[axis][0];
+      pAx->Speed = 0.0f;
+      pAx->SpeedPre = 0.0f;
+      pAx->SpeedNoDC = 0.0f;
+      pAx->SpeedMs = 0.0f;
+      pAx->AccMs = pScratch->TdAcc[axis][0] * pScratch->TdAcc[axis][0];
+    }
+    pState->WN = 1.0f;
+    pState->WnSteady = 0;
+    First = 1;
   }
-  else
+
+  /* Gain of each sample: 1/WN with WN = Lambda*WN + 1, constant once WN reaches its float fixed point */
+  i = First;
+  while ((i < Len) && (pState->WnSteady == 0))
   {
-    SquareData.AXIS_X = pSrc->Array.X[SrcId] * pSrc->Array.X[SrcId];
-    SquareData.AXIS_Y = pSrc->Array.Y[SrcId] * pSrc->Array.Y[SrcId];
-    SquareData.AXIS_Z = pSrc->Array.Z[SrcId] * pSrc->Array.Z[SrcId];;
-    
-    PrevSquareData.AXIS_X = pDst->AccRms.AXIS_X * pDst->AccRms.AXIS_X;
-    PrevSquareData.AXIS_Y = pDst->AccRms.AXIS_Y * pDst->AccRms.AXIS_Y;
-    PrevSquareData.AXIS_Z = pDst->AccRms.AXIS_Z * pDst->AccRms.AXIS_Z;
-    
-    arm_sqrt_f32(((1 - 1 / WN) * PrevSquareData.AXIS_X + (1 / WN) * SquareData.AXIS_X), &pDst->AccRms.AXIS_X);
-    arm_sqrt_f32(((1 - 1 / WN) * PrevSquareData.AXIS_Y + (1 / WN) * SquareData.AXIS_Y), &pDst->AccRms.AXIS_Y);
-    arm_sqrt_f32(((1 - 1 / WN) * PrevSquareData.AXIS_Z + (1 / WN) * SquareData.AXIS_Z), &pDst->AccRms.AXIS_Z);
-    
-    WN_1 =  WN;
-    WN =  AccOdr.Tau * WN_1 + 1;
+    TdGain[i] = 1.0f / pState->WN;
+    WnNext = Lambda * pState->WN + 1.0f;
+    if (WnNext == pState->WN)
+    {
+      pState->WnSteady = 1;
+    }
+    pState->WN = WnNext;
+    i++;
+  }
+  if (i < Len)
+  {
+    arm_fill_f32(1.0f / pState->WN, &TdGain[i], Len - i);
+  }
+
+  N = Len - First;
+  pG = &TdGain[First];
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    pAx = &pState->Axis[axis];
+
+    /* Peak evaluation */
+    arm_abs_f32(pScratch->TdAcc[axis], TdTmp, Len);
+    arm_max_f32(TdTmp, Len, &Max, &MaxId);
+    if (*pPk[axis] < Max)
+    {
+      *pPk[axis] = Max;
+    }
+
+    if (N == 0)
+    {
+      continue;
+    }
+    pA = &pScratch->TdAcc[axis][First];
+
+    if (td_type != TD_ACCELERO)
+    {
+      /* vi = vi-1 +[(1-GAMMA)*DELTA_T]*ai-1 + (GAMMA*DELTA_T)*ai (in mm/s) */
+      arm_scale_f32((float *)pA, GAMMA * Period, TdTmp, N);
+      TdTmp2[0] = ((1 - GAMMA) * Period) * pAx->AccPre;
+      arm_scale_f32((float *)pA, (1 - GAMMA) * Period, &TdTmp2[1], N - 1);
+      arm_add_f32(TdTmp, TdTmp2, TdTmp, N);
+
+      /* Speed integration, speed DC removal and speed mean square are recursive */
+      for (i = 0; i < N; i++)
+      {
+        pAx->Speed += TdTmp[i];
+        pAx->SpeedNoDC = DC_SMOOTH * (pAx->SpeedNoDC + (pAx->Speed - pAx->SpeedPre));
+        pAx->SpeedPre = pAx->Speed;
+        pAx->SpeedMs += pG[i] * ((pAx->SpeedNoDC * pAx->SpeedNoDC) - pAx->SpeedMs);
+      }
+    }
+
+    if (td_type != TD_SPEED)
+    {
+      arm_mult_f32((float *)pA, (float *)pA, TdTmp, N);
+      for (i = 0; i < N; i++)
+      {
+        pAx->AccMs += pG[i] * (TdTmp[i] - pAx->AccMs);
+      }
+    }
+
+    pAx->AccPre = pA[N - 1];
+  }
+}
+
+/**
+  * @brief  RMS values from the mean squares of the time domain block engine
+  * @param  pState Block engine state
+  * @param  td_type Time domain analysis type
+  * @param  pSpeedRms X-Y-Z speed RMS to fill
+  * @param  pAccRms X-Y-Z acceleration RMS to fill
+  * @return none
+  */
+static void MotionSP_TD_BlockRms(const sTdBlockState_t *pState, Td_Type_t td_type,
+                                 SensorVal_f_t *pSpeedRms, SensorVal_f_t *pAccRms)
+{
+  if (td_type != TD_ACCELERO)
+  {
+    arm_sqrt_f32(pState->Axis[0].SpeedMs, &pSpeedRms->AXIS_X);
+    arm_sqrt_f32(pState->Axis[1].SpeedMs, &pSpeedRms->AXIS_Y);
+    arm_sqrt_f32(pState->Axis[2].SpeedMs, &pSpeedRms->AXIS_Z);
+  }
+
+  if (td_type != TD_SPEED)
+  {
+    arm_sqrt_f32(pState->Axis[0].AccMs, &pAccRms->AXIS_X);
+    arm_sqrt_f32(pState->Axis[1].AccMs, &pAccRms->AXIS_Y);
+    arm_sqrt_f32(pState->Axis[2].AccMs, &pAccRms->AXIS_Z);
   }
 }
 
 /**
   *  @brief High Pass Filter to delete Accelerometer Offset
   *
+  *  @param pCtx: pointer to the MotionSP context
   *  @param pDstArr: pointer to Accelero Array without offset
   *  @param pSrcArr: pointer to Accelero Array with offset
   *  @param Smooth: smoothing factor
   *  @param Restart: flag to Re-Init internal value
   */
-void MotionSP_accDelOffset(SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint16_t Restart)
+void MotionSP_accDelOffset(MotionSP_Context_t *pCtx, SensorVal_f_t *pDstArr, SensorVal_f_t *pSrcArr, float Smooth, uint16_t Restart)
 {
-  static SensorVal_f_t DstArrPre;
-  static SensorVal_f_t SrcArrPre;
+  SensorVal_f_t *pDstArrPre = &pCtx->State.AccDstPre;
+  SensorVal_f_t *pSrcArrPre = &pCtx->State.AccSrcPre;
   
   if (Restart == 1)
   {
     pDstArr->AXIS_X = 0.0;
     pDstArr->AXIS_Y = 0.0;
     pDstArr->AXIS_Z = 0.0;
-    DstArrPre.AXIS_X = pSrcArr->AXIS_X;
-    DstArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    DstArrPre.AXIS_Z = pSrcArr->AXIS_Z;
-    SrcArrPre.AXIS_X = pSrcArr->AXIS_X;
-    SrcArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    SrcArrPre.AXIS_Z = pSrcArr->AXIS_Z;
+    pDstArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pDstArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pDstArrPre->AXIS_Z = pSrcArr->AXIS_Z;
+    pSrcArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pSrcArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pSrcArrPre->AXIS_Z = pSrcArr->AXIS_Z;
   }
   else
   {
-    pDstArr->AXIS_X = (Smooth * DstArrPre.AXIS_X) + Smooth * (pSrcArr->AXIS_X - SrcArrPre.AXIS_X);
-    pDstArr->AXIS_Y = (Smooth * DstArrPre.AXIS_Y) + Smooth * (pSrcArr->AXIS_Y - SrcArrPre.AXIS_Y);
-    pDstArr->AXIS_Z = (Smooth * DstArrPre.AXIS_Z) + Smooth * (pSrcArr->AXIS_Z - SrcArrPre.AXIS_Z);
-    DstArrPre.AXIS_X = pDstArr->AXIS_X;
-    DstArrPre.AXIS_Y = pDstArr->AXIS_Y;
-    DstArrPre.AXIS_Z = pDstArr->AXIS_Z;
-    SrcArrPre.AXIS_X = pSrcArr->AXIS_X;
-    SrcArrPre.AXIS_Y = pSrcArr->AXIS_Y;
-    SrcArrPre.AXIS_Z = pSrcArr->AXIS_Z;
+    pDstArr->AXIS_X = (Smooth * pDstArrPre->AXIS_X) + Smooth * (pSrcArr->AXIS_X - pSrcArrPre->AXIS_X);
+    pDstArr->AXIS_Y = (Smooth * pDstArrPre->AXIS_Y) + Smooth * (pSrcArr->AXIS_Y - pSrcArrPre->AXIS_Y);
+    pDstArr->AXIS_Z = (Smooth * pDstArrPre->AXIS_Z) + Smooth * (pSrcArr->AXIS_Z - pSrcArrPre->AXIS_Z);
+    pDstArrPre->AXIS_X = pDstArr->AXIS_X;
+    pDstArrPre->AXIS_Y = pDstArr->AXIS_Y;
+    pDstArrPre->AXIS_Z = pDstArr->AXIS_Z;
+    pSrcArrPre->AXIS_X = pSrcArr->AXIS_X;
+    pSrcArrPre->AXIS_Y = pSrcArr->AXIS_Y;
+    pSrcArrPre->AXIS_Z = pSrcArr->AXIS_Z;
   }
 }
 
@@ -481,50 +680,179 @@ void MotionSP_CreateAccCircBuffer(sCircBuffer_t *pCircBuff, SensorVal_f_t buffTy
   pCircBuff->Data.AXIS_Z[pCircBuff->IdPos] = buffType.AXIS_Z*G_CONV;
 }
 
+#ifdef MOTIONSP_USE_Q15
+/**
+  * @brief  High Pass Filter to delete Accelerometer Offset on a single axis in fixed point
+  * @param  pDstPre pointer to the previous output with DC_Q15_FRAC_BITS fractional bits
+  * @param  pSrcPre pointer to the previous input
+  * @param  Src new input
+  * @param  Smooth smoothing factor in Q15
+  * @return New output saturated in Q15
+  */
+static q15_t MotionSP_accDelOffsetAxis_q15(q31_t *pDstPre, q15_t *pSrcPre, q15_t Src, q15_t Smooth)
+{
+  q31_t Acc;
+
+  // y = Smooth * (y(n-1) + x - x(n-1)), with the extra bits of y kept between the samples
+  Acc = *pDstPre + ((q31_t)(Src - *pSrcPre) * (1 << DC_Q15_FRAC_BITS));
+  *pDstPre = (q31_t)(((q63_t)Smooth * Acc) >> 15);
+  *pSrcPre = Src;
+
+  return (q15_t)__SSAT((*pDstPre + (1 << (DC_Q15_FRAC_BITS - 1))) >> DC_Q15_FRAC_BITS, 16);
+}
+
+/**
+  *  @brief High Pass Filter to delete Accelerometer Offset in fixed point
+  *
+  *  @param pCtx: pointer to the MotionSP context
+  *  @param pDstArr: pointer to Accelero values without offset [LSB]
+  *  @param pSrcArr: pointer to Accelero raw values [LSB]
+  *  @param Smooth: smoothing factor in Q15
+  *  @param Restart: flag to Re-Init internal value
+  */
+void MotionSP_accDelOffset_q15(MotionSP_Context_t *pCtx, SensorVal_q15_t *pDstArr, SensorVal_q15_t *pSrcArr, q15_t Smooth, uint16_t Restart)
+{
+  q31_t *DstArrPre = pCtx->State.AccDstPre_q15;
+  q15_t *SrcArrPre = pCtx->State.AccSrcPre_q15;
+  
+  if (Restart == 1)
+  {
+    pDstArr->AXIS_X = 0;
+    pDstArr->AXIS_Y = 0;
+    pDstArr->AXIS_Z = 0;
+    DstArrPre[0] = (q31_t)pSrcArr->AXIS_X * (1 << DC_Q15_FRAC_BITS);
+    DstArrPre[1] = (q31_t)pSrcArr->AXIS_Y * (1 << DC_Q15_FRAC_BITS);
+    DstArrPre[2] = (q31_t)pSrcArr->AXIS_Z * (1 << DC_Q15_FRAC_BITS);
+    SrcArrPre[0] = pSrcArr->AXIS_X;
+    SrcArrPre[1] = pSrcArr->AXIS_Y;
+    SrcArrPre[2] = pSrcArr->AXIS_Z;
+  }
+  else
+  {
+    pDstArr->AXIS_X = MotionSP_accDelOffsetAxis_q15(&DstArrPre[0], &SrcArrPre[0], pSrcArr->AXIS_X, Smooth);
+    pDstArr->AXIS_Y = MotionSP_accDelOffsetAxis_q15(&DstArrPre[1], &SrcArrPre[1], pSrcArr->AXIS_Y, Smooth);
+    pDstArr->AXIS_Z = MotionSP_accDelOffsetAxis_q15(&DstArrPre[2], &SrcArrPre[2], pSrcArr->AXIS_Z, Smooth);
+  }
+}
+
+/**
+  *  @brief Add the accelerometer values without offset to the circular buffer of Q15 samples
+  *  @param pCircBuff pointer to the circular buffer
+  *  @param buffType accelerometer values without offset [LSB]
+  *  @return None
+  */
+void MotionSP_CreateAccCircBuffer_q15(sCircBuffer_t *pCircBuff, SensorVal_q15_t buffType)
+{
+  pCircBuff->IdPos += 1;
+  
+  if (pCircBuff->IdPos == pCircBuff->Size)
+  {
+    pCircBuff->IdPos = 0;
+    pCircBuff->Ovf = 1;
+  }
+
+  pCircBuff->Data.AXIS_X[pCircBuff->IdPos] = buffType.AXIS_X;
+  pCircBuff->Data.AXIS_Y[pCircBuff->IdPos] = buffType.AXIS_Y;
+  pCircBuff->Data.AXIS_Z[pCircBuff->IdPos] = buffType.AXIS_Z;
+}
+#endif /* MOTIONSP_USE_Q15 */
+
 /**
   * @brief Time Domain Processing
   * @brief From accelerometer to speed estimation to target the final RMS value processing
-  * @param pTimeDomain Pointer to time domain parameter to evaluate
+  * @param pCtx Pointer to the MotionSP context, results in pCtx->TimeDomain
   * @param td_type Time domain analysis type
   * @param Restart Flag
   * @return none
   */
-void MotionSP_TimeDomainProcess(sAcceleroParam_t *pTimeDomain, Td_Type_t td_type, uint8_t Restart)
+void MotionSP_TimeDomainProcess(MotionSP_Context_t *pCtx, Td_Type_t td_type, uint8_t Restart)
 {
-  MotionSP_SwAccPkEval(&pTimeDomain->AccPeak, &AccCircBuffer);
+  sAcceleroParam_t *pTimeDomain = &pCtx->TimeDomain;
+  sMotionSP_State_t *pState = &pCtx->State;
+
+  MotionSP_SwAccPkEval(pCtx, &pTimeDomain->AccPeak);
 
   if (td_type == TD_SPEED)
   {
     /* TIME DOMAIN ANALYSIS: Speed RMS Moving AVERAGE */
-    MotionSP_evalSpeedFromAccelero(&SpeedTimeDomain, &AccCircBuffer, Restart);
+    MotionSP_evalSpeedFromAccelero(pCtx, &pState->Speed, Restart);
     // Delete the Speed DC components
-    MotionSP_speedDelOffset(&SpeedTimeDomain_noDC, &SpeedTimeDomain, DC_SMOOTH, Restart);
+    MotionSP_speedDelOffset(pState, &pState->SpeedNoDC, &pState->Speed, DC_SMOOTH, Restart);
     // Evaluate SwExponential Filter by TAU_FILTER on Speed data
-    MotionSP_SwSpeedRmsFilter(&sTimeDomain.SpeedRms, &SpeedTimeDomain_noDC, AcceleroODR.Tau, Restart);
+    MotionSP_SwSpeedRmsFilter(&pState->SpeedWN, &pTimeDomain->SpeedRms, &pState->SpeedNoDC, pCtx->AcceleroODR.Tau, Restart);
   }
 
   if (td_type == TD_ACCELERO)
   {
     /* TIME DOMAIN ANALYSIS: Accelerometer RMS Moving AVERAGE */
     // Evaluate SwExponential Filter by TAU_FILTER on Accelerometer data
-    MotionSP_SwAccRmsFilter(&sTimeDomain.AccRms, &AccCircBuffer, AcceleroODR.Tau, Restart);
+    MotionSP_SwAccRmsFilter(pCtx, &pTimeDomain->AccRms, pCtx->AcceleroODR.Tau, Restart);
   }
 
   if (td_type == TD_BOTH_TAU)
   {
     /* TIME DOMAIN ANALYSIS: Speed and both RMS Moving AVERAGE TAU */
-    MotionSP_evalSpeedFromAccelero(&SpeedTimeDomain, &AccCircBuffer, Restart);
+    MotionSP_evalSpeedFromAccelero(pCtx, &pState->Speed, Restart);
     // Delete the Speed DC components
-    MotionSP_speedDelOffset(&SpeedTimeDomain_noDC, &SpeedTimeDomain, DC_SMOOTH, Restart);
+    MotionSP_speedDelOffset(pState, &pState->SpeedNoDC, &pState->Speed, DC_SMOOTH, Restart);
     // Evaluate SwExponential Filter by TAU_FILTER on Speed data
-    MotionSP_SwSpeedRmsFilter(&sTimeDomain.SpeedRms, &SpeedTimeDomain_noDC, AcceleroODR.Tau, Restart);
+    MotionSP_SwSpeedRmsFilter(&pState->SpeedWN, &pTimeDomain->SpeedRms, &pState->SpeedNoDC, pCtx->AcceleroODR.Tau, Restart);
     // Evaluate SwExponential Filter by TAU_FILTER on Accelerometer data
-    MotionSP_SwAccRmsFilter(&sTimeDomain.AccRms, &AccCircBuffer, AcceleroODR.Tau, Restart);
+    MotionSP_SwAccRmsFilter(pCtx, &pTimeDomain->AccRms, pCtx->AcceleroODR.Tau, Restart);
+  }
+}
+
+/**
+  * @brief Time Domain Processing of the last samples added to the context AccCircBuffer
+  * @brief Same evaluation of MotionSP_TimeDomainProcess, done by blocks of TD_BLOCK_LEN samples
+  * @param pCtx Pointer to the MotionSP context, results in pCtx->TimeDomain
+  * @param td_type Time domain analysis type
+  * @param NewSamples Samples added to AccCircBuffer since the previous call
+  * @param Restart Flag
+  * @return none
+  */
+void MotionSP_TimeDomainProcessBlock(MotionSP_Context_t *pCtx, Td_Type_t td_type, uint16_t NewSamples, uint8_t Restart)
+{
+  sCircBuffer_t *pCirc = &pCtx->AccCircBuffer;
+  sMotionSP_State_t *pState = &pCtx->State;
+  uint16_t Id;
+  uint16_t Len;
+
+  if (NewSamples > pCirc->Size)
+  {
+    NewSamples = pCirc->Size;
+  }
+
+  /* Evaluate the initial IdPos for these new data samples */
+  Id = (uint16_t)(((uint32_t)pCirc->IdPos + pCirc->Size - (NewSamples - 1)) % pCirc->Size);
+
+  while (NewSamples > 0)
+  {
+    Len = (NewSamples < TD_BLOCK_LEN) ? NewSamples : TD_BLOCK_LEN;
+
+#ifdef MOTIONSP_USE_Q15
+    MotionSP_TD_CopyFromCirc_q15(pState->TdAcc[0], pCirc->Data.AXIS_X, pCirc->Size, Id, Len, pCtx->SampleScale);
+    MotionSP_TD_CopyFromCirc_q15(pState->TdAcc[1], pCirc->Data.AXIS_Y, pCirc->Size, Id, Len, pCtx->SampleScale);
+    MotionSP_TD_CopyFromCirc_q15(pState->TdAcc[2], pCirc->Data.AXIS_Z, pCirc->Size, Id, Len, pCtx->SampleScale);
+#else /* MOTIONSP_USE_Q15 */
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[0], pCirc->Data.AXIS_X, pCirc->Size, Id, Len);
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[1], pCirc->Data.AXIS_Y, pCirc->Size, Id, Len);
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[2], pCirc->Data.AXIS_Z, pCirc->Size, Id, Len);
+#endif /* MOTIONSP_USE_Q15 */
+
+    MotionSP_TD_Block(pState, &pState->TdProcess, Len, td_type, pCtx->AcceleroODR.Period, pCtx->AcceleroODR.Tau, Restart, &pCtx->TimeDomain.AccPeak);
+    Restart = 0;
+
+    Id = (uint16_t)(((uint32_t)Id + Len) % pCirc->Size);
+    NewSamples -= Len;
   }
+
+  MotionSP_TD_BlockRms(&pState->TdProcess, td_type, &pCtx->TimeDomain.SpeedRms, &pCtx->TimeDomain.AccRms);
 }
 
 /**
   * @brief Time Domain Data Evaluation from a stored accelerations
+  * @param pCtx Pointer to the MotionSP context holding the evaluation state
   * @param pTimeDomainData Time domain data to be filled
   * @param pAccCircBuff Stored accelerations
   * @param NewDataSamples New samples of stored accelerations
@@ -533,107 +861,88 @@ void MotionSP_TimeDomainProcess(sAcceleroParam_t *pTimeDomain, Td_Type_t td_type
   * @param Rst Restart flag
   * @return none
   */
-void MotionSP_TimeDomainEvalFromCircBuff(sTimeDomainData_t *pTimeDomainData, sCircBuff_t *pAccCircBuff, uint16_t NewDataSamples, Td_Type_t td_type, sAcceleroODR_t  AccOdr, uint8_t Rst)
+void MotionSP_TimeDomainEvalFromCircBuff(MotionSP_Context_t *pCtx, sTimeDomainData_t *pTimeDomainData, sCircBuff_t *pAccCircBuff, uint16_t NewDataSamples, Td_Type_t td_type, sAcceleroODR_t  AccOdr, uint8_t Rst)
 {
-  int16_t id = 0;
-  uint16_t s = 0;
-  
-  /* Evaluate the initial IdPos for theese new data samples */
-  id = (pAccCircBuff->IdPos) - (NewDataSamples - 1);
-  if (id < 0)
-    id += (pAccCircBuff->Size);
-  
-  for (s=0; s<NewDataSamples; s++)
+  sMotionSP_State_t *pState = &pCtx->State;
+  uint16_t Id;
+  uint16_t Len;
+
+  if (NewDataSamples > pAccCircBuff->Size)
   {
-    /* Peak evaluation */
-    MotionSP_TD_PeakEvalFromCircBuff(pTimeDomainData, pAccCircBuff, id);
-    
-    /* RMS ********************************************************************/
-    switch (td_type)
-    {
-    case TD_SPEED:
-      /* Speed evaluation */
-      MotionSP_TD_SpeedEvalFromCircBuff(pTimeDomainData, pAccCircBuff, id, AccOdr, Rst);
-      
-      /* Remove the speed DC components */
-      MotionSP_speedDelOffset(&pTimeDomainData->Speed_noDC, &pTimeDomainData->Speed, DC_SMOOTH, Rst);
-      
-      /* Evaluate SwExponential Filter by TAU_FILTER on Speed data */
-      MotionSP_SwSpeedRmsFilter(&pTimeDomainData->SpeedRms, &pTimeDomainData->Speed_noDC, AccOdr.Tau, Rst);
-      break;
-      
-    case TD_ACCELERO:
-      /* Acceleration RMS evaluation */
-      MotionSP_TD_AccRmsEvalFromCircBuff(pTimeDomainData, pAccCircBuff, id, AccOdr, Rst);
-      break;
-      
-    case TD_BOTH_TAU:
-      /* Speed evaluation */
-      MotionSP_TD_SpeedEvalFromCircBuff(pTimeDomainData, pAccCircBuff, id, AccOdr, Rst);
-      
-      /* Remove the speed DC components */
-      MotionSP_speedDelOffset(&pTimeDomainData->Speed_noDC, &pTimeDomainData->Speed, DC_SMOOTH, Rst);
-      
-      /* Evaluate SwExponential Filter by TAU_FILTER on Speed data */
-      MotionSP_SwSpeedRmsFilter(&pTimeDomainData->SpeedRms, &pTimeDomainData->Speed_noDC, AccOdr.Tau, Rst);
-
-      /* Acceleration RMS evaluation */
-      MotionSP_TD_AccRmsEvalFromCircBuff(pTimeDomainData, pAccCircBuff, id, AccOdr, Rst);
-      break;
-      
-    default:
-      break;
-    }
-    /**************************************************************************/
-    
-    /* Prepare next id */
-    id++;
-    id %= (pAccCircBuff->Size);
-    
-    if (Rst)
-      Rst = 0;
+    NewDataSamples = pAccCircBuff->Size;
+  }
+
+  /* Evaluate the initial IdPos for these new data samples */
+  Id = (uint16_t)(((uint32_t)pAccCircBuff->IdPos + pAccCircBuff->Size - (NewDataSamples - 1)) % pAccCircBuff->Size);
+
+  while (NewDataSamples > 0)
+  {
+    Len = (NewDataSamples < TD_BLOCK_LEN) ? NewDataSamples : TD_BLOCK_LEN;
+
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[0], pAccCircBuff->Array.X, pAccCircBuff->Size, Id, Len);
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[1], pAccCircBuff->Array.Y, pAccCircBuff->Size, Id, Len);
+    MotionSP_TD_CopyFromCirc(pState->TdAcc[2], pAccCircBuff->Array.Z, pAccCircBuff->Size, Id, Len);
+
+    MotionSP_TD_Block(pState, &pState->TdEval, Len, td_type, AccOdr.Period, AccOdr.Tau, Rst, &pTimeDomainData->AccPeak);
+    Rst = 0;
+
+    Id = (uint16_t)(((uint32_t)Id + Len) % pAccCircBuff->Size);
+    NewDataSamples -= Len;
+  }
+
+  if (td_type != TD_ACCELERO)
+  {
+    pTimeDomainData->Speed.AXIS_X = pState->TdEval.Axis[0].Speed;
+    pTimeDomainData->Speed.AXIS_Y = pState->TdEval.Axis[1].Speed;
+    pTimeDomainData->Speed.AXIS_Z = pState->TdEval.Axis[2].Speed;
+    pTimeDomainData->Speed_noDC.AXIS_X = pState->TdEval.Axis[0].SpeedNoDC;
+    pTimeDomainData->Speed_noDC.AXIS_Y = pState->TdEval.Axis[1].SpeedNoDC;
+    pTimeDomainData->Speed_noDC.AXIS_Z = pState->TdEval.Axis[2].SpeedNoDC;
   }
+
+  MotionSP_TD_BlockRms(&pState->TdEval, td_type, &pTimeDomainData->SpeedRms, &pTimeDomainData->AccRms);
 }
 
 /**
   * @brief  Perform a FFT just for one Axis
-  * @param  pfftS  pointer to the instance structure for the floating-point RFFT/RIFFT function
+  * @param  pCtx   pointer to the MotionSP context with the RFFT instance and the FFT scratch
   * @param  pfftIn pointer to the FFT-In array
   * @param  pfftOut pointer to the FFT-Out array
   * @return none
   */
-void MotionSP_fftCalc(arm_rfft_fast_instance_f32 *pfftS, float *pfftIn, float *pfftOut)
+void MotionSP_fftCalc(MotionSP_Context_t *pCtx, float *pfftIn, float *pfftOut)
 {
-  static float fftTmp[FFT_SIZE_MAX];
+  float *fftTmp = pCtx->State.Fft.f32.Cmplx;
 
   // Compute the Fourier transform of the signal.
-  arm_rfft_fast_f32(pfftS, pfftIn, fftTmp, 0);
+  arm_rfft_fast_f32(&pCtx->fftS, pfftIn, fftTmp, 0);
 
   // Compute the two-sided spectrum
-  arm_cmplx_mag_f32(fftTmp, pfftOut, pfftS->fftLenRFFT / 2);
+  arm_cmplx_mag_f32(fftTmp, pfftOut, pCtx->fftS.fftLenRFFT / 2);
 }
 
 /**
   * @brief  Re-scaling the FFT Output after the RAW frequency Domain processing
   * @param  pfftCmplxMag description for pfftCmplxMag
   * @param  size description for size
+  * @param  WSF Scale factor to correct amplitude
   * @return none
   */
-void MotionSP_fftAdapt(sAxesMagBuff_t *pfftCmplxMag, uint16_t size)
+void MotionSP_fftAdapt(sAxesMagBuff_t *pfftCmplxMag, uint16_t size, float WSF)
 {
   for (int i = 0; i < size; i++)
   {
     if (i == 0) /* Adjust DC component */
     {
-      pfftCmplxMag->AXIS_X[i] = (pfftCmplxMag->AXIS_X[i] / (2 * size)) * Window_Scale_Factor;
-      pfftCmplxMag->AXIS_Y[i] = (pfftCmplxMag->AXIS_Y[i] / (2 * size)) * Window_Scale_Factor;
-      pfftCmplxMag->AXIS_Z[i] = (pfftCmplxMag->AXIS_Z[i] / (2 * size)) * Window_Scale_Factor;
+      pfftCmplxMag->AXIS_X[i] = (pfftCmplxMag->AXIS_X[i] / (2 * size)) * WSF;
+      pfftCmplxMag->AXIS_Y[i] = (pfftCmplxMag->AXIS_Y[i] / (2 * size)) * WSF;
+      pfftCmplxMag->AXIS_Z[i] = (pfftCmplxMag->AXIS_Z[i] / (2 * size)) * WSF;
     }
     else /* Adjust all the elements with i > 0 */
     {
-      pfftCmplxMag->AXIS_X[i] = (pfftCmplxMag->AXIS_X[i] / size) * Window_Scale_Factor;
-      pfftCmplxMag->AXIS_Y[i] = (pfftCmplxMag->AXIS_Y[i] / size) * Window_Scale_Factor;
-      pfftCmplxMag->AXIS_Z[i] = (pfftCmplxMag->AXIS_Z[i] / size) * Window_Scale_Factor;
+      pfftCmplxMag->AXIS_X[i] = (pfftCmplxMag->AXIS_X[i] / size) * WSF;
+      pfftCmplxMag->AXIS_Y[i] = (pfftCmplxMag->AXIS_Y[i] / size) * WSF;
+      pfftCmplxMag->AXIS_Z[i] = (pfftCmplxMag->AXIS_Z[i] / size) * WSF;
     }
   }
 }
@@ -696,13 +1005,18 @@ void MotionSP_fftPeakFinding(sAccMagResults_t *pAccMagResults)
 
 /**
   * @brief  Initialize Windowing Coefficient Arrays
-  * @param  Filter_Params pointer to filtering parameters array
+  * @param  pCtx pointer to the MotionSP context, filled in Filter_Params, Window_Scale_Factor
+  *         and the window normalizations (power sum and equivalent noise bandwidth)
   * @param  size filtering parameters array size
   * @param  Ftype filtering method
   * @return none
   */
-void MotionSP_SetWindFiltArray(float *Filter_Params, uint16_t size, Filt_Type_t Ftype)
+void MotionSP_SetWindFiltArray(MotionSP_Context_t *pCtx, uint16_t size, Filt_Type_t Ftype)
 {
+  float *Filter_Params = pCtx->Filter_Params;
+  float Mean;
+  float PowerSum;
+
   for (int i = 0; i < size; i++)
   {
     if (Ftype == RECTANGULAR)
@@ -731,21 +1045,34 @@ void MotionSP_SetWindFiltArray(float *Filter_Params, uint16_t size, Filt_Type_t
   switch (Ftype)
   {
     case RECTANGULAR:
-      Window_Scale_Factor = 1.0f;
+      pCtx->Window_Scale_Factor = 1.0f;
       break;
 
     case HANNING:
-      Window_Scale_Factor = 2.0f;
+      pCtx->Window_Scale_Factor = 2.0f;
       break;
 
     case HAMMING:
-      Window_Scale_Factor = 1.85f;
+      pCtx->Window_Scale_Factor = 1.85f;
       break;
 
     case FLAT_TOP:
-      Window_Scale_Factor = 4.55f;
+      pCtx->Window_Scale_Factor = 4.55f;
       break;
   }
+
+  // Sum and sum of squares of the coefficients, ENBW in bins = size * S2 / S1^2
+  arm_mean_f32(Filter_Params, size, &Mean);
+  arm_power_f32(Filter_Params, size, &PowerSum);
+  pCtx->Window_PowerSum = PowerSum;
+  pCtx->Window_Enbw = PowerSum / ((float)size * Mean * Mean);
+
+  pCtx->WindowSize = size;
+  pCtx->WindowType = (uint16_t)Ftype;
+
+#ifdef MOTIONSP_USE_Q15
+  arm_float_to_q15(Filter_Params, pCtx->Filter_Params_q15, size);
+#endif /* MOTIONSP_USE_Q15 */
 }
 
 /**
@@ -840,10 +1167,7 @@ uint8_t MotionSP_fftAverageCalcSamples(float *pDstArr, float *pSrcArr, uint16_t
   if (*pSumCnt == MaxSumCnt)
   {
     // calculate the average
-    for (j = 0; j < LenArr; j++)
-    {
-      *(pDstArr + j) = *(pDstArr + j) / (*pSumCnt);
-    }
+    arm_scale_f32(pDstArr, 1.0f / (float)(*pSumCnt), pDstArr, LenArr);
 
     // reset the number of times
     *pSumCnt = 0;
@@ -884,10 +1208,7 @@ uint8_t MotionSP_fftAverageCalcTime(float *pDstArr, float *pSrcArr, uint16_t Len
   if (FinishAvg)
   {
     // Process the average
-    for (uint16_t j = 0; j < LenArr; j++)
-    {
-      *(pDstArr + j) = *(pDstArr + j) / (*pSumCnt);
-    }
+    arm_scale_f32(pDstArr, 1.0f / (float)(*pSumCnt), pDstArr, LenArr);
 
     return 1;
   }
@@ -895,237 +1216,1279 @@ uint8_t MotionSP_fftAverageCalcTime(float *pDstArr, float *pSrcArr, uint16_t Len
   return 0;
 }
 
+#ifndef MOTIONSP_USE_Q15
 /**
-  * @brief  Frequency Domain Processing
-  * @param  None
+  * @brief  Apply the window to the three axes in one pass over a contiguous block
+  * @param  pDstX pointer to the X windowed array
+  * @param  pDstY pointer to the Y windowed array
+  * @param  pDstZ pointer to the Z windowed array
+  * @param  pSrcX pointer to the X input samples
+  * @param  pSrcY pointer to the Y input samples
+  * @param  pSrcZ pointer to the Z input samples
+  * @param  pWin pointer to the windowing coefficients
+  * @param  Len number of samples
   * @return None
   */
-void MotionSP_FrequencyDomainProcess(void)
+static void MotionSP_fftWindow3Axes(float *pDstX, float *pDstY, float *pDstZ,
+                                    const float *pSrcX, const float *pSrcY, const float *pSrcZ,
+                                    const float *pWin, uint16_t Len)
 {
-  static struct {
-    uint8_t xAccAvgRdy : 1;
-    uint8_t yAccAvgRdy : 1;
-    uint8_t zAccAvgRdy : 1;
-  } AvgRdy = {0,0,0};
- 
-  static sAccAxesArray_t AccAxesArray_fftIn;  //!< Array for acc axes input values for FFT
-  static float fftIn[FFT_SIZE_MAX];           //!< Array for input values for FFT
-  static float fftOut[FFT_SIZE_MAX];          //!< Array for output values for the complex magnitude function
+  uint16_t blkCnt = Len >> 2U;
+  float w0, w1, w2, w3;
 
-  /* ------------------ Freeze the Accelerometer data to analyze--------------*/
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_X, MotionSP_Parameters.FftSize, AccCircBuffer.Data.AXIS_X, AccCircBuffer.Size, accCircBuffIndexForFft);
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_Y, MotionSP_Parameters.FftSize, AccCircBuffer.Data.AXIS_Y, AccCircBuffer.Size, accCircBuffIndexForFft);
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_Z, MotionSP_Parameters.FftSize, AccCircBuffer.Data.AXIS_Z, AccCircBuffer.Size, accCircBuffIndexForFft);
-
-  /* ------------------ First Axis: Analysis on X-Acceleration--------------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_X, MotionSP_Parameters.FftSize, Filter_Params);
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccAxesAvgMagBuff.AXIS_X, fftOut, magSize, &(AccSumCnt.AXIS_X), FinishAvgFlag))
-  {
-    // Save the Max FFT Number evaluated
-    AccAxesMagResults.X_FFT_AVG = AccSumCnt.AXIS_X;
-    // Reset the FFT AVG Number for axis evaluated
-    AccSumCnt.AXIS_X = 0;
-    // AVG available
-    AvgRdy.xAccAvgRdy = 1;
-  }
-
-  /* ------------------ Second Axis: Analysis on Y-Acceleration ----------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_Y, MotionSP_Parameters.FftSize,
-                        Filter_Params); /* Evaluate FFT on Acc Data */
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccAxesAvgMagBuff.AXIS_Y, fftOut, magSize, &(AccSumCnt.AXIS_Y), FinishAvgFlag))
-  {
-    // Save the Max FFT Number evaluated
-    AccAxesMagResults.Y_FFT_AVG = AccSumCnt.AXIS_Y;    // Reset the FFT AVG Number for axis evaluated
-    AccSumCnt.AXIS_Y = 0;
-    // AVG available
-    AvgRdy.yAccAvgRdy = 1;
-  }
-
-  /* ------------------ Third Axis: Analysis on Z-Acceleration-------------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_Z, MotionSP_Parameters.FftSize, Filter_Params);
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccAxesAvgMagBuff.AXIS_Z, fftOut, magSize, &(AccSumCnt.AXIS_Z), FinishAvgFlag))
-  {
-    // Save the Max FFT Number evaluated
-    AccAxesMagResults.Z_FFT_AVG = AccSumCnt.AXIS_Z;
-    // Reset the FFT AVG Number for axis evaluated
-    AccSumCnt.AXIS_Z = 0;
-    // AVG available
-    AvgRdy.zAccAvgRdy = 1;
+  /* 4 samples of the 3 axes for each window coefficients load */
+  while (blkCnt > 0U)
+  {
+    w0 = pWin[0];
+    w1 = pWin[1];
+    w2 = pWin[2];
+    w3 = pWin[3];
+
+    pDstX[0] = pSrcX[0] * w0;
+    pDstY[0] = pSrcY[0] * w0;
+    pDstZ[0] = pSrcZ[0] * w0;
+    pDstX[1] = pSrcX[1] * w1;
+    pDstY[1] = pSrcY[1] * w1;
+    pDstZ[1] = pSrcZ[1] * w1;
+    pDstX[2] = pSrcX[2] * w2;
+    pDstY[2] = pSrcY[2] * w2;
+    pDstZ[2] = pSrcZ[2] * w2;
+    pDstX[3] = pSrcX[3] * w3;
+    pDstY[3] = pSrcY[3] * w3;
+    pDstZ[3] = pSrcZ[3] * w3;
+
+    pWin += 4;
+    pSrcX += 4;
+    pSrcY += 4;
+    pSrcZ += 4;
+    pDstX += 4;
+    pDstY += 4;
+    pDstZ += 4;
+    blkCnt--;
   }
 
-  /* ---------------------------- Finish ----------------------------------*/
-  if (AvgRdy.xAccAvgRdy & AvgRdy.yAccAvgRdy & AvgRdy.zAccAvgRdy) 
+  blkCnt = Len & 0x3U;
+  while (blkCnt > 0U)
   {
-    MotionSP_fftAdapt(&AccAxesAvgMagBuff, magSize);
-    MotionSP_fftFindPeak(&AccAxesAvgMagBuff, magSize, &AccAxesMagResults);
-
-
-#ifdef USE_SUBRANGE	
-    MotionSP_evalMaxAmplitudeRange (AccAxesAvgMagBuff.AXIS_X, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_X, SRBinVal.AXIS_X);
-    MotionSP_evalMaxAmplitudeRange (AccAxesAvgMagBuff.AXIS_Y, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_Y, SRBinVal.AXIS_Y);
-    MotionSP_evalMaxAmplitudeRange (AccAxesAvgMagBuff.AXIS_Z, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_Z, SRBinVal.AXIS_Z);
-#endif /* USE_SUBRANGE */
-
-    AvgRdy.xAccAvgRdy = 0;
-    AvgRdy.yAccAvgRdy = 0;
-    AvgRdy.zAccAvgRdy = 0;
+    w0 = *pWin++;
+    *pDstX++ = *pSrcX++ * w0;
+    *pDstY++ = *pSrcY++ * w0;
+    *pDstZ++ = *pSrcZ++ * w0;
+    blkCnt--;
   }
 }
 
 /**
-  * @brief  Frequency Domain Analysis
-  * @param  avg Performing average
-  * @return None
+  * @brief  Get the windowed FFT-In arrays of the three axes from the circular buffer
+  *         (same data as MotionSP_fftInBuild followed by motionSP_fftUseWindow, without the staging copy)
+  * @param  pDst pointer to the destination arrays
+  * @param  DstSize destination array size
+  * @param  pSrc pointer to the circular buffer
+  * @param  SrcLastPos last index of data to be taken
+  * @param  pWin pointer to the windowing coefficients
+  * @retval 0 in case of success
+  * @retval 1 in case of failure
   */
-void MotionSP_fftExecution(uint8_t avg)
+static uint8_t MotionSP_fftWindowFromCircBuff(sAccAxesArray_t *pDst, uint16_t DstSize, sCircBuffer_t *pSrc, uint16_t SrcLastPos, const float *pWin)
 {
-  static struct
-  {
-    uint16_t X;
-    uint16_t Y;
-    uint16_t Z;
-  } FftCnt = {0,0,0};       //!< Sum counter for FFT during averaging
+  int16_t initPos;
+  uint16_t pos2end;
+  uint16_t SrcSize = pSrc->Size;
 
-  static struct
+  if (SrcLastPos >= SrcSize)
   {
-    uint8_t X: 1;
-    uint8_t Y: 1;
-    uint8_t Z: 1;
-  } IsFftAvgRdy = {0,0,0};  //!< FFT average has been done
- 
-  static sAccAxesArray_t AccAxesArray_fftIn;  //!< Array for acc axes input values for FFT
-  static float fftIn[FFT_SIZE_MAX];           //!< Array for input values for FFT
-  static float fftOut[FFT_SIZE_MAX];          //!< Array for output values for the complex magnitude function
+    return 1;
+  }
 
-  /* ------------------ Freeze the Accelerometer data to analyze--------------*/
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_X, MotionSP_Parameters.FftSize, MotionSP_Data.AccCircBuff.Array.X, MotionSP_Data.AccCircBuff.Size, accCircBuffIndexForFft);
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_Y, MotionSP_Parameters.FftSize, MotionSP_Data.AccCircBuff.Array.Y, MotionSP_Data.AccCircBuff.Size, accCircBuffIndexForFft);
-  MotionSP_fftInBuild(AccAxesArray_fftIn.AXIS_Z, MotionSP_Parameters.FftSize, MotionSP_Data.AccCircBuff.Array.Z, MotionSP_Data.AccCircBuff.Size, accCircBuffIndexForFft);
-  
-  /* ------------------ First Axis: Analysis on X-Acceleration--------------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_X, MotionSP_Parameters.FftSize, Filter_Params);
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccMagResults.Array.X, fftOut, AccMagResults.MagSizeTBU, &(FftCnt.X), avg))
+  // Replace the last index of data to be taken with the first one
+  initPos = SrcLastPos - (DstSize - 1);
+  if (initPos < 0)
   {
-    // Save the max evaluated FFT Number
-    AccMagResults.FFT_Items.X = FftCnt.X;
-    // Set flag about available average
-    IsFftAvgRdy.X = 1;
+    initPos += SrcSize;
   }
 
-  /* ------------------ Second Axis: Analysis on Y-Acceleration ----------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_Y, MotionSP_Parameters.FftSize, Filter_Params);
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccMagResults.Array.Y, fftOut, AccMagResults.MagSizeTBU, &(FftCnt.Y), avg))
+  if (initPos <= (SrcSize - DstSize))
   {
-    // Save the max evaluated FFT Number
-    AccMagResults.FFT_Items.Y = FftCnt.Y;
-    // Set flag about available average
-    IsFftAvgRdy.Y = 1;
+    pos2end = DstSize;
   }
-
-  /* ------------------ Third Axis: Analysis on Z-Acceleration-------------*/
-  /* Apply the Windowing before to perform FFT */
-  motionSP_fftUseWindow(fftIn, AccAxesArray_fftIn.AXIS_Z, MotionSP_Parameters.FftSize, Filter_Params);
-  MotionSP_fftCalc(&fftS, fftIn, fftOut);
-  if (MotionSP_fftAverageCalcTime(AccMagResults.Array.Z, fftOut, AccMagResults.MagSizeTBU, &(FftCnt.Z), avg))
+  else
   {
-    // Save the max evaluated FFT Number
-    AccMagResults.FFT_Items.Z = FftCnt.Z;
-    // Set flag about available average
-    IsFftAvgRdy.Z = 1;
+    pos2end = SrcSize - initPos;
   }
 
-  /* ---------------------------- Finish ----------------------------------*/
-  if (IsFftAvgRdy.X & IsFftAvgRdy.Y & IsFftAvgRdy.Z) 
+  MotionSP_fftWindow3Axes(pDst->AXIS_X, pDst->AXIS_Y, pDst->AXIS_Z,
+                          &pSrc->Data.AXIS_X[initPos], &pSrc->Data.AXIS_Y[initPos], &pSrc->Data.AXIS_Z[initPos],
+                          pWin, pos2end);
+
+  if (pos2end < DstSize)
   {
-    MotionSP_fftAdapting(&AccMagResults, Window_Scale_Factor);
-    MotionSP_fftPeakFinding(&AccMagResults);
+    // Wrap around the end of the circular buffer
+    MotionSP_fftWindow3Axes(&pDst->AXIS_X[pos2end], &pDst->AXIS_Y[pos2end], &pDst->AXIS_Z[pos2end],
+                            pSrc->Data.AXIS_X, pSrc->Data.AXIS_Y, pSrc->Data.AXIS_Z,
+                            &pWin[pos2end], DstSize - pos2end);
+  }
 
-#ifdef USE_SUBRANGE	
-    MotionSP_evalMaxAmplitudeRange (AccMagResults.Array.X, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_X, SRBinVal.AXIS_X);
-    MotionSP_evalMaxAmplitudeRange (AccMagResults.Array.Y, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_Y, SRBinVal.AXIS_Y);
-    MotionSP_evalMaxAmplitudeRange (AccMagResults.Array.Z, MotionSP_Parameters.subrange_num, SRAmplitude.AXIS_Z, SRBinVal.AXIS_Z);
-#endif /* USE_SUBRANGE */
+  return 0;
+}
+
+#ifdef MOTIONSP_USE_PSD
+/**
+  * @brief  Squared magnitude of the RFFT output added to the power sum, without square roots
+  * @param  pSum pointer to the power sum array
+  * @param  pCmplx pointer to the RFFT output (interleaved real and imaginary parts)
+  * @param  pPow pointer to a scratch array of MagSize values
+  * @param  MagSize number of power values
+  * @param  Reset 1 to start a new power sum
+  * @return None
+  */
+static void MotionSP_fftPowerAccumulate(float *pSum, const float *pCmplx, float *pPow, uint16_t MagSize, uint8_t Reset)
+{
+  float *pDst = (Reset) ? pSum : pPow;
+
+  arm_cmplx_mag_squared_f32((float *)pCmplx, pDst, MagSize);
 
-    // Reset FFT sum counter
-    FftCnt.X = 0;
-    FftCnt.Y = 0;
-    FftCnt.Z = 0;
+  // arm_rfft_fast_f32 packs the real Nyquist value in the imaginary part of the DC bin
+  pDst[0] = pCmplx[0] * pCmplx[0];
 
-    // Reset FFT average status
-    IsFftAvgRdy.X = 0;
-    IsFftAvgRdy.Y = 0;
-    IsFftAvgRdy.Z = 0;
+  if (!Reset)
+  {
+    arm_add_f32(pSum, pPow, pSum, MagSize);
   }
 }
-
+#else /* MOTIONSP_USE_PSD */
 /**
-  * @brief FFT subrange analysis to detect the Max Amplitude and related Bin frequency for each subranges
-  * @param pfftCmplxMagAxis: FFT Input Arrays to analyze for each subrange
-  * @param subrange:  Subranges number
-  * @param SR_Amplitude: Max Amplitude for each Subrange analyzed
-  * @param SR_Bin_Value: Bin Frequency related to Max Amplitude detected inside subrange analyzed
+  * @brief  Complex magnitude of the RFFT output added to the average sum
+  * @param  pAvg pointer to the average sum array
+  * @param  pCmplx pointer to the RFFT output (interleaved real and imaginary parts)
+  * @param  MagSize number of magnitude values
+  * @param  Reset 1 to start a new average sum
   * @return None
   */
-void MotionSP_evalMaxAmplitudeRange(float *pfftCmplxMagAxis, uint16_t subrange, float *SR_Amplitude, float *SR_Bin_Value)
+static void MotionSP_fftMagAccumulate(float *pAvg, const float *pCmplx, uint16_t MagSize, uint8_t Reset)
 {
-  uint8_t winsamples;
-  float MaxValue;
-  uint32_t MaxIndex;
-  uint16_t FFTindex;
-  winsamples = AccMagResults.MagSizeTBU / subrange;
-  for (int i = 0; i < subrange; i++)
+  float re, im, mag;
+  uint16_t i;
+
+  if (Reset)
   {
-    FFTindex = winsamples * i;
-    arm_max_f32(&pfftCmplxMagAxis[FFTindex], winsamples, &MaxValue, &MaxIndex);
-    SR_Amplitude[i] = MaxValue;
-    SR_Bin_Value[i] = MaxIndex + FFTindex;
+    for (i = 0; i < MagSize; i++)
+    {
+      re = pCmplx[2 * i];
+      im = pCmplx[(2 * i) + 1];
+      arm_sqrt_f32((re * re) + (im * im), &pAvg[i]);
+    }
+  }
+  else
+  {
+    for (i = 0; i < MagSize; i++)
+    {
+      re = pCmplx[2 * i];
+      im = pCmplx[(2 * i) + 1];
+      arm_sqrt_f32((re * re) + (im * im), &mag);
+      pAvg[i] += mag;
+    }
   }
 }
+#endif /* MOTIONSP_USE_PSD */
+#else /* MOTIONSP_USE_Q15 */
+/**
+  * @brief  Apply the Q15 window to a contiguous block of Q15 samples
+  * @param  pDst pointer to the windowed array in Q31
+  * @param  pSrc pointer to the input samples
+  * @param  pWin pointer to the windowing coefficients
+  * @param  Len number of samples
+  * @return None
+  */
+static void MotionSP_fftWindow_q15(q31_t *pDst, const q15_t *pSrc, const q15_t *pWin, uint16_t Len)
+{
+  uint16_t blkCnt = Len >> 2U;
+
+  /* Q15 x Q15 product kept in Q31 */
+  while (blkCnt > 0U)
+  {
+    pDst[0] = ((q31_t)pSrc[0] * pWin[0]) << 1;
+    pDst[1] = ((q31_t)pSrc[1] * pWin[1]) << 1;
+    pDst[2] = ((q31_t)pSrc[2] * pWin[2]) << 1;
+    pDst[3] = ((q31_t)pSrc[3] * pWin[3]) << 1;
+
+    pWin += 4;
+    pSrc += 4;
+    pDst += 4;
+    blkCnt--;
+  }
+
+  blkCnt = Len & 0x3U;
+  while (blkCnt > 0U)
+  {
+    *pDst++ = ((q31_t)*pSrc++ * *pWin++) << 1;
+    blkCnt--;
+  }
+}
+
+/**
+  * @brief  Get the windowed Q31 FFT-In array of one axis from the circular buffer of Q15 samples
+  * @param  pDst pointer to the destination array
+  * @param  DstSize destination array size
+  * @param  pSrc pointer to the circular buffer axis
+  * @param  SrcSize circular buffer size
+  * @param  SrcLastPos last index of data to be taken
+  * @param  pWin pointer to the windowing coefficients
+  * @retval 0 in case of success
+  * @retval 1 in case of failure
+  */
+static uint8_t MotionSP_fftWindowFromCircBuff_q15(q31_t *pDst, uint16_t DstSize, const q15_t *pSrc, uint16_t SrcSize, uint16_t SrcLastPos, const q15_t *pWin)
+{
+  int16_t initPos;
+  uint16_t pos2end;
+
+  if (SrcLastPos >= SrcSize)
+  {
+    return 1;
+  }
+
+  // Replace the last index of data to be taken with the first one
+  initPos = SrcLastPos - (DstSize - 1);
+  if (initPos < 0)
+  {
+    initPos += SrcSize;
+  }
+
+  if (initPos <= (SrcSize - DstSize))
+  {
+    pos2end = DstSize;
+  }
+  else
+  {
+    pos2end = SrcSize - initPos;
+  }
+
+  MotionSP_fftWindow_q15(pDst, &pSrc[initPos], pWin, pos2end);
+
+  if (pos2end < DstSize)
+  {
+    // Wrap around the end of the circular buffer
+    MotionSP_fftWindow_q15(&pDst[pos2end], pSrc, &pWin[pos2end], DstSize - pos2end);
+  }
+
+  return 0;
+}
+
+#ifdef MOTIONSP_USE_PSD
+/**
+  * @brief  Squared magnitude of the Q31 RFFT output added to the power sum
+  *         The squares are summed in float, so that neither the square root nor the 64-bit
+  *         normalization of MotionSP_fftMag_q31 is needed
+  * @param  pSum pointer to the power sum array
+  * @param  pCmplx pointer to the RFFT output (interleaved real and imaginary parts)
+  * @param  MagSize number of power values
+  * @param  Reset 1 to start a new power sum
+  * @return None
+  */
+static void MotionSP_fftPowerAccumulate_q31(float *pSum, const q31_t *pCmplx, uint16_t MagSize, uint8_t Reset)
+{
+  float re, im;
+  uint16_t i;
+
+  if (Reset)
+  {
+    for (i = 0; i < MagSize; i++)
+    {
+      re = (float)pCmplx[2 * i];
+      im = (float)pCmplx[(2 * i) + 1];
+      pSum[i] = (re * re) + (im * im);
+    }
+  }
+  else
+  {
+    for (i = 0; i < MagSize; i++)
+    {
+      re = (float)pCmplx[2 * i];
+      im = (float)pCmplx[(2 * i) + 1];
+      pSum[i] += (re * re) + (im * im);
+    }
+  }
+}
+#else /* MOTIONSP_USE_PSD */
+/**
+  * @brief  Complex magnitude of the Q31 RFFT output
+  *         Same units of the input like arm_cmplx_mag_q31, but the square root is taken
+  *         on the normalized 64-bit sum of squares, so that the small bins keep their precision
+  * @param  pCmplx pointer to the RFFT output (interleaved real and imaginary parts)
+  * @param  pMag pointer to the magnitude values
+  * @param  MagSize number of magnitude values
+  * @return None
+  */
+static void MotionSP_fftMag_q31(const q31_t *pCmplx, q31_t *pMag, uint16_t MagSize)
+{
+  uint64_t Sum;
+  uint32_t Hi;
+  int8_t Norm;
+  q31_t Root;
+  uint16_t i;
+
+  for (i = 0; i < MagSize; i++)
+  {
+    Sum = (uint64_t)((q63_t)pCmplx[2 * i] * pCmplx[2 * i]) +
+          (uint64_t)((q63_t)pCmplx[(2 * i) + 1] * pCmplx[(2 * i) + 1]);
+
+    if (Sum == 0U)
+    {
+      pMag[i] = 0;
+      continue;
+    }
+
+    // Even shift that brings the most significant bit of the sum to bit 61 or 60
+    Hi = (uint32_t)(Sum >> 32);
+    Norm = (int8_t)((Hi != 0U) ? __CLZ(Hi) : (32U + __CLZ((uint32_t)Sum))) - 2;
+    Norm &= ~1;
+
+    // sqrt(x / 2^31) * 2^31 with x = Sum * 2^Norm / 2^31 gives sqrt(Sum) * 2^(Norm/2)
+    if (Norm >= 0)
+    {
+      arm_sqrt_q31((q31_t)((Sum << Norm) >> 31), &Root);
+      pMag[i] = Root >> (Norm / 2);
+    }
+    else
+    {
+      arm_sqrt_q31((q31_t)(Sum >> (31 - Norm)), &Root);
+      pMag[i] = Root << (-Norm / 2);
+    }
+  }
+}
+
+/**
+  * @brief  Q31 FFT magnitude added to the average sum
+  * @param  pAvg pointer to the average sum array
+  * @param  pMag pointer to the magnitude values
+  * @param  MagSize number of magnitude values
+  * @param  Reset 1 to start a new average sum
+  * @return None
+  */
+static void MotionSP_fftMagAccumulate_q31(float *pAvg, const q31_t *pMag, uint16_t MagSize, uint8_t Reset)
+{
+  uint16_t i;
+
+  if (Reset)
+  {
+    for (i = 0; i < MagSize; i++)
+    {
+      pAvg[i] = (float)pMag[i];
+    }
+  }
+  else
+  {
+    for (i = 0; i < MagSize; i++)
+    {
+      pAvg[i] += (float)pMag[i];
+    }
+  }
+}
+#endif /* MOTIONSP_USE_PSD */
+#endif /* MOTIONSP_USE_Q15 */
+
+#ifdef MOTIONSP_USE_PSD
+/**
+  * @brief  Complete the Welch average: one sided power spectral density in g^2/Hz
+  *         PSD = 2 * |X|^2 / (fs * S2 * n), with S2 the sum of the squared window coefficients,
+  *         applied with a single multiplication for each bin
+  * @param  pCtx pointer to the MotionSP context
+  * @param  PowerScale conversion of the squared FFT output to (m/s^2)^2
+  * @return None
+  */
+static void MotionSP_fftPsdDone(MotionSP_Context_t *pCtx, float PowerScale)
+{
+  float *pAvg[3] = {pCtx->AccAxesAvgMagBuff.AXIS_X, pCtx->AccAxesAvgMagBuff.AXIS_Y, pCtx->AccAxesAvgMagBuff.AXIS_Z};
+  float Scale;
+  uint8_t axis;
+
+  Scale = (2.0f * PowerScale) / (pCtx->AcceleroODR.Frequency * pCtx->Window_PowerSum * G_CONST * G_CONST *
+                                 (float)pCtx->AccSumCnt.AXIS_X);
+  for (axis = 0; axis < 3; axis++)
+  {
+    arm_scale_f32(pAvg[axis], Scale, pAvg[axis], pCtx->magSize);
+    /* DC component is not doubled by the one sided density */
+    pAvg[axis][0] *= 0.5f;
+  }
+
+  MotionSP_fftAverageDone(pCtx);
+}
+
+/**
+  * @brief  Convert the peaks found on the PSD to the sine amplitudes in m/s^2,
+  *         A = sqrt(2 * PSD * ENBW * df) * G_CONST, so that the thresholds keep their units
+  * @param  pCtx pointer to the MotionSP context
+  * @return None
+  */
+static void MotionSP_fftPsdToAmplitude(MotionSP_Context_t *pCtx)
+{
+  float Scale = 2.0f * pCtx->Window_Enbw * (pCtx->AcceleroODR.Frequency / (float)pCtx->Parameters.FftSize) *
+                G_CONST * G_CONST;
+
+  arm_sqrt_f32(pCtx->AccAxesMagResults.X_Value * Scale, &pCtx->AccAxesMagResults.X_Value);
+  arm_sqrt_f32(pCtx->AccAxesMagResults.Y_Value * Scale, &pCtx->AccAxesMagResults.Y_Value);
+  arm_sqrt_f32(pCtx->AccAxesMagResults.Z_Value * Scale, &pCtx->AccAxesMagResults.Z_Value);
+
+#ifdef USE_SUBRANGE
+  for (uint16_t i = 0; i < pCtx->Parameters.subrange_num; i++)
+  {
+    arm_sqrt_f32(pCtx->SRAmplitude.AXIS_X[i] * Scale, &pCtx->SRAmplitude.AXIS_X[i]);
+    arm_sqrt_f32(pCtx->SRAmplitude.AXIS_Y[i] * Scale, &pCtx->SRAmplitude.AXIS_Y[i]);
+    arm_sqrt_f32(pCtx->SRAmplitude.AXIS_Z[i] * Scale, &pCtx->SRAmplitude.AXIS_Z[i]);
+  }
+#endif /* USE_SUBRANGE */
+}
+#endif /* MOTIONSP_USE_PSD */
+
+/**
+  * @brief  Complete the FFT average: save the number of averaged spectra and look for the peaks
+  * @param  pCtx pointer to the MotionSP context
+  * @return None
+  */
+static void MotionSP_fftAverageDone(MotionSP_Context_t *pCtx)
+{
+  // Save the Max FFT Number evaluated
+  pCtx->AccAxesMagResults.X_FFT_AVG = pCtx->AccSumCnt.AXIS_X;
+  pCtx->AccAxesMagResults.Y_FFT_AVG = pCtx->AccSumCnt.AXIS_Y;
+  pCtx->AccAxesMagResults.Z_FFT_AVG = pCtx->AccSumCnt.AXIS_Z;
+  // Reset the FFT AVG Number for axes evaluated
+  pCtx->AccSumCnt.AXIS_X = 0;
+  pCtx->AccSumCnt.AXIS_Y = 0;
+  pCtx->AccSumCnt.AXIS_Z = 0;
+
+  MotionSP_fftFindPeak(&pCtx->AccAxesAvgMagBuff, pCtx->magSize, &pCtx->AccAxesMagResults);
+
+#ifdef USE_SUBRANGE	
+  MotionSP_evalMaxAmplitudeRange(pCtx, pCtx->AccAxesAvgMagBuff.AXIS_X, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_X, pCtx->SRBinVal.AXIS_X);
+  MotionSP_evalMaxAmplitudeRange(pCtx, pCtx->AccAxesAvgMagBuff.AXIS_Y, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_Y, pCtx->SRBinVal.AXIS_Y);
+  MotionSP_evalMaxAmplitudeRange(pCtx, pCtx->AccAxesAvgMagBuff.AXIS_Z, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_Z, pCtx->SRBinVal.AXIS_Z);
+#endif /* USE_SUBRANGE */
+
+#ifdef MOTIONSP_USE_PSD
+  MotionSP_fftPsdToAmplitude(pCtx);
+#endif /* MOTIONSP_USE_PSD */
+}
+
+#ifndef MOTIONSP_USE_Q15
+/**
+  * @brief  Frequency Domain Processing
+  *         The three axes are windowed together straight from the circular buffer into
+  *         State.Fft.f32.In, then each FFT magnitude is accumulated in the average.
+  *         The three windowed axes need 3 * FFT_SIZE_MAX floats of scratch (24 KB at 2048 points)
+  * @param  pCtx pointer to the MotionSP context
+  * @return None
+  */
+void MotionSP_FrequencyDomainProcess(MotionSP_Context_t *pCtx)
+{
+  sAccAxesArray_t *pfftInArr = &pCtx->State.Fft.f32.In;  //!< Windowed acc axes input values for FFT
+  float *fftTmp = pCtx->State.Fft.f32.Cmplx;             //!< Complex FFT output
+
+  float *pfftIn[3] = {pfftInArr->AXIS_X, pfftInArr->AXIS_Y, pfftInArr->AXIS_Z};
+  float *pAvg[3] = {pCtx->AccAxesAvgMagBuff.AXIS_X, pCtx->AccAxesAvgMagBuff.AXIS_Y, pCtx->AccAxesAvgMagBuff.AXIS_Z};
+#ifndef MOTIONSP_USE_PSD
+  float Scale;
+#endif /* MOTIONSP_USE_PSD */
+  uint8_t axis;
+
+  /* ------------------ Freeze and window the Accelerometer data to analyze ---*/
+  if (MotionSP_fftWindowFromCircBuff(pfftInArr, pCtx->Parameters.FftSize,
+                                     &pCtx->AccCircBuffer, pCtx->accCircBuffIndexForFft, pCtx->Filter_Params))
+  {
+    return;
+  }
+
+  /* ------------------ X, Y and Z FFT added to the average -------------------*/
+  for (axis = 0; axis < 3; axis++)
+  {
+    arm_rfft_fast_f32(&pCtx->fftS, pfftIn[axis], fftTmp, 0);
+#ifdef MOTIONSP_USE_PSD
+    MotionSP_fftPowerAccumulate(pAvg[axis], fftTmp, pCtx->State.Fft.f32.Mag, pCtx->magSize, (pCtx->AccSumCnt.AXIS_X == 0));
+#else /* MOTIONSP_USE_PSD */
+    MotionSP_fftMagAccumulate(pAvg[axis], fftTmp, pCtx->magSize, (pCtx->AccSumCnt.AXIS_X == 0));
+#endif /* MOTIONSP_USE_PSD */
+  }
+
+  // The three axes are always averaged together
+  pCtx->AccSumCnt.AXIS_X += 1;
+  pCtx->AccSumCnt.AXIS_Y = pCtx->AccSumCnt.AXIS_X;
+  pCtx->AccSumCnt.AXIS_Z = pCtx->AccSumCnt.AXIS_X;
+
+  /* ---------------------------- Finish ----------------------------------*/
+  if (pCtx->FinishAvgFlag)
+  {
+#ifdef MOTIONSP_USE_PSD
+    MotionSP_fftPsdDone(pCtx, 1.0f);
+#else /* MOTIONSP_USE_PSD */
+    // Average and re-scaling (MotionSP_fftAdapt) in a single pass
+    Scale = pCtx->Window_Scale_Factor / ((float)pCtx->magSize * (float)pCtx->AccSumCnt.AXIS_X);
+    for (axis = 0; axis < 3; axis++)
+    {
+      arm_scale_f32(pAvg[axis], Scale, pAvg[axis], pCtx->magSize);
+      /* Adjust DC component */
+      pAvg[axis][0] *= 0.5f;
+    }
+
+    MotionSP_fftAverageDone(pCtx);
+#endif /* MOTIONSP_USE_PSD */
+  }
+}
+#else /* MOTIONSP_USE_Q15 */
+/**
+  * @brief  Frequency Domain Processing in fixed point
+  *         Each axis is windowed in Q31 straight from the circular buffer of Q15 samples,
+  *         transformed by the Q31 RFFT and its magnitude is accumulated in the average.
+  *         It halves the circular buffer RAM but it is not faster than the float FFT:
+  *         the Q31 RFFT and the 64-bit magnitude take about twice its time in the host replay
+  * @param  pCtx pointer to the MotionSP context
+  * @return None
+  */
+void MotionSP_FrequencyDomainProcess(MotionSP_Context_t *pCtx)
+{
+  q31_t *fftIn = pCtx->State.Fft.q31.In;    //!< Windowed input values of one axis, then its magnitude
+  q31_t *fftOut = pCtx->State.Fft.q31.Out;  //!< Complex Q31 RFFT output
+
+  const q15_t *pSrc[3] = {pCtx->AccCircBuffer.Data.AXIS_X, pCtx->AccCircBuffer.Data.AXIS_Y, pCtx->AccCircBuffer.Data.AXIS_Z};
+  float *pAvg[3] = {pCtx->AccAxesAvgMagBuff.AXIS_X, pCtx->AccAxesAvgMagBuff.AXIS_Y, pCtx->AccAxesAvgMagBuff.AXIS_Z};
+  float Scale;
+  uint8_t Reset = (pCtx->AccSumCnt.AXIS_X == 0);
+  uint8_t axis;
+
+  /* ------------------ X, Y and Z FFT added to the average -------------------*/
+  for (axis = 0; axis < 3; axis++)
+  {
+    /* Freeze and window the Accelerometer data to analyze */
+    if (MotionSP_fftWindowFromCircBuff_q15(fftIn, pCtx->Parameters.FftSize, pSrc[axis],
+                                           pCtx->AccCircBuffer.Size, pCtx->accCircBuffIndexForFft, pCtx->Filter_Params_q15))
+    {
+      return;
+    }
+
+    arm_rfft_q31(&pCtx->fftS_q31, fftIn, fftOut);
+#ifdef MOTIONSP_USE_PSD
+    MotionSP_fftPowerAccumulate_q31(pAvg[axis], fftOut, pCtx->magSize, Reset);
+#else /* MOTIONSP_USE_PSD */
+    MotionSP_fftMag_q31(fftOut, fftIn, pCtx->magSize);
+    MotionSP_fftMagAccumulate_q31(pAvg[axis], fftIn, pCtx->magSize, Reset);
+#endif /* MOTIONSP_USE_PSD */
+  }
+
+  // The three axes are always averaged together
+  pCtx->AccSumCnt.AXIS_X += 1;
+  pCtx->AccSumCnt.AXIS_Y = pCtx->AccSumCnt.AXIS_X;
+  pCtx->AccSumCnt.AXIS_Z = pCtx->AccSumCnt.AXIS_X;
+
+  /* ---------------------------- Finish ----------------------------------*/
+  if (pCtx->FinishAvgFlag)
+  {
+    // The Q31 RFFT output is downscaled by FftSize/2: |X| [LSB] = Mag * FftSize / 2^16
+#ifdef MOTIONSP_USE_PSD
+    Scale = ((float)pCtx->Parameters.FftSize / 65536.0f) * pCtx->SampleScale;
+    MotionSP_fftPsdDone(pCtx, Scale * Scale);
+#else /* MOTIONSP_USE_PSD */
+    // then to m/s^2 with the average and re-scaling
+    Scale = ((float)pCtx->Parameters.FftSize / 65536.0f) * pCtx->SampleScale *
+            (pCtx->Window_Scale_Factor / ((float)pCtx->magSize * (float)pCtx->AccSumCnt.AXIS_X));
+    for (axis = 0; axis < 3; axis++)
+    {
+      arm_scale_f32(pAvg[axis], Scale, pAvg[axis], pCtx->magSize);
+      /* Adjust DC component */
+      pAvg[axis][0] *= 0.5f;
+    }
+
+    MotionSP_fftAverageDone(pCtx);
+#endif /* MOTIONSP_USE_PSD */
+  }
+}
+#endif /* MOTIONSP_USE_Q15 */
+
+/**
+  * @brief  Frequency Domain Analysis
+  * @param  pCtx pointer to the MotionSP context, data from pCtx->Data.AccCircBuff
+  * @param  avg Performing average
+  * @return None
+  */
+void MotionSP_fftExecution(MotionSP_Context_t *pCtx, uint8_t avg)
+{
+  sMotionSP_State_t *pState = &pCtx->State;
+  sAccAxesArray_t *pfftIn = &pState->Fft.f32.In;  //!< Acc axes input values for FFT, windowed in place
+  float *fftOut = pState->Fft.f32.Mag;            //!< Output values for the complex magnitude function
+  sAccMagResults_t *pMag = &pCtx->AccMagResults;
+  sCircBuff_t *pCirc = &pCtx->Data.AccCircBuff;
+  uint16_t FftSize = pCtx->Parameters.FftSize;
+  float *pIn[NUM_AXES] = {pfftIn->AXIS_X, pfftIn->AXIS_Y, pfftIn->AXIS_Z};
+  float *pRes[NUM_AXES] = {pMag->Array.X, pMag->Array.Y, pMag->Array.Z};
+  uint16_t *pItems[NUM_AXES] = {&pMag->FFT_Items.X, &pMag->FFT_Items.Y, &pMag->FFT_Items.Z};
+  uint8_t axis;
+
+  /* ------------------ Freeze the Accelerometer data to analyze--------------*/
+  MotionSP_fftInBuild(pfftIn->AXIS_X, FftSize, pCirc->Array.X, pCirc->Size, pCtx->accCircBuffIndexForFft);
+  MotionSP_fftInBuild(pfftIn->AXIS_Y, FftSize, pCirc->Array.Y, pCirc->Size, pCtx->accCircBuffIndexForFft);
+  MotionSP_fftInBuild(pfftIn->AXIS_Z, FftSize, pCirc->Array.Z, pCirc->Size, pCtx->accCircBuffIndexForFft);
+
+  /* ------------------ X, Y and Z Analysis ---------------------------------*/
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    /* Apply the Windowing before to perform FFT */
+    motionSP_fftUseWindow(pIn[axis], pIn[axis], FftSize, pCtx->Filter_Params);
+    MotionSP_fftCalc(pCtx, pIn[axis], fftOut);
+    if (MotionSP_fftAverageCalcTime(pRes[axis], fftOut, pMag->MagSizeTBU, &pState->FftCnt[axis], avg))
+    {
+      // Save the max evaluated FFT Number
+      *pItems[axis] = pState->FftCnt[axis];
+      // Set flag about available average
+      pState->FftAvgRdy[axis] = 1;
+    }
+  }
+
+  /* ---------------------------- Finish ----------------------------------*/
+  if (pState->FftAvgRdy[0] & pState->FftAvgRdy[1] & pState->FftAvgRdy[2])
+  {
+    MotionSP_fftAdapting(pMag, pCtx->Window_Scale_Factor);
+    MotionSP_fftPeakFinding(pMag);
+
+#ifdef USE_SUBRANGE	
+    MotionSP_evalMaxAmplitudeRange(pCtx, pMag->Array.X, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_X, pCtx->SRBinVal.AXIS_X);
+    MotionSP_evalMaxAmplitudeRange(pCtx, pMag->Array.Y, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_Y, pCtx->SRBinVal.AXIS_Y);
+    MotionSP_evalMaxAmplitudeRange(pCtx, pMag->Array.Z, pCtx->Parameters.subrange_num, pCtx->SRAmplitude.AXIS_Z, pCtx->SRBinVal.AXIS_Z);
+#endif /* USE_SUBRANGE */
+
+    // Reset FFT sum counter and average status
+    memset((void *)pState->FftCnt, 0, sizeof(pState->FftCnt));
+    memset((void *)pState->FftAvgRdy, 0, sizeof(pState->FftAvgRdy));
+  }
+}
+
+/**
+  * @brief FFT subrange analysis to detect the Max Amplitude and related Bin frequency for each subranges
+  * @param pCtx: pointer to the MotionSP context
+  * @param pfftCmplxMagAxis: FFT Input Arrays to analyze for each subrange
+  * @param subrange:  Subranges number
+  * @param SR_Amplitude: Max Amplitude for each Subrange analyzed
+  * @param SR_Bin_Value: Bin Frequency related to Max Amplitude detected inside subrange analyzed
+  * @return None
+  */
+void MotionSP_evalMaxAmplitudeRange(MotionSP_Context_t *pCtx, float *pfftCmplxMagAxis, uint16_t subrange, float *SR_Amplitude, float *SR_Bin_Value)
+{
+  uint8_t winsamples;
+  float MaxValue;
+  uint32_t MaxIndex;
+  uint16_t FFTindex;
+  winsamples = pCtx->AccMagResults.MagSizeTBU / subrange;
+  for (int i = 0; i < subrange; i++)
+  {
+    FFTindex = winsamples * i;
+    arm_max_f32(&pfftCmplxMagAxis[FFTindex], winsamples, &MaxValue, &MaxIndex);
+    SR_Amplitude[i] = MaxValue;
+    SR_Bin_Value[i] = MaxIndex + FFTindex;
+  }
+}
+
+#ifdef MOTIONSP_USE_SDFT
+/**
+  * @brief  Clear the sliding DFT bins, they are complete again after FftSize samples
+  * @param  pSdft pointer to the sliding DFT state
+  * @return None
+  */
+static void MotionSP_SdftReset(sSdft_t *pSdft)
+{
+  uint8_t axis;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    memset((void *)pSdft->Axis[axis].Re, 0, sizeof(pSdft->Axis[axis].Re));
+    memset((void *)pSdft->Axis[axis].Im, 0, sizeof(pSdft->Axis[axis].Im));
+  }
+
+  pSdft->SampleCnt = 0;
+}
+
+/**
+  * @brief  Initialize the sliding DFT for a new acquisition
+  *         The followed bins are kept while the FFT size does not change
+  * @param  pCtx pointer to the MotionSP context
+  * @param  FftSize number of samples inside the DFT
+  * @param  Ftype window applied on the bins (FLAT_TOP is approximated by HANNING)
+  * @return None
+  */
+void MotionSP_SdftInit(MotionSP_Context_t *pCtx, uint16_t FftSize, Filt_Type_t Ftype)
+{
+  sSdft_t *pSdft = &pCtx->State.Sdft;
+
+  if (pSdft->FftSize != FftSize)
+  {
+    pSdft->SubrangeNum = 0;
+    pSdft->FftSize = FftSize;
+  }
+
+  // Cosine windows are a three bins convolution in the frequency domain: A0*X(k) - A1*(X(k-1) + X(k+1))
+  switch (Ftype)
+  {
+    case RECTANGULAR:
+      pSdft->WinA0 = 1.0f;
+      pSdft->WinA1 = 0.0f;
+      break;
+
+    case HAMMING:
+      pSdft->WinA0 = 0.54f;
+      pSdft->WinA1 = 0.23f;
+      break;
+
+    default:
+      pSdft->WinA0 = 0.5f;
+      pSdft->WinA1 = 0.25f;
+      break;
+  }
+
+  // Amplitude of a tone like the averaged FFT: 1 / (coherent gain of the window * FftSize/2 * mean gain of the damping)
+  pSdft->DampingN = powf(SDFT_DAMPING, (float)FftSize);
+  pSdft->Scale = ((float)FftSize * (1.0f - SDFT_DAMPING)) /
+               (pSdft->WinA0 * (float)(FftSize / 2) * SDFT_DAMPING * (1.0f - pSdft->DampingN));
+
+  MotionSP_SdftReset(pSdft);
+}
+
+/**
+  * @brief  Set the bins followed by the sliding DFT
+  * @param  pCtx pointer to the MotionSP context
+  * @param  pBinVal pointer to the peak bin of each subrange (see MotionSP_evalMaxAmplitudeRange)
+  * @param  SubrangeNum number of subranges, 0 or more than SDFT_SUBRANGE_MAX to stop the sliding DFT
+  * @return None
+  */
+void MotionSP_SdftSetBins(MotionSP_Context_t *pCtx, const sSubrange_t *pBinVal, uint16_t SubrangeNum)
+{
+  sSdft_t *pSdft = &pCtx->State.Sdft;
+  const float *pBin[NUM_AXES];
+  sSdftAxis_t *pAxis;
+  float Phase;
+  uint8_t axis;
+  uint16_t i;
+  uint8_t j;
+
+  if ((pBinVal == NULL) || (SubrangeNum > SDFT_SUBRANGE_MAX))
+  {
+    SubrangeNum = 0;
+  }
+
+  pSdft->SubrangeNum = SubrangeNum;
+  if (SubrangeNum == 0)
+  {
+    return;
+  }
+
+  pBin[0] = pBinVal->AXIS_X;
+  pBin[1] = pBinVal->AXIS_Y;
+  pBin[2] = pBinVal->AXIS_Z;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    pAxis = &pSdft->Axis[axis];
+
+    for (i = 0; i < SubrangeNum; i++)
+    {
+      pAxis->Bin[i] = (uint16_t)pBin[axis][i];
+
+      // r * e^(j*2*pi*k/N) for k = Bin-1, Bin and Bin+1, cosf/sinf keep the twiddle module below the damping
+      for (j = 0; j < 3; j++)
+      {
+        Phase = (2.0f * PI * ((float)pAxis->Bin[i] + (float)j - 1.0f)) / (float)pSdft->FftSize;
+        pAxis->Cos[i][j] = SDFT_DAMPING * cosf(Phase);
+        pAxis->Sin[i][j] = SDFT_DAMPING * sinf(Phase);
+      }
+    }
+  }
+
+  MotionSP_SdftReset(pSdft);
+}
+
+/**
+  * @brief  Check if the sliding DFT has bins to follow
+  * @param  pCtx pointer to the MotionSP context
+  * @return 1 if the bins are set, 0 otherwise
+  */
+uint8_t MotionSP_SdftIsSeeded(MotionSP_Context_t *pCtx)
+{
+  return (pCtx->State.Sdft.SubrangeNum != 0);
+}
+
+/**
+  * @brief  Slide the DFT by the last Len samples added to the circular buffer
+  *         Each bin goes through the whole block with its state in registers
+  *         To be called every SDFT_BLOCK_LEN samples at least, before the circular buffer
+  *         overwrites the samples leaving the DFT
+  * @param  pCtx pointer to the MotionSP context
+  * @param  Len number of new samples, not greater than SDFT_BLOCK_LEN
+  * @return None
+  */
+void MotionSP_SdftUpdateBlock(MotionSP_Context_t *pCtx, uint16_t Len)
+{
+  const sCircBuffer_t *pCircBuff = &pCtx->AccCircBuffer;
+  sSdft_t *pSdft = &pCtx->State.Sdft;
+  const MotionSP_Sample_t *pSrc[NUM_AXES] = {pCircBuff->Data.AXIS_X, pCircBuff->Data.AXIS_Y, pCircBuff->Data.AXIS_Z};
+  float *Delta = pCtx->State.TdTmp;
+  sSdftAxis_t *pAxis;
+  int32_t FirstPos;
+  int32_t NewPos;
+  int32_t OldPos;
+  float Re0, Im0, Re1, Im1, Re2, Im2;
+  float Tmp;
+  uint8_t axis;
+  uint16_t i;
+  uint16_t n;
+
+  if ((pSdft->SubrangeNum == 0) || (Len == 0))
+  {
+    return;
+  }
+
+  if (Len > SDFT_BLOCK_LEN)
+  {
+    Len = SDFT_BLOCK_LEN;
+  }
+
+  // Circular buffer index of the first new sample
+  FirstPos = (int32_t)pCircBuff->IdPos - (int32_t)(Len - 1);
+  if (FirstPos < 0)
+  {
+    FirstPos += pCircBuff->Size;
+  }
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    pAxis = &pSdft->Axis[axis];
+
+    // x(n) - r^N * x(n-N), there is no sample leaving the DFT during the first FftSize samples
+    NewPos = FirstPos;
+    OldPos = FirstPos - (int32_t)pSdft->FftSize;
+    if (OldPos < 0)
+    {
+      OldPos += pCircBuff->Size;
+    }
+
+    for (n = 0; n < Len; n++)
+    {
+      Delta[n] = CIRC_SAMPLE(pCtx, pSrc[axis][NewPos]);
+      if ((pSdft->SampleCnt + n) >= pSdft->FftSize)
+      {
+        Delta[n] -= pSdft->DampingN * CIRC_SAMPLE(pCtx, pSrc[axis][OldPos]);
+      }
+
+      if (++NewPos == pCircBuff->Size)
+      {
+        NewPos = 0;
+      }
+      if (++OldPos == pCircBuff->Size)
+      {
+        OldPos = 0;
+      }
+    }
+
+    // X(n) = r * e^(j*2*pi*k/N) * (X(n-1) + x(n) - r^N * x(n-N)) for k = Bin-1, Bin and Bin+1
+    for (i = 0; i < pSdft->SubrangeNum; i++)
+    {
+      Re0 = pAxis->Re[i][0];
+      Im0 = pAxis->Im[i][0];
+      Re1 = pAxis->Re[i][1];
+      Im1 = pAxis->Im[i][1];
+      Re2 = pAxis->Re[i][2];
+      Im2 = pAxis->Im[i][2];
+
+      for (n = 0; n < Len; n++)
+      {
+        Tmp = Re0 + Delta[n];
+        Re0 = (pAxis->Cos[i][0] * Tmp) - (pAxis->Sin[i][0] * Im0);
+        Im0 = (pAxis->Sin[i][0] * Tmp) + (pAxis->Cos[i][0] * Im0);
+
+        Tmp = Re1 + Delta[n];
+        Re1 = (pAxis->Cos[i][1] * Tmp) - (pAxis->Sin[i][1] * Im1);
+        Im1 = (pAxis->Sin[i][1] * Tmp) + (pAxis->Cos[i][1] * Im1);
+
+        Tmp = Re2 + Delta[n];
+        Re2 = (pAxis->Cos[i][2] * Tmp) - (pAxis->Sin[i][2] * Im2);
+        Im2 = (pAxis->Sin[i][2] * Tmp) + (pAxis->Cos[i][2] * Im2);
+      }
+
+      pAxis->Re[i][0] = Re0;
+      pAxis->Im[i][0] = Im0;
+      pAxis->Re[i][1] = Re1;
+      pAxis->Im[i][1] = Im1;
+      pAxis->Re[i][2] = Re2;
+      pAxis->Im[i][2] = Im2;
+    }
+  }
+
+  pSdft->SampleCnt += Len;
+  if (pSdft->SampleCnt > pSdft->FftSize)
+  {
+    pSdft->SampleCnt = pSdft->FftSize;
+  }
+}
+
+/**
+  * @brief  Windowed amplitude of the bins followed by the sliding DFT, same scale of the averaged FFT
+  * @param  pCtx pointer to the MotionSP context
+  * @param  pAmplitude pointer to the amplitude of each subrange
+  * @return 1 if the amplitudes are valid, 0 if the bins are not set or the DFT is not complete yet
+  */
+uint8_t MotionSP_SdftEvalAmplitude(MotionSP_Context_t *pCtx, sSubrange_t *pAmplitude)
+{
+  sSdft_t *pSdft = &pCtx->State.Sdft;
+  float *pDst[NUM_AXES] = {pAmplitude->AXIS_X, pAmplitude->AXIS_Y, pAmplitude->AXIS_Z};
+  sSdftAxis_t *pAxis;
+  float Re;
+  float Im;
+  float Mag;
+  uint8_t axis;
+  uint16_t i;
+
+  if ((pSdft->SubrangeNum == 0) || (pSdft->SampleCnt < pSdft->FftSize))
+  {
+    return 0;
+  }
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    pAxis = &pSdft->Axis[axis];
+
+    for (i = 0; i < pSdft->SubrangeNum; i++)
+    {
+      Re = (pSdft->WinA0 * pAxis->Re[i][1]) - (pSdft->WinA1 * (pAxis->Re[i][0] + pAxis->Re[i][2]));
+      Im = (pSdft->WinA0 * pAxis->Im[i][1]) - (pSdft->WinA1 * (pAxis->Im[i][0] + pAxis->Im[i][2]));
+      arm_sqrt_f32((Re * Re) + (Im * Im), &Mag);
+      Mag *= pSdft->Scale;
+
+      /* Adjust DC component */
+      if (pAxis->Bin[i] == 0)
+      {
+        Mag *= 0.5f;
+      }
+
+      pDst[axis][i] = Mag;
+    }
+  }
+
+  return 1;
+}
+#endif /* MOTIONSP_USE_SDFT */
+
+#ifdef MOTIONSP_USE_ENVELOPE
+/**
+  * @brief  Second order Butterworth section of the envelope band-pass
+  * @param  pCoeffs pointer to the 5 coefficients {b0, b1, b2, a1, a2} in the CMSIS-DSP format
+  * @param  Freq cut-off frequency [Hz]
+  * @param  Fs sampling frequency [Hz]
+  * @param  HighPass 1 for a high-pass section, 0 for a low-pass section
+  * @return None
+  */
+static void MotionSP_EnvelopeBiquad(float *pCoeffs, float Freq, float Fs, uint8_t HighPass)
+{
+  float w0 = 2.0f * PI * Freq / Fs;
+  float CosW0 = arm_cos_f32(w0);
+  float Alpha = arm_sin_f32(w0) / (2.0f * 0.70710678f);
+  float a0 = 1.0f + Alpha;
+  float b1 = (HighPass) ? -(1.0f + CosW0) : (1.0f - CosW0);
+
+  pCoeffs[0] = 0.5f * fabsf(b1) / a0;
+  pCoeffs[1] = b1 / a0;
+  pCoeffs[2] = pCoeffs[0];
+  // arm_biquad_cascade_df1_f32 adds the feedback terms, their sign is changed
+  pCoeffs[3] = 2.0f * CosW0 / a0;
+  pCoeffs[4] = -(1.0f - Alpha) / a0;
+}
+
+/**
+  * @brief  Init the envelope analysis: band-pass, decimation low-pass and FFT of the envelope
+  * @param  pCtx Pointer to the MotionSP context, with the accelerometer ODR already measured
+  * @retval 0 in case of success
+  * @retval 1 if the envelope band or the decimation factor do not fit the accelerometer ODR
+  *
+  * @details The band-pass is a Butterworth high-pass at env_band_low followed by a Butterworth
+  *          low-pass at env_band_high. The decimation low-pass is a Hamming windowed sinc of
+  *          ENV_LPF_TAPS_PER_DEC taps for each unit of env_dec, with unity gain at DC.
+  */
+uint8_t MotionSP_EnvelopeInit(MotionSP_Context_t *pCtx)
+{
+  sEnvelope_t *pEnv = &pCtx->Envelope;
+  float Fs = pCtx->AcceleroODR.Frequency;
+  float Low = (float)pCtx->Parameters.env_band_low;
+  float High = (float)pCtx->Parameters.env_band_high;
+  uint16_t Dec = pCtx->Parameters.env_dec;
+  uint16_t NumTaps = ENV_LPF_TAPS_PER_DEC * Dec;
+  float Fc = ENV_LPF_CUTOFF / (2.0f * Dec);
+  float Arg;
+  float Sum;
+  uint16_t i;
+
+  pEnv->IsEnabled = 0;
+  pEnv->RectCnt = 0;
+  pEnv->FrameCnt = 0;
+  pEnv->SumCnt = 0;
+  memset((void *)(&pEnv->MagResults), 0x00, sizeof(sAxesMagResults_t));
+
+  // The decimation factor divides ENV_BLOCK_LEN when it is a power of two not greater than ENV_DEC_MAX
+  if ((Dec < 2) || (Dec > ENV_DEC_MAX) || ((Dec & (Dec - 1)) != 0))
+  {
+    return 1;
+  }
+
+  if ((Fs <= 0.0f) || (Low <= 0.0f) || (Low >= High) || (High >= (0.45f * Fs)))
+  {
+    return 1;
+  }
+
+  /* Band-pass */
+  MotionSP_EnvelopeBiquad(&pEnv->BandPassCoeffs[0], Low, Fs, 1);
+  MotionSP_EnvelopeBiquad(&pEnv->BandPassCoeffs[5], High, Fs, 0);
+
+  /* Decimation low-pass */
+  Sum = 0.0f;
+  for (i = 0; i < NumTaps; i++)
+  {
+    Arg = (float)i - ((float)(NumTaps - 1) / 2.0f);
+    pEnv->DecimCoeffs[i] = (Arg == 0.0f) ? (2.0f * Fc) : (arm_sin_f32(2.0f * PI * Fc * Arg) / (PI * Arg));
+    pEnv->DecimCoeffs[i] *= 0.54f - (0.46f * arm_cos_f32((2 * PI * i) / (NumTaps - 1)));
+    Sum += pEnv->DecimCoeffs[i];
+  }
+  arm_scale_f32(pEnv->DecimCoeffs, 1.0f / Sum, pEnv->DecimCoeffs, NumTaps);
+
+  for (i = 0; i < NUM_AXES; i++)
+  {
+    arm_biquad_cascade_df1_init_f32(&pEnv->BandPass[i], ENV_BP_STAGES, pEnv->BandPassCoeffs, pEnv->BandPassState[i]);
+    arm_fir_decimate_init_f32(&pEnv->Decim[i], NumTaps, (uint8_t)Dec, pEnv->DecimCoeffs, pEnv->DecimState[i], ENV_BLOCK_LEN);
+  }
+
+  /* Hanning window of the envelope FFT */
+  Sum = 0.0f;
+  for (i = 0; i < ENV_FFT_SIZE; i++)
+  {
+    pEnv->Window[i] = (0.5f * (1 - arm_cos_f32((2 * PI * i) / (ENV_FFT_SIZE - 1))));
+    Sum += pEnv->Window[i];
+  }
+
+  /* A tone of amplitude A gives A*Sum/2 on its bin, the rectified envelope is 2/PI of the band-pass envelope */
+  pEnv->Scale = PI / Sum;
+
+  arm_rfft_fast_init_f32(&pEnv->fftS, ENV_FFT_SIZE);
+
+  pEnv->Frequency = Fs / Dec;
+  pEnv->IsEnabled = 1;
+
+  return 0;
+}
+
+/**
+  * @brief  FFT of the decimated envelope frame added to the envelope spectrum sum
+  * @param  pEnv Pointer to the envelope state, with ENV_FFT_SIZE samples inside Frame
+  * @return None
+  *
+  * @details The frames overlap by 50%: the newest half is kept for the next frame.
+  */
+static void MotionSP_EnvelopeFrame(sEnvelope_t *pEnv)
+{
+  float Mean;
+  uint8_t Axis;
+
+  for (Axis = 0; Axis < NUM_AXES; Axis++)
+  {
+    /* The rectified envelope has a large mean value, it is removed before windowing */
+    arm_mean_f32(pEnv->Frame[Axis], ENV_FFT_SIZE, &Mean);
+    arm_offset_f32(pEnv->Frame[Axis], -Mean, pEnv->FftIn, ENV_FFT_SIZE);
+    arm_mult_f32(pEnv->FftIn, pEnv->Window, pEnv->FftIn, ENV_FFT_SIZE);
+
+    arm_rfft_fast_f32(&pEnv->fftS, pEnv->FftIn, pEnv->FftOut, 0);
+
+    /* The input array is free after the RFFT, it holds the magnitude */
+    arm_cmplx_mag_f32(pEnv->FftOut, pEnv->FftIn, ENV_MAG_SIZE);
+    // arm_rfft_fast_f32 packs the real Nyquist value in the imaginary part of the DC bin
+    pEnv->FftIn[0] = fabsf(pEnv->FftOut[0]);
+
+    if (pEnv->SumCnt == 0)
+    {
+      arm_copy_f32(pEnv->FftIn, pEnv->AvgMag[Axis], ENV_MAG_SIZE);
+    }
+    else
+    {
+      arm_add_f32(pEnv->AvgMag[Axis], pEnv->FftIn, pEnv->AvgMag[Axis], ENV_MAG_SIZE);
+    }
+
+    arm_copy_f32(&pEnv->Frame[Axis][ENV_FFT_SIZE / 2], pEnv->Frame[Axis], ENV_FFT_SIZE / 2);
+  }
+
+  pEnv->SumCnt++;
+  pEnv->FrameCnt = ENV_FFT_SIZE / 2;
+}
+
+/**
+  * @brief  Envelope analysis of the samples added to AccCircBuffer since the previous call
+  * @param  pCtx Pointer to the MotionSP context
+  * @param  NewSamples Samples added to AccCircBuffer since the previous call
+  * @return None
+  *
+  * @details The samples are band-passed and rectified as they arrive, the decimation low-pass
+  *          runs on blocks of ENV_BLOCK_LEN rectified samples and the FFT of the envelope runs
+  *          every ENV_FFT_SIZE/2 decimated samples.
+  */
+void MotionSP_EnvelopeProcessBlock(MotionSP_Context_t *pCtx, uint16_t NewSamples)
+{
+  sCircBuffer_t *pCirc = &pCtx->AccCircBuffer;
+  sEnvelope_t *pEnv = &pCtx->Envelope;
+  const MotionSP_Sample_t *pAxis[NUM_AXES] = {pCirc->Data.AXIS_X, pCirc->Data.AXIS_Y, pCirc->Data.AXIS_Z};
+  uint16_t DecLen;
+  uint16_t Id;
+  uint16_t Len;
+  uint8_t Axis;
+
+  if (!pEnv->IsEnabled)
+  {
+    return;
+  }
+
+  if (NewSamples > pCirc->Size)
+  {
+    NewSamples = pCirc->Size;
+  }
+
+  DecLen = ENV_BLOCK_LEN / pEnv->Decim[0].M;
+
+  /* Evaluate the initial IdPos for these new data samples */
+  Id = (uint16_t)(((uint32_t)pCirc->IdPos + pCirc->Size - (NewSamples - 1)) % pCirc->Size);
+
+  while (NewSamples > 0)
+  {
+    Len = ENV_BLOCK_LEN - pEnv->RectCnt;
+    if (NewSamples < Len)
+    {
+      Len = NewSamples;
+    }
+
+    for (Axis = 0; Axis < NUM_AXES; Axis++)
+    {
+#ifdef MOTIONSP_USE_Q15
+      MotionSP_TD_CopyFromCirc_q15(pEnv->Tmp, pAxis[Axis], pCirc->Size, Id, Len, pCtx->SampleScale);
+#else /* MOTIONSP_USE_Q15 */
+      MotionSP_TD_CopyFromCirc(pEnv->Tmp, pAxis[Axis], pCirc->Size, Id, Len);
+#endif /* MOTIONSP_USE_Q15 */
+      arm_biquad_cascade_df1_f32(&pEnv->BandPass[Axis], pEnv->Tmp, pEnv->Tmp, Len);
+      /* Full wave rectification */
+      arm_abs_f32(pEnv->Tmp, &pEnv->Rect[Axis][pEnv->RectCnt], Len);
+    }
+    pEnv->RectCnt += Len;
+
+    if (pEnv->RectCnt == ENV_BLOCK_LEN)
+    {
+      for (Axis = 0; Axis < NUM_AXES; Axis++)
+      {
+        arm_fir_decimate_f32(&pEnv->Decim[Axis], pEnv->Rect[Axis], &pEnv->Frame[Axis][pEnv->FrameCnt], ENV_BLOCK_LEN);
+      }
+      pEnv->RectCnt = 0;
+      pEnv->FrameCnt += DecLen;
+
+      if (pEnv->FrameCnt == ENV_FFT_SIZE)
+      {
+        MotionSP_EnvelopeFrame(pEnv);
+      }
+    }
+
+    Id = (uint16_t)(((uint32_t)Id + Len) % pCirc->Size);
+    NewSamples -= Len;
+  }
+}
+
+/**
+  * @brief  Complete the envelope spectrum of the acquisition and find its peaks
+  * @param  pCtx Pointer to the MotionSP context
+  * @retval 1 if the envelope spectrum is ready in Envelope.AvgMag and Envelope.MagResults
+  * @retval 0 if no envelope frame has been analyzed
+  *
+  * @details The spectrum is the amplitude [m/s^2] of the band-pass envelope modulation, the
+  *          bins below ENV_PEAK_BIN_MIN are skipped by the peak search. A new spectrum sum
+  *          starts with the next frame.
+  */
+uint8_t MotionSP_EnvelopeDone(MotionSP_Context_t *pCtx)
+{
+  sEnvelope_t *pEnv = &pCtx->Envelope;
+  float Scale;
+  float Value;
+  uint32_t Index;
+  uint8_t Axis;
+
+  if ((!pEnv->IsEnabled) || (pEnv->SumCnt == 0))
+  {
+    return 0;
+  }
+
+  Scale = pEnv->Scale / pEnv->SumCnt;
+
+  for (Axis = 0; Axis < NUM_AXES; Axis++)
+  {
+    arm_scale_f32(pEnv->AvgMag[Axis], Scale, pEnv->AvgMag[Axis], ENV_MAG_SIZE);
+    arm_max_f32(&pEnv->AvgMag[Axis][ENV_PEAK_BIN_MIN], ENV_MAG_SIZE - ENV_PEAK_BIN_MIN, &Value, &Index);
+    Index += ENV_PEAK_BIN_MIN;
+
+    switch (Axis)
+    {
+      case 0:
+        pEnv->MagResults.X_Value = Value;
+        pEnv->MagResults.X_Index = Index;
+        pEnv->MagResults.X_FFT_AVG = pEnv->SumCnt;
+        break;
+
+      case 1:
+        pEnv->MagResults.Y_Value = Value;
+        pEnv->MagResults.Y_Index = Index;
+        pEnv->MagResults.Y_FFT_AVG = pEnv->SumCnt;
+        break;
+
+      default:
+        pEnv->MagResults.Z_Value = Value;
+        pEnv->MagResults.Z_Index = Index;
+        pEnv->MagResults.Z_FFT_AVG = pEnv->SumCnt;
+        break;
+    }
+  }
+
+  pEnv->SumCnt = 0;
+
+  return 1;
+}
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 /**
   * @brief Get real accelerometer ODR
+  * @param pCtx Pointer to the MotionSP context
   * @return sAcceleroODR_t Pointer to the real accelerometer ODR
   */
-sAcceleroODR_t *MotionSP_GetRealAcceleroOdr(void)
+sAcceleroODR_t *MotionSP_GetRealAcceleroOdr(MotionSP_Context_t *pCtx)
 {
-  return &AcceleroODR;
+  return &pCtx->AcceleroODR;
 }
 
 /**
   * @brief Get MotionSP Parameters
+  * @param pCtx Pointer to the MotionSP context
   * @return sMotionSP_Parameter_t Pointer to the MotionSP Parameters
   */
-sMotionSP_Parameter_t *MotionSP_GetParameters(void)
+sMotionSP_Parameter_t *MotionSP_GetParameters(MotionSP_Context_t *pCtx)
 {
-  return &MotionSP_Parameters;
+  return &pCtx->Parameters;
 }
 
 /**
   * @brief Get accelero magnitude results
+  * @param pCtx Pointer to the MotionSP context
   * @return sAccMagResults_t Pointer to the accelero magnitude results
   */
-sAccMagResults_t *MotionSP_GetAccMagResults(void)
+sAccMagResults_t *MotionSP_GetAccMagResults(MotionSP_Context_t *pCtx)
 {
-  return &AccMagResults;
+  return &pCtx->AccMagResults;
 }
 
 /**
   * @brief Get time domain data
+  * @param pCtx Pointer to the MotionSP context
   * @return sTimeDomainData_t Pointer to the time domain data
   */
-sTimeDomainData_t *MotionSP_GetTimeDomainData(void)
+sTimeDomainData_t *MotionSP_GetTimeDomainData(MotionSP_Context_t *pCtx)
 {
-  return &TimeDomainData;
+  return &pCtx->TimeDomainData;
 }
 
 /**
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    BleLink.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Header for BleLink.c
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BLE_LINK_H_
+#define _BLE_LINK_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Data length extension: max LL payload and its time on the 1M PHY [us] */
+#define BLE_LINK_MAX_TX_OCTETS      251U
+#define BLE_LINK_MAX_TX_TIME        2120U
+
+/* Connection parameters of the profiles (interval in 1.25ms, timeout in 10ms),
+ * inside the limits of the iOS accessory design guidelines */
+#define BLE_LINK_FAST_INTERVAL_MIN    12U   //!< 15ms
+#define BLE_LINK_FAST_INTERVAL_MAX    24U   //!< 30ms
+#define BLE_LINK_FAST_LATENCY         0U
+#define BLE_LINK_ACTIVE_INTERVAL_MIN  24U   //!< 30ms
+#define BLE_LINK_ACTIVE_INTERVAL_MAX  48U   //!< 60ms
+#define BLE_LINK_ACTIVE_LATENCY       0U
+#define BLE_LINK_IDLE_INTERVAL_MIN    80U   //!< 100ms
+#define BLE_LINK_IDLE_INTERVAL_MAX    160U  //!< 200ms
+#define BLE_LINK_IDLE_LATENCY         4U    //!< 1s between two connection events at most
+#define BLE_LINK_TIMEOUT              600U  //!< 6s
+
+/* Time after the connection before the first update (the central discovers the services) [ms] */
+#define BLE_LINK_FIRST_UPDATE_MS      3000U
+/* Time without backlog before leaving the fast profile [ms] */
+#define BLE_LINK_FAST_HOLD_MS         2000U
+/* Time without notifications before entering the idle profile [ms] */
+#define BLE_LINK_IDLE_MS              5000U
+/* Time before requesting again a profile refused by the central [ms] */
+#define BLE_LINK_RETRY_MS             30000U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Connection parameters requested to the central
+ */
+typedef enum
+{
+  BLE_LINK_PROFILE_CENTRAL = 0,  //!< Chosen by the central at the connection
+  BLE_LINK_PROFILE_FAST,         //!< Short interval for the backlogs and the bulk transfers
+  BLE_LINK_PROFILE_ACTIVE,       //!< Periodic notifications
+  BLE_LINK_PROFILE_IDLE,         //!< Long interval with slave latency
+  BLE_LINK_PROFILE_NUMBER
+} BleLink_Profile_t;
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for setting the default data length of the new connections,
+ * it must be called after aci_gap_init */
+extern void BleLink_Init(void);
+
+/* API for choosing the connection parameters from the notification backlog,
+ * it must be called periodically from the main loop */
+extern void BleLink_Process(void);
+
+/* API for keeping the fast profile during the transfers from the central (FOTA) */
+extern void BleLink_ForceFast(uint8_t Enable);
+
+/* API for the hci_le_connection_complete_event */
+extern void BleLink_Connected(uint16_t Connection_Handle, uint16_t Conn_Interval,
+                              uint16_t Conn_Latency, uint16_t Supervision_Timeout);
+
+/* API for the hci_le_connection_update_complete_event */
+extern void BleLink_Updated(uint16_t Conn_Interval, uint16_t Conn_Latency, uint16_t Supervision_Timeout);
+
+/* API for the aci_l2cap_connection_update_resp_event (Result 0 if accepted)
+ * and the aci_l2cap_proc_timeout_event (Result 0xFFFF) */
+extern void BleLink_UpdateAnswer(uint16_t Result);
+
+/* API for the hci_le_data_length_change_event */
+extern void BleLink_DataLength(uint16_t MaxTx);
+
+/* API for the hci_disconnection_complete_event */
+extern void BleLink_Disconnected(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLE_LINK_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    BleNotify.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Header for BleNotify.c
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BLE_NOTIFY_H_
+#define _BLE_NOTIFY_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "bluenrg1_types.h"
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Max length of one notification (ATT MTU 247 - 3 bytes of ATT header) */
+#define BLE_NOTIFY_MAX_LEN          244U
+/* Max length of the values coalesced by BleNotify_Post */
+#define BLE_NOTIFY_LATEST_MAX_LEN   20U
+/* Values queued by BleNotify_PostReliable and not yet accepted by the BlueNRG-2 */
+#define BLE_NOTIFY_RELIABLE_NUM     2U
+
+/* The low priority channels are held back while the BlueNRG-2 TX pool
+ * has this number of buffers or less, so they are kept for the gestures */
+#define BLE_NOTIFY_LOW_PRIO_RESERVE 2U
+/* Validity of the TX pool credits reported by aci_gatt_tx_pool_available_event [ms] */
+#define BLE_NOTIFY_CREDITS_TTL_MS   100U
+/* Max time without aci_gatt_tx_pool_available_event after a refused update [ms] */
+#define BLE_NOTIFY_BLOCKED_MAX_MS   1000U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Notified characteristics.
+ *        The lower the value the higher the priority on the air
+ */
+typedef enum
+{
+  BLE_NOTIFY_TAICHI = 0,          //!< TaiChi gestures (reliable)
+  BLE_NOTIFY_FFT_ALARM_SPEED_RMS, //!< FFT Alarm Speed RMS status
+  BLE_NOTIFY_FFT_ALARM_ACC,       //!< FFT Alarm Acc Peak status
+  BLE_NOTIFY_FFT_ALARM_SUBRANGE,  //!< FFT Alarm Subrange status
+  BLE_NOTIFY_FFT_ENVELOPE,        //!< Envelope spectrum peaks
+  BLE_NOTIFY_TIME_DOMAIN,         //!< Time Domain
+  BLE_NOTIFY_ACC_GYRO_MAG,        //!< Acc/Gyro/Mag
+  BLE_NOTIFY_AUDIO_LEVEL,         //!< Audio Level
+  BLE_NOTIFY_FFT_AMPLITUDE,       //!< FFT Amplitude (stream)
+  BLE_NOTIFY_BATTERY_INFO,        //!< Battery Info (low priority)
+  BLE_NOTIFY_ENVIRONMENTAL,       //!< Environmental (low priority)
+  BLE_NOTIFY_NUMBER
+} BleNotify_Channel_t;
+
+/* First channel held back when the TX pool is low */
+#define BLE_NOTIFY_LOW_PRIO_FIRST   BLE_NOTIFY_BATTERY_INFO
+
+/* Completion of a notification: BLE_STATUS_SUCCESS when the BlueNRG-2 accepted it */
+typedef void (*BleNotify_Done_t)(tBleStatus Status);
+
+/* Next chunk of a stream: it fills pBuff with up to MaxLen bytes and
+ * it returns the chunk length, 0 when the stream is finished */
+typedef uint8_t (*BleNotify_Pull_t)(uint8_t *pBuff, uint8_t MaxLen);
+
+/**
+ * @brief Notification counters since the boot
+ */
+typedef struct
+{
+  uint32_t Sent;       //!< Notifications accepted by the BlueNRG-2
+  uint32_t SentBytes;  //!< Bytes of the notifications accepted by the BlueNRG-2
+  uint32_t Coalesced;  //!< Values overwritten by a newer one before being sent
+  uint32_t Refused;    //!< Updates refused for lack of TX buffers (they are retried)
+  uint32_t Errors;     //!< Updates failed (they are dropped)
+} BleNotify_Stats_t;
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for attaching a channel to its characteristic, it must be called
+ * after aci_gatt_add_char. The channels not registered refuse the updates */
+extern void BleNotify_Register(BleNotify_Channel_t Ch, uint16_t ServHandle, uint16_t CharHandle);
+
+/* API for notifying a periodic value: the value is copied and a newer one
+ * overwrites it while it is waiting for the BlueNRG-2 */
+extern tBleStatus BleNotify_Post(BleNotify_Channel_t Ch, const uint8_t *pData, uint8_t Len);
+
+/* API for notifying a value that must not be lost: it is copied and retried until
+ * accepted. Done is called with the result only if the value has been queued */
+extern tBleStatus BleNotify_PostReliable(BleNotify_Channel_t Ch, const uint8_t *pData, uint8_t Len,
+                                         BleNotify_Done_t Done);
+
+/* API for dropping the reliable values completed by Done that are not yet on the air,
+ * Done is not called for them. It returns the number of values dropped */
+extern uint8_t BleNotify_DropReliable(BleNotify_Done_t Done);
+
+/* API for starting a stream: Pull is called for each notification while the
+ * BlueNRG-2 accepts them and Done after each one (a refused chunk is pulled again) */
+extern tBleStatus BleNotify_Stream(BleNotify_Channel_t Ch, BleNotify_Pull_t Pull, BleNotify_Done_t Done);
+
+/* API for the aci_gatt_tx_pool_available_event: it resumes the refused updates */
+extern void BleNotify_TxPoolAvailable(uint16_t AvailableBuffers);
+
+/* API for dropping all the pending updates when the connection is closed,
+ * the reliable values and the streams are completed with an error */
+extern void BleNotify_Reset(void);
+
+/* API for reading the notification counters */
+extern void BleNotify_GetStats(BleNotify_Stats_t *Stats);
+
+/* API for reading if some updates are waiting for more than one notification:
+ * a stream running, reliable values queued or updates refused for lack of TX buffers */
+extern uint8_t BleNotify_HasBacklog(void);
+
+/* API for reading the HAL_GetTick of the last update posted */
+extern uint32_t BleNotify_LastPostTick(void);
+
+/* API for reporting the failed updates, called from the main loop */
+extern void BleNotify_ReportErrors(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLE_NOTIFY_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    ImuCapture.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Raw Acc/Gyro/Mag capture streamed over USB CDC as binary frames
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _IMU_CAPTURE_H_
+#define _IMU_CAPTURE_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Frame layout (little endian):
+ *   Sync (1 byte) | Type (1 byte) | Seq (2 bytes) | Data (6 bytes)
+ * Seq is incremented for every frame, also for the ones dropped
+ * because the USB CDC ring was full, so the host can detect the gaps */
+#define IMU_CAPTURE_SYNC          0xA5U
+#define IMU_CAPTURE_FRAME_LEN     10U
+#define IMU_CAPTURE_DATA_LEN      6U
+
+/* Frame types: the ISM330DHCX FIFO words keep their tag as type, the other tags are not sent */
+#define IMU_CAPTURE_TYPE_GYRO     0x01U  //!< X/Y/Z int16 raw
+#define IMU_CAPTURE_TYPE_ACC      0x02U  //!< X/Y/Z int16 raw
+#define IMU_CAPTURE_TYPE_TIME     0x04U  //!< uint32 sensor timestamp (25us LSB)
+#define IMU_CAPTURE_TYPE_MAG      0x80U  //!< X/Y/Z int16 raw
+/* Sensor configuration: float sensitivity (mg|mdps|mgauss per LSB) + uint16 ODR [Hz] */
+#define IMU_CAPTURE_TYPE_CFG_ACC  0x81U
+#define IMU_CAPTURE_TYPE_CFG_GYRO 0x82U
+#define IMU_CAPTURE_TYPE_CFG_MAG  0x83U
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for starting the capture: the Acc/Gyro are batched at their current ODR
+ * in the ISM330DHCX FIFO (stream mode) with the sensor timestamp */
+extern void ImuCapture_Start(void);
+
+/* API for stopping the capture and putting the ISM330DHCX FIFO in bypass mode */
+extern void ImuCapture_Stop(void);
+
+/* API for reading if the capture is running, it could be called from interrupt context */
+extern uint8_t ImuCapture_IsRunning(void);
+
+/* API for draining the ISM330DHCX FIFO and the IIS2MDC into the USB CDC,
+ * it must be called periodically from the main loop while the capture is running */
+extern void ImuCapture_Process(void);
+
+/* API for reading the number of frames lost because the USB CDC ring was full */
+extern uint32_t ImuCapture_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IMU_CAPTURE_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    Logger.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Deferred logger: format string and raw arguments formatted later
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Max num of arguments for each record (32 bit integers or pointers to constant strings) */
+#define LOG_MAX_ARGS        6
+/* Num of records waiting to be formatted (power of 2) */
+#define LOG_RING_SIZE       64
+/* Max length of one formatted record */
+#define LOG_LINE_LEN        128
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Record the format string and the arguments, the trailing 0 allows calls without arguments */
+#define LOG_WRITE(...) LOG_WRITE_ARGS(__VA_ARGS__, 0U)
+#define LOG_WRITE_ARGS(Fmt, ...) {\
+  const uint32_t LogArgs[] = {__VA_ARGS__};\
+  Log_Write(Fmt, LogArgs, (sizeof(LogArgs)/sizeof(uint32_t))-1U);\
+}
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Sink for the formatted records */
+typedef void (*LogOutput_t)(uint8_t *Buf, uint32_t Len);
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for recording one log entry without formatting it.
+ * Lock free, it could be called from any interrupt context.
+ * Fmt must be a string literal since it is read when the entry is formatted */
+extern void Log_Write(const char *Fmt, const uint32_t *pArgs, uint32_t NArgs);
+
+/* API for formatting the recorded entries in order and passing them to Output.
+ * Only one context (the lowest priority one) must call it.
+ * The entries are formatted on target and not by a host decoder: a record keeps the
+ * flash address of its format string, that only the matching firmware image could map
+ * back to the text, and the USB CDC console of the demo expects text */
+extern void Log_Flush(LogOutput_t Output);
+
+/* API for reading the num of entries lost because the ring was full */
+extern uint32_t Log_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LOGGER_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
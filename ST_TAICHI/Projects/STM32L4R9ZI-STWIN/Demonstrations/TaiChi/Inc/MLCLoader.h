@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    MLCLoader.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Loader of ISM330DHCX machine learning core programs (UCF)
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _MLC_LOADER_H_
+#define _MLC_LOADER_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32l4xx_hal.h"
+#include "ism330dhcx_reg.h"
+
+/* Exported types ------------------------------------------------------------*/
+#ifndef MEMS_UCF_SHARED_TYPES
+#define MEMS_UCF_SHARED_TYPES
+
+/** Common data block definition **/
+typedef struct {
+  uint8_t address;
+  uint8_t data;
+} ucf_line_t;
+
+#endif /* MEMS_UCF_SHARED_TYPES */
+
+/* Exported defines ---------------------------------------------------------*/
+
+/* Max size of one UCF image received over BLE [bytes] */
+#define MLC_UCF_MAX_SIZE  4096U
+
+/* UCF image received over BLE: sequence of blocks
+ *   [Address][Count][Data_0]...[Data_Count-1]
+ * Count bit 7 = 0: Data written from Address upward in one burst (auto-increment)
+ * Count bit 7 = 1: (Count & 0x7F) writes of Data to the same Address (e.g. PAGE_VALUE)
+ * The image is padded with 0x00 to a multiple of 4 bytes and protected by
+ * the STM32 CRC-32 (same parameters as the firmware OTA) */
+#define MLC_UCF_SAME_ADDRESS  0x80U
+#define MLC_UCF_COUNT_MASK    0x7FU
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for setting the CRC peripheral (configured for 32-bit words) */
+extern void MLCLoader_Init(CRC_HandleTypeDef *hcrc);
+
+/* API for writing a compiled-in UCF table, consecutive registers in one burst */
+extern int32_t MLCLoader_WriteTable(stmdev_ctx_t *ctx, const ucf_line_t *Ucf, uint32_t Lines);
+
+/* API for starting the reception of one UCF image.
+ * Returns 1 if the Size is accepted */
+extern uint8_t MLCLoader_Start(uint32_t Size, uint32_t Crc);
+
+/* API for reading the number of bytes still expected (0 when not receiving) */
+extern uint32_t MLCLoader_Remaining(void);
+
+/* API for saving one chunk of the UCF image.
+ * Returns 0 if more data is expected, 1 if the image is complete and valid, -1 on error */
+extern int8_t MLCLoader_Receive(const uint8_t *Data, uint32_t Length);
+
+/* API for writing the last valid UCF image received.
+ * Returns 0 on success */
+extern int32_t MLCLoader_Apply(stmdev_ctx_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MLC_LOADER_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    MotionSP_Alarm.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Header for MotionSP_Alarm.c
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+  
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _MOTIONSP_ALARM_H_
+#define _MOTIONSP_ALARM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  
+/* Includes ------------------------------------------------------------------*/
+/* Only the MotionSP library and thresholds: the file is built by the host tools too */
+#include "MotionSP_Threshold.h"
+#include "MotionSP.h"
+  
+/** @addtogroup Projects
+  * @{
+  */
+
+/** @addtogroup DEMONSTRATIONS Demonstrations
+  * @{
+  */
+
+/** @addtogroup PREDCTIVE_MAINTENANCE Predictive Maintenance BLE
+  * @{
+  */
+
+/** @addtogroup PREDCTIVE_MAINTENANCE_MOTIONSP_MANAGER Predictive Maintenance Motion Signal Processing Manager
+  * @{
+  */
+
+/* Exported Functions Prototypes ---------------------------------------------*/
+void MotionSP_TimeDomainAlarmInit (sTimeDomainAlarm_t *pTdAlarm,
+                                   sAcceleroParam_t *pTimeDomainVal,
+                                   sTimeDomainThresh_t *pTdRmsThreshold,
+                                   sTimeDomainThresh_t *pTdPkThreshold);
+
+void MotionSP_FreqDomainAlarmInit (float **pWarnThresh,
+                                   float **pAlarmThresh,
+                                   sFreqDomainAlarm_t *pTHR_Fft_Alarms,
+                                   uint8_t subrange_num);
+
+void MotionSP_TimeDomainAlarm (sTimeDomainAlarm_t *pTdAlarm,
+                               sAcceleroParam_t *pTimeDomainVal,
+                               sTimeDomainThresh_t *pTdRmsThreshold,
+                               sTimeDomainThresh_t *pTdPkThreshold,
+                               sAcceleroParam_t *pTimeDomain);
+
+void MotionSP_FreqDomainAlarm (sSubrange_t *pSRAmplitude,
+                               float *pFDWarnThresh,
+                               float *pFDAlarmThresh,
+                               uint8_t subrange_num, 
+                               sSubrange_t *pTHR_Check, 
+                               sFreqDomainAlarm_t *pTHR_Fft_Alarms);
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOTIONSP_ALARM_H_ */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -46,6 +46,7 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "MotionSP_Threshold.h"
 #include "MotionSP.h"
+#include "MotionSP_Alarm.h"
 #include "TargetFeatures.h"
   
 /** @addtogroup Projects
@@ -110,6 +111,9 @@ typedef struct
   const uint8_t hp_filter_available;
 } sensor_setting_t;
 
+/* Exported Variables --------------------------------------------------------*/
+extern MotionSP_Context_t MotionSP_Ctx;
+
 /* Exported Functions Prototypes ---------------------------------------------*/
 void FuncOn_FifoFull(void);
 void FuncOn_DRDY_XL(void);
@@ -120,21 +124,12 @@ void MotionSP_ConfigFifo(void);
 uint8_t EnableDisable_ACC_HP_Filter(uint8_t FilterIsEnabled);
 uint8_t SetAccelerometerParameters(void);
 void MotionSP_VibrationAnalysis(void);
+void MotionSP_FftAmplitudeResume(void);
 
 uint8_t enable_FIFO(void);
 uint8_t disable_FIFO(void);
 uint8_t restart_FIFO(void);
 
-void MotionSP_TimeDomainAlarmInit (sTimeDomainAlarm_t *pTdAlarm,
-                                   sAcceleroParam_t *pTimeDomainVal,
-                                   sTimeDomainThresh_t *pTdRmsThreshold,
-                                   sTimeDomainThresh_t *pTdPkThreshold);
-
-void MotionSP_FreqDomainAlarmInit (float **pWarnThresh,
-                                   float **pAlarmThresh,
-                                   sFreqDomainAlarm_t *pTHR_Fft_Alarms,
-                                   uint8_t subrange_num);
-
 
 /**
   * @}
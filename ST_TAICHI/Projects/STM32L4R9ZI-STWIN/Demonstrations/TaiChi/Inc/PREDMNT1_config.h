@@ -75,6 +75,7 @@
 #define MOTION_SENSOR_Write_Register            BSP_MOTION_SENSOR_Write_Register          
 
 #define MOTION_SENSOR_SetOutputDataRate         BSP_MOTION_SENSOR_SetOutputDataRate
+#define MOTION_SENSOR_GetOutputDataRate         BSP_MOTION_SENSOR_GetOutputDataRate
 #define MOTION_SENSOR_Enable_HP_Filter          BSP_MOTION_SENSOR_Enable_HP_Filter
 #define MOTION_SENSOR_Set_INT2_DRDY             BSP_MOTION_SENSOR_Set_INT2_DRDY
 #define MOTION_SENSOR_DRDY_Set_Mode             BSP_MOTION_SENSOR_DRDY_Set_Mode
@@ -82,6 +83,8 @@
 #define MOTION_SENSOR_FIFO_Set_Mode             BSP_MOTION_SENSOR_FIFO_Set_Mode
 #define MOTION_SENSOR_FIFO_Set_INT2_FIFO_Full   BSP_MOTION_SENSOR_FIFO_Set_INT2_FIFO_Full
 #define MOTION_SENSOR_FIFO_Get_Data_Word        BSP_MOTION_SENSOR_FIFO_Get_Data_Word
+#define MOTION_SENSOR_FIFO_Read_Block          BSP_MOTION_SENSOR_FIFO_Read_Block
+#define MOTION_SENSOR_FIFO_Get_Num_Samples      BSP_MOTION_SENSOR_FIFO_Get_Num_Samples
 #define MOTION_SENSOR_FIFO_Set_Decimation       BSP_MOTION_SENSOR_FIFO_Set_Decimation
 #define MOTION_SENSOR_FIFO_Set_BDR              BSP_MOTION_SENSOR_FIFO_Set_BDR
 #define MOTION_SENSOR_FIFO_Set_Watermark_Level  BSP_MOTION_SENSOR_FIFO_Set_Watermark_Level
@@ -105,6 +108,19 @@
 /* For enabling trasmission for notified services (except for quaternions) */
 #define PREDMNT1_DEBUG_NOTIFY_TRAMISSION
 
+/* For dumping in hex every TaiChi notification sent */
+//#define PREDMNT1_DEBUG_TAICHI_DUMP
+
+/* For printing the cycles spent on each X-Y-Z FFT of the vibration analysis */
+//#define PREDMNT1_DEBUG_MOTIONSP_CYCLES
+
+/* For comparing the fixed point vibration analysis (MOTIONSP_USE_Q15) with a float FFT of the same frames */
+//#define PREDMNT1_DEBUG_MOTIONSP_COMPARE
+
+/*************** Power Defines ******************/
+/* For entering in STOP2 instead of Sleep when only TaiChi is running (USB CDC is not available in STOP2) */
+//#define PREDMNT1_ENABLE_STOP2
+
 /*************** Don't Change the following defines *************/
 
 /* Package Version only numbers 0->9 */
@@ -136,21 +152,28 @@
 #define SENSOR_ACC_FS_DEFAULT                   4
 
 /*  FIFO size limit */
-#define FIFO_WATERMARK   ((MotionSP_Parameters.FftSize + 1)*3)
+#define FIFO_WATERMARK   ((MotionSP_Ctx.Parameters.FftSize + 1)*3)
 
 /*************************
 * Serial control section *
 **************************/
 #ifdef PREDMNT1_ENABLE_PRINTF
     #include "usbd_cdc_interface.h"
+    /* A line that does not fit in the USB CDC ring is dropped: the drops are
+       reported on the console by the USB CDC timer callback */
     #define PREDMNT1_PRINTF(...) {\
       char TmpBufferToWrite[256];\
       int32_t TmpBytesToWrite;\
       TmpBytesToWrite = sprintf( TmpBufferToWrite, __VA_ARGS__);\
       CDC_Fill_Buffer(( uint8_t * )TmpBufferToWrite, TmpBytesToWrite);\
     }
+    /* Deferred log for hot paths and interrupts: only 32 bit arguments (no float),
+       the formatting is done by the USB CDC timer callback */
+    #include "Logger.h"
+    #define PREDMNT1_LOG(...) LOG_WRITE(__VA_ARGS__)
 #else /* PREDMNT1_ENABLE_PRINTF */
   #define PREDMNT1_PRINTF(...)
+  #define PREDMNT1_LOG(...)
   //#define PREDMNT1_PRINTF(...) printf(__VA_ARGS__)
 #endif /* PREDMNT1_ENABLE_PRINTF */
 
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    Scheduler.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Run-to-completion event scheduler for the main loop
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Main loop events.
+ *        The lower the value the higher the dispatch priority
+ */
+typedef enum
+{
+  SCHED_EVT_HCI = 0,         //!< BlueNRG-2 event packets to process
+  SCHED_EVT_MOTION_ML,       //!< MLC interrupt on ISM330DHCX INT2
+  SCHED_EVT_TAICHI,          //!< TaiChi gestures waiting to notify
+  SCHED_EVT_MLC_PROGRAM,     //!< MLC program received over BLE to apply
+  SCHED_EVT_BUTTON,          //!< User button pressed
+  SCHED_EVT_FFT_AMPLITUDE,   //!< FFT Amplitude stream ended
+  SCHED_EVT_ACC_GYRO_MAG_READ, //!< Acc/Gyro/Mag bus read completed
+  SCHED_EVT_ACC_GYRO_MAG,    //!< Acc/Gyro/Mag timer elapsed
+  SCHED_EVT_IMU_CAPTURE,     //!< Raw Acc/Gyro/Mag capture to drain over USB CDC
+  SCHED_EVT_AUDIO_LEVEL,     //!< Audio level timer elapsed
+  SCHED_EVT_ENV,             //!< Environmental timer elapsed
+  SCHED_EVT_BATTERY_INFO,    //!< Battery info timer elapsed
+  SCHED_EVT_NUMBER
+} SchedEvent_t;
+
+typedef void (*SchedHandler_t)(void);
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for clearing all the handlers and the pending events.
+ * IdleHandler is called with interrupts masked when nothing is pending,
+ * it must put the MCU in a low power mode that wakes up on interrupt (WFI) */
+extern void Sched_Init(SchedHandler_t IdleHandler);
+
+/* API for attaching the handler executed when Event is dispatched */
+extern void Sched_Register(SchedEvent_t Event, SchedHandler_t Handler);
+
+/* API for setting one event as pending, it could be called from interrupt context */
+extern void Sched_Post(SchedEvent_t Event);
+
+/* API for reading the bitmask of the pending events */
+extern uint32_t Sched_Pending(void);
+
+/* API for dispatching the highest priority pending event,
+ * or for entering in low power mode if there is nothing to do */
+extern void Sched_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SCHEDULER_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    TaiChiJournal.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Append-only TaiChi gesture journal on internal flash
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _TAICHI_JOURNAL_H_
+#define _TAICHI_JOURNAL_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32l4xx_hal.h"
+#include "TaiChiRing.h"
+
+/* Exported defines ---------------------------------------------------------*/
+
+/* Journal pages: between the end of the OTA area (OTA_MAX_PROG_SIZE)
+ * and the MetaDataManager page (MDM_FLASH_ADD) */
+#define TAICHI_JOURNAL_ADD_START  ((uint32_t)0x081FC000)
+#define TAICHI_JOURNAL_PAGES      3U
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for scanning the journal after reset and restoring the send cursor.
+ * The CRC peripheral must be configured for 32-bit words */
+extern void TaiChiJournal_Init(CRC_HandleTypeDef *hcrc);
+
+/* API for appending one gesture (HAL tick timeline).
+ * Returns 1 if the gesture has been written, 0 on flash error */
+extern uint8_t TaiChiJournal_Append(const taiChiResult_t *Item);
+
+/* API for reading the number of gestures not yet sent */
+extern uint32_t TaiChiJournal_Count(void);
+
+/* API for reading the Index-th oldest gesture not yet sent (HAL tick timeline).
+ * Returns 0 if Index is out of range */
+extern uint8_t TaiChiJournal_Read(uint32_t Index, taiChiResult_t *Item);
+
+/* API for marking the Num oldest gestures as sent */
+extern void TaiChiJournal_Release(uint32_t Num);
+
+/* API for reading the number of gestures overwritten before being sent */
+extern uint32_t TaiChiJournal_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TAICHI_JOURNAL_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
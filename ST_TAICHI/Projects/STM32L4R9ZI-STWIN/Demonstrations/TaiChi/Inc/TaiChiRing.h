@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    TaiChiRing.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Lock-free single producer/single consumer buffer for TaiChi results
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _TAICHI_RING_H_
+#define _TAICHI_RING_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "stm32l4xx_hal.h"
+
+/* Exported defines ---------------------------------------------------------*/
+
+/* Max num of items waiting to send (must be a power of 2) */
+#define BUFF_TAICHIRESULT_SIZE  16U
+
+#if (BUFF_TAICHIRESULT_SIZE & (BUFF_TAICHIRESULT_SIZE - 1U)) != 0U
+#error "BUFF_TAICHIRESULT_SIZE must be a power of 2"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One recognized TaiChi gesture
+ */
+typedef __PACKED_STRUCT
+{
+  uint16_t type;   //!< MLC decision tree output
+  uint32_t start;  //!< HAL tick when the gesture has been recognized [ms]
+  uint32_t end;    //!< HAL tick when the gesture has finished [ms]
+} taiChiResult_t;
+
+/**
+ * @brief Statically allocated ring of TaiChi gestures.
+ *        Head is written only by the producer (MLC interrupt path),
+ *        Tail only by the consumer (BLE sending in main loop).
+ *        Both indexes are free running and masked on access.
+ */
+typedef struct
+{
+  taiChiResult_t Item[BUFF_TAICHIRESULT_SIZE];
+  volatile uint32_t Head;
+  volatile uint32_t Tail;
+  volatile uint32_t Dropped;  //!< Gestures lost because the ring was full
+} taiChiRing_t;
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* API for emptying the ring and clearing the drop counter */
+extern void TaiChiRing_Init(taiChiRing_t *Ring);
+
+/* API (producer side) for appending one gesture.
+ * When the ring is full the new gesture is dropped and counted,
+ * the consumer owns the Tail so the oldest one can not be evicted.
+ * Returns 1 if stored, 0 if dropped */
+extern uint8_t TaiChiRing_Push(taiChiRing_t *Ring, const taiChiResult_t *Item);
+
+/* API (consumer side) for reading the number of gestures waiting to send */
+extern uint32_t TaiChiRing_Count(const taiChiRing_t *Ring);
+
+/* API (consumer side) for accessing the Index-th oldest gesture without removing it.
+ * Returns NULL if Index is out of the stored ones */
+extern const taiChiResult_t *TaiChiRing_Peek(const taiChiRing_t *Ring, uint32_t Index);
+
+/* API (consumer side) for removing the Num oldest gestures */
+extern void TaiChiRing_Release(taiChiRing_t *Ring, uint32_t Num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TAICHI_RING_H_ */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -161,6 +161,9 @@ extern void LedOnTargetPlatform(void);
 extern void LedOffTargetPlatform(void);
 extern void LedToggleTargetPlatform(void);
 
+extern uint32_t GetPage(uint32_t Address);
+extern uint32_t GetBank(uint32_t Address);
+
 /**
   * @}
   */
@@ -69,7 +69,8 @@ extern "C" {
 /*---------- Number of Bytes reserved for HCI Read Packet -----------*/
 #define HCI_READ_PACKET_SIZE      128
 /*---------- Number of Bytes reserved for HCI Max Payload -----------*/
-#define HCI_MAX_PAYLOAD_SIZE      128
+/* Room for one ATT MTU sized notification (6 bytes of parameters + 244 bytes of value) */
+#define HCI_MAX_PAYLOAD_SIZE      255
 
 #define HCI_DEFAULT_TIMEOUT_MS        1000
 
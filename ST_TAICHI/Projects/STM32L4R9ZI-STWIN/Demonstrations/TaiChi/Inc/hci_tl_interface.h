@@ -50,7 +50,6 @@
 /* Exported Functions --------------------------------------------------------*/
 int32_t HCI_TL_SPI_Init    (void* pConf);
 int32_t HCI_TL_SPI_DeInit  (void);
-int32_t HCI_TL_SPI_Receive (uint8_t* buffer, uint16_t size);
 int32_t HCI_TL_SPI_Send    (uint8_t* buffer, uint16_t size);
 int32_t HCI_TL_SPI_Reset   (void);
 
@@ -70,6 +69,14 @@ void hci_tl_lowlevel_init(void);
  */
 void hci_tl_lowlevel_isr(void);
 
+/**
+ * @brief  Start the next SPI exchange with the BlueNRG-2 if the transport is free
+ *
+ * @param  None
+ * @retval None
+ */
+void hci_tl_lowlevel_kick(void);
+
 #ifdef __cplusplus
 }
 #endif
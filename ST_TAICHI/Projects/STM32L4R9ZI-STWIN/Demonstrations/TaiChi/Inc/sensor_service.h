@@ -66,7 +66,10 @@
 #include <stdlib.h>
 #include "main.h"
 
+/* Exported types ------------------------------------------------------------*/
 
+/* Completion of a characteristic update queued without waiting for the BlueNRG-2 answer */
+typedef void (*W2ST_UpdateDone_t)(tBleStatus Status);
 
 /* Exported functions ------------------------------------------------------- */
 extern tBleStatus Add_HW_ServW2ST_Service(void);
@@ -76,11 +79,15 @@ extern tBleStatus AudioLevel_Update(uint16_t *Mic);
 extern tBleStatus BatteryInfo_Update(uint32_t BatteryLevel, uint32_t Voltage, stbc02_State_TypeDef BC_State);
 
 extern tBleStatus Add_SW_ServW2ST_Service(void);
-extern tBleStatus FFT_Amplitude_Update(uint8_t *TotalBuff, uint16_t ActualMagSize, uint8_t *SendingFFT, uint16_t *CountSendData);
+extern tBleStatus FFT_Amplitude_Update(sAxesMagBuff_t *pMagBuff, uint16_t ActualMagSize, float BinFreqStep,
+                                       uint8_t *SendingFFT, uint32_t *pCursor);
 extern tBleStatus TimeDomain_Update(sAcceleroParam_t *sTimeDomain);
 extern tBleStatus FFT_AlarmSpeedRMS_Status_Update(sTimeDomainAlarm_t *pTdAlarm, sAcceleroParam_t *sTimeDomainVal);
 extern tBleStatus FFT_AlarmAccStatus_Update(sTimeDomainAlarm_t *pTdAlarm, sAcceleroParam_t *sTimeDomainVal);
 extern tBleStatus FFT_AlarmSubrangeStatus_Update(sAxesMagResults_t *AccAxesMagResults,sFreqDomainAlarm_t *THR_Fft_Alarms, uint16_t SubrangeNum, uint16_t ActualMagSize);
+#ifdef MOTIONSP_USE_ENVELOPE
+extern tBleStatus FFT_Envelope_Update(sAxesMagResults_t *pEnvMagResults, float BinFreqStep);
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 extern tBleStatus Add_ConsoleW2ST_Service(void);
 extern tBleStatus Stderr_Update(uint8_t *data,uint8_t length);
@@ -95,20 +102,13 @@ extern void       setConnectable(void);
 
 
 extern tBleStatus Add_TaiChi_ServW2ST_Service(void);
-extern tBleStatus TaiChi_Update(uint8_t buff[]);
+extern tBleStatus TaiChi_Update(uint8_t buff[],uint8_t len,W2ST_UpdateDone_t Done);
+extern uint16_t   TaiChi_MaxItemsPerUpdate(void);
 
 
 
 /* Exported variables --------------------------------------------------------*/
 
-/* For enabling the capability to handle BlueNRG Congestion */
-#define ACC_BLUENRG_CONGESTION
-
-#ifdef ACC_BLUENRG_CONGESTION
-/* For defining how many events skip when there is a congestion */
-#define ACC_BLUENRG_CONGESTION_SKIP 30
-#endif /* ACC_BLUENRG_CONGESTION */
-
 /*************** Don't Change the following defines *************/
 
 /* Define the Max dimesion of the Bluetooth characteristics for each packet */
@@ -171,6 +171,9 @@ used in Console service */
 /* FFT Alarm Subrange Status */
 #define W2ST_CONNECT_FFT_ALARM_SUBRANGE_STATUS  (1<<8)
 
+/* FFT Envelope */
+#define W2ST_CONNECT_FFT_ENVELOPE               (1<<13)
+
 /* Battery Info Feature */
 #define W2ST_CONNECT_BATTERY_INFO       (1<<9)
 
@@ -182,10 +185,19 @@ used in Console service */
 
 /* TaiChi*/
 #define W2ST_CONNECT_TAICHI				(1<<12)
-// Max num of items every bluetooth event can be send
-#define W2ST_TAICHI_MAX_BUFF_LEN		4
-// Max num of items waiting to send
-#define BUFF_TAICHIRESULT_SIZE 			10
+// Max num of items every bluetooth event can be send (the whole ring with a large ATT MTU)
+#define W2ST_TAICHI_MAX_BUFF_LEN		16
+// TaiChi notification: timestamp + num of items, then 6 bytes for each item
+#define W2ST_TAICHI_HEADER_LEN			4
+#define W2ST_TAICHI_ITEM_LEN			6
+
+/* ATT MTU used until the central negotiates a bigger one */
+#define W2ST_DEFAULT_ATT_MTU            23
+
+// FFT Amplitude stream: nSample (2) + nComponents (1) + Frequency Steps (4), then X, Y and Z samples
+#define W2ST_FFT_AMPLITUDE_HEADER_LEN   7
+// Max FFT Amplitude notification (largest ATT MTU - 3)
+#define W2ST_FFT_AMPLITUDE_MAX_CHAR_LEN 244
 
 
 #define W2ST_CHECK_CONNECTION(BleChar) ((ConnectionBleStatus&(BleChar)) ? 1 : 0)
@@ -66,6 +66,16 @@ void DMA1_Channel7_IRQHandler(void);
 void DMA1_Channel4_IRQHandler(void);
 void DFSDM1_FLT0_IRQHandler(void);
 void DFSDM1_FLT1_IRQHandler(void);
+void DMA2_Channel1_IRQHandler(void);
+void DMA2_Channel2_IRQHandler(void);
+void DMA2_Channel3_IRQHandler(void);
+void DMA2_Channel4_IRQHandler(void);
+void DMA2_Channel5_IRQHandler(void);
+void DMA2_Channel6_IRQHandler(void);
+void SPI2_IRQHandler(void);
+void SPI3_IRQHandler(void);
+void I2C2_EV_IRQHandler(void);
+void I2C2_ER_IRQHandler(void);
 
 
 #ifdef __cplusplus
@@ -58,13 +58,63 @@
  */
 #define HCI_READ_PACKET_NUM_MAX 	   (5)
 
+/**
+ * Rings of packet indexes: free packets (main loop -> ISR) and received
+ * packets (ISR -> main loop). Power of 2, bigger than HCI_READ_PACKET_NUM_MAX
+ * so they never overflow.
+ */
+#define HCI_PKT_RING_SIZE          (8)
+#define HCI_PKT_RING_MASK          (HCI_PKT_RING_SIZE - 1)
+
+/**
+ * Asynchronous requests waiting to be sent or answered.
+ * The BlueNRG-2 accepts one command at a time (Num_HCI_Command_Packets = 1),
+ * so only the oldest one is on the air.
+ */
+#define HCI_ASYNC_CMD_NUM_MAX      (8)
+#define HCI_ASYNC_CMD_PARAM_MAX    (HCI_MAX_PAYLOAD_SIZE - HCI_HDR_SIZE - HCI_COMMAND_HDR_SIZE)
+
 #define MIN(a,b)      ((a) < (b))? (a) : (b)
 #define MAX(a,b)      ((a) > (b))? (a) : (b)
 
-tListNode             hciReadPktPool;
-tListNode             hciReadPktRxQueue;
+/**
+ * @brief Asynchronous HCI request with its copy of the command parameters
+ */
+typedef struct
+{
+  hci_cmd_cb_t Callback;
+  void         *pUser;
+  uint16_t     ogf;
+  uint16_t     ocf;
+  uint8_t      clen;
+  uint8_t      cparam[HCI_ASYNC_CMD_PARAM_MAX];
+} tHciAsyncCmd;
+
+/**
+ * @brief Single producer single consumer ring of packet indexes.
+ *        Head is written by the consumer only, Tail by the producer only,
+ *        both are free running (the ring size divides 256).
+ */
+typedef struct
+{
+  uint8_t          Idx[HCI_PKT_RING_SIZE];
+  volatile uint8_t Head;
+  volatile uint8_t Tail;
+} tHciPktRing;
+
+static tHciPktRing    hciFreeRing;  /* Producer: main loop, consumer: ISR */
+static tHciPktRing    hciRxRing;    /* Producer: ISR, consumer: main loop */
 static tHciDataPacket hciReadPacketBuffer[HCI_READ_PACKET_NUM_MAX];
 static tHciContext    hciContext;
+static tHciStats      hciStats;
+
+static tHciAsyncCmd   hciAsyncCmd[HCI_ASYNC_CMD_NUM_MAX];
+static uint8_t        hciAsyncHead;   /* Oldest request */
+static uint8_t        hciAsyncCount;  /* Requests queued */
+static uint8_t        hciAsyncSent;   /* The oldest request is waiting for its answer */
+static uint32_t       hciAsyncTick;   /* When the oldest request has been sent */
+static uint8_t        hciSyncWait;    /* A synchronous request is waiting: the requests queued meanwhile are held */
+static uint8_t        hciAsyncBefore; /* Requests queued before the synchronous one, still to be completed */
 
 /************************* Static internal functions **************************/
 
@@ -115,22 +165,104 @@ static void send_cmd(uint16_t ogf, uint16_t ocf, uint8_t plen, void *param)
 }
 
 /**
-  * @brief  Remove the tail from a source list and insert it to the head 
-  *         of a destination list.
+  * @brief  Number of packets in a ring.
+  *
+  * @param  ring
+  * @retval Number of packets
+  */
+static uint8_t ring_count(const tHciPktRing * ring)
+{
+  return (uint8_t)(ring->Tail - ring->Head);
+}
+
+/**
+  * @brief  Packet index at a given position from the head of a ring.
+  *
+  * @param  ring
+  * @param  pos Position (0 for the oldest packet)
+  * @retval Packet index
+  */
+static uint8_t ring_at(const tHciPktRing * ring, uint8_t pos)
+{
+  return ring->Idx[(uint8_t)(ring->Head + pos) & HCI_PKT_RING_MASK];
+}
+
+/**
+  * @brief  Append a packet to a ring (producer side).
   *
-  * @param  dest_list
-  * @param  src_list
+  * @param  ring
+  * @param  index Packet index
   * @retval None
   */
-static void move_list(tListNode * dest_list, tListNode * src_list)
+static void ring_put(tHciPktRing * ring, uint8_t index)
 {
-  pListNode tmp_node;
-  
-  while (!list_is_empty(src_list))
+  ring->Idx[ring->Tail & HCI_PKT_RING_MASK] = index;
+  /* The slot must be written before it is published */
+  __DMB();
+  ring->Tail++;
+}
+
+/**
+  * @brief  Remove the oldest packet from a ring (consumer side).
+  *
+  * @param  ring
+  * @retval None
+  */
+static void ring_drop(tHciPktRing * ring)
+{
+  /* The slot must be read before it is given back */
+  __DMB();
+  ring->Head++;
+}
+
+/**
+  * @brief  Give a packet back to the free ring. If the ring was empty the
+  *         transport is restarted, an event may be waiting in the BlueNRG-2.
+  *
+  * @param  index Packet index
+  * @retval None
+  */
+static void free_put(uint8_t index)
+{
+  uint8_t was_empty = (ring_count(&hciFreeRing) == 0);
+
+  ring_put(&hciFreeRing, index);
+
+  if (was_empty)
+  {
+    hci_tl_lowlevel_kick();
+  }
+}
+
+/**
+  * @brief  Take a received packet out of the order: the older ones
+  *         are shifted by one slot (indexes only).
+  *
+  * @param  pos Position from the head of the received packets ring
+  * @retval Packet index
+  */
+static uint8_t rx_take(uint8_t pos)
+{
+  uint8_t index = ring_at(&hciRxRing, pos);
+
+  for (; pos > 0; pos--)
   {
-    list_remove_tail(src_list, &tmp_node);
-    list_insert_head(dest_list, tmp_node);
+    hciRxRing.Idx[(uint8_t)(hciRxRing.Head + pos) & HCI_PKT_RING_MASK] = ring_at(&hciRxRing, pos - 1);
   }
+  ring_drop(&hciRxRing);
+
+  return index;
+}
+
+/**
+  * @brief  Give a received packet back to the free ring.
+  *
+  * @param  pos Position from the head of the received packets ring
+  * @retval None
+  */
+static void rx_release(uint8_t pos)
+{
+  free_put(rx_take(pos));
 }
 
 /**
@@ -141,13 +273,202 @@ static void move_list(tListNode * dest_list, tListNode * src_list)
   */
 static void free_event_list(void)
 {
-  tHciDataPacket * pckt;
+  while ((ring_count(&hciFreeRing) < HCI_READ_PACKET_NUM_MAX/2) && (ring_count(&hciRxRing) > 0))
+  {
+    rx_release(0);
+    hciStats.Discarded++;
+  }
+}
+
+/**
+  * @brief  Send the oldest asynchronous request if the BlueNRG-2 is not
+  *         processing another one.
+  *
+  * @param  None
+  * @retval None
+  */
+static void async_send_next(void)
+{
+  tHciAsyncCmd *cmd;
+
+  if ((hciAsyncCount == 0) || hciAsyncSent)
+    return;
+
+  /* Only the requests queued before the synchronous one go before it */
+  if (hciSyncWait && (hciAsyncBefore == 0))
+    return;
+
+  cmd = &hciAsyncCmd[hciAsyncHead];
+  hciAsyncSent = 1;
+  hciAsyncTick = HAL_GetTick();
+  send_cmd(cmd->ogf, cmd->ocf, cmd->clen, cmd->cparam);
+}
+
+/**
+  * @brief  Release the asynchronous request on the air, send the next one
+  *         and then report the completion.
+  *
+  * @param  status Command status
+  * @param  ret Command Complete return parameters (NULL if none)
+  * @param  rlen Length of the return parameters
+  * @retval None
+  */
+static void async_complete(uint8_t status, const uint8_t *ret, uint8_t rlen)
+{
+  hci_cmd_cb_t callback = hciAsyncCmd[hciAsyncHead].Callback;
+  void *user = hciAsyncCmd[hciAsyncHead].pUser;
+
+  hciAsyncHead = (hciAsyncHead + 1) % HCI_ASYNC_CMD_NUM_MAX;
+  hciAsyncCount--;
+  hciAsyncSent = 0;
+  if (hciAsyncBefore)
+    hciAsyncBefore--;
+
+  async_send_next();
+
+  if (callback != NULL)
+  {
+    callback(status, ret, rlen, user);
+  }
+}
+
+/**
+  * @brief  Complete the asynchronous request on the air if the BlueNRG-2
+  *         does not answer.
+  *
+  * @param  None
+  * @retval 1 if the request has been completed, 0 otherwise
+  */
+static int async_check_timeout(void)
+{
+  if (hciAsyncSent && ((HAL_GetTick() - hciAsyncTick) > HCI_DEFAULT_TIMEOUT_MS))
+  {
+    async_complete(BLE_STATUS_TIMEOUT, NULL, 0);
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+  * @brief  Match a received packet with the asynchronous request on the air.
+  *         The matching packet is taken out of the received ring before the
+  *         callback runs and it is released after.
+  *
+  * @param  pos Position from the head of the received packets ring
+  * @retval 1 if the packet completed the request (it must not be passed to the user),
+  *         0 otherwise
+  */
+static int async_match(uint8_t pos)
+{
+  const tHciDataPacket *hciReadPacket;
+  const hci_event_pckt *event_pckt;
+  const uint8_t *ptr;
+  uint32_t len;
+  uint16_t opcode;
+  uint8_t index;
+
+  if (!hciAsyncSent)
+    return 0;
+
+  index = ring_at(&hciRxRing, pos);
+  hciReadPacket = &hciReadPacketBuffer[index];
+
+  opcode = htobs(cmd_opcode_pack(hciAsyncCmd[hciAsyncHead].ogf, hciAsyncCmd[hciAsyncHead].ocf));
+  event_pckt = (const void *)(hciReadPacket->dataBuff + 1);
+  ptr = hciReadPacket->dataBuff + (1 + HCI_EVENT_HDR_SIZE);
+  len = hciReadPacket->data_len - (1 + HCI_EVENT_HDR_SIZE);
+
+  switch (event_pckt->evt)
+  {
+  case EVT_CMD_STATUS:
+    if (((const evt_cmd_status *)ptr)->opcode != opcode)
+      return 0;
+
+    rx_take(pos);
+    async_complete(((const evt_cmd_status *)ptr)->status, NULL, 0);
+    break;
+
+  case EVT_CMD_COMPLETE:
+    if ((len < EVT_CMD_COMPLETE_SIZE) || (((const evt_cmd_complete *)ptr)->opcode != opcode))
+      return 0;
+
+    ptr += EVT_CMD_COMPLETE_SIZE;
+    len -= EVT_CMD_COMPLETE_SIZE;
+
+    /* The first return parameter is the status for all the commands */
+    rx_take(pos);
+    async_complete((len > 0) ? ptr[0] : BLE_STATUS_SUCCESS, ptr, (uint8_t)len);
+    break;
+
+  default:
+    return 0;
+  }
+
+  free_put(index);
+  return 1;
+}
+
+/**
+  * @brief  Wait for the answers to the asynchronous requests queued so far.
+  *         The ones queued by their callbacks are held until async_resume(),
+  *         so a stream refilled from the callbacks does not delay the
+  *         synchronous request. The other packets are kept in order for the
+  *         application.
+  *
+  * @param  None
+  * @retval None
+  */
+static void async_flush(void)
+{
+  /* Packets before pos are left in the ring for the application */
+  uint8_t pos = 0;
+
+  hciSyncWait = 1;
+  hciAsyncBefore = hciAsyncCount;
+
+  while (hciAsyncBefore > 0)
+  {
+    async_send_next();
+
+    /* A callback could have consumed packets: restart from the oldest one */
+    if (async_check_timeout())
+    {
+      pos = 0;
+      continue;
+    }
 
-  while(list_get_size(&hciReadPktPool) < HCI_READ_PACKET_NUM_MAX/2){
-    list_remove_head(&hciReadPktRxQueue, (tListNode **)&pckt);    
-    list_insert_tail(&hciReadPktPool, (tListNode *)pckt);
+    if (ring_count(&hciRxRing) <= pos)
+      continue;
+
+    if (async_match(pos))
+    {
+      pos = 0;
+    }
+    else if (ring_count(&hciFreeRing) == 0)
+    {
+      /* Without free packets the answer could not be received: the event is lost */
+      rx_release(pos);
+      hciStats.Discarded++;
+    }
+    else
+    {
+      pos++;
+    }
   }
+}
 
+/**
+  * @brief  Send the asynchronous requests held while the synchronous one
+  *         was waiting for its answer.
+  *
+  * @param  None
+  * @retval None
+  */
+static void async_resume(void)
+{
+  hciSyncWait = 0;
+  async_send_next();
 }
 
 /********************** HCI Transport layer functions *****************************/
@@ -164,14 +485,15 @@ void hci_init(void(* UserEvtRx)(void* pData), void* pConf)
   /* Initialize TL BLE layer */
   hci_tl_lowlevel_init();
   
-  /* Initialize list heads of ready and free hci data packet queues */
-  list_init_head(&hciReadPktPool);
-  list_init_head(&hciReadPktRxQueue);
+  /* Initialize the rings of received and free hci data packets */
+  hciFreeRing.Head = hciFreeRing.Tail = 0;
+  hciRxRing.Head = hciRxRing.Tail = 0;
+  BLUENRG_memset(&hciStats, 0, sizeof(hciStats));
+  hciStats.FreeMin = HCI_READ_PACKET_NUM_MAX;
   
-  /* Initialize the queue of free hci data packets */
   for (index = 0; index < HCI_READ_PACKET_NUM_MAX; index++)
   {
-    list_insert_tail(&hciReadPktPool, (tListNode *)&hciReadPacketBuffer[index]);
+    ring_put(&hciFreeRing, index);
   } 
   
   /* Initialize low level driver */
@@ -197,9 +519,11 @@ int hci_send_req(struct hci_request* r, BOOL async)
   hci_spi_pckt *hci_hdr;
 
   tHciDataPacket * hciReadPacket = NULL;
-  tListNode hciTempQueue;
-  
-  list_init_head(&hciTempQueue);
+  /* Packets before pos are left in the ring for the application */
+  uint8_t pos = 0;
+
+  /* The BlueNRG-2 processes one command at a time */
+  async_flush();
 
   free_event_list();
   
@@ -207,6 +531,7 @@ int hci_send_req(struct hci_request* r, BOOL async)
   
   if (async)
   {
+    async_resume();
     return 0;
   }
   
@@ -226,14 +551,14 @@ int hci_send_req(struct hci_request* r, BOOL async)
         goto failed;
       }
       
-      if (!list_is_empty(&hciReadPktRxQueue)) 
+      if (ring_count(&hciRxRing) > pos) 
       {
         break;
       }
     }
     
-    /* Extract packet from HCI event queue. */
-    list_remove_head(&hciReadPktRxQueue, (tListNode **)&hciReadPacket);    
+    /* Next packet from HCI event ring, it is left there until processed */
+    hciReadPacket = &hciReadPacketBuffer[ring_at(&hciRxRing, pos)];
     
     hci_hdr = (void *)hciReadPacket->dataBuff;
 
@@ -299,91 +624,148 @@ int hci_send_req(struct hci_request* r, BOOL async)
        packet in the pool to process the expected event.
        If no free packets are available, discard the processed event and insert it
        into the pool. */
-    if (list_is_empty(&hciReadPktPool) && list_is_empty(&hciReadPktRxQueue)) {
-      list_insert_tail(&hciReadPktPool, (tListNode *)hciReadPacket);
-      hciReadPacket=NULL;
+    if ((ring_count(&hciFreeRing) == 0) && (ring_count(&hciRxRing) == pos + 1)) {
+      rx_release(pos);
+      hciStats.Discarded++;
     }
     else {
-      /* Insert the packet in a different queue. These packets will be
-      inserted back in the main queue just before exiting from send_req(), so that
-      these events can be processed by the application.
-    */
-    list_insert_tail(&hciTempQueue, (tListNode *)hciReadPacket);
-      hciReadPacket=NULL;
+      /* Leave the packet in the ring, so that this event can be processed
+         by the application */
+      pos++;
     }
+    hciReadPacket=NULL;
 
   }
   
 failed: 
   if (hciReadPacket!=NULL) {
-    list_insert_head(&hciReadPktPool, (tListNode *)hciReadPacket);
+    rx_release(pos);
   }
-  move_list(&hciReadPktRxQueue, &hciTempQueue);
 
+  async_resume();
   return -1;
   
 done:
   /* Insert the packet back into the pool.*/
-  list_insert_head(&hciReadPktPool, (tListNode *)hciReadPacket); 
-  move_list(&hciReadPktRxQueue, &hciTempQueue);
+  rx_release(pos);
+
+  async_resume();
+  return 0;
+}
+
+int hci_send_req_async(struct hci_request* r, hci_cmd_cb_t Callback, void *pUser)
+{
+  tHciAsyncCmd *cmd;
+
+  async_check_timeout();
+
+  if ((hciAsyncCount == HCI_ASYNC_CMD_NUM_MAX) || (r->clen > HCI_ASYNC_CMD_PARAM_MAX))
+  {
+    return -1;
+  }
+
+  cmd = &hciAsyncCmd[(hciAsyncHead + hciAsyncCount) % HCI_ASYNC_CMD_NUM_MAX];
+  cmd->Callback = Callback;
+  cmd->pUser    = pUser;
+  cmd->ogf      = r->ogf;
+  cmd->ocf      = r->ocf;
+  cmd->clen     = r->clen;
+  BLUENRG_memcpy(cmd->cparam, r->cparam, r->clen);
+  hciAsyncCount++;
+
+  async_send_next();
 
   return 0;
 }
 
 void hci_user_evt_proc(void)
 {
-  tHciDataPacket * hciReadPacket = NULL;
+  uint8_t index;
      
   /* process any pending events read */
-  while (list_is_empty(&hciReadPktRxQueue) == FALSE)
+  while (ring_count(&hciRxRing) > 0)
   {
-    list_remove_head (&hciReadPktRxQueue, (tListNode **)&hciReadPacket);
+    /* The answers to the asynchronous requests are reported to their callbacks */
+    if (async_match(0))
+      continue;
+
+    index = rx_take(0);
 
     if (hciContext.UserEvtRx != NULL)
     {
-      hciContext.UserEvtRx(hciReadPacket->dataBuff);
+      hciContext.UserEvtRx(hciReadPacketBuffer[index].dataBuff);
     }
 
-    list_insert_tail(&hciReadPktPool, (tListNode *)hciReadPacket);
+    free_put(index);
+  }
+
+  async_check_timeout();
+}
+
+void hci_get_stats(tHciStats *Stats)
+{
+  *Stats = hciStats;
+}
+
+uint8_t *hci_get_rx_buffer(void)
+{
+  if (ring_count(&hciFreeRing) == 0)
+  {
+    /* The event stays in the BlueNRG-2 until a packet is released */
+    hciStats.PoolEmpty++;
+    return NULL;
+  }
+
+  /* The packet leaves the free ring only if it gets a valid event */
+  return hciReadPacketBuffer[ring_at(&hciFreeRing, 0)].dataBuff;
+}
+
+int hci_notify_rx_cplt(uint16_t len)
+{
+  uint8_t free_num = ring_count(&hciFreeRing);
+  uint8_t index = ring_at(&hciFreeRing, 0);
+  tHciDataPacket * hciReadPacket = &hciReadPacketBuffer[index];
+
+  hciReadPacket->data_len = (uint8_t)len;
+  if (verify_packet(hciReadPacket) != 0)
+  {
+    hciStats.Invalid++;
+    return -1;
+  }
+
+  ring_drop(&hciFreeRing);
+  ring_put(&hciRxRing, index);
+
+  hciStats.RxPackets++;
+  if ((free_num - 1) < hciStats.FreeMin)
+  {
+    hciStats.FreeMin = free_num - 1;
   }
+
+  return 0;
 }
 
 uint32_t hci_notify_asynch_evt(void* pdata)
 {
-  tHciDataPacket * hciReadPacket = NULL;
-  uint8_t data_len;
-  
-  int32_t ret = 0;
-  
-  if (list_is_empty (&hciReadPktPool) == FALSE)
+  uint8_t *buff;
+  int32_t data_len;
+
+  buff = hci_get_rx_buffer();
+  if (buff == NULL)
   {
-    /* Queuing a packet to read */
-    list_remove_head (&hciReadPktPool, (tListNode **)&hciReadPacket);
-    
-    if (hciContext.io.Receive)
-    {
-      data_len = hciContext.io.Receive(hciReadPacket->dataBuff, HCI_READ_PACKET_SIZE);
-      if (data_len > 0)
-      {                    
-        hciReadPacket->data_len = data_len;
-        if (verify_packet(hciReadPacket) == 0)
-          list_insert_tail(&hciReadPktRxQueue, (tListNode *)hciReadPacket);
-        else
-          list_insert_head(&hciReadPktPool, (tListNode *)hciReadPacket);          
-      }
-      else 
-      {
-        /* Insert the packet back into the pool*/
-        list_insert_head(&hciReadPktPool, (tListNode *)hciReadPacket);
-      }
-    }
+    return 1;
   }
-  else
+
+  if (hciContext.io.Receive)
   {
-    ret= 1;
+    data_len = hciContext.io.Receive(buff, HCI_READ_PACKET_SIZE);
+    if (data_len > 0)
+    {
+      (void)hci_notify_rx_cplt((uint16_t)data_len);
+    }
   }
-  
-  return ret;
+
+  return 0;
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
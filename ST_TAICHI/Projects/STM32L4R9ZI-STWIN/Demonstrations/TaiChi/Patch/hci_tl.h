@@ -19,7 +19,6 @@
 #include "hci_tl_interface.h"
 //#include "bluenrg1_types.h"
 #include "ble_types.h"
-#include "ble_list.h"
 #include "bluenrg_conf.h"
 
 /** 
@@ -64,7 +63,6 @@ struct hci_request {
  */
 typedef struct _tHciDataPacket
 {
-  tListNode currentNode;
   uint8_t dataBuff[HCI_READ_PACKET_SIZE];
   uint8_t data_len;
 } tHciDataPacket;
@@ -114,6 +112,30 @@ typedef struct
   void (* UserEvtRx) (void * pData); /**< ACI events callback function pointer */
 } tHciContext;
 
+/**
+ * @brief Completion callback of an asynchronous HCI request
+ *        Status: status of the Command Complete/Status event, BLE_STATUS_TIMEOUT
+ *        if the BlueNRG-2 did not answer.
+ *        pReturn/ReturnLen: Command Complete return parameters (status included),
+ *        NULL/0 for Command Status and timeout.
+ *        It is called from the main loop and it may queue other asynchronous requests,
+ *        but it must not send synchronous ones: it can run while a synchronous
+ *        request is waiting for the queued ones.
+ */
+typedef void (* hci_cmd_cb_t) (uint8_t Status, const uint8_t *pReturn, uint8_t ReturnLen, void *pUser);
+
+/**
+ * @brief HCI packet pool counters, for sizing the number of read packets
+ */
+typedef struct
+{
+  uint32_t RxPackets;   /**< Events received */
+  uint32_t PoolEmpty;   /**< Events left in the BlueNRG-2 because no packet was free */
+  uint32_t Discarded;   /**< Events discarded to receive the answer to a command */
+  uint32_t Invalid;     /**< Packets with wrong type or length */
+  uint8_t  FreeMin;     /**< Lowest number of free packets after a reception */
+} tHciStats;
+
 /**
  * @}
  */ 
@@ -134,6 +156,30 @@ typedef struct
   * @retval int: 0 when success, -1 when failure
   */
 int hci_send_req(struct hci_request *r, BOOL async);
+
+/**
+  * @brief  Queue an HCI request completed by a Command Complete/Status event
+  *         without waiting for the answer.
+  *         The command parameters are copied, the requests are sent one at a time
+  *         in queuing order and Callback is called from hci_user_evt_proc() when
+  *         the matching event is received.
+  *         A synchronous request waits for the ones queued before it to be completed,
+  *         the ones queued meanwhile (by their callbacks) are sent after it.
+  *
+  * @param  r: The HCI request (event, rparam and rlen are not used)
+  * @param  Callback: Completion callback (it could be NULL)
+  * @param  pUser: Passed back to Callback
+  * @retval int: 0 when queued, -1 when the queue is full or the command too long
+  */
+int hci_send_req_async(struct hci_request *r, hci_cmd_cb_t Callback, void *pUser);
+
+/**
+  * @brief  Read the HCI packet pool counters.
+  *
+  * @param  Stats: Filled with the counters since hci_init()
+  * @retval None
+  */
+void hci_get_stats(tHciStats *Stats);
  
 /**
  * @brief  Register IO bus services.
@@ -191,6 +237,29 @@ void hci_register_io_bus(tHciIO* fops);
  */
 uint32_t hci_notify_asynch_evt(void* pdata);
 
+/**
+ * @brief  Packet buffer for the next event, for transports that read the
+ *         event in the background (DMA) instead of through tHciIO.Receive.
+ *         The buffer is owned by the transport until hci_notify_rx_cplt().
+ *         Only one reception can be in progress.
+ *
+ * @param  None
+ * @retval uint8_t*: buffer of HCI_READ_PACKET_SIZE bytes, NULL if no packet is
+ *         free (the event must be left in the BlueNRG-2, the transport is
+ *         restarted through hci_tl_lowlevel_kick() when a packet is released)
+ */
+uint8_t *hci_get_rx_buffer(void);
+
+/**
+ * @brief  End of the reception into the buffer given by hci_get_rx_buffer().
+ *         It may be called from interrupt context.
+ *
+ * @param  len Number of bytes read
+ * @retval int: 0 when the event has been queued for hci_user_evt_proc(),
+ *         -1 when the packet is not valid (the buffer stays free)
+ */
+int hci_notify_rx_cplt(uint16_t len);
+
 /**
  * @brief  This function resume the User Event Flow which has been stopped on return 
  *         from UserEvtRx() when the User Event has not been processed.
@@ -0,0 +1,385 @@
+/**
+  ******************************************************************************
+  * @file    BleLink.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Data length, ATT MTU and connection parameters of the BLE link
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "TargetFeatures.h"
+#include "sensor_service.h"
+#include "bluenrg1_l2cap_aci.h"
+#include "BleNotify.h"
+#include "BleLink.h"
+
+/* Local defines -------------------------------------------------------------*/
+
+/* Result of BleLink_UpdateAnswer for the aci_l2cap_proc_timeout_event */
+#define BLE_LINK_ANSWER_TIMEOUT     0xFFFFU
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Connection parameters of one profile
+ */
+typedef struct
+{
+  const char *Name;
+  uint16_t IntervalMin;   //!< 1.25ms
+  uint16_t IntervalMax;   //!< 1.25ms
+  uint16_t Latency;       //!< Connection events
+} BleLinkParams_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const BleLinkParams_t ProfileParams[BLE_LINK_PROFILE_NUMBER] =
+{
+  {"CENTRAL", 0,                            0,                            0},
+  {"FAST",    BLE_LINK_FAST_INTERVAL_MIN,   BLE_LINK_FAST_INTERVAL_MAX,   BLE_LINK_FAST_LATENCY},
+  {"ACTIVE",  BLE_LINK_ACTIVE_INTERVAL_MIN, BLE_LINK_ACTIVE_INTERVAL_MAX, BLE_LINK_ACTIVE_LATENCY},
+  {"IDLE",    BLE_LINK_IDLE_INTERVAL_MIN,   BLE_LINK_IDLE_INTERVAL_MAX,   BLE_LINK_IDLE_LATENCY}
+};
+
+static uint8_t Connected;
+static uint16_t ConnHandle;
+static uint32_t ConnectTick;
+/* Data length and ATT MTU to request from the main loop */
+static uint8_t SetupPending;
+
+/* Connection parameters in use */
+static BleLink_Profile_t Profile;
+static uint16_t Interval;
+static uint16_t Latency;
+static uint16_t MaxTxOctets;
+
+/* Connection parameter update request waiting for the central */
+static uint8_t RequestPending;
+static BleLink_Profile_t Requested;
+
+/* Last profile refused by the central */
+static BleLink_Profile_t Refused;
+static uint32_t RefusedTick;
+
+static uint8_t ForceFast;
+static uint32_t BacklogTick;
+
+/* Notified bytes since the last change of the connection parameters */
+static uint32_t PeriodTick;
+static uint32_t PeriodBytes;
+
+/* Local function prototypes --------------------------------------------------*/
+static BleLink_Profile_t ChooseProfile(uint32_t Now);
+static void RequestProfile(BleLink_Profile_t Target, uint32_t Now);
+static void ReportPeriod(void);
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Set the default data length of the new connections
+ * @param None
+ * @retval None
+ */
+void BleLink_Init(void)
+{
+  tBleStatus ret;
+
+  ret = hci_le_write_suggested_default_data_length(BLE_LINK_MAX_TX_OCTETS, BLE_LINK_MAX_TX_TIME);
+  if(ret != BLE_STATUS_SUCCESS) {
+    PREDMNT1_PRINTF("\r\nSetting the default data length failed 0x%02x\r\n",ret);
+  }
+
+  Connected = 0;
+}
+
+/**
+ * @brief Request the data length, the ATT MTU and the connection parameters:
+ *        the fast profile while a backlog is pending, the active one while
+ *        the notifications are running and the idle one when there are none
+ * @param None
+ * @retval None
+ */
+void BleLink_Process(void)
+{
+  tBleStatus ret;
+  BleLink_Profile_t Target;
+  uint32_t Now;
+
+  if(!Connected) {
+    return;
+  }
+
+  if(SetupPending) {
+    SetupPending = 0;
+
+    /* The controller answers with hci_le_data_length_change_event if the central supports it */
+    ret = hci_le_set_data_length(ConnHandle, BLE_LINK_MAX_TX_OCTETS, BLE_LINK_MAX_TX_TIME);
+    if(ret != BLE_STATUS_SUCCESS) {
+      PREDMNT1_PRINTF("Data length request failed 0x%02x\r\n",ret);
+    }
+
+    /* The result is reported by aci_att_exchange_mtu_resp_event */
+    ret = aci_gatt_exchange_config(ConnHandle);
+    if(ret != BLE_STATUS_SUCCESS) {
+      PREDMNT1_PRINTF("ATT MTU exchange failed 0x%02x\r\n",ret);
+    }
+  }
+
+  Now = HAL_GetTick();
+
+  if(ForceFast || BleNotify_HasBacklog()) {
+    BacklogTick = Now;
+  }
+
+  /* Leave the central alone during the services discovery */
+  if(RequestPending || ((Now - ConnectTick) < BLE_LINK_FIRST_UPDATE_MS)) {
+    return;
+  }
+
+  Target = ChooseProfile(Now);
+
+  if(Target == Profile) {
+    return;
+  }
+
+  if((Target == Refused) && ((Now - RefusedTick) < BLE_LINK_RETRY_MS)) {
+    return;
+  }
+
+  RequestProfile(Target, Now);
+}
+
+/**
+ * @brief Keep the fast profile during the transfers from the central
+ * @param uint8_t Enable 1 for keeping the fast profile, 0 for releasing it
+ * @retval None
+ */
+void BleLink_ForceFast(uint8_t Enable)
+{
+  ForceFast = Enable;
+
+  if(Enable) {
+    BacklogTick = HAL_GetTick();
+  }
+}
+
+/**
+ * @brief Start the link policy for a new connection
+ * @param uint16_t Connection_Handle Connection handle
+ * @param uint16_t Conn_Interval Connection interval chosen by the central (1.25ms)
+ * @param uint16_t Conn_Latency Slave latency chosen by the central
+ * @param uint16_t Supervision_Timeout Supervision timeout chosen by the central (10ms)
+ * @retval None
+ */
+void BleLink_Connected(uint16_t Connection_Handle, uint16_t Conn_Interval,
+                       uint16_t Conn_Latency, uint16_t Supervision_Timeout)
+{
+  /* Start of the first throughput period */
+  ReportPeriod();
+
+  Connected = 1;
+  ConnHandle = Connection_Handle;
+  ConnectTick = HAL_GetTick();
+  SetupPending = 1;
+
+  Profile = BLE_LINK_PROFILE_CENTRAL;
+  Interval = Conn_Interval;
+  Latency = Conn_Latency;
+  MaxTxOctets = 27;
+
+  RequestPending = 0;
+  Refused = BLE_LINK_PROFILE_CENTRAL;
+  ForceFast = 0;
+  BacklogTick = ConnectTick - BLE_LINK_FAST_HOLD_MS;
+}
+
+/**
+ * @brief Track the connection parameters in use
+ * @param uint16_t Conn_Interval Connection interval (1.25ms)
+ * @param uint16_t Conn_Latency Slave latency
+ * @param uint16_t Supervision_Timeout Supervision timeout (10ms)
+ * @retval None
+ */
+void BleLink_Updated(uint16_t Conn_Interval, uint16_t Conn_Latency, uint16_t Supervision_Timeout)
+{
+  const BleLinkParams_t *pParams = &ProfileParams[Profile];
+
+  /* Throughput obtained with the previous parameters */
+  ReportPeriod();
+
+  Interval = Conn_Interval;
+  Latency = Conn_Latency;
+
+  /* Parameters changed by the central on its own */
+  if((!RequestPending) &&
+     ((Conn_Interval < pParams->IntervalMin) || (Conn_Interval > pParams->IntervalMax) ||
+      (Conn_Latency != pParams->Latency))) {
+    Profile = BLE_LINK_PROFILE_CENTRAL;
+  }
+}
+
+/**
+ * @brief Answer of the central to the connection parameter update request
+ * @param uint16_t Result 0 if accepted, 0xFFFF if the central did not answer
+ * @retval None
+ */
+void BleLink_UpdateAnswer(uint16_t Result)
+{
+  if(!RequestPending) {
+    return;
+  }
+
+  RequestPending = 0;
+
+  if(Result == 0) {
+    Profile = Requested;
+  } else {
+    Refused = Requested;
+    RefusedTick = HAL_GetTick();
+  }
+
+#ifdef PREDMNT1_DEBUG_CONNECTION
+  PREDMNT1_PRINTF(">>>>>>LINK %s %s\r\n", ProfileParams[Requested].Name,
+                  (Result == 0) ? "accepted" : ((Result == BLE_LINK_ANSWER_TIMEOUT) ? "timeout" : "refused"));
+#endif /* PREDMNT1_DEBUG_CONNECTION */
+}
+
+/**
+ * @brief Track the data length in use
+ * @param uint16_t MaxTx Max payload of a LL data PDU sent on the connection
+ * @retval None
+ */
+void BleLink_DataLength(uint16_t MaxTx)
+{
+  MaxTxOctets = MaxTx;
+
+#ifdef PREDMNT1_DEBUG_CONNECTION
+  PREDMNT1_PRINTF(">>>>>>DATA LENGTH %d\r\n\r\n",MaxTxOctets);
+#endif /* PREDMNT1_DEBUG_CONNECTION */
+}
+
+/**
+ * @brief Stop the link policy
+ * @param None
+ * @retval None
+ */
+void BleLink_Disconnected(void)
+{
+  if(Connected) {
+    ReportPeriod();
+  }
+
+  Connected = 0;
+  SetupPending = 0;
+  RequestPending = 0;
+  ForceFast = 0;
+}
+
+/* Local functions  -----------------------------------------------------*/
+
+/**
+ * @brief Choose the connection parameters for the notifications
+ * @param uint32_t Now HAL_GetTick
+ * @retval BleLink_Profile_t Profile to request
+ */
+static BleLink_Profile_t ChooseProfile(uint32_t Now)
+{
+  if((Now - BacklogTick) < BLE_LINK_FAST_HOLD_MS) {
+    return BLE_LINK_PROFILE_FAST;
+  }
+
+  if((Now - BleNotify_LastPostTick()) < BLE_LINK_IDLE_MS) {
+    return BLE_LINK_PROFILE_ACTIVE;
+  }
+
+  return BLE_LINK_PROFILE_IDLE;
+}
+
+/**
+ * @brief Send the L2CAP connection parameter update request
+ * @param BleLink_Profile_t Target Profile to request
+ * @param uint32_t Now HAL_GetTick
+ * @retval None
+ */
+static void RequestProfile(BleLink_Profile_t Target, uint32_t Now)
+{
+  const BleLinkParams_t *pParams = &ProfileParams[Target];
+  tBleStatus ret;
+
+  ret = aci_l2cap_connection_parameter_update_req(ConnHandle,
+                                                  pParams->IntervalMin,
+                                                  pParams->IntervalMax,
+                                                  pParams->Latency,
+                                                  BLE_LINK_TIMEOUT);
+
+  if(ret == BLE_STATUS_SUCCESS) {
+    RequestPending = 1;
+    Requested = Target;
+  } else {
+    Refused = Target;
+    RefusedTick = Now;
+    PREDMNT1_PRINTF("Problem Changing the connection interval 0x%02x\r\n",ret);
+  }
+}
+
+/**
+ * @brief Report the notification throughput with the connection parameters in use
+ * @param None
+ * @retval None
+ */
+static void ReportPeriod(void)
+{
+  BleNotify_Stats_t Stats;
+  uint32_t Now = HAL_GetTick();
+
+  BleNotify_GetStats(&Stats);
+
+#ifdef PREDMNT1_DEBUG_CONNECTION
+  {
+    uint32_t Ms = Now - PeriodTick;
+    uint32_t Bytes = Stats.SentBytes - PeriodBytes;
+
+    if(Connected && Ms) {
+      PREDMNT1_PRINTF(">>>>>>LINK %s %ld.%02ldms latency %d DLE %d: %ld bytes in %ld ms (%ld bit/s)\r\n\r\n",
+                      ProfileParams[Profile].Name,
+                      ((uint32_t)Interval*125)/100, ((uint32_t)Interval*125)%100, Latency, MaxTxOctets,
+                      Bytes, Ms, (uint32_t)(((uint64_t)Bytes*8000)/Ms));
+    }
+  }
+#endif /* PREDMNT1_DEBUG_CONNECTION */
+
+  PeriodTick = Now;
+  PeriodBytes = Stats.SentBytes;
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
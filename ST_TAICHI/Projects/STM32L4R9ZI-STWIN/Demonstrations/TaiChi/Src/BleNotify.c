@@ -0,0 +1,614 @@
+/**
+  ******************************************************************************
+  * @file    BleNotify.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Notifications of the BLE characteristics scheduled on the BlueNRG-2 TX pool
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "TargetFeatures.h"
+#include "sensor_service.h"
+#include "BleNotify.h"
+
+/* Local defines -------------------------------------------------------------*/
+
+/* ACI_GATT_UPDATE_CHAR_VALUE parameters before the value */
+#define BLE_NOTIFY_CMD_HEADER_LEN   6U
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Kind of the update waiting for the BlueNRG-2 answer
+ */
+typedef enum
+{
+  BLE_NOTIFY_KIND_NONE = 0,
+  BLE_NOTIFY_KIND_LATEST,
+  BLE_NOTIFY_KIND_RELIABLE,
+  BLE_NOTIFY_KIND_STREAM
+} BleNotifyKind_t;
+
+/**
+ * @brief Characteristic attached to a channel
+ */
+typedef struct
+{
+  uint16_t ServHandle;                      //!< Handle of the service
+  uint16_t CharHandle;                      //!< Handle of the characteristic (0 if not registered)
+  uint8_t Pending;                          //!< Latest value waiting to be sent
+  uint8_t Len;                              //!< Length of the latest value
+  uint8_t Buff[BLE_NOTIFY_LATEST_MAX_LEN];  //!< Latest value
+  BleNotify_Pull_t Pull;                    //!< Stream running (NULL if none)
+  BleNotify_Done_t Done;                    //!< Completion of the stream chunks
+} BleNotifyChannel_t;
+
+/**
+ * @brief Value queued until it is accepted by the BlueNRG-2
+ */
+typedef struct
+{
+  BleNotify_Channel_t Ch;
+  uint8_t Len;
+  BleNotify_Done_t Done;
+  uint8_t Buff[BLE_NOTIFY_MAX_LEN];
+} BleNotifyReliable_t;
+
+/* Imported variables --------------------------------------------------------*/
+extern uint32_t ConnectionBleStatus;
+
+/* Private variables ---------------------------------------------------------*/
+static const char * const ChannelName[BLE_NOTIFY_NUMBER] =
+{
+  "TaiChi",
+  "FFT Alarm Speed Status",
+  "FFT Alarm Acc Status",
+  "FFT Alarm Subrange Status",
+  "FFT Envelope",
+  "Time Domain",
+  "Acc/Gyro/Mag",
+  "Mic",
+  "FFT Amplitude",
+  "Battery Info",
+  "Environmental"
+};
+
+static BleNotifyChannel_t Channel[BLE_NOTIFY_NUMBER];
+
+static BleNotifyReliable_t Reliable[BLE_NOTIFY_RELIABLE_NUM];
+static uint8_t ReliableHead;
+static uint8_t ReliableCount;
+
+/* Only one update is queued in the HCI layer: the next one is chosen when it is answered */
+static BleNotifyKind_t InFlight = BLE_NOTIFY_KIND_NONE;
+static BleNotify_Channel_t InFlightCh;
+static uint8_t InFlightLen;
+static uint32_t InFlightEpoch;
+/* Incremented by BleNotify_Reset for ignoring the answer of the update on the air */
+static uint32_t Epoch;
+
+/* Set by BLE_STATUS_INSUFFICIENT_RESOURCES, cleared by aci_gatt_tx_pool_available_event */
+static uint8_t Blocked;
+static uint32_t BlockedTick;
+
+/* Free TX buffers estimated from the last aci_gatt_tx_pool_available_event */
+static uint8_t CreditsValid;
+static uint16_t Credits;
+static uint32_t CreditsTick;
+
+static BleNotify_Stats_t Stats;
+static uint32_t LastPostTick;
+/* Channels with a failed update, reported by BleNotify_ReportErrors */
+static uint16_t ErrorMask;
+
+/* Local function prototypes --------------------------------------------------*/
+static uint8_t LowPrioHeld(void);
+static BleNotifyKind_t Fill(BleNotify_Channel_t Ch, uint8_t *pValue, uint8_t *pLen);
+static void Kick(void);
+static void UpdateDone(uint8_t Status, const uint8_t *pReturn, uint8_t ReturnLen, void *pUser);
+static void ReportError(BleNotify_Channel_t Ch);
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Attach a channel to its characteristic
+ * @param BleNotify_Channel_t Ch Channel
+ * @param uint16_t ServHandle The handle of the service
+ * @param uint16_t CharHandle The handle of the characteristic
+ * @retval None
+ */
+void BleNotify_Register(BleNotify_Channel_t Ch, uint16_t ServHandle, uint16_t CharHandle)
+{
+  if(Ch < BLE_NOTIFY_NUMBER) {
+    Channel[Ch].ServHandle = ServHandle;
+    Channel[Ch].CharHandle = CharHandle;
+  }
+}
+
+/**
+ * @brief Notify a periodic value, a newer value overwrites the one not yet sent
+ * @param BleNotify_Channel_t Ch Channel
+ * @param const uint8_t *pData Value (it is copied)
+ * @param uint8_t Len Length of the value (not bigger than BLE_NOTIFY_LATEST_MAX_LEN)
+ * @retval tBleStatus Status
+ */
+tBleStatus BleNotify_Post(BleNotify_Channel_t Ch, const uint8_t *pData, uint8_t Len)
+{
+  if((Ch >= BLE_NOTIFY_NUMBER) || (Channel[Ch].CharHandle == 0) || (Len > BLE_NOTIFY_LATEST_MAX_LEN)) {
+    return BLE_STATUS_INVALID_PARAMS;
+  }
+
+  if(Channel[Ch].Pending) {
+    Stats.Coalesced++;
+  }
+
+  memcpy(Channel[Ch].Buff, pData, Len);
+  Channel[Ch].Len = Len;
+  Channel[Ch].Pending = 1;
+  LastPostTick = HAL_GetTick();
+
+  Kick();
+
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Notify a value that is retried until it is accepted by the BlueNRG-2
+ * @param BleNotify_Channel_t Ch Channel
+ * @param const uint8_t *pData Value (it is copied)
+ * @param uint8_t Len Length of the value (not bigger than ATT MTU - 3)
+ * @param BleNotify_Done_t Done Called with the result, only if the value has been queued
+ * @retval tBleStatus Status (BLE_STATUS_INSUFFICIENT_RESOURCES if the queue is full)
+ */
+tBleStatus BleNotify_PostReliable(BleNotify_Channel_t Ch, const uint8_t *pData, uint8_t Len,
+                                  BleNotify_Done_t Done)
+{
+  BleNotifyReliable_t *Item;
+
+  if((Ch >= BLE_NOTIFY_NUMBER) || (Channel[Ch].CharHandle == 0) || (Len > BLE_NOTIFY_MAX_LEN)) {
+    return BLE_STATUS_INVALID_PARAMS;
+  }
+
+  if(ReliableCount == BLE_NOTIFY_RELIABLE_NUM) {
+    return BLE_STATUS_INSUFFICIENT_RESOURCES;
+  }
+
+  Item = &Reliable[(ReliableHead + ReliableCount) % BLE_NOTIFY_RELIABLE_NUM];
+  Item->Ch = Ch;
+  Item->Len = Len;
+  Item->Done = Done;
+  memcpy(Item->Buff, pData, Len);
+  ReliableCount++;
+  LastPostTick = HAL_GetTick();
+
+  Kick();
+
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Drop the queued reliable values not yet on the air
+ *        It could be called by a Done callback, for the values queued after a failed one
+ * @param BleNotify_Done_t Done Completion of the values to drop (it is not called)
+ * @retval uint8_t Num of values dropped
+ */
+uint8_t BleNotify_DropReliable(BleNotify_Done_t Done)
+{
+  BleNotifyReliable_t *Item;
+  uint8_t Num = ReliableCount;
+  uint8_t Dropped = 0;
+  uint8_t n;
+
+  /* The head on the air stays in the queue until its answer */
+  n = ((InFlight == BLE_NOTIFY_KIND_RELIABLE) && (InFlightEpoch == Epoch)) ? 1 : 0;
+  ReliableCount = n;
+
+  /* The values kept are moved forward, in order */
+  for(; n<Num; n++) {
+    Item = &Reliable[(ReliableHead + n) % BLE_NOTIFY_RELIABLE_NUM];
+    if(Item->Done == Done) {
+      Dropped++;
+    } else {
+      if(Dropped) {
+        memcpy(&Reliable[(ReliableHead + ReliableCount) % BLE_NOTIFY_RELIABLE_NUM], Item, sizeof(BleNotifyReliable_t));
+      }
+      ReliableCount++;
+    }
+  }
+
+  return Dropped;
+}
+
+/**
+ * @brief Start a stream, or update the callbacks of the running one
+ * @param BleNotify_Channel_t Ch Channel
+ * @param BleNotify_Pull_t Pull Called for filling each notification
+ * @param BleNotify_Done_t Done Called with the result of each notification (it could be NULL)
+ * @retval tBleStatus Status
+ */
+tBleStatus BleNotify_Stream(BleNotify_Channel_t Ch, BleNotify_Pull_t Pull, BleNotify_Done_t Done)
+{
+  if((Ch >= BLE_NOTIFY_NUMBER) || (Channel[Ch].CharHandle == 0) || (Pull == NULL)) {
+    return BLE_STATUS_INVALID_PARAMS;
+  }
+
+  Channel[Ch].Pull = Pull;
+  Channel[Ch].Done = Done;
+  LastPostTick = HAL_GetTick();
+
+  Kick();
+
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Resume the updates refused for lack of TX buffers
+ * @param uint16_t AvailableBuffers Free buffers reported by aci_gatt_tx_pool_available_event
+ * @retval None
+ */
+void BleNotify_TxPoolAvailable(uint16_t AvailableBuffers)
+{
+  Blocked = 0;
+
+  Credits = AvailableBuffers;
+  CreditsTick = HAL_GetTick();
+  CreditsValid = 1;
+
+  Kick();
+}
+
+/**
+ * @brief Drop all the pending updates when the connection is closed
+ *        The reliable values and the streams are completed with BLE_STATUS_ERROR
+ * @param None
+ * @retval None
+ */
+void BleNotify_Reset(void)
+{
+  BleNotify_Done_t StreamDone[BLE_NOTIFY_NUMBER];
+  BleNotify_Done_t Done;
+  uint32_t Ch;
+
+  /* The answer of the update on the air is ignored */
+  Epoch++;
+
+  Blocked = 0;
+  CreditsValid = 0;
+
+  for(Ch=0; Ch<BLE_NOTIFY_NUMBER; Ch++) {
+    StreamDone[Ch] = (Channel[Ch].Pull != NULL) ? Channel[Ch].Done : NULL;
+    Channel[Ch].Pending = 0;
+    Channel[Ch].Pull = NULL;
+    Channel[Ch].Done = NULL;
+  }
+
+  /* The callbacks could queue new values: the queue is emptied before */
+  while(ReliableCount) {
+    Done = Reliable[ReliableHead].Done;
+    ReliableHead = (ReliableHead + 1) % BLE_NOTIFY_RELIABLE_NUM;
+    ReliableCount--;
+
+    if(Done != NULL) {
+      Done(BLE_STATUS_ERROR);
+    }
+  }
+
+  for(Ch=0; Ch<BLE_NOTIFY_NUMBER; Ch++) {
+    if(StreamDone[Ch] != NULL) {
+      StreamDone[Ch](BLE_STATUS_ERROR);
+    }
+  }
+}
+
+/**
+ * @brief Read the notification counters
+ * @param BleNotify_Stats_t *pStats Counters since the boot
+ * @retval None
+ */
+void BleNotify_GetStats(BleNotify_Stats_t *pStats)
+{
+  *pStats = Stats;
+}
+
+/**
+ * @brief Check if some updates are waiting for more than one notification
+ * @param None
+ * @retval uint8_t 1 if a stream is running, reliable values are queued
+ *         or an update has been refused for lack of TX buffers
+ */
+uint8_t BleNotify_HasBacklog(void)
+{
+  uint32_t Ch;
+
+  if(ReliableCount || Blocked) {
+    return 1;
+  }
+
+  for(Ch=0; Ch<BLE_NOTIFY_NUMBER; Ch++) {
+    if(Channel[Ch].Pull != NULL) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Read when the last update has been posted
+ * @param None
+ * @retval uint32_t HAL_GetTick of the last update posted
+ */
+uint32_t BleNotify_LastPostTick(void)
+{
+  return LastPostTick;
+}
+
+/**
+ * @brief Report the failed updates on the stderr characteristic or on the console.
+ *        It sends synchronous commands: it must be called from the main loop
+ *        and not from a completion callback
+ * @param None
+ * @retval None
+ */
+void BleNotify_ReportErrors(void)
+{
+  BleNotify_Channel_t Ch;
+  uint16_t Mask = ErrorMask;
+
+  ErrorMask = 0;
+  for(Ch=0; Ch<BLE_NOTIFY_NUMBER; Ch++) {
+    if(Mask & (1U << Ch)) {
+      if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
+        BytesToWrite =sprintf((char *)BufferToWrite, "Error Updating %s Char\r\n",ChannelName[Ch]);
+        Stderr_Update(BufferToWrite,BytesToWrite);
+      } else {
+        PREDMNT1_PRINTF("Error Updating %s Char\r\n",ChannelName[Ch]);
+      }
+    }
+  }
+}
+
+/* Local functions  -----------------------------------------------------*/
+
+/**
+ * @brief Check if the low priority channels must leave the TX buffers to the others
+ * @param None
+ * @retval uint8_t 1 if the known free TX buffers are not more than the reserve
+ */
+static uint8_t LowPrioHeld(void)
+{
+  /* Without a recent aci_gatt_tx_pool_available_event the estimate is not reliable,
+   * the next refused update renews it */
+  if((!CreditsValid) || ((HAL_GetTick() - CreditsTick) > BLE_NOTIFY_CREDITS_TTL_MS)) {
+    CreditsValid = 0;
+    return 0;
+  }
+
+  return (Credits <= BLE_NOTIFY_LOW_PRIO_RESERVE) ? 1 : 0;
+}
+
+/**
+ * @brief Take the value to send for one channel
+ *        Reliable values first, then the latest value, then the stream
+ * @param BleNotify_Channel_t Ch Channel
+ * @param uint8_t *pValue Filled with the value
+ * @param uint8_t *pLen Filled with the length of the value
+ * @retval BleNotifyKind_t Kind of the value (BLE_NOTIFY_KIND_NONE if nothing to send)
+ */
+static BleNotifyKind_t Fill(BleNotify_Channel_t Ch, uint8_t *pValue, uint8_t *pLen)
+{
+  BleNotifyChannel_t *pChannel = &Channel[Ch];
+
+  /* The reliable value stays in the queue until it is accepted */
+  if(ReliableCount && (Reliable[ReliableHead].Ch == Ch)) {
+    *pLen = Reliable[ReliableHead].Len;
+    memcpy(pValue, Reliable[ReliableHead].Buff, *pLen);
+    return BLE_NOTIFY_KIND_RELIABLE;
+  }
+
+  if(pChannel->Pending) {
+    pChannel->Pending = 0;
+    *pLen = pChannel->Len;
+    memcpy(pValue, pChannel->Buff, *pLen);
+    return BLE_NOTIFY_KIND_LATEST;
+  }
+
+  if(pChannel->Pull != NULL) {
+    *pLen = pChannel->Pull(pValue, BLE_NOTIFY_MAX_LEN);
+    if(*pLen) {
+      return BLE_NOTIFY_KIND_STREAM;
+    }
+
+    /* End of the stream */
+    pChannel->Pull = NULL;
+    pChannel->Done = NULL;
+  }
+
+  return BLE_NOTIFY_KIND_NONE;
+}
+
+/**
+ * @brief Send the highest priority pending update if nothing is on the air
+ *        and the BlueNRG-2 TX pool is not full
+ * @param None
+ * @retval None
+ */
+static void Kick(void)
+{
+  /* Sized as the command structure (up to HCI_MAX_PAYLOAD_SIZE), not only the longest value */
+  uint8_t CmdBuff[sizeof(aci_gatt_update_char_value_cp0)];
+  aci_gatt_update_char_value_cp0 *cp0 = (aci_gatt_update_char_value_cp0 *)CmdBuff;
+  struct hci_request rq;
+  BleNotifyKind_t Kind = BLE_NOTIFY_KIND_NONE;
+  uint32_t Ch;
+  uint8_t Len = 0;
+
+  if(InFlight != BLE_NOTIFY_KIND_NONE) {
+    return;
+  }
+
+  if(Blocked) {
+    /* Safety net if aci_gatt_tx_pool_available_event is lost */
+    if((HAL_GetTick() - BlockedTick) < BLE_NOTIFY_BLOCKED_MAX_MS) {
+      return;
+    }
+    Blocked = 0;
+  }
+
+  for(Ch=0; Ch<BLE_NOTIFY_NUMBER; Ch++) {
+    if((Ch >= BLE_NOTIFY_LOW_PRIO_FIRST) && LowPrioHeld()) {
+      /* The held values are sent by the next update or TX pool event */
+      return;
+    }
+
+    Kind = Fill((BleNotify_Channel_t)Ch, cp0->Char_Value, &Len);
+    if(Kind != BLE_NOTIFY_KIND_NONE) {
+      break;
+    }
+  }
+
+  if(Kind == BLE_NOTIFY_KIND_NONE) {
+    return;
+  }
+
+  cp0->Service_Handle = Channel[Ch].ServHandle;
+  cp0->Char_Handle = Channel[Ch].CharHandle;
+  cp0->Val_Offset = 0;
+  cp0->Char_Value_Length = Len;
+
+  /* ACI_GATT_UPDATE_CHAR_VALUE */
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = 0x3f;
+  rq.ocf = 0x106;
+  rq.cparam = CmdBuff;
+  rq.clen = BLE_NOTIFY_CMD_HEADER_LEN + Len;
+
+  /* Set before sending: a callback run by the HCI layer could post a new value */
+  InFlight = Kind;
+  InFlightCh = (BleNotify_Channel_t)Ch;
+  InFlightLen = Len;
+  InFlightEpoch = Epoch;
+
+  if(hci_send_req_async(&rq, UpdateDone, NULL) < 0) {
+    /* HCI requests table full: retried by the next update */
+    InFlight = BLE_NOTIFY_KIND_NONE;
+    if(Kind == BLE_NOTIFY_KIND_LATEST) {
+      Channel[Ch].Pending = 1;
+    }
+  }
+}
+
+/**
+ * @brief  Answer of the BlueNRG-2 to the update on the air
+ * @param  uint8_t Status Status of the ACI_GATT_UPDATE_CHAR_VALUE command
+ * @param  const uint8_t *pReturn Not used
+ * @param  uint8_t ReturnLen Not used
+ * @param  void *pUser Not used
+ * @retval None
+ */
+static void UpdateDone(uint8_t Status, const uint8_t *pReturn, uint8_t ReturnLen, void *pUser)
+{
+  BleNotifyKind_t Kind = InFlight;
+  BleNotify_Channel_t Ch = InFlightCh;
+  BleNotify_Done_t Done = NULL;
+
+  InFlight = BLE_NOTIFY_KIND_NONE;
+
+  /* Dropped by BleNotify_Reset */
+  if(InFlightEpoch != Epoch) {
+    Kick();
+    return;
+  }
+
+  if(Status == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+    /* Nothing else is sent until aci_gatt_tx_pool_available_event: then the highest
+     * priority update goes first. A refused latest value is kept if not overwritten,
+     * the reliable value is still in the queue and the stream chunk is pulled again */
+    Stats.Refused++;
+    Blocked = 1;
+    BlockedTick = HAL_GetTick();
+    Credits = 0;
+    CreditsTick = BlockedTick;
+    CreditsValid = 1;
+
+    if(Kind == BLE_NOTIFY_KIND_LATEST) {
+      Channel[Ch].Pending = 1;
+    }
+    return;
+  }
+
+  if(Status == BLE_STATUS_SUCCESS) {
+    Stats.Sent++;
+    Stats.SentBytes += InFlightLen;
+    if(Credits) {
+      Credits--;
+    }
+  } else {
+    Stats.Errors++;
+    ReportError(Ch);
+  }
+
+  if(Kind == BLE_NOTIFY_KIND_RELIABLE) {
+    Done = Reliable[ReliableHead].Done;
+    ReliableHead = (ReliableHead + 1) % BLE_NOTIFY_RELIABLE_NUM;
+    ReliableCount--;
+  } else if(Kind == BLE_NOTIFY_KIND_STREAM) {
+    Done = Channel[Ch].Done;
+    if(Status != BLE_STATUS_SUCCESS) {
+      Channel[Ch].Pull = NULL;
+      Channel[Ch].Done = NULL;
+    }
+  }
+
+  /* Before the next update: a stream moves its cursor here */
+  if(Done != NULL) {
+    Done(Status);
+  }
+
+  Kick();
+}
+
+/**
+ * @brief  Latch a failed characteristic update: it is reported from the main
+ *         loop, a synchronous command is not sent from the completion callback
+ * @param  BleNotify_Channel_t Ch Channel
+ * @retval None
+ */
+static void ReportError(BleNotify_Channel_t Ch)
+{
+  ErrorMask |= (uint16_t)(1U << Ch);
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
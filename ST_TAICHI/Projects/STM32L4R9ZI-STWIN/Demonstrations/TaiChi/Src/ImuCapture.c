@@ -0,0 +1,328 @@
+/**
+  ******************************************************************************
+  * @file    ImuCapture.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Raw Acc/Gyro/Mag capture streamed over USB CDC as binary frames
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "TargetFeatures.h"
+#include "ImuCapture.h"
+
+#ifdef PREDMNT1_ENABLE_PRINTF
+
+/* Local defines -------------------------------------------------------------*/
+
+/* FIFO words read with a single bus transfer */
+#define IMU_CAPTURE_BURST_WORDS    32U
+/* Period for repeating the configuration frames [ms] */
+#define IMU_CAPTURE_CONFIG_PERIOD  1000U
+
+/* IIS2MDC STATUS_REG: new X/Y/Z data available */
+#define IMU_CAPTURE_MAG_ZYXDA      0x08U
+
+/* Imported variables --------------------------------------------------------*/
+extern void *MotionCompObj[MOTION_INSTANCES_NBR];
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint8_t Running;
+static uint16_t Seq;
+static uint32_t Dropped;
+static uint32_t ConfigTick;
+
+static uint8_t FifoBuff[IMU_CAPTURE_BURST_WORDS * ISM330DHCX_FIFO_WORD_LEN];
+static uint8_t FrameBuff[IMU_CAPTURE_BURST_WORDS * IMU_CAPTURE_FRAME_LEN];
+
+/* Local function prototypes --------------------------------------------------*/
+static uint32_t PutFrame(uint8_t *pFrame, uint8_t Type, const uint8_t *pData);
+static uint32_t PutConfig(uint8_t *pFrame, uint8_t Type, uint32_t Instance, uint32_t Function);
+static void SendFrames(uint32_t NumFrames);
+static void SendConfig(void);
+static void SendMag(void);
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Start the capture: Acc/Gyro batched in the ISM330DHCX FIFO at their current ODR
+ * @param None
+ * @retval None
+ */
+void ImuCapture_Start(void)
+{
+  stmdev_ctx_t *ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
+  float Odr;
+
+  if(Running || (!TargetBoardFeatures.AccSensorIsInit)) {
+    return;
+  }
+
+  Seq     = 0;
+  Dropped = 0;
+
+  /* Restart from an empty FIFO */
+  MOTION_SENSOR_FIFO_Set_Mode(ACCELERO_INSTANCE, ACCELERO_BYPASS_MODE);
+
+  MOTION_SENSOR_GetOutputDataRate(ACCELERO_INSTANCE, MOTION_ACCELERO, &Odr);
+  MOTION_SENSOR_FIFO_Set_BDR(ACCELERO_INSTANCE, MOTION_ACCELERO, Odr);
+
+  if(TargetBoardFeatures.GyroSensorIsInit) {
+    MOTION_SENSOR_GetOutputDataRate(GYRO_INSTANCE, MOTION_GYRO, &Odr);
+    MOTION_SENSOR_FIFO_Set_BDR(GYRO_INSTANCE, MOTION_GYRO, Odr);
+  } else {
+    ism330dhcx_fifo_gy_batch_set(ctx, ISM330DHCX_GY_NOT_BATCHED);
+  }
+
+  /* One timestamp word for each batch: the host rebuilds the sample times without jitter */
+  ism330dhcx_timestamp_set(ctx, PROPERTY_ENABLE);
+  ism330dhcx_fifo_timestamp_decimation_set(ctx, ISM330DHCX_DEC_1);
+
+  MOTION_SENSOR_FIFO_Set_Mode(ACCELERO_INSTANCE, ACCELERO_STREAM_MODE);
+
+  Running = 1;
+  SendConfig();
+}
+
+/**
+ * @brief Stop the capture and put the ISM330DHCX FIFO in bypass mode
+ * @param None
+ * @retval None
+ */
+void ImuCapture_Stop(void)
+{
+  stmdev_ctx_t *ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
+
+  if(!Running) {
+    return;
+  }
+
+  Running = 0;
+
+  MOTION_SENSOR_FIFO_Set_Mode(ACCELERO_INSTANCE, ACCELERO_BYPASS_MODE);
+  ism330dhcx_fifo_xl_batch_set(ctx, ISM330DHCX_XL_NOT_BATCHED);
+  ism330dhcx_fifo_gy_batch_set(ctx, ISM330DHCX_GY_NOT_BATCHED);
+  ism330dhcx_fifo_timestamp_decimation_set(ctx, ISM330DHCX_NO_DECIMATION);
+  ism330dhcx_timestamp_set(ctx, PROPERTY_DISABLE);
+}
+
+/**
+ * @brief Read if the capture is running
+ * @param None
+ * @retval uint8_t 1 if the capture is running
+ */
+uint8_t ImuCapture_IsRunning(void)
+{
+  return Running;
+}
+
+/**
+ * @brief Drain the ISM330DHCX FIFO and the IIS2MDC into the USB CDC
+ * @param None
+ * @retval None
+ */
+void ImuCapture_Process(void)
+{
+  uint16_t Level;
+  uint16_t Num;
+  uint16_t Word;
+  uint32_t NumFrames;
+
+  if(!Running) {
+    return;
+  }
+
+  if((HAL_GetTick() - ConfigTick) >= IMU_CAPTURE_CONFIG_PERIOD) {
+    SendConfig();
+  }
+
+  if(MOTION_SENSOR_FIFO_Get_Num_Samples(ACCELERO_INSTANCE, &Level) != BSP_ERROR_NONE) {
+    Level = 0;
+  }
+
+  /* Only the words already there: the ones arriving meanwhile wait for the next call */
+  while(Level > 0U) {
+    Num = (Level > IMU_CAPTURE_BURST_WORDS) ? IMU_CAPTURE_BURST_WORDS : Level;
+
+    if(MOTION_SENSOR_FIFO_Read_Block(ACCELERO_INSTANCE, FifoBuff, Num) != BSP_ERROR_NONE) {
+      break;
+    }
+    Level -= Num;
+
+    NumFrames = 0;
+    for(Word=0; Word<Num; Word++) {
+      const uint8_t *pWord = &FifoBuff[Word * ISM330DHCX_FIFO_WORD_LEN];
+      /* TAG_SENSOR is in the 5 MSBs of the tag byte */
+      uint8_t Tag = pWord[0] >> 3;
+
+      /* Only the frame types of the host decoder: the other words (temperature,
+       * CFG_CHANGE, ...) would make it resynchronize and drop the next frames */
+      if((Tag == IMU_CAPTURE_TYPE_GYRO) || (Tag == IMU_CAPTURE_TYPE_ACC) || (Tag == IMU_CAPTURE_TYPE_TIME)) {
+        NumFrames += PutFrame(&FrameBuff[NumFrames * IMU_CAPTURE_FRAME_LEN], Tag, &pWord[1]);
+      }
+    }
+    SendFrames(NumFrames);
+  }
+
+  if(TargetBoardFeatures.MagSensorIsInit) {
+    SendMag();
+  }
+}
+
+/**
+ * @brief Read the number of frames lost because the USB CDC ring was full
+ * @param None
+ * @retval uint32_t Num of frames lost since the capture start
+ */
+uint32_t ImuCapture_Dropped(void)
+{
+  return Dropped;
+}
+
+/* Local functions  --------------------------------------------------*/
+
+/**
+ * @brief Build one frame with the next sequence number
+ * @param uint8_t *pFrame Destination (IMU_CAPTURE_FRAME_LEN bytes)
+ * @param uint8_t Type Frame type
+ * @param const uint8_t *pData Payload (IMU_CAPTURE_DATA_LEN bytes, little endian)
+ * @retval uint32_t Num of frames built (1)
+ */
+static uint32_t PutFrame(uint8_t *pFrame, uint8_t Type, const uint8_t *pData)
+{
+  pFrame[0] = IMU_CAPTURE_SYNC;
+  pFrame[1] = Type;
+  pFrame[2] = (uint8_t)(Seq);
+  pFrame[3] = (uint8_t)(Seq >> 8);
+  memcpy(&pFrame[4], pData, IMU_CAPTURE_DATA_LEN);
+  Seq++;
+
+  return 1;
+}
+
+/**
+ * @brief Build one configuration frame: sensitivity and ODR of one sensor
+ * @param uint8_t *pFrame Destination (IMU_CAPTURE_FRAME_LEN bytes)
+ * @param uint8_t Type Configuration frame type
+ * @param uint32_t Instance Sensor instance
+ * @param uint32_t Function Sensor function
+ * @retval uint32_t Num of frames built (1)
+ */
+static uint32_t PutConfig(uint8_t *pFrame, uint8_t Type, uint32_t Instance, uint32_t Function)
+{
+  uint8_t Data[IMU_CAPTURE_DATA_LEN];
+  float Sensitivity = 0.0f;
+  float Odr = 0.0f;
+  uint16_t OdrHz;
+
+  MOTION_SENSOR_GetSensitivity(Instance, Function, &Sensitivity);
+  MOTION_SENSOR_GetOutputDataRate(Instance, Function, &Odr);
+  OdrHz = (uint16_t)(Odr + 0.5f);
+
+  /* Cortex-M4 is little endian: the float is copied as it is */
+  memcpy(Data, &Sensitivity, sizeof(Sensitivity));
+  Data[4] = (uint8_t)(OdrHz);
+  Data[5] = (uint8_t)(OdrHz >> 8);
+
+  return PutFrame(pFrame, Type, Data);
+}
+
+/**
+ * @brief Copy the frames built in FrameBuff to the USB CDC ring
+ * @param uint32_t NumFrames Num of frames in FrameBuff
+ * @retval None
+ */
+static void SendFrames(uint32_t NumFrames)
+{
+  if(NumFrames == 0U) {
+    return;
+  }
+
+  /* The whole block is dropped if it does not fit, the Seq gap shows it to the host */
+  if(CDC_Fill_Buffer(FrameBuff, NumFrames * IMU_CAPTURE_FRAME_LEN) != USBD_OK) {
+    Dropped += NumFrames;
+  }
+}
+
+/**
+ * @brief Send the configuration frames, repeated so a host may attach at any time
+ * @param None
+ * @retval None
+ */
+static void SendConfig(void)
+{
+  uint32_t NumFrames = 0;
+
+  ConfigTick = HAL_GetTick();
+
+  NumFrames += PutConfig(&FrameBuff[NumFrames * IMU_CAPTURE_FRAME_LEN],
+                         IMU_CAPTURE_TYPE_CFG_ACC, ACCELERO_INSTANCE, MOTION_ACCELERO);
+
+  if(TargetBoardFeatures.GyroSensorIsInit) {
+    NumFrames += PutConfig(&FrameBuff[NumFrames * IMU_CAPTURE_FRAME_LEN],
+                           IMU_CAPTURE_TYPE_CFG_GYRO, GYRO_INSTANCE, MOTION_GYRO);
+  }
+
+  if(TargetBoardFeatures.MagSensorIsInit) {
+    NumFrames += PutConfig(&FrameBuff[NumFrames * IMU_CAPTURE_FRAME_LEN],
+                           IMU_CAPTURE_TYPE_CFG_MAG, MAGNETO_INSTANCE, MOTION_MAGNETO);
+  }
+
+  SendFrames(NumFrames);
+}
+
+/**
+ * @brief Send the IIS2MDC sample if a new one is available
+ * @param None
+ * @retval None
+ */
+static void SendMag(void)
+{
+  stmdev_ctx_t *ctx = &(((IIS2MDC_Object_t *)MotionCompObj[IIS2MDC_0])->Ctx);
+  /* STATUS_REG followed by OUTX_L_REG..OUTZ_H_REG */
+  uint8_t Raw[1 + IMU_CAPTURE_DATA_LEN];
+
+  if(iis2mdc_read_reg(ctx, IIS2MDC_STATUS_REG, Raw, sizeof(Raw)) != 0) {
+    return;
+  }
+
+  if((Raw[0] & IMU_CAPTURE_MAG_ZYXDA) == 0U) {
+    return;
+  }
+
+  SendFrames(PutFrame(FrameBuff, IMU_CAPTURE_TYPE_MAG, &Raw[1]));
+}
+
+#endif /* PREDMNT1_ENABLE_PRINTF */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
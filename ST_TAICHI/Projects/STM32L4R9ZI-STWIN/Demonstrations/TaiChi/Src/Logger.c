@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    Logger.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Deferred logger: format string and raw arguments formatted later
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "TargetFeatures.h"
+#include "Logger.h"
+
+#ifdef PREDMNT1_ENABLE_PRINTF
+
+/* Local types ---------------------------------------------------------------*/
+
+/**
+ * @brief Log entry, Ready is set by the producer once the entry is complete
+ */
+typedef struct
+{
+  const char *Fmt;              //!< Format string (in flash)
+  uint32_t Arg[LOG_MAX_ARGS];   //!< Raw arguments
+  uint8_t NArgs;                //!< Num of valid arguments
+  volatile uint8_t Ready;       //!< Entry can be formatted
+} LogRecord_t;
+
+/* Private variables ---------------------------------------------------------*/
+static LogRecord_t LogRing[LOG_RING_SIZE];
+/* Free running indexes: next entry reserved by the producers, next entry to format */
+static volatile uint32_t LogHead = 0;
+static volatile uint32_t LogTail = 0;
+static volatile uint32_t LogDropped = 0;
+static uint32_t LogDroppedReported = 0;
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Record one log entry (lock free, interrupt safe)
+ * @param const char *Fmt printf format string with only 32 bit arguments
+ * @param const uint32_t *pArgs Arguments
+ * @param uint32_t NArgs Num of arguments (extra ones are discarded)
+ * @retval None
+ */
+void Log_Write(const char *Fmt, const uint32_t *pArgs, uint32_t NArgs)
+{
+  LogRecord_t *pRec;
+  uint32_t Head;
+  uint32_t Arg;
+
+  /* Reserve one entry, retried only when preempted by another producer */
+  do {
+    Head = __LDREXW(&LogHead);
+    if((Head - LogTail) >= LOG_RING_SIZE) {
+      __CLREX();
+      do {
+        Arg = __LDREXW(&LogDropped);
+      } while(__STREXW(Arg + 1U, &LogDropped) != 0U);
+      return;
+    }
+  } while(__STREXW(Head + 1U, &LogHead) != 0U);
+
+  pRec = &LogRing[Head & (LOG_RING_SIZE - 1U)];
+
+  if(NArgs > LOG_MAX_ARGS) {
+    NArgs = LOG_MAX_ARGS;
+  }
+  for(Arg=0; Arg<NArgs; Arg++) {
+    pRec->Arg[Arg] = pArgs[Arg];
+  }
+  pRec->NArgs = (uint8_t)NArgs;
+  pRec->Fmt = Fmt;
+
+  /* The entry must be complete before the consumer sees it */
+  __DMB();
+  pRec->Ready = 1;
+}
+
+/**
+ * @brief Format the recorded entries in order
+ * @param LogOutput_t Output Sink for each formatted entry
+ * @retval None
+ */
+void Log_Flush(LogOutput_t Output)
+{
+  char Line[LOG_LINE_LEN];
+  LogRecord_t *pRec;
+  uint32_t Dropped;
+  int32_t Len;
+
+  /* Stop at the first entry still being written by a preempted producer */
+  while(LogTail != LogHead) {
+    pRec = &LogRing[LogTail & (LOG_RING_SIZE - 1U)];
+    if(!pRec->Ready) {
+      break;
+    }
+
+    /* printf ignores the arguments not used by the format string */
+    Len = snprintf(Line, sizeof(Line), pRec->Fmt,
+                   pRec->Arg[0], pRec->Arg[1], pRec->Arg[2],
+                   pRec->Arg[3], pRec->Arg[4], pRec->Arg[5]);
+    if(Len > 0) {
+      Output((uint8_t *)Line, (Len < (int32_t)sizeof(Line)) ? (uint32_t)Len : (sizeof(Line) - 1U));
+    }
+
+    pRec->Ready = 0;
+    __DMB();
+    LogTail++;
+  }
+
+  Dropped = LogDropped;
+  if(Dropped != LogDroppedReported) {
+    Len = snprintf(Line, sizeof(Line), "LOG: %lu entries dropped\r\n", Dropped - LogDroppedReported);
+    Output((uint8_t *)Line, (uint32_t)Len);
+    LogDroppedReported = Dropped;
+  }
+}
+
+/**
+ * @brief Num of entries lost because the ring was full
+ * @param None
+ * @retval uint32_t Dropped entries since the boot
+ */
+uint32_t Log_Dropped(void)
+{
+  return LogDropped;
+}
+
+#endif /* PREDMNT1_ENABLE_PRINTF */
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,250 @@
+/**
+  ******************************************************************************
+  * @file    MLCLoader.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Loader of ISM330DHCX machine learning core programs (UCF)
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include <string.h>
+
+#include "MLCLoader.h"
+
+/* Local defines -------------------------------------------------------------*/
+
+/* Register switching the embedded functions bank: never part of a burst */
+#define MLC_UCF_BANK_REG  ISM330DHCX_FUNC_CFG_ACCESS
+
+/* Longest burst written with one SPI transaction */
+#define MLC_UCF_MAX_BURST MLC_UCF_COUNT_MASK
+
+/* Private variables ---------------------------------------------------------*/
+static CRC_HandleTypeDef *LoaderCrc;
+
+/* Word aligned for the CRC peripheral */
+static uint32_t UcfImage[MLC_UCF_MAX_SIZE / 4U];
+static uint32_t UcfSize;      /* Size of the image being received */
+static uint32_t UcfReceived;
+static uint32_t UcfExpectedCrc;
+static uint32_t UcfValidSize; /* Size of the last valid image, 0 if none */
+
+/* Local function prototypes --------------------------------------------------*/
+static int32_t ParseImage(stmdev_ctx_t *ctx, uint32_t Size);
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Set the CRC peripheral used for checking the UCF images
+ * @param CRC_HandleTypeDef *hcrc CRC peripheral configured for 32-bit words
+ * @retval None
+ */
+void MLCLoader_Init(CRC_HandleTypeDef *hcrc)
+{
+  LoaderCrc = hcrc;
+  UcfSize = 0;
+  UcfReceived = 0;
+  UcfValidSize = 0;
+}
+
+/**
+ * @brief Write a compiled-in UCF table, merging the lines on consecutive
+ *        registers in one burst write
+ * @param stmdev_ctx_t *ctx ISM330DHCX context
+ * @param ucf_line_t *Ucf UCF table generated by Unico
+ * @param uint32_t Lines Number of lines of the table
+ * @retval int32_t 0 on success
+ */
+int32_t MLCLoader_WriteTable(stmdev_ctx_t *ctx, const ucf_line_t *Ucf, uint32_t Lines)
+{
+  uint8_t Burst[MLC_UCF_MAX_BURST];
+  uint32_t Line = 0;
+  uint32_t Count;
+
+  while(Line < Lines) {
+    Burst[0] = Ucf[Line].data;
+    Count = 1;
+
+    if(Ucf[Line].address != MLC_UCF_BANK_REG) {
+      while(((Line + Count) < Lines) && (Count < MLC_UCF_MAX_BURST) &&
+            (Ucf[Line + Count].address == (uint8_t)(Ucf[Line].address + Count)) &&
+            (Ucf[Line + Count].address != MLC_UCF_BANK_REG)) {
+        Burst[Count] = Ucf[Line + Count].data;
+        Count++;
+      }
+    }
+
+    if(ism330dhcx_write_reg(ctx, Ucf[Line].address, Burst, (uint16_t)Count) != 0) {
+      return -1;
+    }
+
+    Line += Count;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Start the reception of one UCF image
+ * @param uint32_t Size Size of the image [bytes], multiple of 4
+ * @param uint32_t Crc Expected CRC-32 of the image
+ * @retval uint8_t 1 if accepted
+ */
+uint8_t MLCLoader_Start(uint32_t Size, uint32_t Crc)
+{
+  UcfReceived = 0;
+  UcfValidSize = 0;
+
+  if((Size == 0U) || (Size > MLC_UCF_MAX_SIZE) || ((Size & 3U) != 0U)) {
+    UcfSize = 0;
+    return 0;
+  }
+
+  UcfSize = Size;
+  UcfExpectedCrc = Crc;
+
+  return 1;
+}
+
+/**
+ * @brief Number of bytes of the UCF image still expected
+ * @param None
+ * @retval uint32_t Remaining bytes (0 when not receiving)
+ */
+uint32_t MLCLoader_Remaining(void)
+{
+  return UcfSize - UcfReceived;
+}
+
+/**
+ * @brief Save one chunk of the UCF image, check it when complete
+ * @param uint8_t *Data Chunk received
+ * @param uint32_t Length Length of the chunk
+ * @retval int8_t 0 if more data is expected, 1 if the image is valid, -1 on error
+ */
+int8_t MLCLoader_Receive(const uint8_t *Data, uint32_t Length)
+{
+  if(Length > MLCLoader_Remaining()) {
+    /* Too many bytes... restart from the beginning */
+    UcfSize = UcfReceived = 0;
+    return -1;
+  }
+
+  memcpy(((uint8_t *)UcfImage) + UcfReceived, Data, Length);
+  UcfReceived += Length;
+
+  if(UcfReceived < UcfSize) {
+    return 0;
+  }
+
+  Length = UcfSize;
+  UcfSize = UcfReceived = 0;
+
+  if(HAL_CRC_Calculate(LoaderCrc, UcfImage, Length >> 2) != UcfExpectedCrc) {
+    return -1;
+  }
+
+  /* Check the blocks before touching the sensor */
+  if(ParseImage(NULL, Length) != 0) {
+    return -1;
+  }
+
+  UcfValidSize = Length;
+  return 1;
+}
+
+/**
+ * @brief Write the last valid UCF image received
+ * @param stmdev_ctx_t *ctx ISM330DHCX context
+ * @retval int32_t 0 on success
+ */
+int32_t MLCLoader_Apply(stmdev_ctx_t *ctx)
+{
+  if(!UcfValidSize) {
+    return -1;
+  }
+
+  return ParseImage(ctx, UcfValidSize);
+}
+
+/* Local functions  --------------------------------------------------*/
+
+/**
+ * @brief Walk the blocks of the UCF image
+ * @param stmdev_ctx_t *ctx ISM330DHCX context, NULL for checking only
+ * @param uint32_t Size Size of the image [bytes]
+ * @retval int32_t 0 on success
+ */
+static int32_t ParseImage(stmdev_ctx_t *ctx, uint32_t Size)
+{
+  const uint8_t *Image = (const uint8_t *)UcfImage;
+  uint32_t Index = 0;
+  uint32_t Count;
+  uint32_t Write;
+  uint8_t Address;
+  uint8_t SameAddress;
+
+  while((Index + 2U) <= Size) {
+    Address     = Image[Index];
+    SameAddress = Image[Index + 1U] & MLC_UCF_SAME_ADDRESS;
+    Count       = Image[Index + 1U] & MLC_UCF_COUNT_MASK;
+    Index += 2U;
+
+    if((Index + Count) > Size) {
+      return -1;
+    }
+
+    /* The bank register can't be written in burst */
+    if((!SameAddress) && (Count > 1U) && (Address <= MLC_UCF_BANK_REG) && ((Address + Count) > MLC_UCF_BANK_REG)) {
+      return -1;
+    }
+
+    if((ctx != NULL) && (Count != 0U)) {
+      if(SameAddress) {
+        for(Write=0; Write<Count; Write++) {
+          if(ism330dhcx_write_reg(ctx, Address, (uint8_t *)&Image[Index + Write], 1) != 0) {
+            return -1;
+          }
+        }
+      } else {
+        if(ism330dhcx_write_reg(ctx, Address, (uint8_t *)&Image[Index], (uint16_t)Count) != 0) {
+          return -1;
+        }
+      }
+    }
+
+    Index += Count;
+  }
+
+  /* Only one padding byte can be left */
+  return ((Index == Size) || (Image[Index] == 0U)) ? 0 : -1;
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    MotionSP_Alarm.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Time and frequency domain alarms of the MotionSP analysis, shared
+  *          by the firmware and by the MotionSPReplay host tool
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "MotionSP_Alarm.h"
+
+/** @addtogroup Projects
+  * @{
+  */
+
+/** @addtogroup DEMONSTRATIONS Demonstrations
+  * @{
+  */
+
+/** @addtogroup PREDCTIVE_MAINTENANCE Predictive Maintenance BLE
+  * @{
+  */
+
+/** @addtogroup PREDCTIVE_MAINTENANCE_MOTIONSP_MANAGER Predictive Maintenance Motion Signal Processing Manager
+  * @{
+  */
+
+/* Exported Functions --------------------------------------------------------*/
+
+/**
+  *  @brief Initialization of Alarm Status on Axes, Alarm Values Reported
+  *         and Thresholds to detect WARNING and ALARM conditions
+  *  @param pTdAlarm: Pointer to TimeDomain Alarms Result
+  *  @param pTimeDomainVal: Pointer to TimeDomain Value Result
+  *  @param pTdRmsThreshold: Pointer to TimeDomain RMS Threshlods to initialize
+  *  @param pTdPkThreshold:  Pointer to TimeDomain PK Threshlods to initialize
+  *  @return Return description
+  */
+void MotionSP_TimeDomainAlarmInit (sTimeDomainAlarm_t *pTdAlarm,
+                                   sAcceleroParam_t *pTimeDomainVal,
+                                   sTimeDomainThresh_t *pTdRmsThreshold,
+                                   sTimeDomainThresh_t *pTdPkThreshold) 
+{
+  
+  pTdAlarm->RMS_STATUS_AXIS_X = GOOD;  
+  pTdAlarm->RMS_STATUS_AXIS_Y = GOOD;  
+  pTdAlarm->RMS_STATUS_AXIS_Z = GOOD;  
+  pTdAlarm->PK_STATUS_AXIS_X = GOOD;  
+  pTdAlarm->PK_STATUS_AXIS_Y = GOOD;  
+  pTdAlarm->PK_STATUS_AXIS_Z = GOOD;   
+  pTimeDomainVal->SpeedRms.AXIS_X = 0.0f;
+  pTimeDomainVal->SpeedRms.AXIS_Y = 0.0f;
+  pTimeDomainVal->SpeedRms.AXIS_Z = 0.0f;
+  pTimeDomainVal->AccPeak.AXIS_X = 0.0f;
+  pTimeDomainVal->AccPeak.AXIS_Y = 0.0f;
+  pTimeDomainVal->AccPeak.AXIS_Z = 0.0f;
+  pTdRmsThreshold->THR_WARN_AXIS_X = TDSpeedRMSThresh.THR_WARN_AXIS_X;     //0.2f;
+  pTdRmsThreshold->THR_WARN_AXIS_Y = TDSpeedRMSThresh.THR_WARN_AXIS_Y;     //0.1f;
+  pTdRmsThreshold->THR_WARN_AXIS_Z = TDSpeedRMSThresh.THR_WARN_AXIS_Z;     //1.5f;
+  pTdRmsThreshold->THR_ALARM_AXIS_X = TDSpeedRMSThresh.THR_ALARM_AXIS_X;   //0.3f;
+  pTdRmsThreshold->THR_ALARM_AXIS_Y = TDSpeedRMSThresh.THR_ALARM_AXIS_Y;   //0.2f;
+  pTdRmsThreshold->THR_ALARM_AXIS_Z = TDSpeedRMSThresh.THR_ALARM_AXIS_Z;   //2.0f;
+  pTdPkThreshold->THR_WARN_AXIS_X = TDAccPeakThresh.THR_WARN_AXIS_X;     //0.2f;
+  pTdPkThreshold->THR_WARN_AXIS_Y = TDAccPeakThresh.THR_WARN_AXIS_Y;     //0.1f;
+  pTdPkThreshold->THR_WARN_AXIS_Z = TDAccPeakThresh.THR_WARN_AXIS_Z;     //1.5f;
+  pTdPkThreshold->THR_ALARM_AXIS_X = TDAccPeakThresh.THR_ALARM_AXIS_X;   //0.3f;
+  pTdPkThreshold->THR_ALARM_AXIS_Y = TDAccPeakThresh.THR_ALARM_AXIS_Y;   //0.2f;
+  pTdPkThreshold->THR_ALARM_AXIS_Z = TDAccPeakThresh.THR_ALARM_AXIS_Z;   //2.0f;
+}
+
+/**
+  *  @brief Frequency domain initialization of Alarm Status
+  *  @param pWarnThresh: Pointer to TimeDomain Warnings thresholds to use
+  *  @param pAlarmThresh: Pointer to TimeDomain Alarms thresholds to use
+  *  @param pTHR_Fft_Alarms: Pointer to Freq Domain Value Arrays Result
+  *  @param subrange_num:  Subranges numbers
+  *  @return Return description
+  *  
+  */
+void MotionSP_FreqDomainAlarmInit (float **pWarnThresh,
+                                   float **pAlarmThresh,
+                                   sFreqDomainAlarm_t *pTHR_Fft_Alarms,
+                                   uint8_t subrange_num) 
+{
+  /* Reset status value for FFT alarms */
+  memset(pTHR_Fft_Alarms, GOOD, sizeof(sFreqDomainAlarm_t));
+  
+  switch (subrange_num){
+  case 8:
+    *pWarnThresh = (float *)FDWarnThresh_Sub8;
+    *pAlarmThresh = (float *)FDAlarmThresh_Sub8;
+    break;
+    
+  case 16:
+    *pWarnThresh = (float *)FDWarnThresh_Sub16;
+    *pAlarmThresh = (float *)FDAlarmThresh_Sub16;
+    break; 
+    
+  case 32:
+    *pWarnThresh = (float *)FDWarnThresh_Sub32;
+    *pAlarmThresh = (float *)FDAlarmThresh_Sub32;
+    break; 
+    
+  case 64:
+    *pWarnThresh = (float *)FDWarnThresh_Sub64;
+    *pAlarmThresh = (float *)FDAlarmThresh_Sub64;
+    break; 
+  }
+}
+
+/**
+  *  @brief  Time Domain Alarm Analysis based just on Speed RMS FAST Moving Average
+  *  @param  pTdAlarm: Pointer to TimeDomain Alarms Result
+  *  @param  pTimeDomainVal: Pointer to TimeDomain Value Result
+  *  @param  pTdRmsThreshold:  Pointer to TimeDomain RMS Threshlods Configured
+  *  @param  pTdPkThreshold:  Pointer to TimeDomain PK Threshlods Configured
+  *  @param  pTimeDomain:   Pointer to TimeDomain Parameters to monitor
+  *  @return None
+  */
+void MotionSP_TimeDomainAlarm (sTimeDomainAlarm_t *pTdAlarm,
+                               sAcceleroParam_t *pTimeDomainVal,
+                               sTimeDomainThresh_t *pTdRmsThreshold,
+                               sTimeDomainThresh_t *pTdPkThreshold,
+                               sAcceleroParam_t *pTimeDomain) 
+{
+  pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
+  pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
+  pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
+  
+  /* Speed RMS comparison with thresholds */      
+  if ((pTimeDomain->SpeedRms.AXIS_X*1000) > pTdRmsThreshold->THR_WARN_AXIS_X)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_X = WARNING;
+        pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
+  }
+  if ((pTimeDomain->SpeedRms.AXIS_Y*1000) > pTdRmsThreshold->THR_WARN_AXIS_Y)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_Y = WARNING;
+        pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
+  }
+  if ((pTimeDomain->SpeedRms.AXIS_Z*1000) > pTdRmsThreshold->THR_WARN_AXIS_Z)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_Z = WARNING;
+        pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
+  }
+  if ((pTimeDomain->SpeedRms.AXIS_X*1000) > pTdRmsThreshold->THR_ALARM_AXIS_X)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_X = ALARM;
+        pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
+  }
+  if ((pTimeDomain->SpeedRms.AXIS_Y*1000) > pTdRmsThreshold->THR_ALARM_AXIS_Y)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_Y = ALARM;
+        pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
+  }
+  if ((pTimeDomain->SpeedRms.AXIS_Z*1000) > pTdRmsThreshold->THR_ALARM_AXIS_Z)
+  {
+        pTdAlarm->RMS_STATUS_AXIS_Z = ALARM;
+        pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
+  }
+  
+  pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
+  pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
+  pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
+        
+  /* Accelerometer Peak comparison with thresholds */      
+  if ((pTimeDomain->AccPeak.AXIS_X) > pTdPkThreshold->THR_WARN_AXIS_X)
+  {
+        pTdAlarm->PK_STATUS_AXIS_X = WARNING;
+        pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
+  }
+  if ((pTimeDomain->AccPeak.AXIS_Y) > pTdPkThreshold->THR_WARN_AXIS_Y)
+  {
+        pTdAlarm->PK_STATUS_AXIS_Y = WARNING;
+        pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
+  }
+  if ((pTimeDomain->AccPeak.AXIS_Z) > pTdPkThreshold->THR_WARN_AXIS_Z)
+  {
+        pTdAlarm->PK_STATUS_AXIS_Z = WARNING;
+        pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
+  }
+  if ((pTimeDomain->AccPeak.AXIS_X) > pTdPkThreshold->THR_ALARM_AXIS_X)
+  {
+        pTdAlarm->PK_STATUS_AXIS_X = ALARM;
+        pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
+  }
+  if ((pTimeDomain->AccPeak.AXIS_Y) > pTdPkThreshold->THR_ALARM_AXIS_Y)
+  {
+        pTdAlarm->PK_STATUS_AXIS_Y = ALARM;
+        pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
+  }
+  if ((pTimeDomain->AccPeak.AXIS_Z) > pTdPkThreshold->THR_ALARM_AXIS_Z)
+  {
+        pTdAlarm->PK_STATUS_AXIS_Z = ALARM;
+        pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
+  }
+}
+
+/**
+  *  @brief  Compare the Frequency domain subrange comparison with external Threshold Arrays
+  *  @param  pSRAmplitude: Pointer to Amplitude subranges Array resulting after Freq Analysis
+  *  @param  pFDWarnThresh: Pointer to Amplitude Warning Threshold subranges Array
+  *  @param  pFDAlarmThresh: Pointer to Amplitude Alarm Threshold subranges Array
+  *  @param  subrange_num: Subranges number
+  *  @param  pTHR_Check: Pointer to Amplitude subranges Values that exceed thresholds
+  *  @param  pTHR_Fft_Alarms: Pointer to Amplitude subranges Threshold Status
+  *  @return None
+  */
+void MotionSP_FreqDomainAlarm (sSubrange_t *pSRAmplitude,
+                               float *pFDWarnThresh,
+                               float *pFDAlarmThresh,
+                               uint8_t subrange_num, 
+                               sSubrange_t *pTHR_Check, 
+                               sFreqDomainAlarm_t *pTHR_Fft_Alarms)
+{
+  float warn_thresholds;
+  float alarm_thresholds;
+  
+  for(int i=0; i<subrange_num; i++)
+  {
+   for(int j=0; j<3; j++) 
+   {
+    warn_thresholds = *(pFDWarnThresh+(i*3)+j);
+    alarm_thresholds = *(pFDAlarmThresh+(i*3)+j);
+    switch (j)
+    {
+      case 0x00:  /* Axis X */
+        pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];        
+        if(pSRAmplitude->AXIS_X[i] > warn_thresholds) {
+            pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];
+            pTHR_Fft_Alarms->STATUS_AXIS_X[i] = WARNING;}
+        if(pSRAmplitude->AXIS_X[i] > alarm_thresholds){
+          pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];
+          pTHR_Fft_Alarms->STATUS_AXIS_X[i] = ALARM;}
+       break;
+
+      case 0x01:  /* Axis Y */
+        pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
+        if(pSRAmplitude->AXIS_Y[i] > warn_thresholds){
+          pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
+          pTHR_Fft_Alarms->STATUS_AXIS_Y[i] = WARNING;}
+        if(pSRAmplitude->AXIS_Y[i] > alarm_thresholds){
+          pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
+          pTHR_Fft_Alarms->STATUS_AXIS_Y[i] = ALARM;}          
+       break;
+      case 0x02:  /* Axis Z */
+        pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
+        if(pSRAmplitude->AXIS_Z[i] > warn_thresholds){
+          pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
+          pTHR_Fft_Alarms->STATUS_AXIS_Z[i] = WARNING;}
+        if(pSRAmplitude->AXIS_Z[i] > alarm_thresholds){
+          pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
+          pTHR_Fft_Alarms->STATUS_AXIS_Z[i] = ALARM;}  
+       break;
+      default:
+        __NOP();
+       break;    
+    }
+   } 
+  }
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
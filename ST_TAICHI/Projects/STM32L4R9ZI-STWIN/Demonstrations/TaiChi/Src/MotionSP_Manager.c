@@ -59,10 +59,29 @@
   * @{
   */
 
+/* Private define ------------------------------------------------------------*/
+/* FIFO tagged word: TAG + X/Y/Z 16-bit */
+#define ACC_FIFO_WORD_LEN       7U
+/* Largest watermark accepted by MotionSP_ConfigFifo (4 kbyte of X/Y/Z data) */
+#define ACC_FIFO_MAX_WORDS      ((1024U*4U)/6U)
+/* FIFO_DATA_OUT_TAG sensor field for not compressed accelerometer data */
+#define ACC_FIFO_TAG_XL         0x02U
+
+#if defined(PREDMNT1_DEBUG_MOTIONSP_COMPARE) && !defined(MOTIONSP_USE_Q15)
+#error "PREDMNT1_DEBUG_MOTIONSP_COMPARE needs MOTIONSP_USE_Q15 in MotionSP_Config.h"
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE && !MOTIONSP_USE_Q15 */
+
+#if defined(PREDMNT1_DEBUG_MOTIONSP_COMPARE) && defined(MOTIONSP_USE_PSD)
+#error "PREDMNT1_DEBUG_MOTIONSP_COMPARE compares the FFT magnitude averages, disable MOTIONSP_USE_PSD"
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE && MOTIONSP_USE_PSD */
+
 /* Exported Variables --------------------------------------------------------*/
 uint8_t RestartFlag = 1;
 sAccelerometer_Parameter_t Accelerometer_Parameters;
 
+/* MotionSP context of the accelerometer analyzed by the vibration analysis */
+MotionSP_Context_t MotionSP_Ctx;
+
 uint32_t Start_Tick = 0;
 
 /* X-Y-Z STATUS ALARM for TimeDomain */
@@ -80,7 +99,6 @@ sFreqDomainAlarm_t THR_Fft_Alarms;
 /* Imported Variables --------------------------------------------------------*/
 extern volatile uint8_t AccIntReceived;
 extern volatile uint8_t FifoEnabled;
-extern sAxesMagBuff_t AccAxesAvgMagBuff;
 
 extern float *FDWarnThresh;
 extern float *FDAlarmThresh;
@@ -93,6 +111,9 @@ volatile uint32_t Int_Current_Time2 = 0;
 
 volatile uint32_t FFT_Amplitude= 0;
 volatile uint32_t FFT_Alarm=    0;
+#ifdef MOTIONSP_USE_ENVELOPE
+volatile uint32_t FFT_Envelope= 0;
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 /* X-Y-Z Amplitude subranges Values that exceed thresholds */
 sSubrange_t THR_Check;
@@ -102,36 +123,64 @@ Alarm_Type_t TotalFDAlarm;
 
 static uint8_t Accelero_Drdy = 0;
 static float MotionSP_Sensitivity;
-static bool IsAcceleroFifoToRead = false;
+/* Raw watermark block drained from the accelerometer FIFO */
+static uint8_t AccFifoBlock[ACC_FIFO_MAX_WORDS*ACC_FIFO_WORD_LEN];
 
 static uint8_t SendingFFT= 0;
-static uint8_t MemoryIsAlloc= 0;
-static uint16_t CountSendData= 0;
-
-uint8_t *TotalBuffToSending;
+/* FFT Amplitude stream: bytes already notified and frequency step of the spectrum in progress */
+static uint32_t FftSendCursor= 0;
+static float FftBinFreqStep;
+
+#ifdef PREDMNT1_DEBUG_MOTIONSP_CYCLES
+/* Core cycles spent in MotionSP_FrequencyDomainProcess for the spectrum in progress */
+static uint32_t FftCyclesMin;
+static uint32_t FftCyclesMax;
+static uint32_t FftCyclesSum;
+static uint32_t FftCyclesCnt;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+/* Float FFT average of the frames analyzed in fixed point and core cycles spent on it */
+static sAxesMagBuff_t FftRefAvgMagBuff;
+static uint16_t FftRefCnt;
+static uint32_t FftRefCyclesSum;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
+
+#ifdef MOTIONSP_USE_SDFT
+/* Acquisition monitored by the sliding DFT only, without the FFT average */
+static uint8_t SdftOnly;
+/* Acquisitions left before the FFT average looks for the subrange peaks again */
+static uint8_t SdftReseedCnt;
+/* Last subrange amplitudes from the sliding DFT and their sum over the acquisition */
+static sSubrange_t SdftAmplitude;
+static sSubrange_t SdftAmplitudeSum;
+static uint16_t SdftAmplitudeCnt;
+#ifdef PREDMNT1_DEBUG_MOTIONSP_CYCLES
+/* Core cycles spent in MotionSP_SdftUpdateBlock and number of samples */
+static uint32_t SdftCyclesSum;
+static uint32_t SdftSamplesCnt;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+#endif /* MOTIONSP_USE_SDFT */
 
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t MotionSP_AccMeasInit(void);
 
 static uint8_t AccOdrMeas(sAcceleroODR_t *pAcceleroODR);
 
-static void AcceleroFifoRead(MOTION_SENSOR_AxesRaw_t *pSensorAxesRaw);
-static void FillCircBuffFromFifo(sCircBuffer_t *pAccCircBuff, float AccSensitivity);
-
-static void PrepareTotalBuffToSending(sAxesMagBuff_t *ArrayToSend, uint16_t ActualMagSize);
+static uint16_t AcceleroFifoRead(uint8_t *pBuff);
+static void FillCircBuffFromFifo(MotionSP_Context_t *pCtx, float AccSensitivity,
+                                 const uint8_t *pBuff, uint16_t NumWords);
 
-static void MotionSP_TimeDomainAlarm (sTimeDomainAlarm_t *pTdAlarm,
-                                      sAcceleroParam_t *pTimeDomainVal,
-                                      sTimeDomainThresh_t *pTdRmsThreshold,
-                                      sTimeDomainThresh_t *pTdPkThreshold,
-                                      sAcceleroParam_t *pTimeDomain);
+static void FrequencyDomainStep(void);
+#ifdef MOTIONSP_USE_SDFT
+static void SdftUpdate(MotionSP_Context_t *pCtx, uint16_t Len);
+static void SdftAcquisitionDone(void);
+#endif /* MOTIONSP_USE_SDFT */
 
-static void MotionSP_FreqDomainAlarm (sSubrange_t *pSRAmplitude,
-                                      float *pFDWarnThresh,
-                                      float *pFDAlarmThresh,
-                                      uint8_t subrange_num, 
-                                      sSubrange_t *pTHR_Check, 
-                                      sFreqDomainAlarm_t *pTHR_Fft_Alarms);
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+static void FftCompareAccumulate(void);
+static void FftCompareReport(void);
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
 
 /* Private defines -----------------------------------------------------------*/
 
@@ -156,13 +205,18 @@ void MotionSP_SetDefaultVibrationParam(void)
   Accelerometer_Parameters.fs=          SENSOR_ACC_FS_DEFAULT;
 
   /* Set default parameters for MotionSP library */
-  MotionSP_Parameters.FftSize=          FFT_SIZE_DEFAULT;
-  MotionSP_Parameters.tau=              TAU_DEFAULT;
-  MotionSP_Parameters.window=           WINDOW_DEFAULT;
-  MotionSP_Parameters.td_type=          TD_DEFAULT;
-  MotionSP_Parameters.tacq=             TACQ_DEFAULT;
-  MotionSP_Parameters.subrange_num=     SUBRANGE_DEFAULT;
-  MotionSP_Parameters.FftOvl=           FFT_OVL_DEFAULT;
+  MotionSP_Ctx.Parameters.FftSize=          FFT_SIZE_DEFAULT;
+  MotionSP_Ctx.Parameters.tau=              TAU_DEFAULT;
+  MotionSP_Ctx.Parameters.window=           WINDOW_DEFAULT;
+  MotionSP_Ctx.Parameters.td_type=          TD_DEFAULT;
+  MotionSP_Ctx.Parameters.tacq=             TACQ_DEFAULT;
+  MotionSP_Ctx.Parameters.subrange_num=     SUBRANGE_DEFAULT;
+  MotionSP_Ctx.Parameters.FftOvl=           FFT_OVL_DEFAULT;
+#ifdef MOTIONSP_USE_ENVELOPE
+  MotionSP_Ctx.Parameters.env_band_low=     ENV_BAND_LOW_DEFAULT;
+  MotionSP_Ctx.Parameters.env_band_high=    ENV_BAND_HIGH_DEFAULT;
+  MotionSP_Ctx.Parameters.env_dec=          ENV_DEC_DEFAULT;
+#endif /* MOTIONSP_USE_ENVELOPE */
 }
 
 /**
@@ -174,48 +228,40 @@ void MotionSP_VibrationInit(void)
 {
   PREDMNT1_PRINTF("\r\nMotionSP Vibration Init");
   
-  if ((MotionSP_Parameters.FftSize) <= FFT_SIZE_MAX)
+  if (MotionSP_ContextInit(&MotionSP_Ctx) == 0)
   {
-    // Reset the accelero circular buffer
-    memset((void *)(&AccCircBuffer), 0x00, sizeof(sCircBuffer_t));
+#ifdef MOTIONSP_USE_SDFT
+    SdftAmplitudeCnt = 0;
     
-    // Set the initial position of the accelero circular buffer
-    AccCircBuffer.IdPos = (uint16_t)(-1);
-
-    /* Create circular buffer and initialize result variables */
-    //AccCircBuffer.Size = (uint16_t)((float)(MotionSP_Parameters.FftSize*(((float)CIRC_BUFFER_RATIO)/10)));
-    AccCircBuffer.Size = (uint16_t)((MotionSP_Parameters.FftSize * CIRC_BUFFER_RATIO_NUM)/CIRC_BUFFER_RATIO_DEN);
-    
-    magSize = MotionSP_Parameters.FftSize / 2;
-    
-    /* Set the mag size to be used */
-    AccMagResults.MagSizeTBU = magSize; 
-
-    // Reset the TimeDomain parameter values
-    memset((void *)(&sTimeDomain), 0x00, sizeof(sAcceleroParam_t));
+    /* With the peaks known and no spectrum to stream, the FFT average runs once every SDFT_RESEED_DEFAULT acquisitions */
+    SdftOnly = (MotionSP_SdftIsSeeded(&MotionSP_Ctx) && (SdftReseedCnt != 0) && !FFT_Amplitude);
+#endif /* MOTIONSP_USE_SDFT */
 
-    // Reset the counters of the number of sums about the calculation of the average
-    memset((void *)(&AccSumCnt), 0x00, sizeof(sSumCnt_t));  
-
-    MotionSP_SetWindFiltArray(Filter_Params, MotionSP_Parameters.FftSize, (Filt_Type_t)MotionSP_Parameters.window);
-
-    /* Reset the flag to enable FFT computation */
-    fftIsEnabled = 0;
-
-    arm_rfft_fast_init_f32(&fftS, MotionSP_Parameters.FftSize);
-
-    /* It is the minimum value to do the first FFT */
-    accCircBuffIndexForFft = MotionSP_Parameters.FftSize - 1;
-    
-    if(MemoryIsAlloc)
-    {
-      free(TotalBuffToSending);
-      MemoryIsAlloc= 0;
-    }
- 
-    FinishAvgFlag = 0;
     RestartFlag = 1;
     SendingFFT= 0;
+    FftSendCursor= 0;
+
+#if defined(PREDMNT1_DEBUG_MOTIONSP_CYCLES) || defined(PREDMNT1_DEBUG_MOTIONSP_COMPARE)
+    /* Enable the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES || PREDMNT1_DEBUG_MOTIONSP_COMPARE */
+#ifdef PREDMNT1_DEBUG_MOTIONSP_CYCLES
+    FftCyclesMax = FftCyclesSum = FftCyclesCnt = 0;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+    FftRefCnt = 0;
+    FftRefCyclesSum = 0;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
+#if defined(PREDMNT1_DEBUG_MOTIONSP_CYCLES) && defined(MOTIONSP_USE_SDFT)
+    SdftCyclesSum = SdftSamplesCnt = 0;
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES && MOTIONSP_USE_SDFT */
+    
+#ifdef MOTIONSP_USE_ENVELOPE
+    if (FFT_Envelope && !MotionSP_Ctx.Envelope.IsEnabled)
+      PREDMNT1_PRINTF("\t--> Envelope band or decimation out of range for the accelerometer ODR.\r\n");
+#endif /* MOTIONSP_USE_ENVELOPE */
     
     PREDMNT1_PRINTF("\t--> OK\r\n");
   }
@@ -226,91 +272,6 @@ void MotionSP_VibrationInit(void)
   }  
 }
 
-/**
-  *  @brief Initialization of Alarm Status on Axes, Alarm Values Reported
-  *         and Thresholds to detect WARNING and ALARM conditions
-  *  @param pTdAlarm: Pointer to TimeDomain Alarms Result
-  *  @param pTimeDomainVal: Pointer to TimeDomain Value Result
-  *  @param pTdRmsThreshold: Pointer to TimeDomain RMS Threshlods to initialize
-  *  @param pTdPkThreshold:  Pointer to TimeDomain PK Threshlods to initialize
-  *  @return Return description
-  */
-void MotionSP_TimeDomainAlarmInit (sTimeDomainAlarm_t *pTdAlarm,
-                                   sAcceleroParam_t *pTimeDomainVal,
-                                   sTimeDomainThresh_t *pTdRmsThreshold,
-                                   sTimeDomainThresh_t *pTdPkThreshold) 
-{
-  
-  PREDMNT1_PRINTF("MotionSP Time Domain Alarm Init\r\n");
-  
-  pTdAlarm->RMS_STATUS_AXIS_X = GOOD;  
-  pTdAlarm->RMS_STATUS_AXIS_Y = GOOD;  
-  pTdAlarm->RMS_STATUS_AXIS_Z = GOOD;  
-  pTdAlarm->PK_STATUS_AXIS_X = GOOD;  
-  pTdAlarm->PK_STATUS_AXIS_Y = GOOD;  
-  pTdAlarm->PK_STATUS_AXIS_Z = GOOD;   
-  pTimeDomainVal->SpeedRms.AXIS_X = 0.0f;
-  pTimeDomainVal->SpeedRms.AXIS_Y = 0.0f;
-  pTimeDomainVal->SpeedRms.AXIS_Z = 0.0f;
-  pTimeDomainVal->AccPeak.AXIS_X = 0.0f;
-  pTimeDomainVal->AccPeak.AXIS_Y = 0.0f;
-  pTimeDomainVal->AccPeak.AXIS_Z = 0.0f;
-  pTdRmsThreshold->THR_WARN_AXIS_X = TDSpeedRMSThresh.THR_WARN_AXIS_X;     //0.2f;
-  pTdRmsThreshold->THR_WARN_AXIS_Y = TDSpeedRMSThresh.THR_WARN_AXIS_Y;     //0.1f;
-  pTdRmsThreshold->THR_WARN_AXIS_Z = TDSpeedRMSThresh.THR_WARN_AXIS_Z;     //1.5f;
-  pTdRmsThreshold->THR_ALARM_AXIS_X = TDSpeedRMSThresh.THR_ALARM_AXIS_X;   //0.3f;
-  pTdRmsThreshold->THR_ALARM_AXIS_Y = TDSpeedRMSThresh.THR_ALARM_AXIS_Y;   //0.2f;
-  pTdRmsThreshold->THR_ALARM_AXIS_Z = TDSpeedRMSThresh.THR_ALARM_AXIS_Z;   //2.0f;
-  pTdPkThreshold->THR_WARN_AXIS_X = TDAccPeakThresh.THR_WARN_AXIS_X;     //0.2f;
-  pTdPkThreshold->THR_WARN_AXIS_Y = TDAccPeakThresh.THR_WARN_AXIS_Y;     //0.1f;
-  pTdPkThreshold->THR_WARN_AXIS_Z = TDAccPeakThresh.THR_WARN_AXIS_Z;     //1.5f;
-  pTdPkThreshold->THR_ALARM_AXIS_X = TDAccPeakThresh.THR_ALARM_AXIS_X;   //0.3f;
-  pTdPkThreshold->THR_ALARM_AXIS_Y = TDAccPeakThresh.THR_ALARM_AXIS_Y;   //0.2f;
-  pTdPkThreshold->THR_ALARM_AXIS_Z = TDAccPeakThresh.THR_ALARM_AXIS_Z;   //2.0f;
-}
-
-/**
-  *  @brief Frequency domain initialization of Alarm Status
-  *  @param pWarnThresh: Pointer to TimeDomain Warnings thresholds to use
-  *  @param pAlarmThresh: Pointer to TimeDomain Alarms thresholds to use
-  *  @param pTHR_Fft_Alarms: Pointer to Freq Domain Value Arrays Result
-  *  @param subrange_num:  Subranges numbers
-  *  @return Return description
-  *  
-  */
-void MotionSP_FreqDomainAlarmInit (float **pWarnThresh,
-                                   float **pAlarmThresh,
-                                   sFreqDomainAlarm_t *pTHR_Fft_Alarms,
-                                   uint8_t subrange_num) 
-{
-  PREDMNT1_PRINTF("MotionSP Frequency Domain Alarm Init\r\n");
-  
-  /* Reset status value for FFT alarms */
-  memset(pTHR_Fft_Alarms, GOOD, 3*64);
-  
-  switch (subrange_num){
-  case 8:
-    *pWarnThresh = (float *)FDWarnThresh_Sub8;
-    *pAlarmThresh = (float *)FDAlarmThresh_Sub8;
-    break;
-    
-  case 16:
-    *pWarnThresh = (float *)FDWarnThresh_Sub16;
-    *pAlarmThresh = (float *)FDAlarmThresh_Sub16;
-    break; 
-    
-  case 32:
-    *pWarnThresh = (float *)FDWarnThresh_Sub32;
-    *pAlarmThresh = (float *)FDAlarmThresh_Sub32;
-    break; 
-    
-  case 64:
-    *pWarnThresh = (float *)FDWarnThresh_Sub64;
-    *pAlarmThresh = (float *)FDAlarmThresh_Sub64;
-    break; 
-  }
-}
-
 /**
   * @brief  Set accelerometer parameters for MotionSP Vibration
   * @param  None
@@ -325,7 +286,7 @@ uint8_t SetAccelerometerParameters(void)
   PREDMNT1_PRINTF("Set Accelerometer Parameters:\r\n");
  
   /* Reset the real accelero ODR value */
-  memset((void *)(&AcceleroODR), 0x00, sizeof(sAcceleroODR_t));
+  memset((void *)(&MotionSP_Ctx.AcceleroODR), 0x00, sizeof(sAcceleroODR_t));
   
  /* Set FS value */
   if ((BSP_Error = MOTION_SENSOR_SetFullScale(ACCELERO_INSTANCE, 
@@ -364,7 +325,7 @@ uint8_t SetAccelerometerParameters(void)
   if (MotionSP_AccMeasInit() == 1)
   {
     PREDMNT1_PRINTF("\tError measure and calculate ODR - Used parameter value (");
-    AcceleroODR.Frequency= Accelerometer_Parameters.AccOdr;
+    MotionSP_Ctx.AcceleroODR.Frequency= Accelerometer_Parameters.AccOdr;
     ret= 0;
   }
   else
@@ -374,7 +335,7 @@ uint8_t SetAccelerometerParameters(void)
   
 #ifdef PREDMNT1_ENABLE_PRINTF
   uint32_t IntPart, DecPart;
-  MCR_BLUEMS_F2I_2D(AcceleroODR.Frequency, IntPart, DecPart);
+  MCR_BLUEMS_F2I_2D(MotionSP_Ctx.AcceleroODR.Frequency, IntPart, DecPart);
 #endif /* PREDMNT1_ENABLE_PRINTF */
 
   /* Send the parameters to terminal */
@@ -394,7 +355,7 @@ void MotionSP_ConfigFifo(void)
   
   PREDMNT1_PRINTF("\r\nFIFO config:\r\n");
 
-  Accelerometer_Parameters.AccFifoSize=(uint16_t)(((float)MotionSP_Parameters.FftSize*(1.0f-((float)MotionSP_Parameters.FftOvl/100.0f)))*0.75f);
+  Accelerometer_Parameters.AccFifoSize=(uint16_t)(((float)MotionSP_Ctx.Parameters.FftSize*(1.0f-((float)MotionSP_Ctx.Parameters.FftOvl/100.0f)))*0.75f);
 
   /* Set FIFO ODR value */
   if ((BSP_Error = MOTION_SENSOR_FIFO_Set_BDR(ACCELERO_INSTANCE,
@@ -467,7 +428,7 @@ void MotionSP_ConfigFifo(void)
   */
 void MotionSP_VibrationAnalysis(void)
 {
-#define FFTSIZEDELTA  (MotionSP_Parameters.FftSize*((100.0-MotionSP_Parameters.FftOvl)/100.0))
+#define FFTSIZEDELTA  (MotionSP_Ctx.Parameters.FftSize*((100.0-MotionSP_Ctx.Parameters.FftOvl)/100.0))
   static uint8_t accCircBuffIndexForFftOvf = 0;
   static uint16_t accCircBuffIndexPre = (uint16_t)(-1);;
   uint32_t ActualTick;
@@ -478,71 +439,95 @@ void MotionSP_VibrationAnalysis(void)
 
   if(!SendingFFT)
   {
-    if ( (AccCircBuffer.IdPos != accCircBuffIndexPre) && (AccCircBuffer.IdPos != (uint16_t)(-1)) )
+    if ( (MotionSP_Ctx.AccCircBuffer.IdPos != accCircBuffIndexPre) && (MotionSP_Ctx.AccCircBuffer.IdPos != (uint16_t)(-1)) )
     {
-      accCircBuffIndexPre = AccCircBuffer.IdPos;
+      accCircBuffIndexPre = MotionSP_Ctx.AccCircBuffer.IdPos;
       
-      accCircBuffIndexTmp = AccCircBuffer.IdPos + (AccCircBuffer.Ovf * AccCircBuffer.Size);
-      accCircBuffIndexForFftTmp = accCircBuffIndexForFft + (accCircBuffIndexForFftOvf * AccCircBuffer.Size);
+      accCircBuffIndexTmp = MotionSP_Ctx.AccCircBuffer.IdPos + (MotionSP_Ctx.AccCircBuffer.Ovf * MotionSP_Ctx.AccCircBuffer.Size);
+      accCircBuffIndexForFftTmp = MotionSP_Ctx.accCircBuffIndexForFft + (accCircBuffIndexForFftOvf * MotionSP_Ctx.AccCircBuffer.Size);
       
       if (accCircBuffIndexTmp >= accCircBuffIndexForFftTmp)
       {
         /* Check the Tick value */
         ActualTick = HAL_GetTick(); 
-        if ((ActualTick - Start_Tick) > MotionSP_Parameters.tacq)
+        if ((ActualTick - Start_Tick) > MotionSP_Ctx.Parameters.tacq)
         {
-          FinishAvgFlag = 1;
+          MotionSP_Ctx.FinishAvgFlag = 1;
         }
         
-        MotionSP_FrequencyDomainProcess();
+#ifdef MOTIONSP_USE_SDFT
+        /* A spectrum requested during an acquisition of the sliding DFT restarts the FFT average */
+        if (SdftOnly && FFT_Amplitude)
+          SdftOnly = 0;
+        
+        if (!SdftOnly)
+          FrequencyDomainStep();
+#else /* MOTIONSP_USE_SDFT */
+        FrequencyDomainStep();
+#endif /* MOTIONSP_USE_SDFT */
         
         /* Status check during Time domain Analysis */
         MotionSP_TimeDomainAlarm(&sTdAlarm,&sTimeDomainVal,
                                  &sTdRmsThresholds,
                                  &sTdPkThresholds,
-                                 &sTimeDomain);
+                                 &MotionSP_Ctx.TimeDomain);
 
         accCircBuffIndexForFftOvf = 0;
-        accCircBuffIndexForFft += FFTSIZEDELTA;
-        if (accCircBuffIndexForFft >= AccCircBuffer.Size)
+        MotionSP_Ctx.accCircBuffIndexForFft += FFTSIZEDELTA;
+        if (MotionSP_Ctx.accCircBuffIndexForFft >= MotionSP_Ctx.AccCircBuffer.Size)
         {
-          accCircBuffIndexForFft -= AccCircBuffer.Size;
+          MotionSP_Ctx.accCircBuffIndexForFft -= MotionSP_Ctx.AccCircBuffer.Size;
           
-          if (!AccCircBuffer.Ovf)
+          if (!MotionSP_Ctx.AccCircBuffer.Ovf)
             accCircBuffIndexForFftOvf = 1;
         }
         
-        AccCircBuffer.Ovf = 0;
+        MotionSP_Ctx.AccCircBuffer.Ovf = 0;
       }
     }
     
     /* Send data to ST BLE Sensor app*/
-    if (FinishAvgFlag == 1)
+    if (MotionSP_Ctx.FinishAvgFlag == 1)
     {
       disable_FIFO();
       
       if(FFT_Amplitude)
       {
-        PrepareTotalBuffToSending(&AccAxesAvgMagBuff, magSize);
+        FftBinFreqStep= (MotionSP_Ctx.AcceleroODR.Frequency / 2) / MotionSP_Ctx.magSize;
         
         /* Send Time Domain to ST BLE Sensor app */
         PREDMNT1_PRINTF("Sending Time Domain to ST BLE Sensor app\r\n");
-        TimeDomain_Update(&sTimeDomain);
+        TimeDomain_Update(&MotionSP_Ctx.TimeDomain);
         
         /* Send Accelerometer ARRAYs FFT average values to ST BLE Sensor app */
         PREDMNT1_PRINTF("Sending FFT Amplitude to ST BLE Sensor app\r\n");
         SendingFFT= 1;
-        CountSendData= 0;
-        FFT_Amplitude_Update(TotalBuffToSending, magSize, &SendingFFT, &CountSendData);
+        FftSendCursor= 0;
+        FFT_Amplitude_Update(&MotionSP_Ctx.AccAxesAvgMagBuff, MotionSP_Ctx.magSize, FftBinFreqStep, &SendingFFT, &FftSendCursor);
       }
       
+#if defined(PREDMNT1_DEBUG_MOTIONSP_CYCLES) && defined(MOTIONSP_USE_SDFT)
+      if (SdftSamplesCnt)
+      {
+        PREDMNT1_PRINTF("SDFT %d bins x3 axes: %lu samples, cycles avg %lu per sample\r\n",
+                        MotionSP_Ctx.Parameters.subrange_num * 3, SdftSamplesCnt, SdftCyclesSum/SdftSamplesCnt);
+        SdftCyclesSum = SdftSamplesCnt = 0;
+      }
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES && MOTIONSP_USE_SDFT */
+      
       if(FFT_Alarm)
       {
         //SendVibrationResult();
 
+#ifdef MOTIONSP_USE_SDFT
+        /* Subrange amplitudes and peaks from the sliding DFT when the FFT average has not run */
+        if (SdftOnly)
+          SdftAcquisitionDone();
+#endif /* MOTIONSP_USE_SDFT */
+
         /* Compare the Frequency domain subrange comparison with external Threshold Arrays */
-        MotionSP_FreqDomainAlarm (&SRAmplitude, FDWarnThresh, FDAlarmThresh,
-                                                          MotionSP_Parameters.subrange_num,
+        MotionSP_FreqDomainAlarm (&MotionSP_Ctx.SRAmplitude, FDWarnThresh, FDAlarmThresh,
+                                                          MotionSP_Ctx.Parameters.subrange_num,
                                                           &THR_Check, 
                                                           &THR_Fft_Alarms);
         
@@ -556,16 +541,52 @@ void MotionSP_VibrationAnalysis(void)
         
         /* Send the frequency domain threshold status for max Subrange value */
         PREDMNT1_PRINTF("Sending the frequency domain threshold status for max Subrange value to ST BLE Sensor app\r\n");
-        FFT_AlarmSubrangeStatus_Update(&AccAxesMagResults,&THR_Fft_Alarms,MotionSP_Parameters.subrange_num,magSize);
+        FFT_AlarmSubrangeStatus_Update(&MotionSP_Ctx.AccAxesMagResults,&THR_Fft_Alarms,MotionSP_Ctx.Parameters.subrange_num,MotionSP_Ctx.magSize);
+        
+#ifdef MOTIONSP_USE_SDFT
+        if (SdftOnly)
+        {
+          SdftReseedCnt--;
+        }
+        else
+        {
+          /* Follow the new subrange peaks with the sliding DFT */
+          MotionSP_SdftSetBins(&MotionSP_Ctx, &MotionSP_Ctx.SRBinVal, MotionSP_Ctx.Parameters.subrange_num);
+          SdftReseedCnt = SDFT_RESEED_DEFAULT;
+        }
+#endif /* MOTIONSP_USE_SDFT */
         
         Reset= 1;
       }
+#ifdef MOTIONSP_USE_SDFT
+      else
+      {
+        /* No alarm to monitor */
+        MotionSP_SdftSetBins(&MotionSP_Ctx, NULL, 0);
+      }
+#endif /* MOTIONSP_USE_SDFT */
+      
+#ifdef MOTIONSP_USE_ENVELOPE
+      if(FFT_Envelope)
+      {
+        /* Send the envelope spectrum peaks */
+        if (MotionSP_EnvelopeDone(&MotionSP_Ctx))
+        {
+          PREDMNT1_PRINTF("Sending the envelope spectrum peaks to ST BLE Sensor app\r\n");
+          FFT_Envelope_Update(&MotionSP_Ctx.Envelope.MagResults, MotionSP_Ctx.Envelope.Frequency / ENV_FFT_SIZE);
+        }
+        
+        /* The FFT Amplitude stream restarts the acquisition when it is ended */
+        if(!SendingFFT)
+          Reset= 1;
+      }
+#endif /* MOTIONSP_USE_ENVELOPE */
     }
   }
   else
   {
-    /* Send Accelerometer ARRAYs FFT average values to ST BLE Sensor app */
-    FFT_Amplitude_Update(TotalBuffToSending, magSize, &SendingFFT, &CountSendData);
+    /* Resume the Accelerometer ARRAYs FFT average values stream to ST BLE Sensor app */
+    FFT_Amplitude_Update(&MotionSP_Ctx.AccAxesAvgMagBuff, MotionSP_Ctx.magSize, FftBinFreqStep, &SendingFFT, &FftSendCursor);
     
     if(!SendingFFT)
       Reset= 1;
@@ -580,10 +601,12 @@ void MotionSP_VibrationAnalysis(void)
     {
       /* Initialization of Alarm Status on Axes, Alarm Values Reported
          and Thresholds to detect WARNING and ALARM conditions */
+      PREDMNT1_PRINTF("MotionSP Time Domain Alarm Init\r\n");
       MotionSP_TimeDomainAlarmInit(&sTdAlarm, &sTimeDomainVal, &sTdRmsThresholds, &sTdPkThresholds);
       
       /* Frequency domain initialization of Alarm Status */
-      MotionSP_FreqDomainAlarmInit(&FDWarnThresh, &FDAlarmThresh, &THR_Fft_Alarms, MotionSP_Parameters.subrange_num);
+      PREDMNT1_PRINTF("MotionSP Frequency Domain Alarm Init\r\n");
+      MotionSP_FreqDomainAlarmInit(&FDWarnThresh, &FDAlarmThresh, &THR_Fft_Alarms, MotionSP_Ctx.Parameters.subrange_num);
     }
     
     enable_FIFO();
@@ -594,6 +617,19 @@ void MotionSP_VibrationAnalysis(void)
   }
 }
 
+/**
+  * @brief  Complete the FFT Amplitude stream when it is ended
+  * @param  None
+  * @retval None
+  */
+void MotionSP_FftAmplitudeResume(void)
+{
+  if(SendingFFT)
+  {
+    MotionSP_VibrationAnalysis();
+  }
+}
+
 /**
   * @brief  Enable FIFO measuring
   * @param  None
@@ -688,25 +724,16 @@ void FuncOn_DRDY_XL(void)
   */
 void FuncOn_FifoFull(void)
 {
+  uint16_t NumWords;
+
   LedOnTargetPlatform();
   
-  IsAcceleroFifoToRead = true;
+  /* Drain the whole watermark block with a single bus transfer */
+  NumWords = AcceleroFifoRead(AccFifoBlock);
   
-  while(IsAcceleroFifoToRead)
-  {
-    if (EXTI->PR1 & M_INT2_O_PIN)
-      while(1);
-    
-    FillCircBuffFromFifo(&AccCircBuffer, MotionSP_Sensitivity);
-    
-    /* Time Domain Processing */
-    MotionSP_TimeDomainProcess(&sTimeDomain, (Td_Type_t)MotionSP_Parameters.td_type, RestartFlag);
-
-    
-    /* Clear the restart flag */
-    if (RestartFlag)
-      RestartFlag = 0;
-  }
+  FillCircBuffFromFifo(&MotionSP_Ctx, MotionSP_Sensitivity, AccFifoBlock, NumWords);
+  
+  LedOffTargetPlatform();
 }
 
 /**
@@ -750,89 +777,6 @@ uint8_t EnableDisable_ACC_HP_Filter(uint8_t FilterIsEnabled)
 
 /* Private function ----------------------------------------------------------*/
 
-/**
-  * @brief  Prepare buffer to send data to Bluetooth
-  * @param  sAxesMagBuff_t *ArrayToSend X, Y and Z FFT Amplitude values
-  * @param  uint16_t ActualMagSize Number of samples for each component
-  * @retval None
-  */
-static void PrepareTotalBuffToSending(sAxesMagBuff_t *ArrayToSend, uint16_t ActualMagSize)
-{
-  uint32_t BuffPos;
-  
-  float BinFreqStep;
-  
-  uint16_t TotalSize;
-  
-  float TempFloat;
-  uint8_t *TempBuff = (uint8_t *)&TempFloat;
-  
-  TotalSize= 2 /* nSample */ + 1 /* nComponents */ + 4 /*  Frequency Steps */ + ((3 * ActualMagSize) * 4) /* Samples */;
-  TotalBuffToSending=(uint8_t *)malloc(TotalSize);
-  
-  if(TotalBuffToSending == NULL)
-  {
-    Error_Handler();
-  }
-  
-  MemoryIsAlloc= 1;
-
-  BinFreqStep= (AcceleroODR.Frequency / 2) / ActualMagSize;
-    
-  STORE_LE_16(TotalBuffToSending, ActualMagSize);
-  TotalBuffToSending[2]= 3;
-  BuffPos= 3;
-  
-  TempFloat = BinFreqStep;
-  TotalBuffToSending[BuffPos]= TempBuff[0];
-  BuffPos++;
-  TotalBuffToSending[BuffPos]= TempBuff[1];
-  BuffPos++;
-  TotalBuffToSending[BuffPos]= TempBuff[2];
-  BuffPos++;
-  TotalBuffToSending[BuffPos]= TempBuff[3];
-  BuffPos++;
-  
-  for(int i=0; i<ActualMagSize; i++)
-  {
-    TempFloat = ArrayToSend->AXIS_X[i];
-    TotalBuffToSending[BuffPos]= TempBuff[0];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[1];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[2];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[3];
-    BuffPos++; 
-  }
-  
-  for(int i=0; i<ActualMagSize; i++)
-  {
-    TempFloat = ArrayToSend->AXIS_Y[i];
-    TotalBuffToSending[BuffPos]= TempBuff[0];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[1];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[2];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[3];
-    BuffPos++;  
-  }
-  
-  for(int i=0; i<ActualMagSize; i++)
-  {
-    TempFloat = ArrayToSend->AXIS_Z[i];
-    TotalBuffToSending[BuffPos]= TempBuff[0];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[1];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[2];
-    BuffPos++;
-    TotalBuffToSending[BuffPos]= TempBuff[3];
-    BuffPos++;
-  }
-}
-
 /**
   * @brief 	Measurement of the accelerometer output data rate
   * @param 	pAcceleroODR Pointer to be fill with the new value
@@ -883,165 +827,13 @@ static uint8_t AccOdrMeas(sAcceleroODR_t *pAcceleroODR)
     /* Calculate measured ODR and Exponential parameters*/
     pAcceleroODR->Frequency = (IntCnt * 1000) / ODRMEASURINGTIME;
     pAcceleroODR->Period = 1/(pAcceleroODR->Frequency);
-    pAcceleroODR->Tau= exp(-(float)(1000*pAcceleroODR->Period)/MotionSP_Parameters.tau);
+    pAcceleroODR->Tau= exp(-(float)(1000*pAcceleroODR->Period)/MotionSP_Ctx.Parameters.tau);
     retValue = 0;
   }
   
   return retValue;
 }
 
-/**
-  *  @brief  Time Domain Alarm Analysis based just on Speed RMS FAST Moving Average
-  *  @param  pTdAlarm: Pointer to TimeDomain Alarms Result
-  *  @param  pTimeDomainVal: Pointer to TimeDomain Value Result
-  *  @param  pTdRmsThreshold:  Pointer to TimeDomain RMS Threshlods Configured
-  *  @param  pTdPkThreshold:  Pointer to TimeDomain PK Threshlods Configured
-  *  @param  pTimeDomain:   Pointer to TimeDomain Parameters to monitor
-  *  @return None
-  */
-static void MotionSP_TimeDomainAlarm (sTimeDomainAlarm_t *pTdAlarm,
-                                      sAcceleroParam_t *pTimeDomainVal,
-                                      sTimeDomainThresh_t *pTdRmsThreshold,
-                                      sTimeDomainThresh_t *pTdPkThreshold,
-                                      sAcceleroParam_t *pTimeDomain) 
-{
-  pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
-  pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
-  pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
-  
-  /* Speed RMS comparison with thresholds */      
-  if ((pTimeDomain->SpeedRms.AXIS_X*1000) > pTdRmsThreshold->THR_WARN_AXIS_X)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_X = WARNING;
-        pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
-  }
-  if ((pTimeDomain->SpeedRms.AXIS_Y*1000) > pTdRmsThreshold->THR_WARN_AXIS_Y)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_Y = WARNING;
-        pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
-  }
-  if ((pTimeDomain->SpeedRms.AXIS_Z*1000) > pTdRmsThreshold->THR_WARN_AXIS_Z)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_Z = WARNING;
-        pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
-  }
-  if ((pTimeDomain->SpeedRms.AXIS_X*1000) > pTdRmsThreshold->THR_ALARM_AXIS_X)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_X = ALARM;
-        pTimeDomainVal->SpeedRms.AXIS_X = pTimeDomain->SpeedRms.AXIS_X*1000;
-  }
-  if ((pTimeDomain->SpeedRms.AXIS_Y*1000) > pTdRmsThreshold->THR_ALARM_AXIS_Y)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_Y = ALARM;
-        pTimeDomainVal->SpeedRms.AXIS_Y = pTimeDomain->SpeedRms.AXIS_Y*1000;
-  }
-  if ((pTimeDomain->SpeedRms.AXIS_Z*1000) > pTdRmsThreshold->THR_ALARM_AXIS_Z)
-  {
-        pTdAlarm->RMS_STATUS_AXIS_Z = ALARM;
-        pTimeDomainVal->SpeedRms.AXIS_Z = pTimeDomain->SpeedRms.AXIS_Z*1000;
-  }
-  
-  pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
-  pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
-  pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
-        
-  /* Accelerometer Peak comparison with thresholds */      
-  if ((pTimeDomain->AccPeak.AXIS_X) > pTdPkThreshold->THR_WARN_AXIS_X)
-  {
-        pTdAlarm->PK_STATUS_AXIS_X = WARNING;
-        pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
-  }
-  if ((pTimeDomain->AccPeak.AXIS_Y) > pTdPkThreshold->THR_WARN_AXIS_Y)
-  {
-        pTdAlarm->PK_STATUS_AXIS_Y = WARNING;
-        pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
-  }
-  if ((pTimeDomain->AccPeak.AXIS_Z) > pTdPkThreshold->THR_WARN_AXIS_Z)
-  {
-        pTdAlarm->PK_STATUS_AXIS_Z = WARNING;
-        pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
-  }
-  if ((pTimeDomain->AccPeak.AXIS_X) > pTdPkThreshold->THR_ALARM_AXIS_X)
-  {
-        pTdAlarm->PK_STATUS_AXIS_X = ALARM;
-        pTimeDomainVal->AccPeak.AXIS_X = pTimeDomain->AccPeak.AXIS_X;
-  }
-  if ((pTimeDomain->AccPeak.AXIS_Y) > pTdPkThreshold->THR_ALARM_AXIS_Y)
-  {
-        pTdAlarm->PK_STATUS_AXIS_Y = ALARM;
-        pTimeDomainVal->AccPeak.AXIS_Y = pTimeDomain->AccPeak.AXIS_Y;
-  }
-  if ((pTimeDomain->AccPeak.AXIS_Z) > pTdPkThreshold->THR_ALARM_AXIS_Z)
-  {
-        pTdAlarm->PK_STATUS_AXIS_Z = ALARM;
-        pTimeDomainVal->AccPeak.AXIS_Z = pTimeDomain->AccPeak.AXIS_Z;
-  }
-}
-
-/**
-  *  @brief  Compare the Frequency domain subrange comparison with external Threshold Arrays
-  *  @param  pSRAmplitude: Pointer to Amplitude subranges Array resulting after Freq Analysis
-  *  @param  pFDWarnThresh: Pointer to Amplitude Warning Threshold subranges Array
-  *  @param  pFDAlarmThresh: Pointer to Amplitude Alarm Threshold subranges Array
-  *  @param  subrange_num: Subranges number
-  *  @param  pTHR_Check: Pointer to Amplitude subranges Values that exceed thresholds
-  *  @param  pTHR_Fft_Alarms: Pointer to Amplitude subranges Threshold Status
-  *  @return None
-  */
-static void MotionSP_FreqDomainAlarm (sSubrange_t *pSRAmplitude,
-                                      float *pFDWarnThresh,
-                                      float *pFDAlarmThresh,
-                                      uint8_t subrange_num, 
-                                      sSubrange_t *pTHR_Check, 
-                                      sFreqDomainAlarm_t *pTHR_Fft_Alarms)
-{
-  float warn_thresholds;
-  float alarm_thresholds;
-  
-  for(int i=0; i<subrange_num; i++)
-  {
-   for(int j=0; j<3; j++) 
-   {
-    warn_thresholds = *(pFDWarnThresh+(i*3)+j);
-    alarm_thresholds = *(pFDAlarmThresh+(i*3)+j);
-    switch (j)
-    {
-      case 0x00:  /* Axis X */
-        pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];        
-        if(pSRAmplitude->AXIS_X[i] > warn_thresholds) {
-            pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];
-            pTHR_Fft_Alarms->STATUS_AXIS_X[i] = WARNING;}
-        if(pSRAmplitude->AXIS_X[i] > alarm_thresholds){
-          pTHR_Check->AXIS_X[i] = pSRAmplitude->AXIS_X[i];
-          pTHR_Fft_Alarms->STATUS_AXIS_X[i] = ALARM;}
-       break;
-
-      case 0x01:  /* Axis Y */
-        pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
-        if(pSRAmplitude->AXIS_Y[i] > warn_thresholds){
-          pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
-          pTHR_Fft_Alarms->STATUS_AXIS_Y[i] = WARNING;}
-        if(pSRAmplitude->AXIS_Y[i] > alarm_thresholds){
-          pTHR_Check->AXIS_Y[i] = pSRAmplitude->AXIS_Y[i];
-          pTHR_Fft_Alarms->STATUS_AXIS_Y[i] = ALARM;}          
-       break;
-      case 0x02:  /* Axis Z */
-        pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
-        if(pSRAmplitude->AXIS_Z[i] > warn_thresholds){
-          pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
-          pTHR_Fft_Alarms->STATUS_AXIS_Z[i] = WARNING;}
-        if(pSRAmplitude->AXIS_Z[i] > alarm_thresholds){
-          pTHR_Check->AXIS_Z[i] = pSRAmplitude->AXIS_Z[i];
-          pTHR_Fft_Alarms->STATUS_AXIS_Z[i] = ALARM;}  
-       break;
-      default:
-        __NOP();
-       break;    
-    }
-   } 
-  }
-}
-
 /**
   * @brief  Measurement initialization for the accelerometer
   * @param  None
@@ -1070,7 +862,7 @@ static uint8_t MotionSP_AccMeasInit(void)
   uint8_t iteration = 0;
   do
   {
-    retValue = AccOdrMeas(&AcceleroODR);
+    retValue = AccOdrMeas(&MotionSP_Ctx.AcceleroODR);
     iteration++;
   } while( (retValue != 0) && (iteration < 3) );
   /************************************************************************/
@@ -1082,53 +874,335 @@ static uint8_t MotionSP_AccMeasInit(void)
 }
 
 /**
-  * @brief Read 3-axes acceleration raw data from FIFO
-  * @param pSensorAxesRaw Pointer to be filled with the new data
-  * @return None
+  * @brief Read the watermark block of tagged words from FIFO
+  * @param pBuff Buffer to be filled, ACC_FIFO_WORD_LEN bytes for each word
+  * @return Number of words read
   */
-static void AcceleroFifoRead(MOTION_SENSOR_AxesRaw_t *pSensorAxesRaw)
+static uint16_t AcceleroFifoRead(uint8_t *pBuff)
 {
-  static uint16_t fifoId = 0;
-  int16_t *data_out;
+  uint16_t NumWords = Accelerometer_Parameters.AccFifoSize;
   
-  data_out = (int16_t *)pSensorAxesRaw;  
-  MOTION_SENSOR_FIFO_Get_Data_Word(ACCELERO_INSTANCE, MOTION_ACCELERO, data_out );
+  if (NumWords > ACC_FIFO_MAX_WORDS)
+    NumWords = ACC_FIFO_MAX_WORDS;
   
-  fifoId++;
-  if (fifoId == Accelerometer_Parameters.AccFifoSize)
-  {
-    fifoId = 0;
-    IsAcceleroFifoToRead = false;
-    LedOffTargetPlatform();
-  }
+  if (MOTION_SENSOR_FIFO_Read_Block(ACCELERO_INSTANCE, pBuff, NumWords) != BSP_ERROR_NONE)
+    return 0;
+  
+  return NumWords;
 }
 
 /**
-  * @brief  Measurement initialization for the accelerometer
-  * @param  sCircBuffer_t *pAccCircBuff
+  * @brief  Convert a FIFO block, fill the circular buffer and run the time domain processing
+  * @param  MotionSP_Context_t *pCtx MotionSP context to fill
   * @param  float AccSensitivity
+  * @param  const uint8_t *pBuff Tagged words read from FIFO
+  * @param  uint16_t NumWords Number of words inside pBuff
   * @return None
   */
-static void FillCircBuffFromFifo(sCircBuffer_t *pAccCircBuff, float AccSensitivity)
+static void FillCircBuffFromFifo(MotionSP_Context_t *pCtx, float AccSensitivity,
+                                 const uint8_t *pBuff, uint16_t NumWords)
 {
-  MOTION_SENSOR_AxesRaw_t rawAcc;
+  sCircBuffer_t *pAccCircBuff = &pCtx->AccCircBuffer;
+#ifdef MOTIONSP_USE_Q15
+  SensorVal_q15_t rawAcc;
+  SensorVal_q15_t rawAccNoDC;
+#else /* MOTIONSP_USE_Q15 */
   SensorVal_f_t mgAcc;
   SensorVal_f_t mgAccNoDC;
+#endif /* MOTIONSP_USE_Q15 */
+#ifdef MOTIONSP_USE_SDFT
+  uint16_t SdftSamples = 0;
+#endif /* MOTIONSP_USE_SDFT */
+  uint16_t WordId;
+  uint16_t AccSamples = 0;
+  uint8_t Restart = RestartFlag;
+  
+  for (WordId = 0; WordId < NumWords; WordId++, pBuff += ACC_FIFO_WORD_LEN)
+  {
+    if (EXTI->PR1 & M_INT2_O_PIN)
+      while(1);
+    
+    /* Skip words not coming from the accelerometer */
+    if ((pBuff[0] >> 3) != ACC_FIFO_TAG_XL)
+      continue;
+    
+#ifdef MOTIONSP_USE_Q15
+    /* Keep the raw acceleration [LSB], the samples are scaled to m/s^2 only when needed */
+    rawAcc.AXIS_X = (int16_t)(((uint16_t)pBuff[2] << 8) | pBuff[1]);
+    rawAcc.AXIS_Y = (int16_t)(((uint16_t)pBuff[4] << 8) | pBuff[3]);
+    rawAcc.AXIS_Z = (int16_t)(((uint16_t)pBuff[6] << 8) | pBuff[5]);
+    
+    if (RestartFlag)
+      pCtx->SampleScale = AccSensitivity * G_CONV;
+    
+    // High Pass Filter to delete Accelerometer Offset
+    MotionSP_accDelOffset_q15(pCtx, &rawAccNoDC, &rawAcc, DC_SMOOTH_Q15, RestartFlag);
+    
+    /* Fill the circular buffer with the accelerations without DC component */
+    MotionSP_CreateAccCircBuffer_q15(pAccCircBuff, rawAccNoDC);
+#else /* MOTIONSP_USE_Q15 */
+    /* Convert raw acceleration in float [mg] */
+    mgAcc.AXIS_X = (float)((int16_t)(((uint16_t)pBuff[2] << 8) | pBuff[1])*AccSensitivity);
+    mgAcc.AXIS_Y = (float)((int16_t)(((uint16_t)pBuff[4] << 8) | pBuff[3])*AccSensitivity);
+    mgAcc.AXIS_Z = (float)((int16_t)(((uint16_t)pBuff[6] << 8) | pBuff[5])*AccSensitivity);
+    
+    // High Pass Filter to delete Accelerometer Offset
+    MotionSP_accDelOffset(pCtx, &mgAccNoDC, &mgAcc, DC_SMOOTH, RestartFlag);
+    
+    /* Fill the circular buffer with the accelerations without DC component */
+    MotionSP_CreateAccCircBuffer(pAccCircBuff, mgAccNoDC);
+#endif /* MOTIONSP_USE_Q15 */
+    
+#ifdef MOTIONSP_USE_SDFT
+    /* Slide the DFT of the subrange peaks before the circular buffer overwrites the samples leaving it */
+    if (++SdftSamples == SDFT_BLOCK_LEN)
+    {
+      SdftUpdate(pCtx, SdftSamples);
+      SdftSamples = 0;
+    }
+#endif /* MOTIONSP_USE_SDFT */
+    
+    AccSamples++;
+    
+    /* Clear the restart flag */
+    if (RestartFlag)
+      RestartFlag = 0;
+  }
+  
+  /* Time Domain Processing of the new samples as a whole */
+  if (AccSamples > 0)
+    MotionSP_TimeDomainProcessBlock(pCtx, (Td_Type_t)pCtx->Parameters.td_type, AccSamples, Restart);
+  
+#ifdef MOTIONSP_USE_ENVELOPE
+  /* Envelope analysis of the new samples, only when its spectrum has been requested */
+  if (FFT_Envelope && (AccSamples > 0))
+    MotionSP_EnvelopeProcessBlock(pCtx, AccSamples);
+#endif /* MOTIONSP_USE_ENVELOPE */
+  
+#ifdef MOTIONSP_USE_SDFT
+  /* Remaining samples of the block */
+  SdftUpdate(pCtx, SdftSamples);
+  
+  /* Continuous monitoring of the subrange peaks, the alarm status is latched until the next report */
+  if (SdftOnly && FFT_Alarm && MotionSP_SdftEvalAmplitude(pCtx, &SdftAmplitude))
+  {
+    if (SdftAmplitudeCnt == 0)
+    {
+      memcpy(&SdftAmplitudeSum, &SdftAmplitude, sizeof(sSubrange_t));
+    }
+    else
+    {
+      arm_add_f32(SdftAmplitudeSum.AXIS_X, SdftAmplitude.AXIS_X, SdftAmplitudeSum.AXIS_X, pCtx->Parameters.subrange_num);
+      arm_add_f32(SdftAmplitudeSum.AXIS_Y, SdftAmplitude.AXIS_Y, SdftAmplitudeSum.AXIS_Y, pCtx->Parameters.subrange_num);
+      arm_add_f32(SdftAmplitudeSum.AXIS_Z, SdftAmplitude.AXIS_Z, SdftAmplitudeSum.AXIS_Z, pCtx->Parameters.subrange_num);
+    }
+    SdftAmplitudeCnt++;
+    
+    MotionSP_FreqDomainAlarm(&SdftAmplitude, FDWarnThresh, FDAlarmThresh,
+                             pCtx->Parameters.subrange_num,
+                             &THR_Check,
+                             &THR_Fft_Alarms);
+  }
+#endif /* MOTIONSP_USE_SDFT */
+}
 
-  /* Get a complete acceleration from FIFO */
-  AcceleroFifoRead(&rawAcc);
+/**
+  * @brief  FFT of the frame in the circular buffer added to the average
+  * @param  None
+  * @return None
+  */
+static void FrequencyDomainStep(void)
+{
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+  /* Float reference of the frame about to be analyzed in fixed point */
+  FftCompareAccumulate();
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
   
-  /* Convert raw acceleration in float [mg] */
-  mgAcc.AXIS_X = (float)(rawAcc.x*AccSensitivity);
-  mgAcc.AXIS_Y = (float)(rawAcc.y*AccSensitivity);
-  mgAcc.AXIS_Z = (float)(rawAcc.z*AccSensitivity);
+#ifdef PREDMNT1_DEBUG_MOTIONSP_CYCLES
+  {
+    uint32_t Cycles = DWT->CYCCNT;
+
+    MotionSP_FrequencyDomainProcess(&MotionSP_Ctx);
+
+    Cycles = DWT->CYCCNT - Cycles;
+    FftCyclesMin = ((FftCyclesCnt == 0) || (Cycles < FftCyclesMin)) ? Cycles : FftCyclesMin;
+    FftCyclesMax = (Cycles > FftCyclesMax) ? Cycles : FftCyclesMax;
+    FftCyclesSum += Cycles;
+    FftCyclesCnt++;
+
+    if(MotionSP_Ctx.FinishAvgFlag)
+    {
+      PREDMNT1_PRINTF("FFT %d points x3 axes: %lu spectra, cycles min %lu avg %lu max %lu\r\n",
+                      MotionSP_Ctx.Parameters.FftSize, FftCyclesCnt,
+                      FftCyclesMin, FftCyclesSum/FftCyclesCnt, FftCyclesMax);
+      FftCyclesMax = FftCyclesSum = FftCyclesCnt = 0;
+    }
+  }
+#else /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+  MotionSP_FrequencyDomainProcess(&MotionSP_Ctx);
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+  
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+  if(MotionSP_Ctx.FinishAvgFlag)
+    FftCompareReport();
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
+}
+
+#ifdef MOTIONSP_USE_SDFT
+/**
+  * @brief  Slide the DFT of the subrange peaks by the last samples of the circular buffer
+  *         Only the acquisitions without the FFT average need it, the bins are set again after it
+  * @param  pCtx pointer to the MotionSP context
+  * @param  Len number of new samples, not greater than SDFT_BLOCK_LEN
+  * @return None
+  */
+static void SdftUpdate(MotionSP_Context_t *pCtx, uint16_t Len)
+{
+  if (!SdftOnly || (Len == 0))
+    return;
+  
+#ifdef PREDMNT1_DEBUG_MOTIONSP_CYCLES
+  {
+    uint32_t Cycles = DWT->CYCCNT;
+
+    MotionSP_SdftUpdateBlock(pCtx, Len);
+
+    SdftCyclesSum += DWT->CYCCNT - Cycles;
+    SdftSamplesCnt += Len;
+  }
+#else /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+  MotionSP_SdftUpdateBlock(pCtx, Len);
+#endif /* PREDMNT1_DEBUG_MOTIONSP_CYCLES */
+}
+
+/**
+  * @brief  Subrange amplitudes and spectrum peaks of an acquisition monitored by the sliding DFT only
+  *         The amplitudes are the average of the sliding DFT evaluations, the peaks are the followed bins
+  * @param  None
+  * @return None
+  */
+static void SdftAcquisitionDone(void)
+{
+  float *pSum[3] = {SdftAmplitudeSum.AXIS_X, SdftAmplitudeSum.AXIS_Y, SdftAmplitudeSum.AXIS_Z};
+  float *pAmp[3] = {MotionSP_Ctx.SRAmplitude.AXIS_X, MotionSP_Ctx.SRAmplitude.AXIS_Y, MotionSP_Ctx.SRAmplitude.AXIS_Z};
+  const float *pBin[3] = {MotionSP_Ctx.SRBinVal.AXIS_X, MotionSP_Ctx.SRBinVal.AXIS_Y, MotionSP_Ctx.SRBinVal.AXIS_Z};
+  float *pValue[3] = {&MotionSP_Ctx.AccAxesMagResults.X_Value, &MotionSP_Ctx.AccAxesMagResults.Y_Value, &MotionSP_Ctx.AccAxesMagResults.Z_Value};
+  uint32_t *pIndex[3] = {&MotionSP_Ctx.AccAxesMagResults.X_Index, &MotionSP_Ctx.AccAxesMagResults.Y_Index, &MotionSP_Ctx.AccAxesMagResults.Z_Index};
+  uint32_t MaxId;
+  uint8_t axis;
+  
+  /* Acquisition shorter than the DFT: the last amplitudes are kept */
+  if (SdftAmplitudeCnt == 0)
+    return;
+  
+  for (axis = 0; axis < 3; axis++)
+  {
+    arm_scale_f32(pSum[axis], 1.0f / (float)SdftAmplitudeCnt, pAmp[axis], MotionSP_Ctx.Parameters.subrange_num);
+    arm_max_f32(pAmp[axis], MotionSP_Ctx.Parameters.subrange_num, pValue[axis], &MaxId);
+    *pIndex[axis] = (uint32_t)pBin[axis][MaxId];
+  }
+}
+#endif /* MOTIONSP_USE_SDFT */
+
+#ifdef PREDMNT1_DEBUG_MOTIONSP_COMPARE
+/**
+  * @brief  Float FFT of the frame about to be analyzed in fixed point, added to the reference average
+  * @param  None
+  * @return None
+  */
+static void FftCompareAccumulate(void)
+{
+  static float fftIn[FFT_SIZE_MAX];
+  static float fftTmp[FFT_SIZE_MAX];
+  const q15_t *pSrc[3] = {MotionSP_Ctx.AccCircBuffer.Data.AXIS_X, MotionSP_Ctx.AccCircBuffer.Data.AXIS_Y, MotionSP_Ctx.AccCircBuffer.Data.AXIS_Z};
+  float *pRef[3] = {FftRefAvgMagBuff.AXIS_X, FftRefAvgMagBuff.AXIS_Y, FftRefAvgMagBuff.AXIS_Z};
+  uint32_t Cycles = DWT->CYCCNT;
+  int16_t initPos;
+  uint16_t SrcId;
+  uint16_t i;
+  uint8_t axis;
+  
+  /* Same frame taken by MotionSP_FrequencyDomainProcess */
+  if (MotionSP_Ctx.accCircBuffIndexForFft >= MotionSP_Ctx.AccCircBuffer.Size)
+    return;
+  
+  initPos = MotionSP_Ctx.accCircBuffIndexForFft - (MotionSP_Ctx.Parameters.FftSize - 1);
+  if (initPos < 0)
+    initPos += MotionSP_Ctx.AccCircBuffer.Size;
+  
+  for (axis = 0; axis < 3; axis++)
+  {
+    SrcId = initPos;
+    for (i = 0; i < MotionSP_Ctx.Parameters.FftSize; i++)
+    {
+      fftIn[i] = (float)pSrc[axis][SrcId] * MotionSP_Ctx.SampleScale * MotionSP_Ctx.Filter_Params[i];
+      if (++SrcId == MotionSP_Ctx.AccCircBuffer.Size)
+        SrcId = 0;
+    }
+    
+    arm_rfft_fast_f32(&MotionSP_Ctx.fftS, fftIn, fftTmp, 0);
+    arm_cmplx_mag_f32(fftTmp, fftIn, MotionSP_Ctx.magSize);
+    
+    if (FftRefCnt == 0)
+      memcpy((void *)pRef[axis], (void *)fftIn, MotionSP_Ctx.magSize * sizeof(float));
+    else
+      arm_add_f32(pRef[axis], fftIn, pRef[axis], MotionSP_Ctx.magSize);
+  }
+  
+  FftRefCnt++;
+  FftRefCyclesSum += DWT->CYCCNT - Cycles;
+}
+
+/**
+  * @brief  Print the error of the fixed point FFT average against the float reference
+  * @param  None
+  * @return None
+  */
+static void FftCompareReport(void)
+{
+  const float *pQ15[3] = {MotionSP_Ctx.AccAxesAvgMagBuff.AXIS_X, MotionSP_Ctx.AccAxesAvgMagBuff.AXIS_Y, MotionSP_Ctx.AccAxesAvgMagBuff.AXIS_Z};
+  float *pRef[3] = {FftRefAvgMagBuff.AXIS_X, FftRefAvgMagBuff.AXIS_Y, FftRefAvgMagBuff.AXIS_Z};
+  float Scale, Err, Peak, MaxErr, SumErr2, SumRef2, RmsErr;
+  uint16_t i;
+  uint8_t axis;
+  
+  if (FftRefCnt == 0)
+    return;
+  
+  /* Same average and re-scaling of MotionSP_FrequencyDomainProcess */
+  Scale = MotionSP_Ctx.Window_Scale_Factor / ((float)MotionSP_Ctx.magSize * (float)FftRefCnt);
+  
+  for (axis = 0; axis < 3; axis++)
+  {
+    arm_scale_f32(pRef[axis], Scale, pRef[axis], MotionSP_Ctx.magSize);
+    pRef[axis][0] *= 0.5f;
+    
+    /* Bin 0 is skipped: arm_rfft_fast_f32 packs the Nyquist value inside it */
+    Peak = MaxErr = SumErr2 = SumRef2 = 0.0f;
+    for (i = 1; i < MotionSP_Ctx.magSize; i++)
+    {
+      Err = fabsf(pQ15[axis][i] - pRef[axis][i]);
+      MaxErr = (Err > MaxErr) ? Err : MaxErr;
+      Peak = (pRef[axis][i] > Peak) ? pRef[axis][i] : Peak;
+      SumErr2 += Err * Err;
+      SumRef2 += pRef[axis][i] * pRef[axis][i];
+    }
+    
+    if (SumRef2 > 0.0f)
+    {
+      arm_sqrt_f32(SumErr2 / SumRef2, &RmsErr);
+      PREDMNT1_PRINTF("FFT Q15 vs float %c axis: max error %lu ppm of the peak, rms error %lu ppm\r\n",
+                      'X' + axis, (uint32_t)((MaxErr / Peak) * 1000000.0f), (uint32_t)(RmsErr * 1000000.0f));
+    }
+  }
   
-  // High Pass Filter to delete Accelerometer Offset
-  MotionSP_accDelOffset(&mgAccNoDC, &mgAcc, DC_SMOOTH, RestartFlag);
+  PREDMNT1_PRINTF("FFT float reference %d points x3 axes: %d spectra, cycles avg %lu\r\n",
+                  MotionSP_Ctx.Parameters.FftSize, FftRefCnt, FftRefCyclesSum / FftRefCnt);
   
-  /* Fill the circular buffer with the accelerations without DC component */
-  MotionSP_CreateAccCircBuffer(pAccCircBuff, mgAccNoDC);
+  FftRefCnt = 0;
+  FftRefCyclesSum = 0;
 }
+#endif /* PREDMNT1_DEBUG_MOTIONSP_COMPARE */
 
 /* Code for MotionSP integration - End Section */
 
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    Scheduler.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Run-to-completion event scheduler for the main loop
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include <stddef.h>
+
+#include "stm32l4xx_hal.h"
+
+#include "Scheduler.h"
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t SchedPendingMask = 0;
+static SchedHandler_t SchedHandler[SCHED_EVT_NUMBER];
+static SchedHandler_t SchedIdleHandler = NULL;
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Clear all the handlers and the pending events
+ * @param SchedHandler_t IdleHandler Low power entry called when nothing is pending
+ * @retval None
+ */
+void Sched_Init(SchedHandler_t IdleHandler)
+{
+  uint32_t Event;
+
+  for(Event=0; Event<SCHED_EVT_NUMBER; Event++) {
+    SchedHandler[Event] = NULL;
+  }
+
+  SchedIdleHandler = IdleHandler;
+  SchedPendingMask = 0;
+}
+
+/**
+ * @brief Attach the handler for one event
+ * @param SchedEvent_t Event Event to handle
+ * @param SchedHandler_t Handler Function executed when Event is dispatched
+ * @retval None
+ */
+void Sched_Register(SchedEvent_t Event, SchedHandler_t Handler)
+{
+  if(Event < SCHED_EVT_NUMBER) {
+    SchedHandler[Event] = Handler;
+  }
+}
+
+/**
+ * @brief Set one event as pending (interrupt safe)
+ * @param SchedEvent_t Event Event to post
+ * @retval None
+ */
+void Sched_Post(SchedEvent_t Event)
+{
+  uint32_t uwPRIMASK_Bit;
+
+  uwPRIMASK_Bit = __get_PRIMASK();
+  __disable_irq();
+  SchedPendingMask |= (1UL << Event);
+  __set_PRIMASK(uwPRIMASK_Bit);
+}
+
+/**
+ * @brief Read the bitmask of the pending events
+ * @param None
+ * @retval uint32_t Pending events (bit n set for event n)
+ */
+uint32_t Sched_Pending(void)
+{
+  return SchedPendingMask;
+}
+
+/**
+ * @brief Dispatch the highest priority pending event,
+ *        or enter in low power mode if nothing is pending
+ * @param None
+ * @retval None
+ */
+void Sched_Run(void)
+{
+  uint32_t uwPRIMASK_Bit;
+  uint32_t Pending;
+  uint32_t Event;
+
+  uwPRIMASK_Bit = __get_PRIMASK();
+  __disable_irq();
+
+  Pending = SchedPendingMask;
+
+  if(Pending == 0) {
+    /* Interrupts are masked so no event can be lost between the check and the WFI:
+     * a pending interrupt wakes up the core and it is served after restoring PRIMASK */
+    if(SchedIdleHandler != NULL) {
+      SchedIdleHandler();
+    }
+    __set_PRIMASK(uwPRIMASK_Bit);
+    return;
+  }
+
+  /* Lowest bit set is the highest priority event */
+  Event = __CLZ(__RBIT(Pending));
+  SchedPendingMask = Pending & ~(1UL << Event);
+
+  __set_PRIMASK(uwPRIMASK_Bit);
+
+  if(SchedHandler[Event] != NULL) {
+    SchedHandler[Event]();
+  }
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,402 @@
+/**
+  ******************************************************************************
+  * @file    TaiChiJournal.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Append-only TaiChi gesture journal on internal flash
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include <stddef.h>
+#include <string.h>
+
+#include "TaiChiJournal.h"
+#include "TargetFeatures.h"
+
+/* Local types ---------------------------------------------------------------*/
+
+/**
+ * @brief Journal record, written as 4 double words (the flash programming unit).
+ *        Sent is left erased until the gesture has been notified, so the send
+ *        cursor survives a reset without rewriting the record.
+ */
+typedef struct
+{
+  uint32_t Seq;        //!< Sequence number, increasing across resets
+  uint16_t Type;       //!< MLC decision tree output
+  uint16_t Reserved;
+  uint32_t Start;      //!< Journal timeline [ms]
+  uint32_t End;        //!< Journal timeline [ms]
+  uint32_t Crc;        //!< CRC of the first 4 words
+  uint32_t Reserved2;
+  uint64_t Sent;       //!< Erased until sent
+} TaiChiJournalRecord_t;
+
+/* Local defines -------------------------------------------------------------*/
+#define TAICHI_JOURNAL_SLOTS_PER_PAGE  (FLASH_PAGE_SIZE / sizeof(TaiChiJournalRecord_t))
+#define TAICHI_JOURNAL_SLOTS           (TAICHI_JOURNAL_PAGES * TAICHI_JOURNAL_SLOTS_PER_PAGE)
+
+#define TAICHI_JOURNAL_ERASED          0xFFFFFFFFU
+#define TAICHI_JOURNAL_ERASED_DW       0xFFFFFFFFFFFFFFFFULL
+
+/* Local Macros -------------------------------------------------------------*/
+#define TAICHI_JOURNAL_SLOT_ADD(n) (TAICHI_JOURNAL_ADD_START + (n) * sizeof(TaiChiJournalRecord_t))
+#define TAICHI_JOURNAL_SLOT(n)     ((const TaiChiJournalRecord_t *)TAICHI_JOURNAL_SLOT_ADD(n))
+#define TAICHI_JOURNAL_NEXT(n) (((n) + 1U) % TAICHI_JOURNAL_SLOTS)
+
+/* Private variables ---------------------------------------------------------*/
+static CRC_HandleTypeDef *JournalCrc;
+
+static uint32_t WriteSlot;   /* Next free slot */
+static uint32_t CursorSlot;  /* Oldest gesture not yet sent */
+static uint32_t NextSeq;
+static uint32_t Pending;
+static uint32_t Dropped;
+
+/* The board has no running RTC: records from before a reset are kept on one
+ * timeline by restarting from the last recorded time (powered off time is lost) */
+static uint32_t TimeOffset;
+
+/* Local function prototypes --------------------------------------------------*/
+static uint8_t IsValid(const TaiChiJournalRecord_t *Rec);
+static uint8_t IsPending(const TaiChiJournalRecord_t *Rec);
+static uint8_t IsBlank(const TaiChiJournalRecord_t *Rec);
+static uint8_t RecyclePage(uint32_t Page);
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Scan the journal after reset and restore the send cursor
+ * @param CRC_HandleTypeDef *hcrc CRC peripheral configured for 32-bit words
+ * @retval None
+ */
+void TaiChiJournal_Init(CRC_HandleTypeDef *hcrc)
+{
+  const TaiChiJournalRecord_t *Rec;
+  uint32_t Slot;
+  uint32_t OldestSeq = 0;
+  uint8_t Found = 0;
+
+  JournalCrc = hcrc;
+  WriteSlot  = 0;
+  CursorSlot = 0;
+  NextSeq    = 0;
+  Pending    = 0;
+  Dropped    = 0;
+  TimeOffset = 0;
+
+  for(Slot=0; Slot<TAICHI_JOURNAL_SLOTS; Slot++) {
+    Rec = TAICHI_JOURNAL_SLOT(Slot);
+
+    if(Rec->Seq == TAICHI_JOURNAL_ERASED) {
+      continue;
+    }
+
+    /* A torn record still consumes its slot */
+    if((!Found) || (Rec->Seq >= NextSeq)) {
+      NextSeq   = Rec->Seq + 1U;
+      WriteSlot = TAICHI_JOURNAL_NEXT(Slot);
+      Found = 1;
+    }
+
+    if(!IsValid(Rec)) {
+      continue;
+    }
+
+    if(Rec->End > TimeOffset) {
+      TimeOffset = Rec->End;
+    }
+
+    if(Rec->Sent == TAICHI_JOURNAL_ERASED_DW) {
+      if((!Pending) || (Rec->Seq < OldestSeq)) {
+        OldestSeq  = Rec->Seq;
+        CursorSlot = Slot;
+      }
+      Pending++;
+    }
+  }
+
+  if(!Pending) {
+    CursorSlot = WriteSlot;
+  }
+}
+
+/**
+ * @brief Append one gesture, recycling the oldest page when entering it
+ * @param taiChiResult_t *Item Gesture on the HAL tick timeline
+ * @retval uint8_t 1 if written, 0 on flash error
+ */
+uint8_t TaiChiJournal_Append(const taiChiResult_t *Item)
+{
+  TaiChiJournalRecord_t Rec;
+  uint32_t Address;
+  uint64_t Dw;
+  uint32_t Index;
+  uint8_t Success = 1;
+
+  /* A slot left dirty by a reset during a page erase: restart from the next page */
+  if(((WriteSlot % TAICHI_JOURNAL_SLOTS_PER_PAGE) != 0U) && (!IsBlank(TAICHI_JOURNAL_SLOT(WriteSlot)))) {
+    WriteSlot = ((WriteSlot / TAICHI_JOURNAL_SLOTS_PER_PAGE + 1U) * TAICHI_JOURNAL_SLOTS_PER_PAGE) % TAICHI_JOURNAL_SLOTS;
+  }
+
+  if((WriteSlot % TAICHI_JOURNAL_SLOTS_PER_PAGE) == 0U) {
+    if(!RecyclePage(WriteSlot / TAICHI_JOURNAL_SLOTS_PER_PAGE)) {
+      return 0;
+    }
+  }
+
+  if(!Pending) {
+    CursorSlot = WriteSlot;
+  }
+
+  memset(&Rec, 0xFF, sizeof(Rec));
+  Rec.Seq   = NextSeq;
+  Rec.Type  = Item->type;
+  Rec.Start = Item->start + TimeOffset;
+  Rec.End   = Item->end + TimeOffset;
+  Rec.Crc   = HAL_CRC_Calculate(JournalCrc, (uint32_t *)&Rec, 4);
+
+  Address = TAICHI_JOURNAL_SLOT_ADD(WriteSlot);
+
+  /* The slot is consumed even if programming fails */
+  NextSeq++;
+  WriteSlot = TAICHI_JOURNAL_NEXT(WriteSlot);
+
+  /* Seq first, Crc last: a record torn by a reset is never valid.
+   * Sent is left erased */
+  HAL_FLASH_Unlock();
+  for(Index=0; Index<3U; Index++) {
+    memcpy(&Dw, ((uint8_t *)&Rec) + Index * 8U, 8U);
+    if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, Address + Index * 8U, Dw) != HAL_OK) {
+      Success = 0;
+      break;
+    }
+  }
+  HAL_FLASH_Lock();
+
+  if(Success) {
+    Pending++;
+  }
+
+  return Success;
+}
+
+/**
+ * @brief Number of gestures not yet sent
+ * @param None
+ * @retval uint32_t Number of gestures
+ */
+uint32_t TaiChiJournal_Count(void)
+{
+  return Pending;
+}
+
+/**
+ * @brief Read one gesture not yet sent without marking it
+ * @param uint32_t Index 0 for the oldest gesture
+ * @param taiChiResult_t *Item Gesture on the HAL tick timeline
+ *        (start/end before the reset wrap below 0)
+ * @retval uint8_t 1 if read, 0 if Index is out of range
+ */
+uint8_t TaiChiJournal_Read(uint32_t Index, taiChiResult_t *Item)
+{
+  const TaiChiJournalRecord_t *Rec;
+  uint32_t Slot = CursorSlot;
+
+  if(Index >= Pending) {
+    return 0;
+  }
+
+  for(;;) {
+    Rec = TAICHI_JOURNAL_SLOT(Slot);
+    if(IsPending(Rec)) {
+      if(!Index) {
+        break;
+      }
+      Index--;
+    }
+    Slot = TAICHI_JOURNAL_NEXT(Slot);
+  }
+
+  Item->type  = Rec->Type;
+  Item->start = Rec->Start - TimeOffset;
+  Item->end   = Rec->End - TimeOffset;
+
+  return 1;
+}
+
+/**
+ * @brief Mark the oldest gestures as sent and move the cursor after them
+ * @param uint32_t Num Number of gestures
+ * @retval None
+ */
+void TaiChiJournal_Release(uint32_t Num)
+{
+  const TaiChiJournalRecord_t *Rec;
+
+  HAL_FLASH_Unlock();
+  while(Num && Pending) {
+    Rec = TAICHI_JOURNAL_SLOT(CursorSlot);
+    if(IsPending(Rec)) {
+      /* If marking fails the gesture is sent again after the next reset */
+      HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, TAICHI_JOURNAL_SLOT_ADD(CursorSlot) + offsetof(TaiChiJournalRecord_t, Sent), 0);
+      Pending--;
+      Num--;
+    }
+    CursorSlot = TAICHI_JOURNAL_NEXT(CursorSlot);
+  }
+  HAL_FLASH_Lock();
+
+  if(!Pending) {
+    CursorSlot = WriteSlot;
+  }
+}
+
+/**
+ * @brief Number of gestures overwritten before being sent
+ * @param None
+ * @retval uint32_t Number of gestures
+ */
+uint32_t TaiChiJournal_Dropped(void)
+{
+  return Dropped;
+}
+
+/* Local functions  --------------------------------------------------*/
+
+/**
+ * @brief Check if a record has been completely written
+ * @param TaiChiJournalRecord_t *Rec Record on flash
+ * @retval uint8_t 1 if valid
+ */
+static uint8_t IsValid(const TaiChiJournalRecord_t *Rec)
+{
+  if(Rec->Seq == TAICHI_JOURNAL_ERASED) {
+    return 0;
+  }
+
+  return (HAL_CRC_Calculate(JournalCrc, (uint32_t *)Rec, 4) == Rec->Crc) ? 1 : 0;
+}
+
+/**
+ * @brief Check if a record is valid and not yet sent
+ * @param TaiChiJournalRecord_t *Rec Record on flash
+ * @retval uint8_t 1 if pending
+ */
+static uint8_t IsPending(const TaiChiJournalRecord_t *Rec)
+{
+  return ((Rec->Sent == TAICHI_JOURNAL_ERASED_DW) && IsValid(Rec)) ? 1 : 0;
+}
+
+/**
+ * @brief Check if a slot is still erased
+ * @param TaiChiJournalRecord_t *Rec Slot on flash
+ * @retval uint8_t 1 if erased
+ */
+static uint8_t IsBlank(const TaiChiJournalRecord_t *Rec)
+{
+  const uint32_t *Word = (const uint32_t *)Rec;
+  uint32_t Index;
+
+  for(Index=0; Index<(sizeof(TaiChiJournalRecord_t) / 4U); Index++) {
+    if(Word[Index] != TAICHI_JOURNAL_ERASED) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * @brief Erase one journal page before writing its first slot.
+ *        The gestures not yet sent in it are lost
+ * @param uint32_t Page Journal page [0..TAICHI_JOURNAL_PAGES-1]
+ * @retval uint8_t 1 if the page is erased, 0 on flash error
+ */
+static uint8_t RecyclePage(uint32_t Page)
+{
+  FLASH_EraseInitTypeDef EraseInitStruct;
+  uint32_t SectorError = 0;
+  uint32_t First = Page * TAICHI_JOURNAL_SLOTS_PER_PAGE;
+  uint32_t Slot;
+  uint32_t Lost = 0;
+  uint8_t Blank = 1;
+  uint8_t Success = 1;
+
+  for(Slot=First; Slot<(First + TAICHI_JOURNAL_SLOTS_PER_PAGE); Slot++) {
+    if(!IsBlank(TAICHI_JOURNAL_SLOT(Slot))) {
+      Blank = 0;
+      Lost += IsPending(TAICHI_JOURNAL_SLOT(Slot));
+    }
+  }
+
+  if(Blank) {
+    return 1;
+  }
+
+  EraseInitStruct.TypeErase   = FLASH_TYPEERASE_PAGES;
+  EraseInitStruct.Banks       = GetBank(TAICHI_JOURNAL_SLOT_ADD(First));
+  EraseInitStruct.Page        = GetPage(TAICHI_JOURNAL_SLOT_ADD(First));
+  EraseInitStruct.NbPages     = 1;
+
+  /* Unlock the Flash to enable the flash control register access *************/
+  HAL_FLASH_Unlock();
+
+  /* Clear OPTVERR bit set on virgin samples */
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+  /* Clear PEMPTY bit set (as the code is executed from Flash which is not empty) */
+  if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_PEMPTY) != 0) {
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PEMPTY);
+  }
+
+  if(HAL_FLASHEx_Erase(&EraseInitStruct, &SectorError) != HAL_OK){
+    Success = 0;
+  }
+
+  /* Lock the Flash to disable the flash control register access (recommended
+  to protect the FLASH memory against possible unwanted operation) *********/
+  HAL_FLASH_Lock();
+
+  if(!Success) {
+    return 0;
+  }
+
+  Pending -= Lost;
+  Dropped += Lost;
+
+  /* The cursor can't stay behind the slots about to be rewritten */
+  if((CursorSlot >= First) && (CursorSlot < (First + TAICHI_JOURNAL_SLOTS_PER_PAGE))) {
+    CursorSlot = (First + TAICHI_JOURNAL_SLOTS_PER_PAGE) % TAICHI_JOURNAL_SLOTS;
+  }
+
+  return 1;
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
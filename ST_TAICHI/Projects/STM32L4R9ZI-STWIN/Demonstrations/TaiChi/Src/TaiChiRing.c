@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file    TaiChiRing.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Lock-free single producer/single consumer buffer for TaiChi results
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+#include <stddef.h>
+
+#include "TaiChiRing.h"
+
+/* Local defines -------------------------------------------------------------*/
+#define TAICHI_RING_MASK (BUFF_TAICHIRESULT_SIZE - 1U)
+
+/* Exported functions  --------------------------------------------------*/
+
+/**
+ * @brief Empty the ring and clear the drop counter
+ * @param taiChiRing_t *Ring Ring to initialize
+ * @retval None
+ */
+void TaiChiRing_Init(taiChiRing_t *Ring)
+{
+  Ring->Head = 0;
+  Ring->Tail = 0;
+  Ring->Dropped = 0;
+}
+
+/**
+ * @brief Append one gesture (producer side)
+ * @param taiChiRing_t *Ring Destination ring
+ * @param taiChiResult_t *Item Gesture to copy inside the ring
+ * @retval uint8_t 1 if stored, 0 if dropped because the ring is full
+ */
+uint8_t TaiChiRing_Push(taiChiRing_t *Ring, const taiChiResult_t *Item)
+{
+  uint32_t Head = Ring->Head;
+
+  if((Head - Ring->Tail) >= BUFF_TAICHIRESULT_SIZE) {
+    Ring->Dropped++;
+    return 0;
+  }
+
+  Ring->Item[Head & TAICHI_RING_MASK] = *Item;
+
+  /* The item must be visible before the consumer sees the new Head */
+  __DMB();
+  Ring->Head = Head + 1U;
+
+  return 1;
+}
+
+/**
+ * @brief Number of gestures waiting to send (consumer side)
+ * @param taiChiRing_t *Ring Source ring
+ * @retval uint32_t Number of stored gestures
+ */
+uint32_t TaiChiRing_Count(const taiChiRing_t *Ring)
+{
+  return Ring->Head - Ring->Tail;
+}
+
+/**
+ * @brief Access one stored gesture without removing it (consumer side)
+ * @param taiChiRing_t *Ring Source ring
+ * @param uint32_t Index 0 for the oldest gesture
+ * @retval taiChiResult_t* Pointer to the gesture or NULL
+ */
+const taiChiResult_t *TaiChiRing_Peek(const taiChiRing_t *Ring, uint32_t Index)
+{
+  uint32_t Tail = Ring->Tail;
+
+  if(Index >= (Ring->Head - Tail)) {
+    return NULL;
+  }
+
+  /* Read the item only after the Head that published it */
+  __DMB();
+  return &Ring->Item[(Tail + Index) & TAICHI_RING_MASK];
+}
+
+/**
+ * @brief Remove the oldest gestures (consumer side)
+ * @param taiChiRing_t *Ring Source ring
+ * @param uint32_t Num Number of gestures to remove
+ * @retval None
+ */
+void TaiChiRing_Release(taiChiRing_t *Ring, uint32_t Num)
+{
+  uint32_t Tail = Ring->Tail;
+  uint32_t Count = Ring->Head - Tail;
+
+  if(Num > Count) {
+    Num = Count;
+  }
+
+  /* Items must be consumed before the producer can overwrite them */
+  __DMB();
+  Ring->Tail = Tail + Num;
+}
+
+/******************* (C) COPYRIGHT 2020 STMicroelectronics *****END OF FILE****/
@@ -107,9 +107,6 @@ static void ISM330DHC_GPIO_Init(void);
 static void Init_MEMS_Sensors(void);
 static void Init_MEMS_Mics(uint32_t AudioFreq, uint32_t AudioVolume);
 
-static uint32_t GetPage(uint32_t Address);
-static uint32_t GetBank(uint32_t Address);
-
 /**
   * @}
   */
@@ -452,7 +449,7 @@ void LedToggleTargetPlatform(void)
   * @param  Addr: Address of the FLASH Memory
   * @retval The page of a given address
   */
-static uint32_t GetPage(uint32_t Addr)
+uint32_t GetPage(uint32_t Addr)
 {
   uint32_t page = 0;
   
@@ -475,7 +472,7 @@ static uint32_t GetPage(uint32_t Addr)
   * @param  Addr: Address of the FLASH Memory
   * @retval The bank of a given address
   */
-static uint32_t GetBank(uint32_t Addr)
+uint32_t GetBank(uint32_t Addr)
 {
   uint32_t bank = 0;
   
@@ -31,8 +31,10 @@
 #include "hci_tl_interface.h"
 #endif /* HCI_TL */
 
+#include <string.h>
 #include "RTE_Components.h"
 #include "stm32l4xx_hal_exti.h"
+#include "Scheduler.h"
 
 /* Defines -------------------------------------------------------------------*/
 
@@ -40,36 +42,58 @@
 #define MAX_BUFFER_SIZE   255U
 #define TIMEOUT_DURATION  15U
 
+/* TxResult while the command is being written */
+#define TX_BUSY           1
+
+/* Private typedef -----------------------------------------------------------*/
+
+/* Transport states. The SPI2 transfers run on DMA (on interrupts below
+   BSP_BUS_DMA_MIN_LEN) and each phase is started from the completion of the
+   previous one, CS stays low across the header and the payload phases */
+typedef enum
+{
+  HCI_TL_SPI_IDLE = 0,
+  HCI_TL_SPI_RX_HEADER,   /* Read header exchange */
+  HCI_TL_SPI_RX_PAYLOAD,  /* Event read into the HCI packet */
+  HCI_TL_SPI_TX_WAIT,     /* CS low, waiting for the BlueNRG-2 to raise IRQ */
+  HCI_TL_SPI_TX_HEADER,   /* Write header exchange */
+  HCI_TL_SPI_TX_PAYLOAD   /* Command written */
+} HCI_TL_SPI_State_t;
+
 /* Private variables ---------------------------------------------------------*/
 EXTI_HandleTypeDef hexti1;
 
+static volatile HCI_TL_SPI_State_t SpiState = HCI_TL_SPI_IDLE;
+static BSP_BUS_Xfer_t SpiXfer;
+static uint8_t HeaderMaster[HEADER_SIZE];
+static uint8_t HeaderSlave[HEADER_SIZE];
+/* Clocked out while the event is read */
+static uint8_t DummyTx[MAX_BUFFER_SIZE];
+
+static uint8_t *pRxBuff;
+
+static uint8_t *pTxBuff;
+static uint16_t TxSize;
+static uint32_t TxTickstart;
+static volatile uint8_t TxPending;
+static volatile int32_t TxResult;
+
 /* Private function prototypes -----------------------------------------------*/
-static void HCI_TL_SPI_Enable_IRQ(void);
-static void HCI_TL_SPI_Disable_IRQ(void);
 static int32_t IsDataAvailable(void);
+static void SPI_Submit(BSP_BUS_XferType_t Type, uint8_t *pTx, uint8_t *pRx, uint16_t Len,
+                       BSP_BUS_XferCb_t Callback);
+static void RX_Start(void);
+static void RX_End(uint16_t Len);
+static void RX_HeaderDone(BSP_BUS_Xfer_t *Xfer);
+static void RX_PayloadDone(BSP_BUS_Xfer_t *Xfer);
+static void TX_Start(void);
+static void TX_Header(void);
+static void TX_End(int32_t Result);
+static void TX_HeaderDone(BSP_BUS_Xfer_t *Xfer);
+static void TX_PayloadDone(BSP_BUS_Xfer_t *Xfer);
 
 /******************** IO Operation and BUS services ***************************/
 
-/**
- * @brief  Enable SPI IRQ.
- * @param  None
- * @retval None
- */
-static void HCI_TL_SPI_Enable_IRQ(void)
-{
-  HAL_NVIC_EnableIRQ(HCI_TL_SPI_EXTI_IRQn);  
-}
-
-/**
- * @brief  Disable SPI IRQ.
- * @param  None
- * @retval None
- */
-static void HCI_TL_SPI_Disable_IRQ(void)
-{ 
-  HAL_NVIC_DisableIRQ(HCI_TL_SPI_EXTI_IRQn);
-}
-
 /**
  * @brief  Initializes the peripherals communication with the BlueNRG
  *         Expansion Board (via SPI, I2C, USART, ...)
@@ -117,7 +141,11 @@ int32_t HCI_TL_SPI_Init(void* pConf)
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(HCI_TL_SPI_CS_PORT, &GPIO_InitStruct);
-    
+
+  memset(DummyTx, 0xFF, sizeof(DummyTx));
+  SpiState = HCI_TL_SPI_IDLE;
+  TxPending = 0;
+
   return BSP_SPI2_Init();
 }
 
@@ -156,77 +184,251 @@ int32_t HCI_TL_SPI_Reset(void)
 }  
 
 /**
- * @brief  Reads from BlueNRG SPI buffer and store data into local buffer.
- *
- * @param  buffer : Buffer where data from SPI are stored
- * @param  size   : Buffer size
- * @retval int32_t: Number of read bytes
+ * @brief  Queue the next phase of the exchange on SPI2.
+ *         CS is driven by the transport, not by the bus
+ * @param  Type: transfer type
+ * @param  pTx: data clocked out
+ * @param  pRx: data clocked in
+ * @param  Len: number of bytes
+ * @param  Callback: end of the phase, in interrupt context
+ * @retval None
  */
-int32_t HCI_TL_SPI_Receive(uint8_t* buffer, uint16_t size)
+static void SPI_Submit(BSP_BUS_XferType_t Type, uint8_t *pTx, uint8_t *pRx, uint16_t Len,
+                       BSP_BUS_XferCb_t Callback)
 {
-  uint16_t byte_count;
-  uint8_t len = 0;
-  uint8_t char_ff = 0xff;
-  volatile uint8_t read_char;
+  SpiXfer.Type     = Type;
+  SpiXfer.DevAddr  = 0;
+  SpiXfer.Reg      = 0;
+  SpiXfer.RegLen   = 0;
+  SpiXfer.CsPort   = NULL;
+  SpiXfer.CsPin    = 0;
+  SpiXfer.pTxData  = pTx;
+  SpiXfer.pRxData  = pRx;
+  SpiXfer.Len      = Len;
+  SpiXfer.Callback = Callback;
+  SpiXfer.pUser    = NULL;
+
+  /* A failure to start is reported through Callback */
+  (void)BSP_BUS_Submit(BSP_BUS_SPI2, &SpiXfer);
+}
 
-  uint8_t header_master[HEADER_SIZE] = {0x0b, 0x00, 0x00, 0x00, 0x00};
-  uint8_t header_slave[HEADER_SIZE];
+/**
+ * @brief  Start reading an event into a free HCI packet.
+ *         Called with interrupts masked in HCI_TL_SPI_IDLE state
+ * @param  None
+ * @retval None
+ */
+static void RX_Start(void)
+{
+  pRxBuff = hci_get_rx_buffer();
+  if (pRxBuff == NULL)
+  {
+    /* Restarted by hci_tl_lowlevel_kick() when a packet is released */
+    return;
+  }
 
-  HCI_TL_SPI_Disable_IRQ();
+  HeaderMaster[0] = 0x0b;
+  HeaderMaster[1] = 0x00;
+  HeaderMaster[2] = 0x00;
+  HeaderMaster[3] = 0x00;
+  HeaderMaster[4] = 0x00;
 
   /* CS reset */
   HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_RESET);
 
-  /* Read the header */
-  BSP_SPI2_SendRecv(header_master, header_slave, HEADER_SIZE);
+  SpiState = HCI_TL_SPI_RX_HEADER;
+  SPI_Submit(BSP_BUS_XFER_WRITE_READ, HeaderMaster, HeaderSlave, HEADER_SIZE, RX_HeaderDone);
+}
+
+/**
+ * @brief  End of a read exchange: queue the event and look for more work
+ * @param  Len: number of bytes read, 0 if nothing has been read
+ * @retval None
+ */
+static void RX_End(uint16_t Len)
+{
+  /* Release CS line */
+  HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_SET);
+  SpiState = HCI_TL_SPI_IDLE;
+
+  if (Len > 0)
+  {
+#if PRINT_CSV_FORMAT
+    PRINT_CSV("BTOH->>\n");
+    print_csv_time();
+    for (int i=0; i<Len; i++)
+    {
+      PRINT_CSV(" %02x", pRxBuff[i]);
+    }
+    PRINT_CSV("\n");
+#endif
+
+    if (hci_notify_rx_cplt(Len) == 0)
+    {
+      Sched_Post(SCHED_EVT_HCI);
+    }
+  }
+
+  /* The BlueNRG-2 keeps IRQ high while it has other events */
+  hci_tl_lowlevel_kick();
+}
+
+/**
+ * @brief  End of the read header exchange, start the payload read
+ * @param  Xfer: header transfer
+ * @retval None
+ */
+static void RX_HeaderDone(BSP_BUS_Xfer_t *Xfer)
+{
+  uint16_t byte_count;
+
+  if (Xfer->Status != BSP_ERROR_NONE)
+  {
+    RX_End(0);
+    return;
+  }
 
   /* device is ready */
-  byte_count = (header_slave[4] << 8)| header_slave[3];
+  byte_count = (HeaderSlave[4] << 8) | HeaderSlave[3];
 
-  if(byte_count > 0)
+  if (byte_count == 0)
   {
+    RX_End(0);
+    return;
+  }
 
-    /* avoid to read more data that size of the buffer */
+  /* avoid to read more data that size of the buffer */
+  if (byte_count > HCI_READ_PACKET_SIZE)
+  {
+    byte_count = HCI_READ_PACKET_SIZE;
+  }
 
-    if (byte_count > size)
-	{
-      byte_count = size;
-    }
+  SpiState = HCI_TL_SPI_RX_PAYLOAD;
+  SPI_Submit(BSP_BUS_XFER_WRITE_READ, DummyTx, pRxBuff, byte_count, RX_PayloadDone);
+}
 
-    for(len = 0; len < byte_count; len++)
-    {           
-      BSP_SPI2_SendRecv(&char_ff, (uint8_t*)&read_char, 1);
-      buffer[len] = read_char;
-    }
-  }  
+/**
+ * @brief  End of the payload read
+ * @param  Xfer: payload transfer
+ * @retval None
+ */
+static void RX_PayloadDone(BSP_BUS_Xfer_t *Xfer)
+{
+  RX_End((Xfer->Status == BSP_ERROR_NONE) ? Xfer->Len : 0U);
+}
+
+/**
+ * @brief  Start writing the pending command.
+ *         Called with interrupts masked in HCI_TL_SPI_IDLE state
+ * @param  None
+ * @retval None
+ */
+static void TX_Start(void)
+{
+  TxPending = 0;
+
+  /* CS reset */
+  HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_RESET);
+  SpiState = HCI_TL_SPI_TX_WAIT;
+
+  /*
+   * The BlueNRG-2 raises the IRQ pin when it is ready, the EXTI edge
+   * kicks the transport if it is not high yet.
+   */
+  if (IsDataAvailable())
+  {
+    TX_Header();
+  }
+}
+
+/**
+ * @brief  Start the write header exchange
+ * @param  None
+ * @retval None
+ */
+static void TX_Header(void)
+{
+  HeaderMaster[0] = 0x0a;
+  HeaderMaster[1] = 0x00;
+  HeaderMaster[2] = 0x00;
+  HeaderMaster[3] = 0x00;
+  HeaderMaster[4] = 0x00;
+
+  SpiState = HCI_TL_SPI_TX_HEADER;
+  SPI_Submit(BSP_BUS_XFER_WRITE_READ, HeaderMaster, HeaderSlave, HEADER_SIZE, TX_HeaderDone);
+}
 
+/**
+ * @brief  End of a write exchange: report the result and look for more work
+ * @param  Result: HCI_TL_SPI_Send() result
+ * @retval None
+ */
+static void TX_End(int32_t Result)
+{
   /* Release CS line */
   HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_SET);
+  SpiState = HCI_TL_SPI_IDLE;
+  TxResult = Result;
 
-  HCI_TL_SPI_Enable_IRQ();
+  hci_tl_lowlevel_kick();
+}
 
-#if PRINT_CSV_FORMAT
-  if (len > 0)
+/**
+ * @brief  End of the write header exchange, write the command if the
+ *         BlueNRG-2 has room for it, try again otherwise
+ * @param  Xfer: header transfer
+ * @retval None
+ */
+static void TX_HeaderDone(BSP_BUS_Xfer_t *Xfer)
+{
+  uint16_t rx_bytes;
+
+  if (Xfer->Status != BSP_ERROR_NONE)
   {
-    PRINT_CSV("BTOH->>\n");
-    print_csv_time();
-    for (int i=0; i<len; i++)
-	{
-      PRINT_CSV(" %02x", buffer[i]);
-    }
-    PRINT_CSV("\n");
+    TX_End(-1);
+    return;
   }
-#endif
 
-  return len;
+  rx_bytes = (((uint16_t)HeaderSlave[2])<<8) | ((uint16_t)HeaderSlave[1]);
+
+  if (rx_bytes >= TxSize)
+  {
+    /* Buffer is big enough */
+    SpiState = HCI_TL_SPI_TX_PAYLOAD;
+    SPI_Submit(BSP_BUS_XFER_WRITE, pTxBuff, NULL, TxSize, TX_PayloadDone);
+  }
+  else if ((HAL_GetTick() - TxTickstart) > TIMEOUT_DURATION)
+  {
+    /* Buffer is too small */
+    TX_End(-2);
+  }
+  else
+  {
+    /* Release CS line and try again */
+    HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_SET);
+    TX_Start();
+  }
+}
+
+/**
+ * @brief  End of the command write
+ * @param  Xfer: payload transfer
+ * @retval None
+ */
+static void TX_PayloadDone(BSP_BUS_Xfer_t *Xfer)
+{
+  TX_End((Xfer->Status == BSP_ERROR_NONE) ? 0 : -1);
 }
 
 /**
  * @brief  Writes data from local buffer to SPI.
+ *         The exchange runs on SPI2 interrupts and DMA: the events read in
+ *         the meantime are still queued to the HCI layer.
  *
- * @param  buffer : data buffer to be written
+ * @param  buffer : data buffer to be written, it must stay valid until return
  * @param  size   : size of first data buffer to be written
- * @retval int32_t: Number of read bytes
+ * @retval int32_t: 0 when written, -2 if the BlueNRG-2 has no room for it,
+ *                  -3 on timeout, -1 on bus error
  */
 int32_t HCI_TL_SPI_Send(uint8_t* buffer, uint16_t size)
 {  
@@ -240,72 +442,60 @@ int32_t HCI_TL_SPI_Send(uint8_t* buffer, uint16_t size)
   PRINT_CSV("\n");
 #endif
 
-  int32_t result;
-  uint16_t rx_bytes;
-
-  uint8_t header_master[HEADER_SIZE] = {0x0a, 0x00, 0x00, 0x00, 0x00};
-  uint8_t header_slave[HEADER_SIZE];
+  uint32_t primask;
 
-  static uint8_t read_char_buf[MAX_BUFFER_SIZE];
-  uint32_t tickstart = HAL_GetTick();
+  primask = __get_PRIMASK();
+  __disable_irq();
 
-  HCI_TL_SPI_Disable_IRQ();
+  pTxBuff = buffer;
+  TxSize = size;
+  TxResult = TX_BUSY;
+  TxTickstart = HAL_GetTick();
 
-  do
+  if (SpiState == HCI_TL_SPI_IDLE)
   {
-    uint32_t tickstart_data_available = HAL_GetTick();
-
-    result = 0;
+    TX_Start();
+  }
+  else
+  {
+    /* Started at the end of the current read */
+    TxPending = 1;
+  }
 
-    /* CS reset */
-    HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_RESET);
+  __set_PRIMASK(primask);
 
-    /*
-     * Wait until BlueNRG-2 is ready.
-     * When ready it will raise the IRQ pin.
-     */
-    while(!IsDataAvailable())
+  while (TxResult == TX_BUSY)
+  {
+    if ((HAL_GetTick() - TxTickstart) > TIMEOUT_DURATION)
     {
-      if((HAL_GetTick() - tickstart_data_available) > TIMEOUT_DURATION)
+      primask = __get_PRIMASK();
+      __disable_irq();
+
+      if ((TxPending != 0U) || (SpiState == HCI_TL_SPI_TX_WAIT))
       {
-        result = -3;
-        break;
+        /* The BlueNRG-2 never got ready: give up without touching the bus */
+        TxPending = 0;
+        if (SpiState == HCI_TL_SPI_TX_WAIT)
+        {
+          TX_End(-3);
+        }
+        else
+        {
+          TxResult = -3;
+        }
       }
-    }
-    if(result == -3)
-    {
-      break;
-    }
-
-    /* Read header */
-    BSP_SPI2_SendRecv(header_master, header_slave, HEADER_SIZE);
-
-    rx_bytes = (((uint16_t)header_slave[2])<<8) | ((uint16_t)header_slave[1]);
-
-    if(rx_bytes >= size)
-    {
-      /* Buffer is big enough */
-      BSP_SPI2_SendRecv(buffer, read_char_buf, size);
-    }
-    else
-    {
-      /* Buffer is too small */
-      result = -2;
-    }
 
-    /* Release CS line */
-    HAL_GPIO_WritePin(HCI_TL_SPI_CS_PORT, HCI_TL_SPI_CS_PIN, GPIO_PIN_SET);
+      __set_PRIMASK(primask);
 
-    if((HAL_GetTick() - tickstart) > TIMEOUT_DURATION)
-    {
-      result = -3;
-      break;
+      if (TxResult == TX_BUSY)
+      {
+        /* A transfer is stuck on the bus: the abort ends the exchange */
+        (void)BSP_BUS_Wait(BSP_BUS_SPI2, &SpiXfer, TIMEOUT_DURATION);
+      }
     }
-  } while(result < 0);
-
-  HCI_TL_SPI_Enable_IRQ();
+  }
 
-  return result;
+  return TxResult;
 }
 
 #ifdef HCI_TL
@@ -340,7 +530,8 @@ void hci_tl_lowlevel_init(void)
   fops.Init    = HCI_TL_SPI_Init;
   fops.DeInit  = HCI_TL_SPI_DeInit;
   fops.Send    = HCI_TL_SPI_Send;
-  fops.Receive = HCI_TL_SPI_Receive;
+  /* The events are read in the background, see hci_tl_lowlevel_kick() */
+  fops.Receive = NULL;
   fops.Reset   = HCI_TL_SPI_Reset;
   fops.GetTick = BSP_GetTick;
   
@@ -362,21 +553,61 @@ void hci_tl_lowlevel_init(void)
 }
 
 /**
-  * @brief HCI Transport Layer Low Level Interrupt Service Routine
+  * @brief  Start the next SPI exchange if the transport is free: the pending
+  *         command first, then the events signalled by the IRQ line.
+  *         Called from the IRQ line interrupt, at the end of each exchange and
+  *         when a HCI packet is released after the pool ran out
   *
   * @param  None
   * @retval None
   */
-void hci_tl_lowlevel_isr(void)
+void hci_tl_lowlevel_kick(void)
 {
-  /* Call hci_notify_asynch_evt() */
 #ifdef HCI_TL
-  while(IsDataAvailable())
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  switch (SpiState)
   {
-    if(hci_notify_asynch_evt(NULL)) {
-      return;
-    }
+    case HCI_TL_SPI_IDLE:
+      if (TxPending != 0U)
+      {
+        TX_Start();
+      }
+      else if (IsDataAvailable())
+      {
+        RX_Start();
+      }
+      break;
+
+    case HCI_TL_SPI_TX_WAIT:
+      if (IsDataAvailable())
+      {
+        TX_Header();
+      }
+      break;
+
+    default:
+      /* The end of the running exchange kicks again */
+      break;
   }
+
+  __set_PRIMASK(primask);
+#endif /* HCI_TL */
+}
+
+/**
+  * @brief HCI Transport Layer Low Level Interrupt Service Routine
+  *
+  * @param  None
+  * @retval None
+  */
+void hci_tl_lowlevel_isr(void)
+{
+  /* The transfers run on their own interrupts, the IRQ line only kicks them */
+#ifdef HCI_TL
+  hci_tl_lowlevel_kick();
 #endif /* HCI_TL */
 
   /* USER CODE BEGIN hci_tl_lowlevel_isr */
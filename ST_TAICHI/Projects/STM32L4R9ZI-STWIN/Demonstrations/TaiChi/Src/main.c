@@ -37,6 +37,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <limits.h>
@@ -46,6 +47,13 @@
 #include "sensor_service.h"
 #include "config.h"
 #include "uuid_ble_service.h"
+#include "TaiChiRing.h"
+#include "TaiChiJournal.h"
+#include "MLCLoader.h"
+#include "Scheduler.h"
+#include "ImuCapture.h"
+#include "BleLink.h"
+#include "BleNotify.h"
 
 /** @addtogroup Projects
   * @{
@@ -72,6 +80,24 @@
 /* Private define ------------------------------------------------------------*/
 #define CHECK_VIBRATION_PARAM ((uint16_t)0x1234)
 
+/* Min duration of one TaiChi gesture for keeping it [ms] */
+#define TAICHI_MIN_DURATION_MS 1000U
+
+/* Decision trees of the MLC, each one feeds its own gesture stream */
+#define TAICHI_MLC_TREES 8U
+
+/* Gesture type: decision tree in the high byte, tree output in the low byte
+ * (tree 0 keeps the plain output value used by the App) */
+#define TAICHI_TYPE(Tree,Result) ((uint16_t)(((uint16_t)(Tree)<<8) | (Result)))
+
+/* Delay before sending again the TaiChi items of a failed notification [ms] */
+#define TAICHI_RETRY_MS 100U
+
+#ifdef PREDMNT1_DEBUG_TAICHI_DUMP
+/* Bytes of each line of the TaiChi notification dump, PREDMNT1_PRINTF formats up to 256 chars */
+#define TAICHI_DUMP_LINE_LEN 32U
+#endif /* PREDMNT1_DEBUG_TAICHI_DUMP */
+
 
 /**
   * @}
@@ -152,7 +178,14 @@ uint8_t bdaddr[6];
 uint32_t uhCCR4_Val = DEFAULT_uhCCR4_Val;
 
 uint8_t  NodeName[8];
+#ifdef MOTIONSP_USE_ENVELOPE
+uint16_t VibrationParam[14];
+#else /* MOTIONSP_USE_ENVELOPE */
 uint16_t VibrationParam[11];
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+/* TaiChi gestures waiting to be written in the flash journal */
+taiChiRing_t TaiChiResultRing;
 
 /**
   * @}
@@ -170,32 +203,35 @@ MDM_knownGMD_t known_MetaData[]={
   {GMD_END    ,0}/* THIS MUST BE THE LAST ONE */
 };
 
-static volatile uint32_t ButtonPressed=         0;
-static volatile uint32_t HCI_ProcessEvent=      0;
-static volatile uint32_t SendEnv=               0;
-static volatile uint32_t SendAudioLevel=        0;
-static volatile uint32_t SendAccGyroMag=        0;
-static volatile uint32_t SendBatteryInfo=       0;
 static volatile uint32_t t_stwin=               0;
-static volatile uint32_t TriggerMotionMLInt=			0;
-static volatile uint32_t printData=				0;
 static volatile uint32_t beaconUpdateTimer=		0;
-
-
-typedef struct {
-	uint16_t type;
-	uint32_t start;
-	uint32_t end;
-}taiChiResult_t;
-
-
-
-volatile taiChiResult_t* BufftaiChiResult[BUFF_TAICHIRESULT_SIZE];
-volatile uint8_t taiChiResultPos = 0;
-
-
-
-
+/* HAL tick of the next LED toggle while not connected */
+static uint32_t LedBlinkTick;
+
+
+/* Gesture in progress for each decision tree, owned by the MLC producer until it is finished */
+static taiChiResult_t TaiChiCurrent[TAICHI_MLC_TREES];
+/* Decision trees with a gesture in progress (bit n for tree n) */
+static uint8_t TaiChiActiveTrees;
+/* Journal items of each TaiChi notification waiting for the BlueNRG-2 answer, oldest first */
+static uint16_t TaiChiInFlight[BLE_NOTIFY_RELIABLE_NUM];
+/* TaiChi notifications waiting for the BlueNRG-2 answer */
+static uint8_t TaiChiInFlightNum;
+/* Set after a failed TaiChi notification: SCHED_EVT_TAICHI is posted again at TaiChiRetryTick */
+static uint8_t TaiChiRetry;
+static uint32_t TaiChiRetryTick;
+
+/* Acc/Gyro/Mag registers read on the sensor buses without blocking the main loop */
+static BSP_BUS_Xfer_t MotionXferAccGyro;
+static BSP_BUS_Xfer_t MotionXferMag;
+/* ISM330DHCX OUTX_L_G..OUTZ_H_A (gyro then acc) and IIS2MDC OUTX_L..OUTZ_H */
+static uint8_t MotionRawAccGyro[12];
+static uint8_t MotionRawMag[6];
+/* Bus reads still in flight for the current Acc/Gyro/Mag sample */
+static volatile uint32_t MotionXferPending;
+static float MotionSensAcc;
+static float MotionSensGyro;
+static float MotionSensMag;
 
 /* CRC handler declaration */
 static CRC_HandleTypeDef hcrc;
@@ -228,9 +264,13 @@ static unsigned char ReCallVibrationParamFromMemory(void);
 
 static void SendEnvironmentalData(void);
 static void SendMotionData(void);
+static void SendMotionDataRead(void);
+static void MotionXferCallback(BSP_BUS_Xfer_t *Xfer);
+static void MotionRawToAxes(const uint8_t *pRaw, float Sensitivity, MOTION_SENSOR_Axes_t *Axes, int32_t Status);
 static void SendAudioLevelData(void);
 static void SendBatteryInfoData(void);
 static void SendTaiChiData(void);
+static void TaiChiUpdateDone(tBleStatus Status);
 
 static void ButtonCallback(void);
 static void AudioProcess(void);
@@ -238,6 +278,11 @@ static void AudioProcess_DB_Noise(void);
 
 static void beaconUpdate(void);
 
+static void InitScheduler(void);
+static void StartMotionML(void);
+static void LoadMotionMLProgram(void);
+static void IdleProcess(void);
+
 void APP_UserEvtRx(void *pData);
 
 /**
@@ -264,16 +309,19 @@ static void _MotionMLIntSet(int status,ism330dhcx_pin_int2_route_t* intRoute){
 
 
 
+		// Route every decision tree, the ones not used by the UCF never fire
 		intRoute->mlc_int2.int2_mlc1 = status;
-
-
-
-
-
+		intRoute->mlc_int2.int2_mlc2 = status;
+		intRoute->mlc_int2.int2_mlc3 = status;
+		intRoute->mlc_int2.int2_mlc4 = status;
+		intRoute->mlc_int2.int2_mlc5 = status;
+		intRoute->mlc_int2.int2_mlc6 = status;
+		intRoute->mlc_int2.int2_mlc7 = status;
+		intRoute->mlc_int2.int2_mlc8 = status;
 
 		if (!ism330dhcx_pin_int2_route_set(ctx,intRoute) &&
 			!ism330dhcx_int_notification_set(ctx, ISM330DHCX_BASE_PULSED_EMB_LATCHED)){
-			PREDMNT1_PRINTF("Enabled MLC1 interrupt\r\n");
+			PREDMNT1_LOG("%s MLC interrupts\r\n",(uint32_t)(status?"Enabled":"Disabled"));
 		}
 
 }
@@ -313,12 +361,30 @@ static void InitMotionML(void){
 
 
 	int n = sizeof(taichi)/sizeof(taichi[0]);
+	stmdev_ctx_t* ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
 
-	// Load config data for ML engine
-	for(int i=0;i<n;i++){
+	TaiChiRing_Init(&TaiChiResultRing);
+	memset(TaiChiCurrent,0,sizeof(TaiChiCurrent));
+	TaiChiActiveTrees = 0;
 
-		ISM330DHCX_Write_Reg( MotionCompObj[ISM330DHCX_0], taichi[i].address , taichi[i].data );
-	}
+	// Restore the gestures not sent before the reset
+	TaiChiJournal_Init(&hcrc);
+	PREDMNT1_PRINTF("TaiChi journal: %ld gestures to send\r\n",TaiChiJournal_Count());
+
+	// Load config data for ML engine, programs received over BLE replace it at runtime
+	MLCLoader_Init(&hcrc);
+	MLCLoader_WriteTable(ctx, taichi, n);
+
+	StartMotionML();
+}
+
+/** @brief Set the sensor for running the MLC program just loaded
+  * @param None
+  * @retval None
+  */
+static void StartMotionML(void){
+
+	stmdev_ctx_t* ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
 
 	ISM330DHCX_ACC_Disable(MotionCompObj[ISM330DHCX_0]);
 	ISM330DHCX_GYRO_Disable(MotionCompObj[ISM330DHCX_0]);
@@ -329,6 +395,10 @@ static void InitMotionML(void){
 	ISM330DHCX_ACC_Enable(MotionCompObj[ISM330DHCX_0]);
 		ISM330DHCX_GYRO_Enable(MotionCompObj[ISM330DHCX_0]);
 
+	uint8_t enabled;
+
+	if (ism330dhcx_mlc_get(ctx,&enabled) || !enabled)
+		PREDMNT1_PRINTF("MLC not enable\r\n");
 
 	// Set MotionML Interrupt
 	MotionMLIntSet(1);
@@ -338,178 +408,110 @@ static void InitMotionML(void){
 
 }
 
-/** @brief Get and prepare data from MotionML
-  * @param None
+/** @brief Update the gesture stream of one decision tree
+  * @param uint8_t Tree decision tree [0..TAICHI_MLC_TREES-1]
+  * @param uint8_t Result new output of the decision tree
+  * @param uint32_t Current timestamp of the MLC interrupt [ms]
   * @retval None
   */
-static void getMotionMLData(void){
+static void TaiChiStreamUpdate(uint8_t Tree, uint8_t Result, uint32_t Current){
 
+	taiChiResult_t *Gesture = &TaiChiCurrent[Tree];
+	uint16_t Type = TAICHI_TYPE(Tree,Result);
 
+	if (Gesture->type){
+		// Same gesture still going on
+		if (Result && Gesture->type == Type)
+			return;
 
-	ism330dhcx_mlc_status_mainpage_t status;
-	uint8_t result;
-
-
-
-	stmdev_ctx_t* ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
+		// close the gesture in progress and publish it if long enough
+		Gesture->end = Current;
 
+		if (Gesture->end-Gesture->start>=TAICHI_MIN_DURATION_MS){
+			if (TaiChiRing_Push(&TaiChiResultRing,Gesture))
+				Sched_Post(SCHED_EVT_TAICHI);
+			else
+				PREDMNT1_LOG("MLC: buffer full, dropped %ld\r\n",TaiChiResultRing.Dropped);
+		}
 
-	ism330dhcx_mlc_get(ctx,&result);
-
-	if (!result){
-		PREDMNT1_PRINTF("MLC not enable\r\n");
-		return;
+		Gesture->type = 0;
+		TaiChiActiveTrees &= ~(1U<<Tree);
 	}
 
+	if (!Result)
+		return;
 
+	Gesture->type = Type;
+	Gesture->start = Current;
+	Gesture->end = Current;
+	TaiChiActiveTrees |= (1U<<Tree);
 
-	ism330dhcx_mlc_status_get(ctx,&status);
-
-
-
-	if (status.is_mlc1){
-
-
-
-
-		int32_t ret = ism330dhcx_mem_bank_set(ctx, ISM330DHCX_EMBEDDED_FUNC_BANK);
-		  if (ret == 0) {
-			  if (ISM330DHCX_OK == ISM330DHCX_Read_Reg(MotionCompObj[ISM330DHCX_0],ISM330DHCX_MLC0_SRC,&result)){
-
-
-
-			  			uint32_t current = HAL_GetTick();
-
-
-			  			taiChiResult_t* last = BufftaiChiResult[taiChiResultPos];
-
-			  		//	PREDMNT1_PRINTF("MLC: 0x%02X\r\n",result);
-
-
-			  			if (last){
-			  				if (result==0 || last->type != result){
-			  						 //update last item second and inc pos
-
-			  						 last->end = current;
-
-			  						 if (last->end-last->start<1000){
-			  							 free(last);
-			  							BufftaiChiResult[taiChiResultPos] = NULL;
-
-			  						 }else{
-
-			  							 ++taiChiResultPos;
-			  						 }
-
-
-			  				}else{
-
-			  					goto end;
-			  				}
-
-
-
-			  			}
-
-			  			if (result==0)
-			  				goto end;
-
-
-			  			if (taiChiResultPos==BUFF_TAICHIRESULT_SIZE){
-
-
-			  				free(BufftaiChiResult[0]);
-
-			  				for (int i=1;i<BUFF_TAICHIRESULT_SIZE;i++)
-			  						 BufftaiChiResult[i-1]=BufftaiChiResult[i];
-
-			  						  		--taiChiResultPos;
-
-			  						  			}
+	PREDMNT1_LOG("MLC: %ld - 0x%04X\r\n",TaiChiRing_Count(&TaiChiResultRing),Gesture->type);
+}
 
-			  			taiChiResult_t* item = malloc(sizeof(taiChiResult_t));
+/** @brief Get and prepare data from MotionML
+  * @param None
+  * @retval None
+  */
+static void getMotionMLData(void){
 
+	ism330dhcx_mlc_status_mainpage_t status;
+	uint8_t changed;
+	uint8_t src[TAICHI_MLC_TREES];
 
-			  			item->type = result;
-			  			item->start = current;
+	stmdev_ctx_t* ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
 
+	// Trees whose output changed, reading it clears the latched interrupt
+	if (ism330dhcx_mlc_status_get(ctx,&status))
+		return;
 
-			  			PREDMNT1_PRINTF("MLC: %d - 0x%02X\r\n",taiChiResultPos,item->type);
+	memcpy(&changed,&status,1);
+	if (!changed)
+		return;
 
-			  			BufftaiChiResult[taiChiResultPos] = item;
+	// All the decision tree outputs (MLC0_SRC..MLC7_SRC) in one embedded bank burst
+	if (ism330dhcx_mem_bank_set(ctx, ISM330DHCX_EMBEDDED_FUNC_BANK))
+		return;
 
-			  }
-		  }
-		  end:
-		  if (ret == 0) {
-		    ret = ism330dhcx_mem_bank_set(ctx, ISM330DHCX_USER_BANK);
+	int32_t ret = ism330dhcx_read_reg(ctx, ISM330DHCX_MLC0_SRC, src, TAICHI_MLC_TREES);
 
+	ism330dhcx_mem_bank_set(ctx, ISM330DHCX_USER_BANK);
 
-		}
+	if (ret)
+		return;
 
+	// Same timestamp for all the trees of this interrupt
+	uint32_t current = HAL_GetTick();
 
-	}else if (status.is_mlc2){
-		PREDMNT1_PRINTF("mlc2\r\n");
-	}else if (status.is_mlc3){
-		PREDMNT1_PRINTF("mlc3\r\n");
-	}else if (status.is_mlc4){
-		PREDMNT1_PRINTF("mlc4\r\n");
-	}else if (status.is_mlc5){
-		PREDMNT1_PRINTF("mlc5\r\n");
-	}else if (status.is_mlc6){
-		PREDMNT1_PRINTF("mlc6\r\n");
-	}else if (status.is_mlc7){
-		PREDMNT1_PRINTF("mlc7\r\n");
-	}else if (status.is_mlc8){
-		PREDMNT1_PRINTF("mlc8\r\n");
+	for (uint8_t tree=0;tree<TAICHI_MLC_TREES;tree++){
+		if (changed & (1U<<tree))
+			TaiChiStreamUpdate(tree,src[tree],current);
 	}
-
-
-
-
-//	if (result)
-//		PREDMNT1_PRINTF("MLC: 0x%.2X\r\n",result);
-
 }
 
+/** @brief Replace the MLC program with the one received over BLE
+  * @param None
+  * @retval None
+  */
+static void LoadMotionMLProgram(void){
 
-static void MotionMLTrainingData(void){
-	 MOTION_SENSOR_Axes_t ACC_Value;
-	  MOTION_SENSOR_Axes_t GYR_Value;
-	  MOTION_SENSOR_Axes_t MAG_Value;
+	stmdev_ctx_t* ctx = &(((ISM330DHCX_Object_t *)MotionCompObj[ISM330DHCX_0])->Ctx);
+	uint32_t start = HAL_GetTick();
 
-	  /* Read the Acc values */
-	  if(TargetBoardFeatures.AccSensorIsInit)
-	  {
-	    MOTION_SENSOR_GetAxes(ACCELERO_INSTANCE, MOTION_ACCELERO, &ACC_Value);
-	  }
-	  else
-	  {
-	    ACC_Value.x = ACC_Value.y = ACC_Value.z =0;
-	  }
+	MotionMLIntSet(0);
+	ISM330DHCX_ACC_Disable(MotionCompObj[ISM330DHCX_0]);
+	ISM330DHCX_GYRO_Disable(MotionCompObj[ISM330DHCX_0]);
 
-	  /* Read the Magneto values */
-	  if(TargetBoardFeatures.MagSensorIsInit)
-	  {
-	    MOTION_SENSOR_GetAxes(MAGNETO_INSTANCE, MOTION_MAGNETO, &MAG_Value);
-	  }
-	  else
-	  {
-	    MAG_Value.x = MAG_Value.y = MAG_Value.z =0;
-	  }
+	// The gestures in progress belong to the previous program
+	memset(TaiChiCurrent,0,sizeof(TaiChiCurrent));
+	TaiChiActiveTrees = 0;
 
-	  /* Read the Gyro values */
-	  if(TargetBoardFeatures.GyroSensorIsInit)
-	  {
-	    MOTION_SENSOR_GetAxes(GYRO_INSTANCE,MOTION_GYRO, &GYR_Value);
-	  }
-	  else
-	  {
-	    GYR_Value.x = GYR_Value.y = GYR_Value.z =0;
-	  }
-
-	  PREDMNT1_PRINTF("%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\r\n",ACC_Value.x,ACC_Value.y,ACC_Value.z,GYR_Value.x,GYR_Value.y,GYR_Value.z,MAG_Value.x,MAG_Value.y,MAG_Value.z);
+	if (MLCLoader_Apply(ctx))
+		PREDMNT1_PRINTF("MLC: program load failed\r\n");
+	else
+		PREDMNT1_PRINTF("MLC: program loaded in %ld ms\r\n",HAL_GetTick()-start);
 
+	StartMotionML();
 }
 
 /**
@@ -603,6 +605,9 @@ int main(void)
   
   InitMotionML();
 
+  /* Events dispatched by the main loop */
+  InitScheduler();
+
 
   /* Infinite loop */
   while (1)
@@ -610,18 +615,25 @@ int main(void)
     /* Led Blinking when there is not a client connected */
     if(!connected)
     {
-      if(!TargetBoardFeatures.LedStatus) {
-        if(!(HAL_GetTick()&0x3FF)) {
+      /* Deadline instead of an exact tick: a loop pass can skip some ms */
+      if((int32_t)(HAL_GetTick() - LedBlinkTick) >= 0) {
+        if(!TargetBoardFeatures.LedStatus) {
           LedOnTargetPlatform();
-        }
-      } else {
-        if(!(HAL_GetTick()&0x3F)) {
+          LedBlinkTick = HAL_GetTick() + 64U;
+        } else {
           LedOffTargetPlatform();
+          LedBlinkTick = HAL_GetTick() + (1024U - 64U);
         }
       }
 
     }
 
+    /* TaiChi items of a failed notification: sent again after the retry delay */
+    if(TaiChiRetry && ((int32_t)(HAL_GetTick() - TaiChiRetryTick) >= 0)) {
+      TaiChiRetry = 0;
+      Sched_Post(SCHED_EVT_TAICHI);
+    }
+
 
 /*
  *
@@ -640,7 +652,7 @@ int main(void)
     if (!connected && HAL_GetTick()%100 < 50){
 
     	// Only broadcast iBeacon when Buff have data waiting to send
-     	if (!isBeacon && taiChiResultPos){
+     	if (!isBeacon && TaiChiJournal_Count()){
      		setBeacon();
      		isBeacon=TRUE;
      	}
@@ -668,12 +680,6 @@ int main(void)
 //
 //    }
 
-    /* Handle user button */
-    if(ButtonPressed) {
-      ButtonCallback();
-      ButtonPressed=0;       
-    }
-    
 //    if(PredictiveMaintenance){
 //      if (IsFirstTime)
 //      {
@@ -692,7 +698,7 @@ int main(void)
 //          MotionSP_TimeDomainAlarmInit(&sTdAlarm, &sTimeDomainVal, &sTdRmsThresholds, &sTdPkThresholds);
 //
 //          /* Frequency domain initialization of Alarm Status */
-//          MotionSP_FreqDomainAlarmInit(&FDWarnThresh, &FDAlarmThresh, &THR_Fft_Alarms, MotionSP_Parameters.subrange_num);
+//          MotionSP_FreqDomainAlarmInit(&FDWarnThresh, &FDAlarmThresh, &THR_Fft_Alarms, MotionSP_Ctx.Parameters.subrange_num);
 //        }
 //
 //        /* Configure the FIFO settings in according with others parammeters changed */
@@ -709,70 +715,19 @@ int main(void)
 //      MotionSP_VibrationAnalysis();
 //    }
 
-    /* handle BLE event */
-    if(HCI_ProcessEvent) {
-      HCI_ProcessEvent=0;
-      hci_user_evt_proc();
-    }
-
-    /* Environmental Data */
-    if(SendEnv) {
-      SendEnv=0;
-      SendEnvironmentalData();
-    }
-
-    /* Mic Data */
-    if (SendAudioLevel) {
-      SendAudioLevel = 0;
-      SendAudioLevelData();
-    }
-
-    /* Motion Data */
-    if(SendAccGyroMag) {
-      SendAccGyroMag=0;
-      SendMotionData();
-    }
-
-    /* Battery Info Data */
-    if(SendBatteryInfo){
-      SendBatteryInfo=0;
-      SendBatteryInfoData();
-    }
-    
-    if(TriggerMotionMLInt){
-    		getMotionMLData();
-        	TriggerMotionMLInt=0;
-    }
-
-
-
-
-//    if (printData && !(HAL_GetTick()%38)){
-//
-//
-//    	MotionMLTrainingData();
-//
-//    }
-
-
-
-
-
-    /* taichi Data*/
-
-
-    SendTaiChiData();
 
 
 
 
 
+    /* Failed notifications: reported here because it sends on the stderr characteristic */
+    BleNotify_ReportErrors();
 
+    /* Connection parameters following the notification backlog */
+    BleLink_Process();
 
-
-
-    /* Wait for Event */
-    //__WFI();
+    /* Dispatch the pending events by priority, Wait for Event if nothing to do */
+    Sched_Run();
   }
 }
 
@@ -800,52 +755,141 @@ static void ButtonCallback(void)
 {
   PREDMNT1_PRINTF("\r\nUser Button Pressed   \r\n\r\n");
 
-//  printData = !printData;
+#ifdef PREDMNT1_ENABLE_PRINTF
+  /* Raw Acc/Gyro/Mag capture over USB CDC */
+  if(ImuCapture_IsRunning()) {
+    ImuCapture_Stop();
+    PREDMNT1_PRINTF("IMU capture stopped (%ld frames dropped)\r\n",ImuCapture_Dropped());
+  } else {
+    PREDMNT1_PRINTF("IMU capture started\r\n");
+    ImuCapture_Start();
+  }
+#endif /* PREDMNT1_ENABLE_PRINTF */
+
 //  SendMotionML = !SendMotionML;
 }
 
 
 /**
-  * @brief  Send Motion Data Acc/Mag/Gyro to BLE
+  * @brief  Start the Acc/Gyro/Mag reads for the next Motion Data sample
+  *         The registers are fetched by the bus layer (SPI3 and I2C2 in parallel),
+  *         SendMotionDataRead sends them to BLE once both reads are completed
   * @param  None
   * @retval None
   */
 static void SendMotionData(void)
 {
-  MOTION_SENSOR_Axes_t ACC_Value;
-  MOTION_SENSOR_Axes_t GYR_Value;
-  MOTION_SENSOR_Axes_t MAG_Value;
+  /* Previous sample still on the buses: skip this timer tick */
+  if(MotionXferPending != 0U)
+  {
+    return;
+  }
 
-  /* Read the Acc values */
+  MotionSensAcc = MotionSensGyro = MotionSensMag = 0.0f;
   if(TargetBoardFeatures.AccSensorIsInit)
   {
-    MOTION_SENSOR_GetAxes(ACCELERO_INSTANCE, MOTION_ACCELERO, &ACC_Value);
+    MOTION_SENSOR_GetSensitivity(ACCELERO_INSTANCE, MOTION_ACCELERO, &MotionSensAcc);
   }
-  else
+  if(TargetBoardFeatures.GyroSensorIsInit)
   {
-    ACC_Value.x = ACC_Value.y = ACC_Value.z =0;
+    MOTION_SENSOR_GetSensitivity(GYRO_INSTANCE, MOTION_GYRO, &MotionSensGyro);
   }
-
-  /* Read the Magneto values */
   if(TargetBoardFeatures.MagSensorIsInit)
   {
-    MOTION_SENSOR_GetAxes(MAGNETO_INSTANCE, MOTION_MAGNETO, &MAG_Value);
+    MOTION_SENSOR_GetSensitivity(MAGNETO_INSTANCE, MOTION_MAGNETO, &MotionSensMag);
   }
-  else
+
+  /* Both reads are accounted before the first one can complete */
+  MotionXferPending = 2U;
+
+  /* ISM330DHCX gyro and acc output registers in one SPI3 burst */
+  memset(&MotionXferAccGyro, 0, sizeof(MotionXferAccGyro));
+  MotionXferAccGyro.Type     = BSP_BUS_XFER_READ;
+  MotionXferAccGyro.Reg      = ISM330DHCX_OUTX_L_G | 0x80U;
+  MotionXferAccGyro.RegLen   = 1U;
+  MotionXferAccGyro.CsPort   = BSP_ISM330DHCX_CS_PORT;
+  MotionXferAccGyro.CsPin    = BSP_ISM330DHCX_CS_PIN;
+  MotionXferAccGyro.pRxData  = MotionRawAccGyro;
+  MotionXferAccGyro.Len      = sizeof(MotionRawAccGyro);
+  MotionXferAccGyro.Callback = MotionXferCallback;
+  if(BSP_BUS_Submit(BSP_BUS_SPI3, &MotionXferAccGyro) != BSP_ERROR_NONE)
   {
-    MAG_Value.x = MAG_Value.y = MAG_Value.z =0;
+    MotionXferAccGyro.Status = BSP_ERROR_PERIPH_FAILURE;
+    MotionXferCallback(&MotionXferAccGyro);
   }
-  
-  /* Read the Gyro values */
-  if(TargetBoardFeatures.GyroSensorIsInit)
+
+  /* IIS2MDC output registers on I2C2 */
+  memset(&MotionXferMag, 0, sizeof(MotionXferMag));
+  MotionXferMag.Type     = BSP_BUS_XFER_READ;
+  MotionXferMag.DevAddr  = IIS2MDC_I2C_ADD;
+  MotionXferMag.Reg      = IIS2MDC_OUTX_L_REG;
+  MotionXferMag.RegLen   = 1U;
+  MotionXferMag.pRxData  = MotionRawMag;
+  MotionXferMag.Len      = sizeof(MotionRawMag);
+  MotionXferMag.Callback = MotionXferCallback;
+  if(BSP_BUS_Submit(BSP_BUS_I2C2, &MotionXferMag) != BSP_ERROR_NONE)
   {
-    MOTION_SENSOR_GetAxes(GYRO_INSTANCE,MOTION_GYRO, &GYR_Value);
+    MotionXferMag.Status = BSP_ERROR_PERIPH_FAILURE;
+    MotionXferCallback(&MotionXferMag);
   }
-  else
+}
+
+/**
+  * @brief  Bus completion of one of the Motion Data reads (interrupt context)
+  * @param  Xfer Completed transaction
+  * @retval None
+  */
+static void MotionXferCallback(BSP_BUS_Xfer_t *Xfer)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  (void)Xfer;
+
+  __disable_irq();
+  MotionXferPending--;
+  if(MotionXferPending == 0U)
   {
-    GYR_Value.x = GYR_Value.y = GYR_Value.z =0;
+    Sched_Post(SCHED_EVT_ACC_GYRO_MAG_READ);
   }
-  
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Convert 3 little endian raw axes with the given sensitivity
+  * @param  pRaw Raw output registers (X, Y, Z)
+  * @param  Sensitivity Sensor sensitivity (0 if the sensor is not available)
+  * @param  Axes Converted values
+  * @param  Status Bus transaction status
+  * @retval None
+  */
+static void MotionRawToAxes(const uint8_t *pRaw, float Sensitivity, MOTION_SENSOR_Axes_t *Axes, int32_t Status)
+{
+  if((Status != BSP_ERROR_NONE) || (Sensitivity == 0.0f))
+  {
+    Axes->x = Axes->y = Axes->z = 0;
+    return;
+  }
+
+  Axes->x = (int32_t)((float)(int16_t)((uint16_t)pRaw[1] << 8 | pRaw[0]) * Sensitivity);
+  Axes->y = (int32_t)((float)(int16_t)((uint16_t)pRaw[3] << 8 | pRaw[2]) * Sensitivity);
+  Axes->z = (int32_t)((float)(int16_t)((uint16_t)pRaw[5] << 8 | pRaw[4]) * Sensitivity);
+}
+
+/**
+  * @brief  Send Motion Data Acc/Mag/Gyro to BLE once the bus reads are completed
+  * @param  None
+  * @retval None
+  */
+static void SendMotionDataRead(void)
+{
+  MOTION_SENSOR_Axes_t ACC_Value;
+  MOTION_SENSOR_Axes_t GYR_Value;
+  MOTION_SENSOR_Axes_t MAG_Value;
+
+  MotionRawToAxes(&MotionRawAccGyro[6], MotionSensAcc,  &ACC_Value, MotionXferAccGyro.Status);
+  MotionRawToAxes(&MotionRawAccGyro[0], MotionSensGyro, &GYR_Value, MotionXferAccGyro.Status);
+  MotionRawToAxes(MotionRawMag,         MotionSensMag,  &MAG_Value, MotionXferMag.Status);
+
   AccGyroMag_Update(&ACC_Value,&GYR_Value,&MAG_Value);
 }
 
@@ -1233,135 +1277,101 @@ void TaiChiEnableHW(void){
 
 /**
   * @brief  Send TaiChi Data to BLE
+  *         The journal backlog is packed in notifications as big as the ATT MTU allows,
+  *         up to BLE_NOTIFY_RELIABLE_NUM of them wait for the BlueNRG-2 answer
   * @param  None
   * @retval None
   */
 static void SendTaiChiData(void)
 {
+  uint8_t buff[W2ST_TAICHI_HEADER_LEN+W2ST_TAICHI_MAX_BUFF_LEN*W2ST_TAICHI_ITEM_LEN];
+  taiChiResult_t item;
+  uint32_t pending;
+  uint32_t sent = 0;
+  uint32_t timestamp;
+  uint16_t max_items;
+  uint16_t num_send;
+  uint16_t i;
+  uint8_t len;
+  uint8_t n;
+#ifdef PREDMNT1_DEBUG_TAICHI_DUMP
+  char hex[TAICHI_DUMP_LINE_LEN*3+1];
+#endif /* PREDMNT1_DEBUG_TAICHI_DUMP */
+
+  // Move the new gestures in the flash journal, they are kept there until sent
+  while (TaiChiRing_Count(&TaiChiResultRing)){
+	  if (!TaiChiJournal_Append(TaiChiRing_Peek(&TaiChiResultRing,0))){
+		  PREDMNT1_PRINTF("TaiChi journal: flash error\r\n");
+		  break;
+	  }
+	  TaiChiRing_Release(&TaiChiResultRing,1);
+  }
 
-  /* Check have data waiting to send*/
-	if (!taiChiResultPos){
-
-
-	    if (W2ST_CHECK_CONNECTION(W2ST_CONNECT_TAICHI) && !taiChiResultPos && BufftaiChiResult[0]==NULL){
-
-	    	// Entry to Sleep mode for Power Save when no activity
-#ifdef PREDMNT1_ENABLE_PRINTF
-
-
-
-	    	  PREDMNT1_PRINTF("Enter Sleep mode\r\n");
-
-
-
-
-#endif
-
-
-
-	    	 HAL_SuspendTick();
-	    //	 TaiChiDisableHW();
-	    	 HAL_PWREx_EnableLowPowerRunMode();
-	    	//HAL_PWR_EnterSTOPMode(PWR_MAINREGULATOR_ON,PWR_STOPENTRY_WFI);
-	    	 HAL_PWR_EnterSLEEPMode(PWR_LOWPOWERREGULATOR_ON,PWR_SLEEPENTRY_WFI);
-	     	 HAL_PWREx_DisableLowPowerRunMode();
-	    //	 TaiChiEnableHW();
-	    	 HAL_ResumeTick();
-
-
-
-
-
-
-	     }
-
+  /* TaiChiUpdateDone posts the event again once a notification has been answered,
+     the main loop after the retry delay of a failed one */
+  if (!W2ST_CHECK_CONNECTION(W2ST_CONNECT_TAICHI))
+    return;
 
+  pending = TaiChiJournal_Count();
+  for (n = 0; n < TaiChiInFlightNum; n++)
+    sent += TaiChiInFlight[n];
 
-			  return;
-	}
+  // num of items fitting in one notification with the negotiated ATT MTU
+  max_items = TaiChi_MaxItemsPerUpdate();
 
+  timestamp = HAL_GetTick();
 
-  if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_TAICHI)) {
+  // The journal items after the ones on the air, released in order by TaiChiUpdateDone
+  while ((pending > sent) && (TaiChiInFlightNum < BLE_NOTIFY_RELIABLE_NUM)){
 
-	  uint8_t buff[4+W2ST_TAICHI_MAX_BUFF_LEN*6];
+	  num_send = ((pending-sent)>max_items) ? max_items : (uint16_t)(pending-sent);
+	  len = W2ST_TAICHI_HEADER_LEN+num_send*W2ST_TAICHI_ITEM_LEN;
 
-	  uint32_t timestamp = HAL_GetTick();
 	  STORE_LE_16(buff,timestamp>>3);
-
-
-	  // num of items have been send in this event, max 4
-
-	  uint16_t num_send = taiChiResultPos>4?4:taiChiResultPos;
-
-
-
 	  STORE_LE_16(buff+2,num_send);
 
-	  int i=0;
-
-	 for(;i<num_send;i++){
-
-
-		  STORE_LE_16(buff+4+i*6,BufftaiChiResult[i]->type);
-
-		  // Start and End time are the seconds before current timestamp
-		  uint16_t start = (timestamp-BufftaiChiResult[i]->start)/1000;
-		  uint16_t end = (timestamp-BufftaiChiResult[i]->end)/1000;
-
-
-		  STORE_LE_16(buff+6+i*6,start);
-		  STORE_LE_16(buff+8+i*6,end);
-
-
-
-		  free(BufftaiChiResult[i]);
-
+	  for(i=0;i<num_send;i++){
 
+		  uint8_t *rec = buff+W2ST_TAICHI_HEADER_LEN+i*W2ST_TAICHI_ITEM_LEN;
 
+		  TaiChiJournal_Read(sent+i,&item);
 
+		  // Start and End time are delta encoded as the seconds before the notification timestamp
+		  STORE_LE_16(rec  ,item.type);
+		  STORE_LE_16(rec+2,(timestamp-item.start)/1000);
+		  STORE_LE_16(rec+4,(timestamp-item.end)/1000);
 	  }
 
-
-	  do
-		  if(i<taiChiResultPos)
-			  BufftaiChiResult[i-num_send]=BufftaiChiResult[i];
-		  else
-			  BufftaiChiResult[i-num_send]=NULL;
-	  while(++i<BUFF_TAICHIRESULT_SIZE);
-
-	  taiChiResultPos -= num_send;
-
-
-	  i=0;
-
-	  PREDMNT1_PRINTF("Send Hex:\r\n");
-
-	  do {
-	 	 PREDMNT1_PRINTF("%02X ",buff[i++])
+#ifdef PREDMNT1_DEBUG_TAICHI_DUMP
+	  // Main loop context: printed here instead of filling the deferred log ring, one line for each TAICHI_DUMP_LINE_LEN bytes
+	  for(i=0;i<len;i++){
+		  sprintf(hex+3*(i%TAICHI_DUMP_LINE_LEN),"%02X ",buff[i]);
+		  if(((i%TAICHI_DUMP_LINE_LEN)==(TAICHI_DUMP_LINE_LEN-1)) || (i==(len-1)))
+			  PREDMNT1_PRINTF("%s %s\r\n",(i<TAICHI_DUMP_LINE_LEN) ? "Send Hex:" : "         ",hex);
 	  }
-	  while(++i<(4+W2ST_TAICHI_MAX_BUFF_LEN*6));
-
-	  PREDMNT1_PRINTF("\r\n");
-
-
-	  TaiChi_Update(buff);
-
-
-
-
-    
+#endif /* PREDMNT1_DEBUG_TAICHI_DUMP */
+
+	  // The items stay in the journal until the notification has been accepted
+	  TaiChiInFlight[TaiChiInFlightNum++] = num_send;
+	  if (TaiChi_Update(buff,len,TaiChiUpdateDone)!=BLE_STATUS_SUCCESS){
+		  TaiChiInFlightNum--;
+		  // Reliable queue full: with nothing of ours on the air no answer would post the event again
+		  if (!TaiChiInFlightNum){
+			  TaiChiRetryTick = HAL_GetTick()+TAICHI_RETRY_MS;
+			  TaiChiRetry = 1;
+		  }
+		  break;
+	  }
+	  sent += num_send;
 
 #ifdef PREDMNT1_DEBUG_NOTIFY_TRAMISSION
-     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_TERM)) {
-       BytesToWrite = sprintf((char *)BufferToWrite,"send taichi data");
-       Term_Update(BufferToWrite,BytesToWrite);
-     } else {
-       PREDMNT1_PRINTF("send taichi data\r\n");
-     }
+	  if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_TERM)) {
+		  BytesToWrite = sprintf((char *)BufferToWrite,"send taichi data");
+		  Term_Update(BufferToWrite,BytesToWrite);
+	  } else {
+		  PREDMNT1_LOG("send taichi data\r\n");
+	  }
 #endif /* PREDMNT1_DEBUG_NOTIFY_TRAMISSION */
-
-
-
   }
 
 //#ifdef PREDMNT1_DEBUG_NOTIFY_TRAMISSION
@@ -1375,6 +1385,97 @@ static void SendTaiChiData(void)
 }
 
 
+/**
+  * @brief  Answer to the oldest TaiChi notification
+  *         A notification refused for lack of TX buffers is retried by BleNotify.
+  *         The ones queued behind a failed one (or dropped at the disconnection) are
+  *         dropped before going on the air: all their items stay in the journal and
+  *         they are sent again, in order, after TAICHI_RETRY_MS
+  * @param  Status Status of the characteristic update
+  * @retval None
+  */
+static void TaiChiUpdateDone(tBleStatus Status)
+{
+  uint16_t Items = TaiChiInFlight[0];
+  uint8_t n;
+
+  TaiChiInFlightNum--;
+  for(n = 0; n < TaiChiInFlightNum; n++)
+    TaiChiInFlight[n] = TaiChiInFlight[n+1];
+
+  if(Status != BLE_STATUS_SUCCESS) {
+    // BleNotify sends one update at a time: none of the next ones is on the air yet
+    BleNotify_DropReliable(TaiChiUpdateDone);
+    TaiChiInFlightNum = 0;
+    TaiChiRetryTick = HAL_GetTick()+TAICHI_RETRY_MS;
+    TaiChiRetry = 1;
+    return;
+  }
+
+  TaiChiJournal_Release(Items);
+
+  if(TaiChiJournal_Count())
+    Sched_Post(SCHED_EVT_TAICHI);
+}
+
+/**
+  * @brief  Attach the main loop handlers to the scheduler events
+  * @param  None
+  * @retval None
+  */
+static void InitScheduler(void)
+{
+  Sched_Init(IdleProcess);
+
+  Sched_Register(SCHED_EVT_HCI,          hci_user_evt_proc);
+  Sched_Register(SCHED_EVT_MOTION_ML,    getMotionMLData);
+  Sched_Register(SCHED_EVT_TAICHI,       SendTaiChiData);
+  Sched_Register(SCHED_EVT_MLC_PROGRAM,  LoadMotionMLProgram);
+  Sched_Register(SCHED_EVT_BUTTON,       ButtonCallback);
+  Sched_Register(SCHED_EVT_FFT_AMPLITUDE, MotionSP_FftAmplitudeResume);
+  Sched_Register(SCHED_EVT_ACC_GYRO_MAG_READ, SendMotionDataRead);
+  Sched_Register(SCHED_EVT_ACC_GYRO_MAG, SendMotionData);
+#ifdef PREDMNT1_ENABLE_PRINTF
+  Sched_Register(SCHED_EVT_IMU_CAPTURE,  ImuCapture_Process);
+#endif /* PREDMNT1_ENABLE_PRINTF */
+  Sched_Register(SCHED_EVT_AUDIO_LEVEL,  SendAudioLevelData);
+  Sched_Register(SCHED_EVT_ENV,          SendEnvironmentalData);
+  Sched_Register(SCHED_EVT_BATTERY_INFO, SendBatteryInfoData);
+}
+
+/**
+  * @brief  Low power entry when no event is pending.
+  *         Called by the scheduler with interrupts masked.
+  *         The LED blinking and the iBeacon switch are polled by the main loop
+  *         while not connected: there the SysTick keeps running and wakes up the
+  *         WFI every ms. It is suspended only when TaiChi is the only connected
+  *         feature and nothing is waiting, the next MLC or BLE interrupt wakes up
+  * @param  None
+  * @retval None
+  */
+static void IdleProcess(void)
+{
+  /* Only TaiChi is running and there is nothing to send: deep sleep until the next MLC or BLE interrupt */
+  if (W2ST_CHECK_CONNECTION(W2ST_CONNECT_TAICHI) && !TaiChiActiveTrees &&
+      !TaiChiRing_Count(&TaiChiResultRing) && !TaiChiJournal_Count() &&
+      BSP_BUS_IsIdle(BSP_BUS_I2C2) && BSP_BUS_IsIdle(BSP_BUS_SPI2) && BSP_BUS_IsIdle(BSP_BUS_SPI3)){
+
+    HAL_SuspendTick();
+#ifdef PREDMNT1_ENABLE_STOP2
+    HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+    /* Wake up from STOP2 on MSI, restore the PLL */
+    SystemClock_Config();
+#else /* PREDMNT1_ENABLE_STOP2 */
+    /* Low-power sleep needs SYSCLK <= 2 MHz: at 120 MHz keep the main regulator */
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON,PWR_SLEEPENTRY_WFI);
+#endif /* PREDMNT1_ENABLE_STOP2 */
+    HAL_ResumeTick();
+  } else {
+    /* Wait for Interrupt, SysTick wakes up the main loop every ms */
+    __WFI();
+  }
+}
+
 /**
   * @brief  CRC init function.
   * @param  None
@@ -1383,6 +1484,12 @@ static void SendTaiChiData(void)
 static void MX_CRC_Init(void)
 {
   hcrc.Instance = CRC;
+  hcrc.Init.DefaultPolynomialUse    = DEFAULT_POLYNOMIAL_ENABLE;
+  hcrc.Init.DefaultInitValueUse     = DEFAULT_INIT_VALUE_ENABLE;
+  hcrc.Init.InputDataInversionMode  = CRC_INPUTDATA_INVERSION_NONE;
+  hcrc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+  /* 32-bit words, used by the TaiChi journal records */
+  hcrc.InputDataFormat              = CRC_INPUTDATA_FORMAT_WORDS;
 
   if (HAL_CRC_Init(&hcrc) != HAL_OK)
   {
@@ -1542,6 +1649,9 @@ static void Init_BlueNRG_Stack(void)
   /* Set output power level: -2,1 dBm */
   aci_hal_set_tx_power_level(1,4);
 
+  /* Longest LL data PDUs for the new connections */
+  BleLink_Init();
+
 
 
 
@@ -1756,11 +1866,16 @@ static void InitPredictiveMaintenance(void)
   PREDMNT1_PRINTF("\r\n");
 
   PREDMNT1_PRINTF("\r\nMotionSP parameters:\r\n");
-  PREDMNT1_PRINTF("size= %d\t", MotionSP_Parameters.FftSize); 
-  PREDMNT1_PRINTF("wind= %d\t", MotionSP_Parameters.window);  
-  PREDMNT1_PRINTF("tacq= %d\t", MotionSP_Parameters.tacq);
-  PREDMNT1_PRINTF("ovl= %d\t", MotionSP_Parameters.FftOvl);
-  PREDMNT1_PRINTF("subrange_num= %d\t", MotionSP_Parameters.subrange_num);
+  PREDMNT1_PRINTF("size= %d\t", MotionSP_Ctx.Parameters.FftSize); 
+  PREDMNT1_PRINTF("wind= %d\t", MotionSP_Ctx.Parameters.window);  
+  PREDMNT1_PRINTF("tacq= %d\t", MotionSP_Ctx.Parameters.tacq);
+  PREDMNT1_PRINTF("ovl= %d\t", MotionSP_Ctx.Parameters.FftOvl);
+  PREDMNT1_PRINTF("subrange_num= %d\t", MotionSP_Ctx.Parameters.subrange_num);
+#ifdef MOTIONSP_USE_ENVELOPE
+  PREDMNT1_PRINTF("\r\nenvlo= %d\t", MotionSP_Ctx.Parameters.env_band_low);
+  PREDMNT1_PRINTF("envhi= %d\t", MotionSP_Ctx.Parameters.env_band_high);
+  PREDMNT1_PRINTF("envdec= %d\t", MotionSP_Ctx.Parameters.env_dec);
+#endif /* MOTIONSP_USE_ENVELOPE */
   PREDMNT1_PRINTF("\r\n\n");
   
   PREDMNT1_PRINTF("************************************************************************\r\n\r\n");
@@ -1928,13 +2043,18 @@ static unsigned char ReCallVibrationParamFromMemory(void)
     Accelerometer_Parameters.AccOdr=    VibrationParam[1];
     Accelerometer_Parameters.FifoOdr=   VibrationParam[2];
     Accelerometer_Parameters.fs=        VibrationParam[3];
-    MotionSP_Parameters.FftSize=        VibrationParam[4];
-    MotionSP_Parameters.tau=            VibrationParam[5];
-    MotionSP_Parameters.window=         VibrationParam[6];
-    MotionSP_Parameters.td_type=        VibrationParam[7];
-    MotionSP_Parameters.tacq=           VibrationParam[8];
-    MotionSP_Parameters.FftOvl=         VibrationParam[9];
-    MotionSP_Parameters.subrange_num=   VibrationParam[10];
+    MotionSP_Ctx.Parameters.FftSize=        VibrationParam[4];
+    MotionSP_Ctx.Parameters.tau=            VibrationParam[5];
+    MotionSP_Ctx.Parameters.window=         VibrationParam[6];
+    MotionSP_Ctx.Parameters.td_type=        VibrationParam[7];
+    MotionSP_Ctx.Parameters.tacq=           VibrationParam[8];
+    MotionSP_Ctx.Parameters.FftOvl=         VibrationParam[9];
+    MotionSP_Ctx.Parameters.subrange_num=   VibrationParam[10];
+#ifdef MOTIONSP_USE_ENVELOPE
+    MotionSP_Ctx.Parameters.env_band_low=   VibrationParam[11];
+    MotionSP_Ctx.Parameters.env_band_high=  VibrationParam[12];
+    MotionSP_Ctx.Parameters.env_dec=        VibrationParam[13];
+#endif /* MOTIONSP_USE_ENVELOPE */
     
     PREDMNT1_PRINTF("Vibration parameter values read from FLASH\r\n");
     
@@ -1972,7 +2092,7 @@ void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
      uhCapture = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_4);
     /* Set the Capture Compare Register value */
     __HAL_TIM_SET_COMPARE(&TimCCHandle, TIM_CHANNEL_4, (uhCapture + uhCCR4_Val));
-    SendAccGyroMag=1;
+    Sched_Post(SCHED_EVT_ACC_GYRO_MAG);
   }
 }
 
@@ -1986,21 +2106,23 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
   if(htim == (&TimEnvHandle)) {
     /* Environmental */
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_ENV))
-      SendEnv=1;
+      Sched_Post(SCHED_EVT_ENV);
     
     /* Battery Info */
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_BATTERY_INFO))
-      SendBatteryInfo= 1;
+      Sched_Post(SCHED_EVT_BATTERY_INFO);
     
   } else if(htim == (&TimAudioDataHandle)) {
     /* Mic Data */
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_AUDIO_LEVEL))
-      SendAudioLevel=1;
+      Sched_Post(SCHED_EVT_AUDIO_LEVEL);
   } else if (htim->Instance == STBC02_USED_TIM) {
     BC_CmdMng();
 #ifdef PREDMNT1_ENABLE_PRINTF
     } else if(htim == (&TimHandle)) {
       CDC_TIM_PeriodElapsedCallback(htim);
+      if(ImuCapture_IsRunning())
+        Sched_Post(SCHED_EVT_IMU_CAPTURE);
 #endif /* PREDMNT1_ENABLE_PRINTF */
   }
 }
@@ -2049,13 +2171,13 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 
   switch(GPIO_Pin){
   case HCI_TL_SPI_EXTI_PIN:
+    /* SCHED_EVT_HCI is posted when the event has been read */
     hci_tl_lowlevel_isr();
-    HCI_ProcessEvent=1;
     break;
 
   case M_INT2_O_PIN:
-	  PREDMNT1_PRINTF("M_INT2_0_PIN\r\n");
-	  TriggerMotionMLInt = 1;
+	  PREDMNT1_LOG("M_INT2_0_PIN\r\n");
+	  Sched_Post(SCHED_EVT_MOTION_ML);
 //    AccIntReceived = 1;
 //    if(FifoEnabled)
 //      FuncOn_FifoFull();
@@ -2065,7 +2187,7 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
     
   case USER_BUTTON_PIN:
 
-    ButtonPressed = 1;
+    Sched_Post(SCHED_EVT_BUTTON);
     break;
     
   case GPIO_PIN_10:
@@ -2164,13 +2286,18 @@ unsigned char SaveVibrationParamToMemory(void)
   VibrationParam[1]=  (uint16_t)Accelerometer_Parameters.AccOdr;
   VibrationParam[2]=  (uint16_t)Accelerometer_Parameters.FifoOdr;
   VibrationParam[3]=  (uint16_t)Accelerometer_Parameters.fs;
-  VibrationParam[4]=  (uint16_t)MotionSP_Parameters.FftSize;
-  VibrationParam[5]=  (uint16_t)MotionSP_Parameters.tau;
-  VibrationParam[6]=  (uint16_t)MotionSP_Parameters.window;
-  VibrationParam[7]=  (uint16_t)MotionSP_Parameters.td_type;
-  VibrationParam[8]=  (uint16_t)MotionSP_Parameters.tacq;
-  VibrationParam[9]=  (uint16_t)MotionSP_Parameters.FftOvl;
-  VibrationParam[10]= (uint16_t)MotionSP_Parameters.subrange_num;
+  VibrationParam[4]=  (uint16_t)MotionSP_Ctx.Parameters.FftSize;
+  VibrationParam[5]=  (uint16_t)MotionSP_Ctx.Parameters.tau;
+  VibrationParam[6]=  (uint16_t)MotionSP_Ctx.Parameters.window;
+  VibrationParam[7]=  (uint16_t)MotionSP_Ctx.Parameters.td_type;
+  VibrationParam[8]=  (uint16_t)MotionSP_Ctx.Parameters.tacq;
+  VibrationParam[9]=  (uint16_t)MotionSP_Ctx.Parameters.FftOvl;
+  VibrationParam[10]= (uint16_t)MotionSP_Ctx.Parameters.subrange_num;
+#ifdef MOTIONSP_USE_ENVELOPE
+  VibrationParam[11]= (uint16_t)MotionSP_Ctx.Parameters.env_band_low;
+  VibrationParam[12]= (uint16_t)MotionSP_Ctx.Parameters.env_band_high;
+  VibrationParam[13]= (uint16_t)MotionSP_Ctx.Parameters.env_dec;
+#endif /* MOTIONSP_USE_ENVELOPE */
   
   PREDMNT1_PRINTF("Vibration parameters values will be saved in FLASH\r\n");
   MDM_SaveGMD(GMD_VIBRATION_PARAM,(void *)VibrationParam);
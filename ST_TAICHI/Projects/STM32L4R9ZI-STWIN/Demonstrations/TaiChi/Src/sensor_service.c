@@ -43,6 +43,12 @@
 #include "bluenrg1_l2cap_aci.h"
 #include "uuid_ble_service.h"
 #include "OTA.h"
+#include "TaiChiRing.h"
+#include "TaiChiJournal.h"
+#include "MLCLoader.h"
+#include "Scheduler.h"
+#include "BleNotify.h"
+#include "BleLink.h"
 
 /** @addtogroup Projects
   * @{
@@ -83,6 +89,9 @@ extern volatile uint32_t PredictiveMaintenance;
 
 extern volatile uint32_t FFT_Amplitude;
 extern volatile uint32_t FFT_Alarm;
+#ifdef MOTIONSP_USE_ENVELOPE
+extern volatile uint32_t FFT_Envelope;
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 extern sAccelerometer_Parameter_t Accelerometer_Parameters;
 extern uint8_t IsFirstTime;
@@ -98,13 +107,30 @@ extern uint32_t uhCCR4_Val;
 
 
 
-extern volatile uint8_t taiChiResultPos;
+extern taiChiRing_t TaiChiResultRing;
 
 extern void TaiChiEnableHW(void);
 extern void TaiChiDisableHW(void);
 
 
 
+/* Private types ----------------------------------------------------------------*/
+
+/**
+ * @brief FFT Amplitude stream pulled by BleNotify
+ */
+typedef struct
+{
+  sAxesMagBuff_t *pMagBuff;   //!< X, Y and Z FFT Amplitude values
+  uint32_t AxisSize;          //!< Bytes for each component
+  uint32_t TotalSize;         //!< Bytes of the stream
+  uint8_t *pSending;          //!< Cleared by the owner for stopping the stream
+  uint32_t *pCursor;          //!< Bytes of the stream already sent
+  uint8_t Header[W2ST_FFT_AMPLITUDE_HEADER_LEN]; //!< nSample + nComponents + Frequency Steps
+  uint8_t ChunkLen;           //!< Length of the notification on the air
+  uint8_t Failed;             //!< A notification has not been sent
+} W2ST_FftStream_t;
+
 /* Private variables ------------------------------------------------------------*/
 #ifdef DISABLE_FOTA
 static uint32_t FirstCommandSent= 1;
@@ -122,6 +148,9 @@ static uint16_t TimeDomainCharHandle;
 static uint16_t FFTAlarmSpeedRMS_StatusCharHandle;
 static uint16_t FFTAlarmAccStatusCharHandle;
 static uint16_t FFTAlarmSubrangeStatusCharHandle;
+#ifdef MOTIONSP_USE_ENVELOPE
+static uint16_t FFTEnvelopeCharHandle;
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 static uint16_t ConfigServW2STHandle;
 static uint16_t ConfigCharHandle;
@@ -148,8 +177,9 @@ static uint8_t  EnvironmentalCharSize = 2; /* Size for Environmental BLE charact
 static uint32_t SizeOfUpdateBlueFW=0;
 
 static uint16_t connection_handle = 0;
+static uint16_t AttMtu = W2ST_DEFAULT_ATT_MTU;
 
-volatile uint8_t BLE_Buffer_Full=0;
+static W2ST_FftStream_t FftStream;
 
 Service_UUID_t service_uuid;
 Char_UUID_t char_uuid;
@@ -181,49 +211,15 @@ static void TimeDomain_AttributeModified_CB(uint8_t *att_data);
 static void FFTAlarmSpeedRMS_AttributeModified_CB(uint8_t *att_data);
 static void FFTAlarmAccStatus_AttributeModified_CB(uint8_t *att_data);
 static void FFTAlarmSubrangeStatus_AttributeModified_CB(uint8_t *att_data);
+#ifdef MOTIONSP_USE_ENVELOPE
+static void FFTEnvelope_AttributeModified_CB(uint8_t *att_data);
+#endif /* MOTIONSP_USE_ENVELOPE */
 
 /* Private define ------------------------------------------------------------*/
 static void TaiChi_AttributeModified_CB(uint8_t *att_data);
 
-#ifdef ACC_BLUENRG_CONGESTION
-#define ACI_GATT_UPDATE_CHAR_VALUE safe_aci_gatt_update_char_value
-static int32_t breath;
-
-
-/* @brief  Update the value of a characteristic avoiding (for a short time) to
- *         send the next updates if an error in the previous sending has
- *         occurred.
- * @param  servHandle The handle of the service
- * @param  charHandle The handle of the characteristic
- * @param  charValOffset The offset of the characteristic
- * @param  charValueLen The length of the characteristic
- * @param  charValue The pointer to the characteristic
- * @retval tBleStatus Status
- */
-tBleStatus safe_aci_gatt_update_char_value(uint16_t servHandle, 
-				      uint16_t charHandle,
-				      uint8_t charValOffset,
-				      uint8_t charValueLen,   
-				      uint8_t *charValue)
-{
-  tBleStatus ret = BLE_STATUS_INSUFFICIENT_RESOURCES;
-  
-  if (breath > 0) {
-    breath--;
-  } else {
-    ret = aci_gatt_update_char_value(servHandle,charHandle,charValOffset,charValueLen,charValue);
-    
-    if (ret != BLE_STATUS_SUCCESS){
-      breath = ACC_BLUENRG_CONGESTION_SKIP;
-    }
-  }
-  
-  return (ret);
-}
-
-#else /* ACC_BLUENRG_CONGESTION */
-#define ACI_GATT_UPDATE_CHAR_VALUE aci_gatt_update_char_value
-#endif /* ACC_BLUENRG_CONGESTION */
+static uint8_t FFT_Amplitude_Pull(uint8_t *pBuff, uint8_t MaxLen);
+static void FFT_Amplitude_Done(tBleStatus Status);
 
 
 /**
@@ -514,6 +510,8 @@ tBleStatus Add_HW_ServW2ST_Service(void)
     goto fail;
   }
 
+  BleNotify_Register(BLE_NOTIFY_ENVIRONMENTAL, HWServW2STHandle, EnvironmentalCharHandle);
+
   COPY_ACC_GYRO_MAG_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
   ret =  aci_gatt_add_char(HWServW2STHandle, UUID_TYPE_128, &char_uuid, 2+3*3*2,
@@ -526,6 +524,8 @@ tBleStatus Add_HW_ServW2ST_Service(void)
     goto fail;
   }
 
+  BleNotify_Register(BLE_NOTIFY_ACC_GYRO_MAG, HWServW2STHandle, AccGyroMagCharHandle);
+
   COPY_MIC_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
   ret =  aci_gatt_add_char(HWServW2STHandle, UUID_TYPE_128, &char_uuid,2+AUDIO_IN_CHANNELS,
@@ -537,6 +537,8 @@ tBleStatus Add_HW_ServW2ST_Service(void)
   if (ret != BLE_STATUS_SUCCESS) {
     goto fail;
   }
+
+  BleNotify_Register(BLE_NOTIFY_AUDIO_LEVEL, HWServW2STHandle, AudioLevelCharHandle);
   
   COPY_BATTERY_INFO_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
@@ -549,6 +551,8 @@ tBleStatus Add_HW_ServW2ST_Service(void)
   if (ret != BLE_STATUS_SUCCESS) {
     goto fail;
   }
+
+  BleNotify_Register(BLE_NOTIFY_BATTERY_INFO, HWServW2STHandle, BatteryFeaturesCharHandle);
   
   return BLE_STATUS_SUCCESS;
 
@@ -590,7 +594,7 @@ tBleStatus Add_TaiChi_ServW2ST_Service(void)
 
   COPY_TAICHI_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
-  ret =  aci_gatt_add_char(TaiChiServW2STHandle, UUID_TYPE_128, &char_uuid, 2+2+6*W2ST_TAICHI_MAX_BUFF_LEN,
+  ret =  aci_gatt_add_char(TaiChiServW2STHandle, UUID_TYPE_128, &char_uuid, W2ST_TAICHI_HEADER_LEN+W2ST_TAICHI_ITEM_LEN*W2ST_TAICHI_MAX_BUFF_LEN,
                            CHAR_PROP_NOTIFY ,
                            ATTR_PERMISSION_NONE,
                            GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
@@ -600,6 +604,8 @@ tBleStatus Add_TaiChi_ServW2ST_Service(void)
     goto fail;
   }
 
+  BleNotify_Register(BLE_NOTIFY_TAICHI, TaiChiServW2STHandle, TaiChiCharHandle);
+
 
 
 
@@ -620,7 +626,11 @@ fail:
 tBleStatus Add_SW_ServW2ST_Service(void)
 {
   tBleStatus ret;
+#ifdef MOTIONSP_USE_ENVELOPE
+  int32_t NumberOfRecords=6;
+#else /* MOTIONSP_USE_ENVELOPE */
   int32_t NumberOfRecords=5;
+#endif /* MOTIONSP_USE_ENVELOPE */
 
   uint8_t uuid[16];
 
@@ -640,7 +650,7 @@ tBleStatus Add_SW_ServW2ST_Service(void)
 
   COPY_FFT_AMPLITUDE_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
-  ret =  aci_gatt_add_char(SWServW2STHandle, UUID_TYPE_128, &char_uuid, 20,
+  ret =  aci_gatt_add_char(SWServW2STHandle, UUID_TYPE_128, &char_uuid, W2ST_FFT_AMPLITUDE_MAX_CHAR_LEN,
                            CHAR_PROP_NOTIFY,
                            ATTR_PERMISSION_NONE,
                            GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
@@ -649,6 +659,8 @@ tBleStatus Add_SW_ServW2ST_Service(void)
   if (ret != BLE_STATUS_SUCCESS) {
     goto fail;
   }
+
+  BleNotify_Register(BLE_NOTIFY_FFT_AMPLITUDE, SWServW2STHandle, FFTAmplitudeCharHandle);
  
   COPY_TIME_DOMAIN_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
@@ -661,6 +673,8 @@ tBleStatus Add_SW_ServW2ST_Service(void)
   if (ret != BLE_STATUS_SUCCESS) {
     goto fail;
   }
+
+  BleNotify_Register(BLE_NOTIFY_TIME_DOMAIN, SWServW2STHandle, TimeDomainCharHandle);
   
   COPY_FFT_ALARM_SPEED_STATUS_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
@@ -673,6 +687,8 @@ tBleStatus Add_SW_ServW2ST_Service(void)
   if (ret != BLE_STATUS_SUCCESS) {
     goto fail;
   }
+
+  BleNotify_Register(BLE_NOTIFY_FFT_ALARM_SPEED_RMS, SWServW2STHandle, FFTAlarmSpeedRMS_StatusCharHandle);
     
   COPY_FFT_ALARM_ACC_STATUS_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
@@ -686,6 +702,8 @@ tBleStatus Add_SW_ServW2ST_Service(void)
     goto fail;
   }
 
+  BleNotify_Register(BLE_NOTIFY_FFT_ALARM_ACC, SWServW2STHandle, FFTAlarmAccStatusCharHandle);
+
   COPY_FFT_ALARM_SUBRANGE_STATUS_W2ST_CHAR_UUID(uuid);
   BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
   ret =  aci_gatt_add_char(SWServW2STHandle, UUID_TYPE_128, &char_uuid, 2+13,
@@ -698,6 +716,24 @@ tBleStatus Add_SW_ServW2ST_Service(void)
     goto fail;
   }
 
+  BleNotify_Register(BLE_NOTIFY_FFT_ALARM_SUBRANGE, SWServW2STHandle, FFTAlarmSubrangeStatusCharHandle);
+
+#ifdef MOTIONSP_USE_ENVELOPE
+  COPY_FFT_ENVELOPE_W2ST_CHAR_UUID(uuid);
+  BLUENRG_memcpy(&char_uuid.Char_UUID_128, uuid, 16);
+  ret =  aci_gatt_add_char(SWServW2STHandle, UUID_TYPE_128, &char_uuid, 2+12,
+                           CHAR_PROP_NOTIFY,
+                           ATTR_PERMISSION_NONE,
+                           GATT_NOTIFY_READ_REQ_AND_WAIT_FOR_APPL_RESP,
+                           16, 0, &FFTEnvelopeCharHandle);
+  
+  if (ret != BLE_STATUS_SUCCESS) {
+    goto fail;
+  }
+
+  BleNotify_Register(BLE_NOTIFY_FFT_ENVELOPE, SWServW2STHandle, FFTEnvelopeCharHandle);
+#endif /* MOTIONSP_USE_ENVELOPE */
+
   return BLE_STATUS_SUCCESS;
 
 fail:
@@ -737,7 +773,7 @@ tBleStatus AccGyroMag_Update(MOTION_SENSOR_Axes_t *Acc,MOTION_SENSOR_Axes_t *Gyr
   STORE_LE_16(buff+16,Mag->y);
   STORE_LE_16(buff+18,Mag->z);
   
-  ret = ACI_GATT_UPDATE_CHAR_VALUE(HWServW2STHandle, AccGyroMagCharHandle, 0, 2+3*3*2, buff);
+  ret = BleNotify_Post(BLE_NOTIFY_ACC_GYRO_MAG, buff, 2+3*3*2);
 	
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -799,7 +835,7 @@ tBleStatus Environmental_Update(int32_t Press,uint16_t Hum,int16_t Temp2,int16_t
     }
   }
 
-  ret = aci_gatt_update_char_value(HWServW2STHandle, EnvironmentalCharHandle, 0, EnvironmentalCharSize,buff);
+  ret = BleNotify_Post(BLE_NOTIFY_ENVIRONMENTAL, buff, EnvironmentalCharSize);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -831,7 +867,7 @@ tBleStatus AudioLevel_Update(uint16_t *Mic)
     buff[2+Counter]= Mic[Counter]&0xFF;
   }
     
-  ret = ACI_GATT_UPDATE_CHAR_VALUE(HWServW2STHandle, AudioLevelCharHandle, 0, 2+AUDIO_IN_CHANNELS,buff);
+  ret = BleNotify_Post(BLE_NOTIFY_AUDIO_LEVEL, buff, 2+AUDIO_IN_CHANNELS);
   
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -847,16 +883,31 @@ tBleStatus AudioLevel_Update(uint16_t *Mic)
 
 
 /**
- * @brief  Update TaiChi value
- * @param  taiChiResult*[]
- * @retval tBleStatus   Status
+ * @brief  Number of TaiChi items that fit in one notification with the current ATT MTU
+ * @param  None
+ * @retval uint16_t Max num of items for TaiChi_Update
  */
-tBleStatus TaiChi_Update(uint8_t buff[])
+uint16_t TaiChi_MaxItemsPerUpdate(void)
 {
+  /* 3 bytes of ATT header (opcode + handle) for each notification */
+  uint16_t MaxItems = (AttMtu-3-W2ST_TAICHI_HEADER_LEN)/W2ST_TAICHI_ITEM_LEN;
 
+  return (MaxItems>W2ST_TAICHI_MAX_BUFF_LEN) ? W2ST_TAICHI_MAX_BUFF_LEN : MaxItems;
+}
 
+/**
+ * @brief  Update TaiChi value without waiting for the BlueNRG-2 answer
+ *         The notification is retried until it is accepted and it goes before all the others
+ * @param  uint8_t buff[] packed TaiChi notification (it is copied)
+ * @param  uint8_t len length of the notification (not bigger than ATT MTU - 3)
+ * @param  W2ST_UpdateDone_t Done called with the answer, only if the update has been queued
+ * @retval tBleStatus   Status
+ */
+tBleStatus TaiChi_Update(uint8_t buff[],uint8_t len,W2ST_UpdateDone_t Done)
+{
+	tBleStatus ret;
 
-	tBleStatus ret = aci_gatt_update_char_value(TaiChiServW2STHandle, TaiChiCharHandle, 0, 4+W2ST_TAICHI_MAX_BUFF_LEN*6,buff);
+	ret = BleNotify_PostReliable(BLE_NOTIFY_TAICHI, buff, len, Done);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -911,7 +962,7 @@ tBleStatus BatteryInfo_Update(uint32_t BatteryLevel, uint32_t Voltage, stbc02_St
     buff[8] = Status;
   }
 
-  ret = aci_gatt_update_char_value(HWServW2STHandle, BatteryFeaturesCharHandle, 0, 2+2+2+2+1,buff);
+  ret = BleNotify_Post(BLE_NOTIFY_BATTERY_INFO, buff, 2+2+2+2+1);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -926,75 +977,183 @@ tBleStatus BatteryInfo_Update(uint32_t BatteryLevel, uint32_t Voltage, stbc02_St
 }
 
 
+/**
+ * @brief  Locate the contiguous bytes of the FFT Amplitude stream at a given offset
+ *         The stream is the header followed by the X, Y and Z magnitude arrays
+ * @param  const uint8_t *pHeader nSample + nComponents + Frequency Steps
+ * @param  sAxesMagBuff_t *pMagBuff X, Y and Z FFT Amplitude values
+ * @param  uint32_t AxisSize Bytes for each component
+ * @param  uint32_t Offset Offset in the stream (smaller than the stream size)
+ * @param  uint32_t *pSegLen Contiguous bytes available from the returned pointer
+ * @retval const uint8_t * Stream bytes at Offset
+ */
+static const uint8_t *FFT_Amplitude_Segment(const uint8_t *pHeader, sAxesMagBuff_t *pMagBuff, uint32_t AxisSize,
+                                            uint32_t Offset, uint32_t *pSegLen)
+{
+  const uint8_t *pAxis[3];
+
+  if(Offset < W2ST_FFT_AMPLITUDE_HEADER_LEN)
+  {
+    *pSegLen = W2ST_FFT_AMPLITUDE_HEADER_LEN - Offset;
+    return pHeader + Offset;
+  }
+
+  pAxis[0]= (const uint8_t *)pMagBuff->AXIS_X;
+  pAxis[1]= (const uint8_t *)pMagBuff->AXIS_Y;
+  pAxis[2]= (const uint8_t *)pMagBuff->AXIS_Z;
+
+  Offset -= W2ST_FFT_AMPLITUDE_HEADER_LEN;
+  *pSegLen = AxisSize - (Offset % AxisSize);
+
+  return pAxis[Offset / AxisSize] + (Offset % AxisSize);
+}
+
 /*
- * @brief  Update FFT Amplitude characteristic value
- * @param  uint8_t *TotalBuff
- * @param  uint16_t ActualMagSize Number of samples
- * @param  uint8_t *SendingFFT
- * @param  uint16_t *CountSendData
+ * @brief  Stream the FFT Amplitude characteristic value
+ *         The first call starts the stream: notifications of ATT MTU - 3 bytes are pulled
+ *         by BleNotify straight from the magnitude arrays while the BlueNRG-2 TX pool
+ *         accepts them, and SCHED_EVT_FFT_AMPLITUDE is posted when the stream is ended.
+ *         The next call reports the end of the stream
+ * @param  sAxesMagBuff_t *pMagBuff X, Y and Z FFT Amplitude values (kept until the end)
+ * @param  uint16_t ActualMagSize Number of samples for each component
+ * @param  float BinFreqStep Frequency step between two samples
+ * @param  uint8_t *SendingFFT Cleared when the stream is finished
+ * @param  uint32_t *pCursor Bytes of the stream already sent
  * @retval tBleStatus   Status
  */
-tBleStatus FFT_Amplitude_Update(uint8_t *TotalBuff, uint16_t ActualMagSize, uint8_t *SendingFFT, uint16_t *CountSendData)
+tBleStatus FFT_Amplitude_Update(sAxesMagBuff_t *pMagBuff, uint16_t ActualMagSize, float BinFreqStep,
+                                uint8_t *SendingFFT, uint32_t *pCursor)
 {
   tBleStatus ret;
-  
-  uint16_t TotalSize;
-  
-  uint16_t index;
-  uint16_t indexStart;
-  uint16_t indexStop;
-  
-  uint8_t Buff[20];
-  
-  uint8_t  NumByteSent;
 
-  TotalSize= 2 /* nSample */ + 1 /* nComponents */ + 4 /*  Frequency Steps */ + ((3 * ActualMagSize) * 4) /* Samples */;
+  /* New stream (a stream failed on its first notification has still the cursor at 0) */
+  if((*pCursor == 0) && (!FftStream.Failed))
+  {
+    FftStream.pMagBuff= pMagBuff;
+    FftStream.AxisSize= (uint32_t)ActualMagSize * 4U;
+    FftStream.TotalSize= W2ST_FFT_AMPLITUDE_HEADER_LEN + (3U * FftStream.AxisSize) /* Samples */;
+    FftStream.pSending= SendingFFT;
+    FftStream.pCursor= pCursor;
 
-  indexStart= 20 * (*CountSendData);
-  indexStop=  20 * ((*CountSendData) + 1);
+    STORE_LE_16(FftStream.Header, ActualMagSize);
+    FftStream.Header[2]= 3;
+    memcpy(&FftStream.Header[3], &BinFreqStep, 4);
+  }
 
-  NumByteSent= 20;
-  
-  if(indexStop > TotalSize)
+  if(FftStream.Failed)
   {
-    indexStop= TotalSize;
-    NumByteSent= TotalSize % NumByteSent;
+    FftStream.Failed= 0;
+    *SendingFFT= 0;
+    *pCursor= 0;
+    return BLE_STATUS_ERROR;
   }
-  
-  for(index=indexStart; index<indexStop; index++)
+
+  if(*pCursor >= FftStream.TotalSize)
   {
-    Buff[index - indexStart]= TotalBuff[index];
+    *SendingFFT= 0;
+    *pCursor= 0;
+    return BLE_STATUS_SUCCESS;
   }
-  
-  if(!BLE_Buffer_Full)
+
+  /* Nothing changes if the stream is already running */
+  ret = BleNotify_Stream(BLE_NOTIFY_FFT_AMPLITUDE, FFT_Amplitude_Pull, FFT_Amplitude_Done);
+
+  if (ret != BLE_STATUS_SUCCESS)
   {
-    ret = aci_gatt_update_char_value(SWServW2STHandle, FFTAmplitudeCharHandle, 0, NumByteSent,Buff);
-    
-    if (ret != BLE_STATUS_SUCCESS)
+    *SendingFFT= 0;
+    *pCursor= 0;
+    return BLE_STATUS_ERROR;
+  }
+
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+ * @brief  Fill the next FFT Amplitude notification from the stream cursor
+ *         Only the notifications across two arrays are gathered from more segments
+ * @param  uint8_t *pBuff Notification to fill
+ * @param  uint8_t MaxLen Max length of the notification
+ * @retval uint8_t Length of the notification, 0 when the stream is ended
+ */
+static uint8_t FFT_Amplitude_Pull(uint8_t *pBuff, uint8_t MaxLen)
+{
+  const uint8_t *pData;
+  uint32_t SegLen;
+  uint32_t Cursor;
+  uint16_t Len;
+  uint16_t Pos;
+
+  /* Stopped by the owner */
+  if((!*FftStream.pSending) || FftStream.Failed)
+  {
+    return 0;
+  }
+
+  Cursor= *FftStream.pCursor;
+  if(Cursor >= FftStream.TotalSize)
+  {
+    return 0;
+  }
+
+  /* 3 bytes of ATT header (opcode + handle) for each notification */
+  Len= AttMtu - 3;
+  if(Len > MaxLen)
+  {
+    Len= MaxLen;
+  }
+  if(Len > W2ST_FFT_AMPLITUDE_MAX_CHAR_LEN)
+  {
+    Len= W2ST_FFT_AMPLITUDE_MAX_CHAR_LEN;
+  }
+  if((FftStream.TotalSize - Cursor) < Len)
+  {
+    Len= (uint16_t)(FftStream.TotalSize - Cursor);
+  }
+
+  /* The notification could span the header and/or two components */
+  for(Pos=0; Pos<Len; Pos+=SegLen)
+  {
+    pData= FFT_Amplitude_Segment(FftStream.Header, FftStream.pMagBuff, FftStream.AxisSize, Cursor + Pos, &SegLen);
+    if(SegLen > (uint32_t)(Len - Pos))
     {
-      /* When the requested operation failed for a temporary lack of resources, repeats sending after 200 ms*/
-      if(ret == BLE_STATUS_INSUFFICIENT_RESOURCES)
-      {
-        BLE_Buffer_Full = 1;
-      }
-      else
-      {
-        return BLE_STATUS_ERROR;
-      }
+      SegLen= Len - Pos;
     }
-    else
+    memcpy(&pBuff[Pos], pData, SegLen);
+  }
+
+  FftStream.ChunkLen= (uint8_t)Len;
+
+  return FftStream.ChunkLen;
+}
+
+/**
+ * @brief  Answer to one FFT Amplitude notification
+ *         The owner is informed with SCHED_EVT_FFT_AMPLITUDE when the stream is ended
+ * @param  tBleStatus Status Status of the notification
+ * @retval None
+ */
+static void FFT_Amplitude_Done(tBleStatus Status)
+{
+  /* Stopped by the owner */
+  if(!*FftStream.pSending)
+  {
+    return;
+  }
+
+  if(Status == BLE_STATUS_SUCCESS)
+  {
+    *FftStream.pCursor += FftStream.ChunkLen;
+    if(*FftStream.pCursor < FftStream.TotalSize)
     {
-      (*CountSendData)++;
-      
-      if(indexStop == TotalSize)
-      {
-        *SendingFFT= 0;
-        *CountSendData= 0;
-      }
+      return;
     }
   }
+  else
+  {
+    FftStream.Failed= 1;
+  }
 
-  return BLE_STATUS_SUCCESS;
+  Sched_Post(SCHED_EVT_FFT_AMPLITUDE);
 }
 
 /**
@@ -1003,12 +1162,13 @@ tBleStatus FFT_Amplitude_Update(uint8_t *TotalBuff, uint16_t ActualMagSize, uint
            is greater than maximum ATT MTU (on stack versions below v2.1 this event is generated when at least 2 packets
            with MTU of 23 bytes are available).
   * @param Connection_Handle Connection handle related to the request
-  * @param Available_Buffers Not used.
+  * @param Available_Buffers Number of free TX buffers
   * @retval None
 */
 void aci_gatt_tx_pool_available_event(uint16_t Connection_Handle, uint16_t Available_Buffers)
 {
-  BLE_Buffer_Full=0;
+  /* The refused notifications are resumed in priority order */
+  BleNotify_TxPoolAvailable(Available_Buffers);
 }
 
 /*
@@ -1070,7 +1230,7 @@ tBleStatus TimeDomain_Update(sAcceleroParam_t *sTimeDomain)
   Buff[BuffPos]= TempBuff[3];
   BuffPos++;
   
-  ret = aci_gatt_update_char_value(SWServW2STHandle, TimeDomainCharHandle, 0, 20,Buff);
+  ret = BleNotify_Post(BLE_NOTIFY_TIME_DOMAIN, Buff, 20);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -1140,7 +1300,7 @@ tBleStatus FFT_AlarmSpeedRMS_Status_Update(sTimeDomainAlarm_t *pTdAlarm, sAccele
   BuffPos++;
     
   
-  ret = aci_gatt_update_char_value(SWServW2STHandle, FFTAlarmSpeedRMS_StatusCharHandle, 0, 2+13, Buff);
+  ret = BleNotify_Post(BLE_NOTIFY_FFT_ALARM_SPEED_RMS, Buff, 2+13);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -1210,7 +1370,7 @@ tBleStatus FFT_AlarmAccStatus_Update(sTimeDomainAlarm_t *pTdAlarm, sAcceleroPara
   BuffPos++;
     
   
-  ret = aci_gatt_update_char_value(SWServW2STHandle, FFTAlarmAccStatusCharHandle, 0, 2+13, Buff);
+  ret = BleNotify_Post(BLE_NOTIFY_FFT_ALARM_ACC, Buff, 2+13);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -1256,7 +1416,7 @@ tBleStatus FFT_AlarmSubrangeStatus_Update(sAxesMagResults_t *AccAxesMagResults,s
   Temp= (TempAlarm_X << 4) | (TempAlarm_Y  << 2) | (TempAlarm_Z);
   Buff[2]= Temp;
   
-  BinFreqStep = (AcceleroODR.Frequency/2) / ActualMagSize;
+  BinFreqStep = (MotionSP_Ctx.AcceleroODR.Frequency/2) / ActualMagSize;
   
   /* X */
   SendValue= (float)(AccAxesMagResults->X_Index*BinFreqStep);
@@ -1276,7 +1436,7 @@ tBleStatus FFT_AlarmSubrangeStatus_Update(sAxesMagResults_t *AccAxesMagResults,s
   SendValue= AccAxesMagResults->Z_Value;
   STORE_LE_16(Buff + 13, ((uint16_t)(SendValue * 100)));
   
-  ret = aci_gatt_update_char_value(SWServW2STHandle, FFTAlarmSubrangeStatusCharHandle, 0, 2+13, Buff);
+  ret = BleNotify_Post(BLE_NOTIFY_FFT_ALARM_SUBRANGE, Buff, 2+13);
 
   if (ret != BLE_STATUS_SUCCESS){
     if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
@@ -1291,6 +1451,57 @@ tBleStatus FFT_AlarmSubrangeStatus_Update(sAxesMagResults_t *AccAxesMagResults,s
   return BLE_STATUS_SUCCESS;
 }
 
+#ifdef MOTIONSP_USE_ENVELOPE
+/*
+ * @brief  Update FFT Envelope with the peaks of the envelope spectrum
+ * @param  sAxesMagResults_t *pEnvMagResults X-Y-Z peaks of the envelope spectrum [m/s^2]
+ * @param  float BinFreqStep Frequency step of the envelope spectrum [Hz]
+ * @retval tBleStatus   Status
+ */
+tBleStatus FFT_Envelope_Update(sAxesMagResults_t *pEnvMagResults, float BinFreqStep)
+{
+  tBleStatus ret;
+  float SendValue;
+  
+  uint8_t Buff[2 + 12];
+  
+  STORE_LE_16(Buff  ,(HAL_GetTick()>>3));
+  
+  /* Frequency in tenth of Hz and amplitude in mm/s^2, saturated to 16 bits */
+  /* X */
+  SendValue= (float)(pEnvMagResults->X_Index*BinFreqStep);
+  STORE_LE_16(Buff + 2, ((uint16_t)(SendValue * 10)));
+  SendValue= pEnvMagResults->X_Value * 1000;
+  STORE_LE_16(Buff + 4, ((uint16_t)((SendValue < 65535.0f) ? SendValue : 65535.0f)));
+  
+  /* Y */
+  SendValue= (float)(pEnvMagResults->Y_Index*BinFreqStep);
+  STORE_LE_16(Buff + 6, ((uint16_t)(SendValue * 10)));
+  SendValue= pEnvMagResults->Y_Value * 1000;
+  STORE_LE_16(Buff + 8, ((uint16_t)((SendValue < 65535.0f) ? SendValue : 65535.0f)));
+  
+  /* Z */
+  SendValue= (float)(pEnvMagResults->Z_Index*BinFreqStep);
+  STORE_LE_16(Buff + 10, ((uint16_t)(SendValue * 10)));
+  SendValue= pEnvMagResults->Z_Value * 1000;
+  STORE_LE_16(Buff + 12, ((uint16_t)((SendValue < 65535.0f) ? SendValue : 65535.0f)));
+  
+  ret = BleNotify_Post(BLE_NOTIFY_FFT_ENVELOPE, Buff, 2+12);
+
+  if (ret != BLE_STATUS_SUCCESS){
+    if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_ERR)){
+      BytesToWrite =sprintf((char *)BufferToWrite, "Error Updating FFT Envelope Char\r\n");
+      Stderr_Update(BufferToWrite,BytesToWrite);
+    } else {
+      PREDMNT1_PRINTF("Error Updating FFT Envelope Char\r\n");
+    }
+    return BLE_STATUS_ERROR;
+  }
+  
+  return BLE_STATUS_SUCCESS;
+}
+#endif /* MOTIONSP_USE_ENVELOPE */
+
 
 /**
  * @brief  Puts the device in connectable mode.
@@ -1555,6 +1766,10 @@ static void Attribute_Modified_Request_CB(uint16_t Connection_Handle, uint16_t a
     FFTAlarmAccStatus_AttributeModified_CB(att_data);
   } else if (attr_handle == FFTAlarmSubrangeStatusCharHandle + 2) {
       FFTAlarmSubrangeStatus_AttributeModified_CB(att_data);
+#ifdef MOTIONSP_USE_ENVELOPE
+  } else if (attr_handle == FFTEnvelopeCharHandle + 2) {
+    FFTEnvelope_AttributeModified_CB(att_data);
+#endif /* MOTIONSP_USE_ENVELOPE */
   } else if(attr_handle == StdErrCharHandle + 2){
     if (att_data[0] == 01) {
       W2ST_ON_CONNECTION(W2ST_CONNECT_STD_ERR);
@@ -1585,6 +1800,16 @@ static void Attribute_Modified_Request_CB(uint16_t Connection_Handle, uint16_t a
         }
       }
       SendBackData=0;
+    } else if(MLCLoader_Remaining()) {
+      /* MLC program image */
+      int8_t RetValue = MLCLoader_Receive(att_data, data_length);
+      if(RetValue!=0) {
+        MCR_FAST_TERM_UPDATE_FOR_OTA(((uint8_t *)&RetValue));
+        if(RetValue==1) {
+          Sched_Post(SCHED_EVT_MLC_PROGRAM);
+        }
+      }
+      SendBackData=0;
     } else {
       /* Received one write from Client on Terminal characteristc */
       SendBackData = DebugConsoleCommandParsing(att_data,data_length);
@@ -1631,9 +1856,11 @@ static void TaiChi_AttributeModified_CB(uint8_t *att_data)
     TaiChiDisableHW();
     // Send a zero packet to iOS for first response if no data waiting to send ,
     // prevent iOS force reconnect and trigger this and prevented enter to sleep mode
-    if (!taiChiResultPos){
-    	uint8_t buff[4+W2ST_TAICHI_MAX_BUFF_LEN*6] = {};
-    	TaiChi_Update(buff);
+    if (!TaiChiRing_Count(&TaiChiResultRing) && !TaiChiJournal_Count()){
+    	uint8_t buff[W2ST_TAICHI_HEADER_LEN] = {};
+    	TaiChi_Update(buff,W2ST_TAICHI_HEADER_LEN,NULL);
+    } else {
+    	Sched_Post(SCHED_EVT_TAICHI);
     }
 
   } else if (att_data[0] == 0){
@@ -1982,6 +2209,54 @@ static void FFTAlarmSubrangeStatus_AttributeModified_CB(uint8_t *att_data)
 #endif /* PREDMNT1_DEBUG_CONNECTION */
 }
 
+#ifdef MOTIONSP_USE_ENVELOPE
+/**
+ * @brief  This function is called when there is a change on the gatt attribute for FFT Envelope
+ * With this function it's possible to understand if one application 
+ * is subscribed or not to the FFT Envelope service
+ * @param uint8_t *att_data attribute data
+ * @retval None
+ */
+static void FFTEnvelope_AttributeModified_CB(uint8_t *att_data)
+{
+  if (att_data[0] == 01) {
+    
+    W2ST_ON_CONNECTION(W2ST_CONNECT_FFT_ENVELOPE);
+    
+    /* The envelope analysis can join the FFT Amplitude or the FFT Alarm acquisitions.
+       They run only with InitPredictiveMaintenance and FuncOn_FifoFull enabled in main.c */
+    FFT_Envelope= 1;
+    
+    if(!PredictiveMaintenance)
+    {
+      PredictiveMaintenance= 1;
+      IsFirstTime = 1;
+    }
+  } else if (att_data[0] == 0) {
+    
+    W2ST_OFF_CONNECTION(W2ST_CONNECT_FFT_ENVELOPE);
+    
+    FFT_Envelope= 0;
+    
+    if((!FFT_Amplitude) && (!FFT_Alarm))
+    {
+      disable_FIFO();
+      EnableDisable_ACC_HP_Filter(0);
+      PredictiveMaintenance= 0;
+    }
+  }
+  
+#ifdef PREDMNT1_DEBUG_CONNECTION
+  if(W2ST_CHECK_CONNECTION(W2ST_CONNECT_STD_TERM)) {
+    BytesToWrite = sprintf((char *)BufferToWrite,"--->FFT Envelope= %s", (W2ST_CHECK_CONNECTION(W2ST_CONNECT_FFT_ENVELOPE)   ? " ON\r\n" : " OFF\r\n") );
+    Term_Update(BufferToWrite,BytesToWrite);
+  } else {
+    PREDMNT1_PRINTF("--->FFT Envelope= %s", (W2ST_CHECK_CONNECTION(W2ST_CONNECT_FFT_ENVELOPE)   ? " ON\r\n" : " OFF\r\n"));
+  }
+#endif /* PREDMNT1_DEBUG_CONNECTION */
+}
+#endif /* MOTIONSP_USE_ENVELOPE */
+
 /**
  * @brief  This function makes the parsing of the Debug Console Commands
  * @param uint8_t *att_data attribute data
@@ -2005,6 +2280,7 @@ static uint32_t DebugConsoleCommandParsing(uint8_t * att_data, uint8_t data_leng
          /*"versionBle -> Ble Version\r\n" */
          "getVibrParam  -> Read Vibration Parameters\r\n"
          "setVibrParam [-odr -fs -size -wind - tacq -subrng -ovl] -> Set Vibration Parameters\r\n"
+         "loadUcf[size][crc] -> Load one MLC program (binary size/crc, then the image)\r\n"
            );
       Term_Update(BufferToWrite,BytesToWrite);
       
@@ -2022,6 +2298,14 @@ static uint32_t DebugConsoleCommandParsing(uint8_t * att_data, uint8_t data_leng
       Term_Update(BufferToWrite,BytesToWrite);
       BytesToWrite =sprintf((char *)BufferToWrite,"\r\novl= [5 - 95]\r\n\r\n");
       Term_Update(BufferToWrite,BytesToWrite);
+#ifdef MOTIONSP_USE_ENVELOPE
+      BytesToWrite =sprintf((char *)BufferToWrite,"setVibrParam [-envlo -envhi -envdec] -> Set Envelope Parameters\r\n");
+      Term_Update(BufferToWrite,BytesToWrite);
+      BytesToWrite =sprintf((char *)BufferToWrite,"envlo= envhi= [10 - 3000] Hz, with envlo < envhi < 0.45*odr");
+      Term_Update(BufferToWrite,BytesToWrite);
+      BytesToWrite =sprintf((char *)BufferToWrite,"\r\nenvdec= [2, 4, 8, 16]\r\n\r\n");
+      Term_Update(BufferToWrite,BytesToWrite);
+#endif /* MOTIONSP_USE_ENVELOPE */
       
       BytesToWrite =sprintf((char *)BufferToWrite,
          "setName xxxxxxx     -> Set the node name (Max 7 characters)\r\n"
@@ -2120,20 +2404,8 @@ static uint32_t DebugConsoleCommandParsing(uint8_t * att_data, uint8_t data_leng
         /* Reset the Flash */
         StartUpdateFWBlueMS(SizeOfUpdateBlueFW,uwCRCValue);
 
-        /* Reduce the connection interval */
-        {
-          int ret = aci_l2cap_connection_parameter_update_req(connection_handle,
-                                                        10 /* interval_min*/,
-                                                        10 /* interval_max */,
-                                                        0   /* slave_latency */,
-                                                        400 /*timeout_multiplier*/);
-          /* Go to infinite loop if there is one error */
-          if (ret != BLE_STATUS_SUCCESS) {
-            while (1) {
-              PREDMNT1_PRINTF("Problem Changing the connection interval\r\n");
-            }
-          }
-        }
+        /* Reduce the connection interval until the disconnection (reboot) */
+        BleLink_ForceFast(1);
         
         /* Signal that we are ready sending back the CRV value*/
         BufferToWrite[0] = PointerByte[0];
@@ -2145,6 +2417,34 @@ static uint32_t DebugConsoleCommandParsing(uint8_t * att_data, uint8_t data_leng
       }
       
       SendBackData=0;      
+    } else if(!strncmp("loadUcf",(char *)(att_data),7)) {
+      uint32_t SizeOfUcf;
+      uint32_t uwCRCValue;
+
+      /* "loadUcf" + 4 bytes of size + 4 bytes of CRC */
+      if(data_length < 15) {
+        PREDMNT1_PRINTF("loadUcf command of %d bytes, 15 expected\r\n",data_length);
+        BytesToWrite =sprintf((char *)BufferToWrite,"loadUcf: size and CRC missing\r\n");
+        Term_Update(BufferToWrite,BytesToWrite);
+      } else {
+        memcpy(&SizeOfUcf,att_data+7,4);
+        memcpy(&uwCRCValue,att_data+11,4);
+
+        if(MLCLoader_Start(SizeOfUcf,uwCRCValue)) {
+          PREDMNT1_PRINTF("MLC program SIZE=%ld uwCRCValue=%lx\r\n",SizeOfUcf,uwCRCValue);
+        } else {
+          PREDMNT1_PRINTF("MLC program SIZE=%ld not allowed (Max %d, multiple of 4)\r\n",SizeOfUcf,MLC_UCF_MAX_SIZE);
+          /* UserAnswer with a wrong CRC value for signaling the problem */
+          uwCRCValue = ~uwCRCValue;
+        }
+
+        /* Signal that we are ready sending back the CRC value */
+        memcpy(BufferToWrite,&uwCRCValue,4);
+        BytesToWrite = 4;
+        Term_Update(BufferToWrite,BytesToWrite);
+      }
+
+      SendBackData=0;
     } else if(!strncmp("versionBle",(char *)(att_data),10)) {
       uint8_t  hwVersion;
       uint16_t fwVersion;
@@ -2168,12 +2468,19 @@ static uint32_t DebugConsoleCommandParsing(uint8_t * att_data, uint8_t data_leng
       BytesToWrite =sprintf((char *)BufferToWrite,"MotionSP parameters:\r\n");
       Term_Update(BufferToWrite,BytesToWrite);
       BytesToWrite =sprintf((char *)BufferToWrite,"size= %d wind= %d tacq= %d subrng= %d ovl= %d\r\n",
-                            MotionSP_Parameters.FftSize,
-                            MotionSP_Parameters.window,
-                            MotionSP_Parameters.tacq,
-                            MotionSP_Parameters.subrange_num,
-                            MotionSP_Parameters.FftOvl);
+                            MotionSP_Ctx.Parameters.FftSize,
+                            MotionSP_Ctx.Parameters.window,
+                            MotionSP_Ctx.Parameters.tacq,
+                            MotionSP_Ctx.Parameters.subrange_num,
+                            MotionSP_Ctx.Parameters.FftOvl);
       Term_Update(BufferToWrite,BytesToWrite);
+#ifdef MOTIONSP_USE_ENVELOPE
+      BytesToWrite =sprintf((char *)BufferToWrite,"envlo= %d envhi= %d envdec= %d\r\n",
+                            MotionSP_Ctx.Parameters.env_band_low,
+                            MotionSP_Ctx.Parameters.env_band_high,
+                            MotionSP_Ctx.Parameters.env_dec);
+      Term_Update(BufferToWrite,BytesToWrite);
+#endif /* MOTIONSP_USE_ENVELOPE */
       SendBackData=0;
     } else if(!strncmp("setVibrParam",(char *)(att_data),12)) {
       SetVibrParam= 1;
@@ -2357,8 +2664,8 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
   uint8_t UpdatedParameters= 0;
   uint8_t UpdatedAccParameters= 0;
   
-  uint8_t i=7;
-  uint32_t Param[7];
+  uint8_t i=10;
+  uint32_t Param[10];
   uint8_t DigitNumber;
   uint8_t ParamFound;
   
@@ -2423,6 +2730,29 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       i=6;
       ParamFound= 1;
     }
+    
+#ifdef MOTIONSP_USE_ENVELOPE
+    if((VibrParam[Index]=='e') & (VibrParam[Index+1]=='n') & (VibrParam[Index+2]=='v') & (VibrParam[Index+3]=='l') & (VibrParam[Index+4]=='o'))
+    {
+      Index+= 6;
+      i=7;
+      ParamFound= 1;
+    }
+    
+    if((VibrParam[Index]=='e') & (VibrParam[Index+1]=='n') & (VibrParam[Index+2]=='v') & (VibrParam[Index+3]=='h') & (VibrParam[Index+4]=='i'))
+    {
+      Index+= 6;
+      i=8;
+      ParamFound= 1;
+    }
+    
+    if((VibrParam[Index]=='e') & (VibrParam[Index+1]=='n') & (VibrParam[Index+2]=='v') & (VibrParam[Index+3]=='d') & (VibrParam[Index+4]=='e') & (VibrParam[Index+5]=='c'))
+    {
+      Index+= 7;
+      i=9;
+      ParamFound= 1;
+    }
+#endif /* MOTIONSP_USE_ENVELOPE */
       
     if(ParamFound == 1)
     {
@@ -2482,7 +2812,7 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       case 2:
         if( (Param[i] == 256) || (Param[i] == 512) || (Param[i] == 1024) || (Param[i] == 2048))
         {
-          MotionSP_Parameters.FftSize= Param[i];
+          MotionSP_Ctx.Parameters.FftSize= Param[i];
           UpdatedParameters= 1;
         }          
         else
@@ -2495,7 +2825,7 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       case 3:
         if(Param[i] < 4)
         {
-          MotionSP_Parameters.window= Param[i];
+          MotionSP_Ctx.Parameters.window= Param[i];
           UpdatedParameters= 1;
         }          
         else
@@ -2508,7 +2838,7 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       case 4:
         if( (Param[i] >= 500) && (Param[i] <= 60000) )
         {
-          MotionSP_Parameters.tacq= Param[i];
+          MotionSP_Ctx.Parameters.tacq= Param[i];
           UpdatedParameters= 1;
         }          
         else
@@ -2521,7 +2851,7 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       case 5:
         if( (Param[i] >= 5) && (Param[i] <= 95) )
         {
-          MotionSP_Parameters.FftOvl= Param[i];
+          MotionSP_Ctx.Parameters.FftOvl= Param[i];
           UpdatedParameters= 1;
         }
         else
@@ -2534,7 +2864,7 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
       case 6:
         if( (Param[i] == 8) || (Param[i] == 16) || (Param[i] == 32) || (Param[i] == 64) )
         {
-          MotionSP_Parameters.subrange_num= Param[i];
+          MotionSP_Ctx.Parameters.subrange_num= Param[i];
           UpdatedParameters= 1;
         }
         else
@@ -2543,6 +2873,47 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
           Term_Update(BufferToWrite,BytesToWrite);
         }
         break;
+#ifdef MOTIONSP_USE_ENVELOPE
+      /* envlo (Low cut-off of the ENVELOPE band-pass in Hz) */
+      case 7:
+        if( (Param[i] >= 10) && (Param[i] <= 3000) )
+        {
+          MotionSP_Ctx.Parameters.env_band_low= Param[i];
+          UpdatedParameters= 1;
+        }
+        else
+        {
+          BytesToWrite =sprintf((char *)BufferToWrite,"\r\nValue out of range for envlo\r\n");
+          Term_Update(BufferToWrite,BytesToWrite);
+        }
+        break;
+      /* envhi (High cut-off of the ENVELOPE band-pass in Hz) */
+      case 8:
+        if( (Param[i] >= 10) && (Param[i] <= 3000) )
+        {
+          MotionSP_Ctx.Parameters.env_band_high= Param[i];
+          UpdatedParameters= 1;
+        }
+        else
+        {
+          BytesToWrite =sprintf((char *)BufferToWrite,"\r\nValue out of range for envhi\r\n");
+          Term_Update(BufferToWrite,BytesToWrite);
+        }
+        break;
+      /* envdec (ENVELOPE decimation factor) */
+      case 9:
+        if( (Param[i] == 2) || (Param[i] == 4) || (Param[i] == 8) || (Param[i] == 16) )
+        {
+          MotionSP_Ctx.Parameters.env_dec= Param[i];
+          UpdatedParameters= 1;
+        }
+        else
+        {
+          BytesToWrite =sprintf((char *)BufferToWrite,"\r\nValue out of range for envdec\r\n");
+          Term_Update(BufferToWrite,BytesToWrite);
+        }
+        break;
+#endif /* MOTIONSP_USE_ENVELOPE */
       }
       
       Index= Index + DigitNumber + 1;
@@ -2570,11 +2941,11 @@ static uint8_t VibrationParametersCommandParsing(uint8_t CommandLenght)
 //  BytesToWrite =sprintf((char *)BufferToWrite,"New MotionSP parameters:\r\n");
 //  Term_Update(BufferToWrite,BytesToWrite);
 //  BytesToWrite =sprintf((char *)BufferToWrite,"size= %d wind= %d tacq= %d ovl= %d subrng= %d\r\n",
-//                        MotionSP_Parameters.FftSize,
-//                        MotionSP_Parameters.window,
-//                        MotionSP_Parameters.tacq,
-//                        MotionSP_Parameters.FftOvl,
-//                        MotionSP_Parameters.subrange_num);
+//                        MotionSP_Ctx.Parameters.FftSize,
+//                        MotionSP_Ctx.Parameters.window,
+//                        MotionSP_Ctx.Parameters.tacq,
+//                        MotionSP_Ctx.Parameters.FftOvl,
+//                        MotionSP_Ctx.Parameters.subrange_num);
 //  Term_Update(BufferToWrite,BytesToWrite);
   
   if(UpdatedAccParameters)
@@ -2720,8 +3091,60 @@ void hci_le_connection_update_complete_event(uint8_t Status,
   PREDMNT1_PRINTF(">>>>>>CONNECTION UPDATE %d %d %d \r\n\r\n",Conn_Interval,Conn_Latency,Supervision_Timeout);
 
 #endif /* PREDMNT1_DEBUG_CONNECTION */
+
+  if(Status == BLE_STATUS_SUCCESS) {
+    BleLink_Updated(Conn_Interval,Conn_Latency,Supervision_Timeout);
+  }
 }
 
+/*******************************************************************************
+ * Function Name  : aci_l2cap_connection_update_resp_event.
+ * Description    : This event reports the answer of the central to the
+ *                  connection parameter update request.
+ * Input          : See file bluenrg1_events.h
+ * Output         : See file bluenrg1_events.h
+ * Return         : See file bluenrg1_events.h
+ *******************************************************************************/
+void aci_l2cap_connection_update_resp_event(uint16_t Connection_Handle,
+                                            uint16_t Result)
+{
+  BleLink_UpdateAnswer(Result);
+}
+/* end aci_l2cap_connection_update_resp_event() */
+
+/*******************************************************************************
+ * Function Name  : aci_l2cap_proc_timeout_event.
+ * Description    : This event occurs when the central does not answer to the
+ *                  connection parameter update request.
+ * Input          : See file bluenrg1_events.h
+ * Output         : See file bluenrg1_events.h
+ * Return         : See file bluenrg1_events.h
+ *******************************************************************************/
+void aci_l2cap_proc_timeout_event(uint16_t Connection_Handle,
+                                  uint8_t Data_Length,
+                                  uint8_t Data[])
+{
+  BleLink_UpdateAnswer(0xFFFF);
+}
+/* end aci_l2cap_proc_timeout_event() */
+
+/*******************************************************************************
+ * Function Name  : hci_le_data_length_change_event.
+ * Description    : This event reports the data length used on the connection.
+ * Input          : See file bluenrg1_events.h
+ * Output         : See file bluenrg1_events.h
+ * Return         : See file bluenrg1_events.h
+ *******************************************************************************/
+void hci_le_data_length_change_event(uint16_t Connection_Handle,
+                                     uint16_t MaxTxOctets,
+                                     uint16_t MaxTxTime,
+                                     uint16_t MaxRxOctets,
+                                     uint16_t MaxRxTime)
+{
+  BleLink_DataLength(MaxTxOctets);
+}
+/* end hci_le_data_length_change_event() */
+
 
 
 /*******************************************************************************
@@ -2743,6 +3166,7 @@ void hci_le_connection_complete_event(uint8_t Status,
 { 
   connected = TRUE;
   connection_handle = Connection_Handle;
+  AttMtu = W2ST_DEFAULT_ATT_MTU;
 
 #ifdef PREDMNT1_DEBUG_CONNECTION
   PREDMNT1_PRINTF(">>>>>>CONNECTED %x:%x:%x:%x:%x:%x\r\n\r\n",Peer_Address[5],Peer_Address[4],Peer_Address[3],Peer_Address[2],Peer_Address[1],Peer_Address[0]);
@@ -2757,7 +3181,8 @@ void hci_le_connection_complete_event(uint8_t Status,
   ConnectionBleStatus=0;
   FirstConnectionConfig  =0;
   
-
+  /* Data length, ATT MTU and connection parameters are requested from the main loop */
+  BleLink_Connected(Connection_Handle,Conn_Interval,Conn_Latency,Supervision_Timeout);
 
 
 #ifdef DISABLE_FOTA
@@ -2766,6 +3191,24 @@ void hci_le_connection_complete_event(uint8_t Status,
 }
 /* end hci_le_connection_complete_event() */
 
+/*******************************************************************************
+ * Function Name  : aci_att_exchange_mtu_resp_event.
+ * Description    : This event reports the ATT MTU agreed with the central.
+ * Input          : See file bluenrg1_events.h
+ * Output         : See file bluenrg1_events.h
+ * Return         : See file bluenrg1_events.h
+ *******************************************************************************/
+void aci_att_exchange_mtu_resp_event(uint16_t Connection_Handle,
+                                     uint16_t Server_RX_MTU)
+{
+  AttMtu = Server_RX_MTU;
+
+#ifdef PREDMNT1_DEBUG_CONNECTION
+  PREDMNT1_PRINTF(">>>>>>ATT MTU %d\r\n\r\n",Server_RX_MTU);
+#endif /* PREDMNT1_DEBUG_CONNECTION */
+}
+/* end aci_att_exchange_mtu_resp_event() */
+
 /*******************************************************************************
  * Function Name  : hci_disconnection_complete_event.
  * Description    : This event occurs when a connection is terminated.
@@ -2784,8 +3227,28 @@ void hci_disconnection_complete_event(uint8_t Status,
 
 #ifdef PREDMNT1_DEBUG_CONNECTION  
   PREDMNT1_PRINTF("\r\n<<<<<<DISCONNECTED\r\n");
+  {
+    tHciStats Stats;
+
+    /* For sizing the HCI read packets pool */
+    hci_get_stats(&Stats);
+    PREDMNT1_PRINTF("HCI: %ld events, %ld pool empty, %ld discarded, %ld invalid, min free %d\r\n",
+                    Stats.RxPackets, Stats.PoolEmpty, Stats.Discarded, Stats.Invalid, Stats.FreeMin);
+  }
+  {
+    BleNotify_Stats_t Stats;
+
+    /* For tuning the notification priorities */
+    BleNotify_GetStats(&Stats);
+    PREDMNT1_PRINTF("Notify: %ld sent, %ld coalesced, %ld refused, %ld errors\r\n",
+                    Stats.Sent, Stats.Coalesced, Stats.Refused, Stats.Errors);
+  }
 #endif /* PREDMNT1_DEBUG_CONNECTION */
 
+  /* The gestures not yet sent stay in the journal for the next connection */
+  BleNotify_Reset();
+  BleLink_Disconnected();
+
  if (W2ST_CHECK_CONNECTION(W2ST_CONNECT_BATTERY_INFO)){
      BSP_BC_BatMS_DeInit();
 
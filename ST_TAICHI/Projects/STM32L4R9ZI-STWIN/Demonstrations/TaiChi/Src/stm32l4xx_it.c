@@ -187,6 +187,61 @@ void DFSDM1_FLT1_IRQHandler(void)
   HAL_DFSDM_IRQHandler(&AMic_OnBoard_DfsdmFilter);
 }
 
+/**
+  * @brief  Asynchronous sensor and BlueNRG-2 buses (see STWIN_bus.h for the DMA routing)
+  * @param  None
+  * @retval None
+  */
+void DMA2_Channel1_IRQHandler(void)
+{
+  BSP_SPI3_DMA_RX_IRQHandler();
+}
+
+void DMA2_Channel2_IRQHandler(void)
+{
+  BSP_SPI3_DMA_TX_IRQHandler();
+}
+
+void DMA2_Channel3_IRQHandler(void)
+{
+  BSP_SPI2_DMA_RX_IRQHandler();
+}
+
+void DMA2_Channel4_IRQHandler(void)
+{
+  BSP_SPI2_DMA_TX_IRQHandler();
+}
+
+void DMA2_Channel5_IRQHandler(void)
+{
+  BSP_I2C2_DMA_RX_IRQHandler();
+}
+
+void DMA2_Channel6_IRQHandler(void)
+{
+  BSP_I2C2_DMA_TX_IRQHandler();
+}
+
+void SPI2_IRQHandler(void)
+{
+  BSP_SPI2_IRQHandler();
+}
+
+void SPI3_IRQHandler(void)
+{
+  BSP_SPI3_IRQHandler();
+}
+
+void I2C2_EV_IRQHandler(void)
+{
+  BSP_I2C2_EV_IRQHandler();
+}
+
+void I2C2_ER_IRQHandler(void)
+{
+  BSP_I2C2_ER_IRQHandler();
+}
+
 /**
   * @brief  This function handles TIM4 interrupt request.
   * @param  None
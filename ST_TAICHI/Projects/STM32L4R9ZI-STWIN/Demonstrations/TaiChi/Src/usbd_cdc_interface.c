@@ -36,6 +36,8 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
 #include "TargetFeatures.h"
 #include "main.h"
 #include "usbd_core.h"
@@ -62,10 +64,18 @@ USBD_CDC_LineCodingTypeDef LineCoding =
 uint8_t UserRxBuffer[APP_RX_DATA_SIZE];/* Received Data over USB are stored in this buffer */
 uint8_t UserTxBuffer[APP_TX_DATA_SIZE];/* Received Data over UART (CDC interface) are stored in this buffer */
 uint32_t BuffLength;
-uint32_t UserTxBufPtrIn = 0;/* Increment this pointer or roll it back to
-                               start address when data are received over USART */
-uint32_t UserTxBufPtrOut = 0; /* Increment this pointer or roll it back to
-                                 start address when data are sent over USB */
+volatile uint32_t UserTxBufPtrIn = 0;/* Increment this pointer or roll it back to
+                                        start address when data are written by CDC_Fill_Buffer */
+volatile uint32_t UserTxBufPtrOut = 0; /* Increment this pointer or roll it back to
+                                          start address when data are sent over USB */
+static uint32_t UserTxInFlight = 0; /* Bytes from UserTxBufPtrOut handed to the IN endpoint */
+
+/* Writes refused because the TX ring was full, and their bytes */
+static uint32_t UserTxDropped = 0;
+static uint32_t UserTxDroppedBytes = 0;
+/* Counters already reported on the console by the timer callback */
+static uint32_t UserTxDroppedReported = 0;
+static uint32_t UserTxDroppedBytesReported = 0;
 
 volatile uint8_t USB_RxBuffer[USB_RxBufferDim];
 volatile uint16_t USB_RxBufferStart_idx = 0;
@@ -82,6 +92,9 @@ static int8_t CDC_Itf_Control  (uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Itf_Receive  (uint8_t* pbuf, uint32_t *Len);
 
 static void CDC_TIM_Config(void);
+static void CDC_LogOutput(uint8_t* Buf, uint32_t Len);
+static void CDC_TxKick(void);
+static void CDC_ReportDropped(void);
 
 USBD_CDC_ItfTypeDef USBD_CDC_fops = 
 {
@@ -211,56 +224,175 @@ static int8_t CDC_Itf_Control (uint8_t cmd, uint8_t* pbuf, uint16_t length)
 
 /**
   * @brief  Fill the usb tx buffer
+  *         The data are copied with at most two memcpy (ring wrap around) and the
+  *         transmission starts immediately if the IN endpoint is idle.
+  *         A write that does not fit is dropped as a whole, never truncated
   * @param  Buf: pointer to the tx buffer
   * @param  TotalLen: number of bytes to be sent
-  * @retval Result of the operation: USBD_OK if all operations are OK
+  * @retval Result of the operation: USBD_OK if all operations are OK, USBD_BUSY if the ring is full
   */
 uint8_t CDC_Fill_Buffer(uint8_t* Buf, uint32_t TotalLen)
 {
-  uint16_t i;
-  
-  for (i = 0; i < TotalLen; i++)
+  uint32_t uwPRIMASK_Bit;
+  uint32_t PtrIn;
+  uint32_t Free;
+  uint32_t ToEnd;
+
+  if (TotalLen == 0)
+  {
+    return (USBD_OK);
+  }
+
+  /* Main loop, timer callback and interrupts write in the same ring */
+  uwPRIMASK_Bit = __get_PRIMASK();
+  __disable_irq();
+
+  PtrIn = UserTxBufPtrIn;
+  /* One byte is kept free for telling a full ring from an empty one */
+  Free = (UserTxBufPtrOut + APP_TX_DATA_SIZE - PtrIn - 1) % APP_TX_DATA_SIZE;
+
+  if (TotalLen > Free)
+  {
+    UserTxDropped++;
+    UserTxDroppedBytes += TotalLen;
+    __set_PRIMASK(uwPRIMASK_Bit);
+    return (USBD_BUSY);
+  }
+
+  ToEnd = APP_TX_DATA_SIZE - PtrIn;
+  if (TotalLen <= ToEnd)
   {
-    UserTxBuffer[UserTxBufPtrIn] = Buf[i];
-    UserTxBufPtrIn = (UserTxBufPtrIn + 1) % APP_RX_DATA_SIZE;
+    memcpy(&UserTxBuffer[PtrIn], Buf, TotalLen);
   }
+  else
+  {
+    memcpy(&UserTxBuffer[PtrIn], Buf, ToEnd);
+    memcpy(UserTxBuffer, &Buf[ToEnd], TotalLen - ToEnd);
+  }
+  UserTxBufPtrIn = (PtrIn + TotalLen) % APP_TX_DATA_SIZE;
+
+  CDC_TxKick();
+
+  __set_PRIMASK(uwPRIMASK_Bit);
+
   return (USBD_OK);
 }
 
 /**
-  * @brief  TIM period elapsed callback
-  * @param  htim: TIM handle
+  * @brief  Release the completed transfer and send the next contiguous block
+  *         if the IN endpoint is idle. Called with interrupts masked
+  * @param  None
   * @retval None
   */
-void CDC_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+static void CDC_TxKick(void)
 {
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)USBD_Device.pClassData;
   uint32_t buffptr;
   uint32_t buffsize;
-  
-  if(UserTxBufPtrOut != UserTxBufPtrIn)
+
+  /* Not configured yet or previous transfer still in progress */
+  if ((hcdc == NULL) || (hcdc->TxState != 0U))
   {
-    if(UserTxBufPtrOut > UserTxBufPtrIn) /* Rollback */
-    {
-      buffsize = APP_RX_DATA_SIZE - UserTxBufPtrOut;
-    }
-    else 
-    {
-      buffsize = UserTxBufPtrIn - UserTxBufPtrOut;
-    }
-    
-    buffptr = UserTxBufPtrOut;
-    
-    USBD_CDC_SetTxBuffer(&USBD_Device, (uint8_t*)&UserTxBuffer[buffptr], buffsize);
-    
-    if(USBD_CDC_TransmitPacket(&USBD_Device) == USBD_OK)
-    {
-      UserTxBufPtrOut += buffsize;
-      if (UserTxBufPtrOut == APP_RX_DATA_SIZE)
-      {
-        UserTxBufPtrOut = 0;
-      }
-    }
+    return;
+  }
+
+  /* The bytes of the completed transfer can be overwritten now */
+  UserTxBufPtrOut = (UserTxBufPtrOut + UserTxInFlight) % APP_TX_DATA_SIZE;
+  UserTxInFlight = 0;
+
+  if (UserTxBufPtrOut == UserTxBufPtrIn)
+  {
+    return;
+  }
+
+  buffptr = UserTxBufPtrOut;
+  if (UserTxBufPtrOut > UserTxBufPtrIn) /* Rollback */
+  {
+    buffsize = APP_TX_DATA_SIZE - UserTxBufPtrOut;
+  }
+  else
+  {
+    buffsize = UserTxBufPtrIn - UserTxBufPtrOut;
+  }
+
+  USBD_CDC_SetTxBuffer(&USBD_Device, (uint8_t*)&UserTxBuffer[buffptr], buffsize);
+
+  if (USBD_CDC_TransmitPacket(&USBD_Device) == USBD_OK)
+  {
+    UserTxInFlight = buffsize;
+  }
+}
+
+/**
+  * @brief  Sink of the deferred log entries
+  * @param  Buf: formatted entry
+  * @param  Len: number of bytes
+  * @retval None
+  */
+static void CDC_LogOutput(uint8_t* Buf, uint32_t Len)
+{
+  CDC_Fill_Buffer(Buf, Len);
+}
+
+/**
+  * @brief  Report the writes dropped since the last report (PREDMNT1_PRINTF
+  *         does not check the result of CDC_Fill_Buffer)
+  *         If the ring is still full the report is tried again next period
+  * @param  None
+  * @retval None
+  */
+static void CDC_ReportDropped(void)
+{
+  char Line[64];
+  uint32_t uwPRIMASK_Bit;
+  uint32_t Dropped = UserTxDropped;
+  uint32_t DroppedBytes = UserTxDroppedBytes;
+  int32_t Len;
+
+  if (Dropped == UserTxDroppedReported)
+  {
+    return;
   }
+
+  Len = snprintf(Line, sizeof(Line), "CDC: %lu writes dropped (%lu bytes)\r\n",
+                 Dropped - UserTxDroppedReported, DroppedBytes - UserTxDroppedBytesReported);
+
+  uwPRIMASK_Bit = __get_PRIMASK();
+  __disable_irq();
+  if (CDC_Fill_Buffer((uint8_t *)Line, (uint32_t)Len) == USBD_OK)
+  {
+    UserTxDroppedReported = Dropped;
+    UserTxDroppedBytesReported = DroppedBytes;
+  }
+  else
+  {
+    /* The report itself is not a dropped write */
+    UserTxDropped--;
+    UserTxDroppedBytes -= (uint32_t)Len;
+  }
+  __set_PRIMASK(uwPRIMASK_Bit);
+}
+
+/**
+  * @brief  TIM period elapsed callback
+  *         Sends what is left in the ring when no write kicked the endpoint
+  *         after the end of the previous transfer
+  * @param  htim: TIM handle
+  * @retval None
+  */
+void CDC_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  uint32_t uwPRIMASK_Bit;
+
+  /* Format the entries recorded by PREDMNT1_LOG since the last period */
+  Log_Flush(CDC_LogOutput);
+
+  CDC_ReportDropped();
+
+  uwPRIMASK_Bit = __get_PRIMASK();
+  __disable_irq();
+  CDC_TxKick();
+  __set_PRIMASK(uwPRIMASK_Bit);
 }
 
 
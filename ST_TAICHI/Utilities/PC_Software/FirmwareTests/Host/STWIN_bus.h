@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    STWIN_bus.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host replacement of the BSP bus header: the HCI transport
+  *          interface only needs the HAL types
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef STWIN_BUS_H
+#define STWIN_BUS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+
+#endif /* STWIN_BUS_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    TargetFeatures.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host replacement of the target platform header: only the flash
+  *          helpers and the console used by the tested modules
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _TARGET_FEATURES_H_
+#define _TARGET_FEATURES_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* No USB CDC on the host */
+#define PREDMNT1_PRINTF(...)
+
+/* Exported functions --------------------------------------------------------*/
+/* Implemented by the flash simulator (Host/flash_sim.c) */
+extern uint32_t GetPage(uint32_t Address);
+extern uint32_t GetBank(uint32_t Address);
+
+#endif /* _TARGET_FEATURES_H_ */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,280 @@
+/**
+  ******************************************************************************
+  * @file    flash_sim.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host simulation of the STM32L4R9 flash with power cut injection
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  *
+  * The simulated area follows the rules of the target flash:
+  * - it can be programmed only when unlocked, one aligned double word at time;
+  * - a double word can be programmed only if erased, except with all zeros;
+  * - pages are erased to 0xFF.
+  * Every program and erase operation is counted, so a test can cut the power
+  * at each of them and restart the firmware module on the resulting flash.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include "flash_sim.h"
+#include "TargetFeatures.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FLASH_SIM_ERASED_DW  0xFFFFFFFFFFFFFFFFULL
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE  0x100000
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t *FlashMem;
+static uint8_t FlashLocked = 1;
+static uint32_t FlashOps;
+
+static uint32_t CutOp;
+static FlashSim_Cut_t CutType;
+static jmp_buf *CutEnv;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Check if the current operation is the one cut by the power loss
+  * @retval 1 if the power is lost now
+  */
+static int PowerLost(void)
+{
+  int lost = ((CutEnv != NULL) && (FlashOps == CutOp)) ? 1 : 0;
+
+  FlashOps++;
+
+  return lost;
+}
+
+/**
+  * @brief  End of the cut operation: the firmware restarts from the test
+  * @retval None
+  */
+static void PowerOff(void)
+{
+  jmp_buf *env = CutEnv;
+
+  CutEnv = NULL;
+  FlashLocked = 1;
+  longjmp(*env, 1);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int FlashSim_Init(void)
+{
+  void *mem;
+
+  if (FlashMem != NULL)
+  {
+    return 1;
+  }
+
+  mem = mmap((void *)FLASH_SIM_BASE, FLASH_SIM_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if ((mem == MAP_FAILED) || (mem != (void *)FLASH_SIM_BASE))
+  {
+    printf("flash_sim: can not map 0x%08lX\n", FLASH_SIM_BASE);
+    return 0;
+  }
+
+  FlashMem = (uint8_t *)mem;
+  FlashSim_Erase();
+
+  return 1;
+}
+
+void FlashSim_Erase(void)
+{
+  memset(FlashMem, 0xFF, FLASH_SIM_SIZE);
+  FlashLocked = 1;
+  FlashOps = 0;
+  CutEnv = NULL;
+}
+
+uint32_t FlashSim_OpCount(void)
+{
+  return FlashOps;
+}
+
+void FlashSim_PowerCut(uint32_t Op, FlashSim_Cut_t Cut, jmp_buf *Env)
+{
+  CutOp = Op;
+  CutType = Cut;
+  CutEnv = Env;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  FlashLocked = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  FlashLocked = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  uint64_t *pDw;
+  uint32_t *pWord;
+
+  if ((FlashLocked != 0U) || (TypeProgram != FLASH_TYPEPROGRAM_DOUBLEWORD) ||
+      (Address < FLASH_SIM_BASE) || (Address > (FLASH_SIM_BASE + FLASH_SIM_SIZE - 8U)) ||
+      ((Address & 7U) != 0U))
+  {
+    return HAL_ERROR;
+  }
+
+  pDw = (uint64_t *)(FlashMem + (Address - FLASH_SIM_BASE));
+  pWord = (uint32_t *)pDw;
+
+  /* PROGERR: only an erased double word can be programmed, all zeros excepted */
+  if ((*pDw != FLASH_SIM_ERASED_DW) && (Data != 0U))
+  {
+    return HAL_ERROR;
+  }
+
+  if (PowerLost() != 0)
+  {
+    switch (CutType)
+    {
+      case FLASH_SIM_CUT_HALF:
+        pWord[0] = (uint32_t)Data;
+        break;
+      case FLASH_SIM_CUT_BITS:
+        pWord[1] = (uint32_t)(Data >> 32);
+        break;
+      case FLASH_SIM_CUT_AFTER:
+        *pDw = Data;
+        break;
+      default:
+        break;
+    }
+    PowerOff();
+  }
+
+  *pDw = Data;
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+  uint32_t address;
+  uint32_t *pWord;
+  uint32_t index;
+  uint32_t page;
+
+  *PageError = 0xFFFFFFFFU;
+
+  if (FlashLocked != 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  for (page = pEraseInit->Page; page < (pEraseInit->Page + pEraseInit->NbPages); page++)
+  {
+    address = FLASH_BASE + page * FLASH_PAGE_SIZE;
+    if (pEraseInit->Banks == FLASH_BANK_2)
+    {
+      address += FLASH_BANK_SIZE;
+    }
+
+    if ((address < FLASH_SIM_BASE) || (address > (FLASH_SIM_BASE + FLASH_SIM_SIZE - FLASH_PAGE_SIZE)))
+    {
+      *PageError = page;
+      return HAL_ERROR;
+    }
+
+    pWord = (uint32_t *)(FlashMem + (address - FLASH_SIM_BASE));
+
+    if (PowerLost() != 0)
+    {
+      switch (CutType)
+      {
+        case FLASH_SIM_CUT_HALF:
+          memset(pWord, 0xFF, FLASH_PAGE_SIZE / 2U);
+          break;
+        case FLASH_SIM_CUT_BITS:
+          for (index = 0; index < (FLASH_PAGE_SIZE / 4U); index++)
+          {
+            pWord[index] |= 0xFFFF0000U;
+          }
+          break;
+        case FLASH_SIM_CUT_AFTER:
+          memset(pWord, 0xFF, FLASH_PAGE_SIZE);
+          break;
+        default:
+          break;
+      }
+      PowerOff();
+    }
+
+    memset(pWord, 0xFF, FLASH_PAGE_SIZE);
+  }
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  CRC peripheral with its default setup: CRC-32 polynomial
+  *         0x04C11DB7, initial value 0xFFFFFFFF, 32-bit words, no reversal
+  */
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+  uint32_t index;
+  uint32_t bit;
+
+  (void)hcrc;
+
+  for (index = 0; index < BufferLength; index++)
+  {
+    crc ^= pBuffer[index];
+    for (bit = 0; bit < 32U; bit++)
+    {
+      crc = ((crc & 0x80000000U) != 0U) ? ((crc << 1) ^ 0x04C11DB7U) : (crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+/**
+  * @brief  Same page and bank mapping as TargetPlatform.c
+  */
+uint32_t GetPage(uint32_t Addr)
+{
+  if (Addr < (FLASH_BASE + FLASH_BANK_SIZE))
+  {
+    return (Addr - FLASH_BASE) / FLASH_PAGE_SIZE;
+  }
+
+  return (Addr - (FLASH_BASE + FLASH_BANK_SIZE)) / FLASH_PAGE_SIZE;
+}
+
+uint32_t GetBank(uint32_t Addr)
+{
+  return (Addr < (FLASH_BASE + FLASH_BANK_SIZE)) ? FLASH_BANK_1 : FLASH_BANK_2;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
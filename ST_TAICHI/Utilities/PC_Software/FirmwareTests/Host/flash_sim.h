@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    flash_sim.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host simulation of the STM32L4R9 flash with power cut injection
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLASH_SIM_H
+#define __FLASH_SIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <setjmp.h>
+
+#include "stm32l4xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Simulated area: the last 64 KB of bank 2, mapped at its target address so
+ * the firmware can read it through plain pointers */
+#define FLASH_SIM_BASE   0x081F0000UL
+#define FLASH_SIM_SIZE   0x00010000UL
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Effect on the flash of the operation cut by the power loss
+  */
+typedef enum
+{
+  FLASH_SIM_CUT_BEFORE = 0,  //!< Nothing written
+  FLASH_SIM_CUT_HALF,        //!< Program: first word only. Erase: first half of the page
+  FLASH_SIM_CUT_BITS,        //!< Program: second word only. Erase: upper half bits of every word
+  FLASH_SIM_CUT_AFTER,       //!< Operation completed
+  FLASH_SIM_CUT_NUM
+} FlashSim_Cut_t;
+
+/* Exported functions --------------------------------------------------------*/
+/* Map the simulated area and erase it, returns 0 if it can not be mapped */
+int FlashSim_Init(void);
+
+/* Erase the whole simulated area and clear the counters */
+void FlashSim_Erase(void);
+
+/* Number of program and erase operations since FlashSim_Erase */
+uint32_t FlashSim_OpCount(void);
+
+/* Cut the power at the Op-th operation (0 for the first one): the operation
+ * leaves the flash as described by Cut then longjmp(*Env, 1) is executed.
+ * Env NULL disables the cut */
+void FlashSim_PowerCut(uint32_t Op, FlashSim_Cut_t Cut, jmp_buf *Env);
+
+#endif /* __FLASH_SIM_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
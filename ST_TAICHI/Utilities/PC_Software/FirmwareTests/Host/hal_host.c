@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file    hal_host.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Simulated core state of the host HAL replacement
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+
+/* Exported variables --------------------------------------------------------*/
+uint32_t HostPrimask = 0;
+uint32_t HostTick = 0;
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
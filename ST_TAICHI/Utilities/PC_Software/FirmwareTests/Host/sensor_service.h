@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    sensor_service.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host replacement of the BLE service header: the BlueNRG-2 types
+  *          and the error reporting used by the notification scheduler
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _SENSOR_SERVICE_H_
+#define _SENSOR_SERVICE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "TargetFeatures.h"
+#include "hci_const.h"
+#include "hci.h"
+#include "bluenrg1_types.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define W2ST_CONNECT_STD_ERR            (1<<11)
+
+#define W2ST_CHECK_CONNECTION(BleChar) ((ConnectionBleStatus&(BleChar)) ? 1 : 0)
+
+/* Exported variables --------------------------------------------------------*/
+/* Defined by each test */
+extern uint32_t ConnectionBleStatus;
+extern uint8_t BufferToWrite[256];
+extern int32_t BytesToWrite;
+
+/* Exported functions --------------------------------------------------------*/
+/* Defined by each test */
+extern tBleStatus Stderr_Update(uint8_t *data,uint8_t length);
+
+#endif /* _SENSOR_SERVICE_H_ */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
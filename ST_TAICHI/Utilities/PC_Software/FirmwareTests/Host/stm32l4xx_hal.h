@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host replacement of the HAL header for the firmware unit tests
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_H
+#define __STM32L4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  HAL_OK       = 0x00,
+  HAL_ERROR    = 0x01,
+  HAL_BUSY     = 0x02,
+  HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+  uint32_t Dummy;
+} CRC_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Page;
+  uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* STM32L4R9 dual bank flash, see Host/flash_sim.c */
+#define FLASH_BASE                    0x08000000UL
+#define FLASH_BANK_SIZE               0x00100000UL
+#define FLASH_PAGE_SIZE               0x00001000UL
+#define FLASH_BANK_1                  0x00000001UL
+#define FLASH_BANK_2                  0x00000002UL
+#define FLASH_TYPEERASE_PAGES         0x00000000UL
+#define FLASH_TYPEPROGRAM_DOUBLEWORD  0x00000000UL
+#define FLASH_FLAG_OPTVERR            0x00008000UL
+#define FLASH_FLAG_PEMPTY             0x00020000UL
+
+/* Exported macro ------------------------------------------------------------*/
+#define __HAL_FLASH_CLEAR_FLAG(__FLAG__)  ((void)(__FLAG__))
+#define __HAL_FLASH_GET_FLAG(__FLAG__)    (0U)
+
+/* CMSIS compiler and core intrinsics used by the tested modules */
+#define __PACKED_STRUCT           struct __attribute__((packed))
+#define __DMB()                   __sync_synchronize()
+
+/* Exported variables --------------------------------------------------------*/
+/* Simulated core state, defined in hal_host.c */
+extern uint32_t HostPrimask;       /* PRIMASK register, 1 when interrupts are masked */
+extern uint32_t HostTick;          /* SysTick counter [ms], advanced by the tests */
+
+/* Exported functions --------------------------------------------------------*/
+/* Flash and CRC, implemented by the flash simulator (Host/flash_sim.c) */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+
+static inline uint32_t HAL_GetTick(void)
+{
+  return HostTick;
+}
+
+static inline uint32_t __get_PRIMASK(void)
+{
+  return HostPrimask;
+}
+
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+  HostPrimask = priMask & 1U;
+}
+
+static inline void __disable_irq(void)
+{
+  HostPrimask = 1U;
+}
+
+static inline void __enable_irq(void)
+{
+  HostPrimask = 0U;
+}
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0;
+  uint32_t i;
+
+  for (i = 0; i < 32U; i++)
+  {
+    result = (result << 1) | ((value >> i) & 1U);
+  }
+
+  return result;
+}
+
+static inline uint8_t __CLZ(uint32_t value)
+{
+  return (value == 0U) ? 32U : (uint8_t)__builtin_clz(value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
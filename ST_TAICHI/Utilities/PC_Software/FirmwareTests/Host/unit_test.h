@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    unit_test.h
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Minimal check macros shared by the firmware unit tests
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __UNIT_TEST_H
+#define __UNIT_TEST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+/* Exported variables --------------------------------------------------------*/
+static unsigned int UnitTestChecks;
+static unsigned int UnitTestFailures;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Count a check and report it when it fails, the test goes on */
+#define CHECK(cond) \
+  do { \
+    UnitTestChecks++; \
+    if (!(cond)) { \
+      UnitTestFailures++; \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    long long _a = (long long)(a); \
+    long long _b = (long long)(b); \
+    UnitTestChecks++; \
+    if (_a != _b) { \
+      UnitTestFailures++; \
+      printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+    } \
+  } while (0)
+
+/* Print the summary and return the exit status of the test program */
+#define UNIT_TEST_END(name) \
+  (printf("%s: %u checks, %u failed\n", (name), UnitTestChecks, UnitTestFailures), \
+   (UnitTestFailures == 0U) ? 0 : 1)
+
+#endif /* __UNIT_TEST_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,841 @@
+/**
+  ******************************************************************************
+  * @file    test_hci_tl.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host unit test of the asynchronous HCI requests (Patch/hci_tl.c)
+  *          and of the notification scheduler on top of them (Src/BleNotify.c)
+  *          with a fake SPI transport and a simulated tick
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+#include "hci_const.h"
+#include "hci.h"
+#include "hci_tl.h"
+#include "BleNotify.h"
+#include "sensor_service.h"
+#include "unit_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SENT_MAX_NUM      64U
+#define EVT_MAX_NUM       64U
+#define CB_MAX_NUM        64U
+
+/* Same as hci_tl.c: the longest command parameters a request can copy */
+#define ASYNC_CMD_NUM     8U
+#define ASYNC_PARAM_MAX   (HCI_MAX_PAYLOAD_SIZE - HCI_HDR_SIZE - HCI_COMMAND_HDR_SIZE)
+
+#define TEST_OGF          0x3fU
+#define TEST_OCF_BASE     0x100U
+
+/* ACI_GATT_UPDATE_CHAR_VALUE sent by BleNotify */
+#define OPCODE_UPDATE     0xFD06U
+#define TAICHI_SERV       0x0010U
+#define TAICHI_CHAR       0x0012U
+#define ENV_SERV          0x0020U
+#define ENV_CHAR          0x0022U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  uint16_t Opcode;
+  uint8_t  Len;
+  uint8_t  Param[HCI_MAX_PAYLOAD_SIZE];
+} SentCmd_t;
+
+typedef struct
+{
+  uint8_t  Status;
+  uint8_t  ReturnLen;
+  uint8_t  Return[4];
+  uint8_t  HasReturn;
+  uint32_t User;
+} CbCall_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* Fake BlueNRG-2: commands written on the SPI and next event to be read */
+static SentCmd_t Sent[SENT_MAX_NUM];
+static uint32_t SentNum;
+static uint8_t EvtBuff[HCI_READ_PACKET_SIZE];
+static uint16_t EvtLen;
+static uint8_t AutoAnswer;          /* Answer each command with a Command Complete */
+static uint32_t KickNum;
+
+/* Events passed to the application */
+static uint8_t UserEvt[EVT_MAX_NUM];
+static uint32_t UserEvtNum;
+
+/* Completion callbacks of the asynchronous requests */
+static CbCall_t CbCall[CB_MAX_NUM];
+static uint32_t CbNum;
+
+/* Completion of the reliable notifications */
+static tBleStatus DoneStatus[CB_MAX_NUM];
+static uint32_t DoneNum;
+static uint32_t DroppedNum;
+static uint32_t StderrNum;
+
+/* Exported variables --------------------------------------------------------*/
+/* Used by BleNotify.c for reporting the errors */
+uint32_t ConnectionBleStatus = 0;
+uint8_t BufferToWrite[256];
+int32_t BytesToWrite;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Queue one event in the fake BlueNRG-2 and read it, like the
+  *         interrupt of the SPI IRQ line
+  * @param  Evt: event code
+  * @param  pParam: event parameters
+  * @param  Len: length of the parameters
+  * @retval None
+  */
+static void InjectEvent(uint8_t Evt, const uint8_t *pParam, uint8_t Len)
+{
+  EvtBuff[0] = HCI_EVENT_PKT;
+  EvtBuff[1] = Evt;
+  EvtBuff[2] = Len;
+  memcpy(&EvtBuff[3], pParam, Len);
+  EvtLen = 3U + Len;
+
+  CHECK_EQ(hci_notify_asynch_evt(NULL), 0);
+  CHECK_EQ(EvtLen, 0);
+}
+
+static void InjectCmdStatus(uint16_t Opcode, uint8_t Status)
+{
+  uint8_t Param[4] = {Status, 1, (uint8_t)Opcode, (uint8_t)(Opcode >> 8)};
+
+  InjectEvent(EVT_CMD_STATUS, Param, sizeof(Param));
+}
+
+static void InjectCmdComplete(uint16_t Opcode, const uint8_t *pReturn, uint8_t ReturnLen)
+{
+  uint8_t Param[3 + 8] = {1, (uint8_t)Opcode, (uint8_t)(Opcode >> 8)};
+
+  memcpy(&Param[3], pReturn, ReturnLen);
+  InjectEvent(EVT_CMD_COMPLETE, Param, 3U + ReturnLen);
+}
+
+static void InjectVendor(uint8_t Code)
+{
+  uint8_t Param[3] = {Code, 0x0C, 0x00};
+
+  InjectEvent(EVT_VENDOR, Param, sizeof(Param));
+}
+
+/**
+  * @brief  Fake SPI write of one HCI command
+  * @retval Number of bytes written
+  */
+static int32_t FakeSend(uint8_t *buffer, uint16_t size)
+{
+  uint16_t Opcode = (uint16_t)(buffer[1] | (buffer[2] << 8));
+  uint8_t Status = BLE_STATUS_SUCCESS;
+
+  CHECK_EQ(buffer[0], HCI_COMMAND_PKT);
+  CHECK_EQ(buffer[3], size - 4U);
+
+  if (SentNum < SENT_MAX_NUM)
+  {
+    Sent[SentNum].Opcode = Opcode;
+    Sent[SentNum].Len = buffer[3];
+    memcpy(Sent[SentNum].Param, &buffer[4], buffer[3]);
+  }
+  SentNum++;
+
+  if (AutoAnswer)
+  {
+    InjectCmdComplete(Opcode, &Status, 1);
+  }
+
+  return size;
+}
+
+/**
+  * @brief  Fake SPI read of the event queued by InjectEvent
+  * @retval Number of bytes read
+  */
+static int32_t FakeReceive(uint8_t *buffer, uint16_t size)
+{
+  uint16_t Len = EvtLen;
+
+  CHECK(Len <= size);
+  memcpy(buffer, EvtBuff, Len);
+  EvtLen = 0;
+
+  return Len;
+}
+
+static void UserEvtRx(void *pData)
+{
+  const uint8_t *pEvt = pData;
+
+  CHECK_EQ(pEvt[0], HCI_EVENT_PKT);
+  if (UserEvtNum < EVT_MAX_NUM)
+  {
+    /* Vendor events are logged by their code, the others by the event code */
+    UserEvt[UserEvtNum] = (pEvt[1] == EVT_VENDOR) ? pEvt[3] : pEvt[1];
+  }
+  UserEvtNum++;
+}
+
+static void RecordCb(uint8_t Status, const uint8_t *pReturn, uint8_t ReturnLen, void *pUser)
+{
+  if (CbNum < CB_MAX_NUM)
+  {
+    CbCall[CbNum].Status = Status;
+    CbCall[CbNum].ReturnLen = ReturnLen;
+    CbCall[CbNum].HasReturn = (pReturn != NULL);
+    memcpy(CbCall[CbNum].Return, pReturn, (ReturnLen < 4U) ? ReturnLen : 4U);
+    CbCall[CbNum].User = (uint32_t)(uintptr_t)pUser;
+  }
+  CbNum++;
+}
+
+/* It queues a new request from the callback, like a BleNotify update */
+static void RequeueCb(uint8_t Status, const uint8_t *pReturn, uint8_t ReturnLen, void *pUser)
+{
+  struct hci_request rq;
+  uint8_t Param = 0xA5;
+
+  RecordCb(Status, pReturn, ReturnLen, pUser);
+
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = TEST_OGF;
+  rq.ocf = TEST_OCF_BASE + 0x80U;
+  rq.cparam = &Param;
+  rq.clen = 1;
+  CHECK_EQ(hci_send_req_async(&rq, RecordCb, (void *)0x80), 0);
+}
+
+static void ReliableDone(tBleStatus Status)
+{
+  if (DoneNum < CB_MAX_NUM)
+  {
+    DoneStatus[DoneNum] = Status;
+  }
+  DoneNum++;
+}
+
+/* It drops the values queued behind a failed one, like TaiChiUpdateDone */
+static void DropOnErrorDone(tBleStatus Status)
+{
+  ReliableDone(Status);
+  if (Status != BLE_STATUS_SUCCESS)
+  {
+    DroppedNum += BleNotify_DropReliable(DropOnErrorDone);
+  }
+}
+
+/**
+  * @brief  Queue one asynchronous request of the test command group
+  * @param  Index: request number, it selects the OCF and the parameters
+  * @param  Len: length of the parameters
+  * @retval Result of hci_send_req_async
+  */
+static int QueueRequest(uint32_t Index, uint32_t Len)
+{
+  struct hci_request rq;
+  uint8_t Param[HCI_MAX_PAYLOAD_SIZE];
+
+  memset(Param, (int)(0x10U + Index), sizeof(Param));
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = TEST_OGF;
+  rq.ocf = TEST_OCF_BASE + Index;
+  rq.cparam = Param;
+  rq.clen = Len;
+
+  return hci_send_req_async(&rq, RecordCb, (void *)(uintptr_t)Index);
+}
+
+static uint16_t TestOpcode(uint32_t Index)
+{
+  return (uint16_t)((TEST_OGF << 10) | (TEST_OCF_BASE + Index));
+}
+
+static void ResetLogs(void)
+{
+  SentNum = 0;
+  UserEvtNum = 0;
+  CbNum = 0;
+  DoneNum = 0;
+  DroppedNum = 0;
+}
+
+/**
+  * @brief  The requests are queued with their parameters copied and they are
+  *         sent one at a time in queuing order, each one when the previous
+  *         one is answered
+  * @retval None
+  */
+static void TestPendingTable(void)
+{
+  uint8_t Return[3] = {BLE_STATUS_SUCCESS, 0x34, 0x12};
+  uint32_t i;
+
+  ResetLogs();
+
+  for (i = 0; i < ASYNC_CMD_NUM; i++)
+  {
+    CHECK_EQ(QueueRequest(i, 1U + i), 0);
+  }
+
+  /* Table full, command too long */
+  CHECK_EQ(QueueRequest(ASYNC_CMD_NUM, 1), -1);
+  CHECK_EQ(SentNum, 1);
+
+  /* Nothing is sent until the BlueNRG-2 answers */
+  hci_user_evt_proc();
+  CHECK_EQ(SentNum, 1);
+  CHECK_EQ(CbNum, 0);
+
+  for (i = 0; i < ASYNC_CMD_NUM; i++)
+  {
+    CHECK_EQ(SentNum, i + 1U);
+    CHECK_EQ(Sent[i].Opcode, TestOpcode(i));
+    CHECK_EQ(Sent[i].Len, 1U + i);
+    CHECK_EQ(Sent[i].Param[0], 0x10U + i);
+    CHECK_EQ(Sent[i].Param[i], 0x10U + i);
+
+    /* Commands alternate Command Status and Command Complete answers */
+    if (i & 1U)
+    {
+      InjectCmdStatus(TestOpcode(i), (uint8_t)i);
+    }
+    else
+    {
+      InjectCmdComplete(TestOpcode(i), Return, sizeof(Return));
+    }
+
+    /* The answer is reported from the main loop only */
+    CHECK_EQ(CbNum, i);
+    hci_user_evt_proc();
+    CHECK_EQ(CbNum, i + 1U);
+    CHECK_EQ(CbCall[i].User, i);
+
+    if (i & 1U)
+    {
+      CHECK_EQ(CbCall[i].Status, i);
+      CHECK_EQ(CbCall[i].HasReturn, 0);
+      CHECK_EQ(CbCall[i].ReturnLen, 0);
+    }
+    else
+    {
+      CHECK_EQ(CbCall[i].Status, BLE_STATUS_SUCCESS);
+      CHECK_EQ(CbCall[i].HasReturn, 1);
+      CHECK_EQ(CbCall[i].ReturnLen, sizeof(Return));
+      CHECK_EQ(CbCall[i].Return[1], 0x34);
+      CHECK_EQ(CbCall[i].Return[2], 0x12);
+    }
+  }
+
+  CHECK_EQ(SentNum, ASYNC_CMD_NUM);
+  CHECK_EQ(UserEvtNum, 0);
+
+  /* The table is empty again, the longest parameters fit */
+  CHECK_EQ(QueueRequest(0, ASYNC_PARAM_MAX + 1U), -1);
+  CHECK_EQ(SentNum, ASYNC_CMD_NUM);
+  CHECK_EQ(QueueRequest(0, ASYNC_PARAM_MAX), 0);
+  CHECK_EQ(SentNum, ASYNC_CMD_NUM + 1U);
+  CHECK_EQ(Sent[ASYNC_CMD_NUM].Len, ASYNC_PARAM_MAX);
+  CHECK_EQ(Sent[ASYNC_CMD_NUM].Param[ASYNC_PARAM_MAX - 1U], 0x10);
+  InjectCmdStatus(TestOpcode(0), BLE_STATUS_SUCCESS);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, ASYNC_CMD_NUM + 1U);
+}
+
+/**
+  * @brief  The events that are not the answer to the request on the air are
+  *         passed to the application in order, the request stays on the air
+  * @retval None
+  */
+static void TestEventMatching(void)
+{
+  uint8_t Return = BLE_STATUS_SUCCESS;
+
+  ResetLogs();
+
+  CHECK_EQ(QueueRequest(1, 2), 0);
+  CHECK_EQ(QueueRequest(2, 2), 0);
+  CHECK_EQ(SentNum, 1);
+
+  /* An application event, the answers to another command and a truncated
+   * Command Complete */
+  InjectVendor(0x01);
+  InjectCmdStatus(TestOpcode(2), BLE_STATUS_SUCCESS);
+  InjectCmdComplete(TestOpcode(3), &Return, 1);
+  InjectEvent(EVT_CMD_COMPLETE, &Return, 1);
+  InjectVendor(0x02);
+
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 0);
+  CHECK_EQ(SentNum, 1);
+  CHECK_EQ(UserEvtNum, 5);
+  CHECK_EQ(UserEvt[0], 0x01);
+  CHECK_EQ(UserEvt[1], EVT_CMD_STATUS);
+  CHECK_EQ(UserEvt[2], EVT_CMD_COMPLETE);
+  CHECK_EQ(UserEvt[3], EVT_CMD_COMPLETE);
+  CHECK_EQ(UserEvt[4], 0x02);
+
+  /* The answer behind an application event: both are delivered, in order */
+  InjectVendor(0x03);
+  InjectCmdComplete(TestOpcode(1), &Return, 1);
+  InjectVendor(0x04);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 1);
+  CHECK_EQ(CbCall[0].User, 1);
+  CHECK_EQ(UserEvtNum, 7);
+  CHECK_EQ(UserEvt[5], 0x03);
+  CHECK_EQ(UserEvt[6], 0x04);
+
+  /* The completion sent the next request, answered by Command Status */
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(Sent[1].Opcode, TestOpcode(2));
+  InjectCmdStatus(TestOpcode(2), BLE_STATUS_INSUFFICIENT_RESOURCES);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(CbCall[1].Status, BLE_STATUS_INSUFFICIENT_RESOURCES);
+
+  /* Without a request on the air the answers go to the application */
+  InjectCmdStatus(TestOpcode(2), BLE_STATUS_SUCCESS);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(UserEvtNum, 8);
+  CHECK_EQ(UserEvt[7], EVT_CMD_STATUS);
+}
+
+/**
+  * @brief  A request without answer is completed with BLE_STATUS_TIMEOUT
+  *         after HCI_DEFAULT_TIMEOUT_MS and the next one is sent
+  * @param  StartTick: tick when the first request is sent
+  * @retval None
+  */
+static void TestTimeout(uint32_t StartTick)
+{
+  uint8_t Return = BLE_STATUS_SUCCESS;
+
+  ResetLogs();
+  HostTick = StartTick;
+
+  CHECK_EQ(QueueRequest(4, 1), 0);
+  CHECK_EQ(QueueRequest(5, 1), 0);
+  CHECK_EQ(SentNum, 1);
+
+  HostTick = StartTick + HCI_DEFAULT_TIMEOUT_MS;
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 0);
+  CHECK_EQ(SentNum, 1);
+
+  HostTick++;
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 1);
+  CHECK_EQ(CbCall[0].User, 4);
+  CHECK_EQ(CbCall[0].Status, BLE_STATUS_TIMEOUT);
+  CHECK_EQ(CbCall[0].HasReturn, 0);
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(Sent[1].Opcode, TestOpcode(5));
+
+  /* The late answer does not complete the next request */
+  InjectCmdComplete(TestOpcode(4), &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 1);
+  CHECK_EQ(UserEvtNum, 1);
+
+  /* The timeout restarts when the next request is sent */
+  HostTick += HCI_DEFAULT_TIMEOUT_MS;
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 1);
+
+  /* A new request detects the timeout too, before being queued */
+  HostTick++;
+  CHECK_EQ(QueueRequest(6, 1), 0);
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(CbCall[1].User, 5);
+  CHECK_EQ(CbCall[1].Status, BLE_STATUS_TIMEOUT);
+  CHECK_EQ(SentNum, 3);
+  CHECK_EQ(Sent[2].Opcode, TestOpcode(6));
+
+  InjectCmdComplete(TestOpcode(6), &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 3);
+  CHECK_EQ(CbCall[2].Status, BLE_STATUS_SUCCESS);
+}
+
+/**
+  * @brief  A callback can queue a request: it is sent after the ones
+  *         already queued
+  * @retval None
+  */
+static void TestCallbackRequeue(void)
+{
+  struct hci_request rq;
+  uint8_t Param = 0;
+  uint8_t Return = BLE_STATUS_SUCCESS;
+
+  ResetLogs();
+
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = TEST_OGF;
+  rq.ocf = TEST_OCF_BASE + 7U;
+  rq.cparam = &Param;
+  rq.clen = 1;
+  CHECK_EQ(hci_send_req_async(&rq, RequeueCb, (void *)7), 0);
+  CHECK_EQ(QueueRequest(8, 1), 0);
+
+  InjectCmdComplete(TestOpcode(7), &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 1);
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(Sent[1].Opcode, TestOpcode(8));
+
+  InjectCmdComplete(TestOpcode(8), &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(SentNum, 3);
+  CHECK_EQ(Sent[2].Opcode, TestOpcode(0x80));
+  CHECK_EQ(Sent[2].Param[0], 0xA5);
+
+  InjectCmdStatus(TestOpcode(0x80), BLE_STATUS_SUCCESS);
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 3);
+  CHECK_EQ(CbCall[2].User, 0x80);
+}
+
+/**
+  * @brief  A synchronous request waits for the queued ones, the application
+  *         events received meanwhile are kept
+  * @retval None
+  */
+static void TestSyncAfterAsync(void)
+{
+  struct hci_request rq;
+  uint8_t Param = 0;
+  uint8_t Resp[4] = {0xEE, 0xEE, 0xEE, 0xEE};
+
+  ResetLogs();
+
+  CHECK_EQ(QueueRequest(9, 1), 0);
+  CHECK_EQ(QueueRequest(10, 1), 0);
+  InjectVendor(0x05);
+
+  AutoAnswer = 1;
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = TEST_OGF;
+  rq.ocf = TEST_OCF_BASE + 11U;
+  rq.event = EVT_CMD_COMPLETE;
+  rq.cparam = &Param;
+  rq.clen = 1;
+  rq.rparam = Resp;
+  rq.rlen = sizeof(Resp);
+  InjectCmdComplete(TestOpcode(9), &Param, 1);
+  CHECK_EQ(hci_send_req(&rq, FALSE), 0);
+  AutoAnswer = 0;
+
+  CHECK_EQ(SentNum, 3);
+  CHECK_EQ(Sent[0].Opcode, TestOpcode(9));
+  CHECK_EQ(Sent[1].Opcode, TestOpcode(10));
+  CHECK_EQ(Sent[2].Opcode, TestOpcode(11));
+  CHECK_EQ(rq.rlen, 1);
+  CHECK_EQ(Resp[0], BLE_STATUS_SUCCESS);
+  CHECK_EQ(Resp[1], 0xEE);
+
+  /* Both asynchronous requests completed, the event is still there */
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(CbCall[0].User, 9);
+  CHECK_EQ(CbCall[1].User, 10);
+  CHECK_EQ(UserEvtNum, 0);
+  hci_user_evt_proc();
+  CHECK_EQ(UserEvtNum, 1);
+  CHECK_EQ(UserEvt[0], 0x05);
+}
+
+/**
+  * @brief  A request queued by a callback while a synchronous request is
+  *         waiting is sent after it: a stream refilled from the callbacks
+  *         does not delay the synchronous request
+  * @retval None
+  */
+static void TestSyncAfterRequeue(void)
+{
+  struct hci_request rq;
+  uint8_t Param = 0;
+  uint8_t Resp[4] = {0};
+
+  ResetLogs();
+
+  AutoAnswer = 1;
+  memset(&rq, 0, sizeof(rq));
+  rq.ogf = TEST_OGF;
+  rq.ocf = TEST_OCF_BASE + 7U;
+  rq.cparam = &Param;
+  rq.clen = 1;
+  CHECK_EQ(hci_send_req_async(&rq, RequeueCb, (void *)7), 0);
+
+  rq.ocf = TEST_OCF_BASE + 12U;
+  rq.event = EVT_CMD_COMPLETE;
+  rq.rparam = Resp;
+  rq.rlen = sizeof(Resp);
+  CHECK_EQ(hci_send_req(&rq, FALSE), 0);
+  AutoAnswer = 0;
+
+  /* The request queued by the callback has been held until the answer */
+  CHECK_EQ(SentNum, 3);
+  CHECK_EQ(Sent[0].Opcode, TestOpcode(7));
+  CHECK_EQ(Sent[1].Opcode, TestOpcode(12));
+  CHECK_EQ(Sent[2].Opcode, TestOpcode(0x80));
+  CHECK_EQ(Resp[0], BLE_STATUS_SUCCESS);
+  CHECK_EQ(CbNum, 1);
+  CHECK_EQ(CbCall[0].User, 7);
+
+  hci_user_evt_proc();
+  CHECK_EQ(CbNum, 2);
+  CHECK_EQ(CbCall[1].User, 0x80);
+  CHECK_EQ(SentNum, 3);
+}
+
+/**
+  * @brief  The answer to the update on the air when the connection is closed
+  *         is ignored: the values posted after BleNotify_Reset are sent next
+  * @retval None
+  */
+static void TestNotifyEpoch(void)
+{
+  uint8_t Old[2] = {0x11, 0x22};
+  uint8_t New[3] = {0x33, 0x44, 0x55};
+  uint8_t Env[1] = {0x66};
+  uint8_t Return = BLE_STATUS_SUCCESS;
+  BleNotify_Stats_t Stats;
+
+  ResetLogs();
+  BleNotify_Register(BLE_NOTIFY_TAICHI, TAICHI_SERV, TAICHI_CHAR);
+  BleNotify_Register(BLE_NOTIFY_ENVIRONMENTAL, ENV_SERV, ENV_CHAR);
+
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Old, sizeof(Old), ReliableDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_Post(BLE_NOTIFY_ENVIRONMENTAL, Env, sizeof(Env)), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 1);
+  CHECK_EQ(Sent[0].Opcode, OPCODE_UPDATE);
+  CHECK_EQ(Sent[0].Len, 6U + sizeof(Old));
+  CHECK_EQ(Sent[0].Param[2], (uint8_t)TAICHI_CHAR);
+  CHECK_EQ(Sent[0].Param[6], 0x11);
+
+  /* Disconnection: the queued values are dropped, the reliable one with an error */
+  BleNotify_Reset();
+  CHECK_EQ(DoneNum, 1);
+  CHECK_EQ(DoneStatus[0], BLE_STATUS_ERROR);
+  CHECK_EQ(BleNotify_HasBacklog(), 0);
+
+  /* New connection: the value waits for the answer to the stale update */
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, New, sizeof(New), ReliableDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 1);
+
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 1);
+  BleNotify_GetStats(&Stats);
+  CHECK_EQ(Stats.Sent, 0);
+
+  /* Only the value posted after the reset is sent */
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(Sent[1].Len, 6U + sizeof(New));
+  CHECK_EQ(Sent[1].Param[6], 0x33);
+  CHECK_EQ(Sent[1].Param[8], 0x55);
+
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 2);
+  CHECK_EQ(DoneStatus[1], BLE_STATUS_SUCCESS);
+  BleNotify_GetStats(&Stats);
+  CHECK_EQ(Stats.Sent, 1);
+  CHECK_EQ(Stats.SentBytes, sizeof(New));
+  CHECK_EQ(SentNum, 2);
+}
+
+/**
+  * @brief  An update without answer is completed with an error and the
+  *         next one is sent
+  * @retval None
+  */
+static void TestNotifyTimeout(void)
+{
+  uint8_t First[1] = {0x77};
+  uint8_t Second[1] = {0x88};
+  uint8_t Return = BLE_STATUS_SUCCESS;
+  BleNotify_Stats_t Stats;
+
+  ResetLogs();
+
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, First, sizeof(First), ReliableDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Second, sizeof(Second), ReliableDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Second, sizeof(Second), ReliableDone),
+           BLE_STATUS_INSUFFICIENT_RESOURCES);
+  CHECK_EQ(SentNum, 1);
+
+  HostTick += HCI_DEFAULT_TIMEOUT_MS + 1U;
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 1);
+  CHECK_EQ(DoneStatus[0], BLE_STATUS_TIMEOUT);
+  BleNotify_GetStats(&Stats);
+  CHECK_EQ(Stats.Errors, 1);
+
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(Sent[1].Param[6], 0x88);
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 2);
+  CHECK_EQ(DoneStatus[1], BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_HasBacklog(), 0);
+}
+
+/**
+  * @brief  The reliable values queued behind a failed one can be dropped by
+  *         its completion before going on the air, the others are kept in order
+  * @retval None
+  */
+static void TestNotifyDropReliable(void)
+{
+  uint8_t First[1] = {0x91};
+  uint8_t Second[1] = {0x92};
+  uint8_t Other[1] = {0x93};
+  uint8_t Env[1] = {0x94};
+  uint8_t Error = BLE_STATUS_ERROR;
+  uint8_t Return = BLE_STATUS_SUCCESS;
+
+  ResetLogs();
+
+  /* The value behind the failed one is not sent and not completed */
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, First, sizeof(First), DropOnErrorDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Second, sizeof(Second), DropOnErrorDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 1);
+  CHECK_EQ(Sent[0].Param[6], 0x91);
+
+  InjectCmdComplete(OPCODE_UPDATE, &Error, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 1);
+  CHECK_EQ(DoneStatus[0], BLE_STATUS_ERROR);
+  CHECK_EQ(DroppedNum, 1);
+  CHECK_EQ(SentNum, 1);
+  CHECK_EQ(BleNotify_HasBacklog(), 0);
+
+  /* The value on the air stays until its answer */
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, First, sizeof(First), DropOnErrorDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 2);
+  CHECK_EQ(BleNotify_DropReliable(DropOnErrorDone), 0);
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 2);
+  CHECK_EQ(DoneStatus[1], BLE_STATUS_SUCCESS);
+
+  /* Both queued behind another update: only the ones of the other completion are kept */
+  CHECK_EQ(BleNotify_Post(BLE_NOTIFY_ENVIRONMENTAL, Env, sizeof(Env)), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 3);
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Second, sizeof(Second), DropOnErrorDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_PostReliable(BLE_NOTIFY_TAICHI, Other, sizeof(Other), ReliableDone), BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_DropReliable(DropOnErrorDone), 1);
+  CHECK_EQ(SentNum, 3);
+
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(SentNum, 4);
+  CHECK_EQ(Sent[3].Param[2], (uint8_t)TAICHI_CHAR);
+  CHECK_EQ(Sent[3].Param[6], 0x93);
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(DoneNum, 3);
+  CHECK_EQ(DoneStatus[2], BLE_STATUS_SUCCESS);
+  CHECK_EQ(BleNotify_HasBacklog(), 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Fake SPI transport of the BlueNRG-2
+  * @retval None
+  */
+void hci_tl_lowlevel_init(void)
+{
+  tHciIO fops;
+
+  memset(&fops, 0, sizeof(fops));
+  fops.Send    = FakeSend;
+  fops.Receive = FakeReceive;
+
+  hci_register_io_bus(&fops);
+}
+
+void hci_tl_lowlevel_kick(void)
+{
+  KickNum++;
+}
+
+tBleStatus Stderr_Update(uint8_t *data, uint8_t length)
+{
+  StderrNum++;
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  A failed update is reported on stderr from the main loop,
+  *         not from the completion callback
+  * @retval None
+  */
+static void TestNotifyReportErrors(void)
+{
+  uint8_t Env[1] = {0x99};
+  uint8_t Return = BLE_STATUS_ERROR;
+
+  ResetLogs();
+  /* Errors of the previous tests */
+  BleNotify_ReportErrors();
+  ConnectionBleStatus = W2ST_CONNECT_STD_ERR;
+  StderrNum = 0;
+
+  CHECK_EQ(BleNotify_Post(BLE_NOTIFY_ENVIRONMENTAL, Env, sizeof(Env)), BLE_STATUS_SUCCESS);
+  CHECK_EQ(SentNum, 1);
+  InjectCmdComplete(OPCODE_UPDATE, &Return, 1);
+  hci_user_evt_proc();
+  CHECK_EQ(StderrNum, 0);
+  CHECK_EQ(BleNotify_HasBacklog(), 0);
+
+  BleNotify_ReportErrors();
+  CHECK_EQ(StderrNum, 1);
+  CHECK(strstr((char *)BufferToWrite, "Environmental") != NULL);
+
+  /* Reported once */
+  BleNotify_ReportErrors();
+  CHECK_EQ(StderrNum, 1);
+  ConnectionBleStatus = 0;
+}
+
+int main(void)
+{
+  hci_init(UserEvtRx, NULL);
+
+  TestPendingTable();
+  TestEventMatching();
+  TestTimeout(1000U);
+  /* Across the wrap of the tick */
+  TestTimeout(0xFFFFFFFFU - (HCI_DEFAULT_TIMEOUT_MS / 2U));
+  TestCallbackRequeue();
+  TestSyncAfterAsync();
+  TestSyncAfterRequeue();
+  TestNotifyEpoch();
+  TestNotifyTimeout();
+  TestNotifyDropReliable();
+  TestNotifyReportErrors();
+
+  return UNIT_TEST_END("test_hci_tl");
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
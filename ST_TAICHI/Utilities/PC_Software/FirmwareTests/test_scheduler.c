@@ -0,0 +1,334 @@
+/**
+  ******************************************************************************
+  * @file    test_scheduler.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host unit test of the main loop scheduler (Src/Scheduler.c)
+  *          driven by a simulated 1 ms tick
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+#include "Scheduler.h"
+#include "unit_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LOG_MAX_LEN   4096U
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Tick;                    /* Simulated HAL tick [ms] */
+static uint32_t IdleCalls;
+static uint32_t IdleUnmasked;            /* Idle entries with interrupts enabled */
+static uint32_t IdleWithPending;         /* Idle entries with events pending */
+
+static SchedEvent_t DispatchLog[LOG_MAX_LEN];
+static uint32_t DispatchTick[LOG_MAX_LEN];
+static uint32_t DispatchNum;
+
+static uint32_t PostTick[SCHED_EVT_NUMBER];
+static uint32_t MaxLatency;              /* Max ticks from post to dispatch */
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Record the dispatch of one event
+  * @param  Event: dispatched event
+  * @retval None
+  */
+static void LogDispatch(SchedEvent_t Event)
+{
+  CHECK_EQ(HostPrimask, 0);
+
+  if (DispatchNum < LOG_MAX_LEN)
+  {
+    DispatchLog[DispatchNum] = Event;
+    DispatchTick[DispatchNum] = Tick;
+    DispatchNum++;
+  }
+
+  if ((Tick - PostTick[Event]) > MaxLatency)
+  {
+    MaxLatency = Tick - PostTick[Event];
+  }
+}
+
+static void OnHci(void)       { LogDispatch(SCHED_EVT_HCI); }
+static void OnMotionMl(void)  { LogDispatch(SCHED_EVT_MOTION_ML); }
+static void OnAccGyroMag(void) { LogDispatch(SCHED_EVT_ACC_GYRO_MAG); }
+static void OnAudio(void)     { LogDispatch(SCHED_EVT_AUDIO_LEVEL); }
+static void OnEnv(void)       { LogDispatch(SCHED_EVT_ENV); }
+static void OnBattery(void)   { LogDispatch(SCHED_EVT_BATTERY_INFO); }
+
+/* The TaiChi handler posts a higher and a lower priority event, like an
+ * interrupt served while it runs */
+static void OnTaiChi(void)
+{
+  LogDispatch(SCHED_EVT_TAICHI);
+  PostTick[SCHED_EVT_HCI] = Tick;
+  Sched_Post(SCHED_EVT_HCI);
+  PostTick[SCHED_EVT_ENV] = Tick;
+  Sched_Post(SCHED_EVT_ENV);
+}
+
+/**
+  * @brief  Post an event from a simulated interrupt
+  * @param  Event: event to post
+  * @retval None
+  */
+static void IrqPost(SchedEvent_t Event)
+{
+  if ((Sched_Pending() & (1UL << Event)) == 0U)
+  {
+    PostTick[Event] = Tick;
+  }
+  Sched_Post(Event);
+}
+
+/**
+  * @brief  Simulated timers of the main loop, called on every tick
+  * @retval None
+  */
+static void TickInterrupts(void)
+{
+  if ((Tick % 20U) == 0U)
+  {
+    IrqPost(SCHED_EVT_ACC_GYRO_MAG);
+  }
+  if ((Tick % 50U) == 0U)
+  {
+    IrqPost(SCHED_EVT_AUDIO_LEVEL);
+  }
+  if ((Tick % 500U) == 0U)
+  {
+    IrqPost(SCHED_EVT_ENV);
+  }
+  if ((Tick % 5000U) == 0U)
+  {
+    IrqPost(SCHED_EVT_BATTERY_INFO);
+  }
+  if ((Tick % 333U) == 0U)
+  {
+    /* MLC interrupt and BlueNRG-2 event on the same tick */
+    IrqPost(SCHED_EVT_BATTERY_INFO);
+    IrqPost(SCHED_EVT_MOTION_ML);
+    IrqPost(SCHED_EVT_HCI);
+  }
+}
+
+/**
+  * @brief  Idle handler: WFI until the next SysTick, that also runs the timers
+  * @retval None
+  */
+static void IdleWfi(void)
+{
+  IdleCalls++;
+  if (HostPrimask == 0U)
+  {
+    IdleUnmasked++;
+  }
+  if (Sched_Pending() != 0U)
+  {
+    IdleWithPending++;
+  }
+
+  /* The interrupt wakes up the core, it is served once PRIMASK is restored */
+  Tick++;
+  TickInterrupts();
+}
+
+/**
+  * @brief  Idle handler that never sleeps
+  * @retval None
+  */
+static void IdleCount(void)
+{
+  IdleCalls++;
+  if (HostPrimask == 0U)
+  {
+    IdleUnmasked++;
+  }
+}
+
+/**
+  * @brief  Clear the recorded state and attach all the handlers
+  * @param  IdleHandler: idle handler to use
+  * @retval None
+  */
+static void Setup(SchedHandler_t IdleHandler)
+{
+  Tick = 0;
+  IdleCalls = 0;
+  IdleUnmasked = 0;
+  IdleWithPending = 0;
+  DispatchNum = 0;
+  MaxLatency = 0;
+  memset(PostTick, 0, sizeof(PostTick));
+  HostPrimask = 0;
+
+  Sched_Init(IdleHandler);
+  Sched_Register(SCHED_EVT_HCI, OnHci);
+  Sched_Register(SCHED_EVT_MOTION_ML, OnMotionMl);
+  Sched_Register(SCHED_EVT_TAICHI, OnTaiChi);
+  Sched_Register(SCHED_EVT_ACC_GYRO_MAG, OnAccGyroMag);
+  Sched_Register(SCHED_EVT_AUDIO_LEVEL, OnAudio);
+  Sched_Register(SCHED_EVT_ENV, OnEnv);
+  Sched_Register(SCHED_EVT_BATTERY_INFO, OnBattery);
+}
+
+/**
+  * @brief  One event for each Sched_Run, the lowest value first, the idle
+  *         handler only when nothing is pending
+  */
+static void TestDispatchOrder(void)
+{
+  Setup(IdleCount);
+
+  Sched_Post(SCHED_EVT_BATTERY_INFO);
+  Sched_Post(SCHED_EVT_ENV);
+  Sched_Post(SCHED_EVT_HCI);
+  Sched_Post(SCHED_EVT_ACC_GYRO_MAG);
+  Sched_Post(SCHED_EVT_ENV);           /* Already pending: coalesced */
+  Sched_Post(SCHED_EVT_BUTTON);        /* No handler: only cleared */
+
+  CHECK_EQ(Sched_Pending(), (1UL << SCHED_EVT_BATTERY_INFO) | (1UL << SCHED_EVT_ENV) |
+                            (1UL << SCHED_EVT_HCI) | (1UL << SCHED_EVT_ACC_GYRO_MAG) |
+                            (1UL << SCHED_EVT_BUTTON));
+
+  Sched_Run();
+  CHECK_EQ(DispatchNum, 1);
+  CHECK_EQ(DispatchLog[0], SCHED_EVT_HCI);
+
+  Sched_Run();                         /* SCHED_EVT_BUTTON */
+  CHECK_EQ(DispatchNum, 1);
+  Sched_Run();
+  Sched_Run();
+  Sched_Run();
+  CHECK_EQ(DispatchNum, 4);
+  CHECK_EQ(DispatchLog[1], SCHED_EVT_ACC_GYRO_MAG);
+  CHECK_EQ(DispatchLog[2], SCHED_EVT_ENV);
+  CHECK_EQ(DispatchLog[3], SCHED_EVT_BATTERY_INFO);
+  CHECK_EQ(Sched_Pending(), 0);
+  CHECK_EQ(IdleCalls, 0);
+
+  Sched_Run();
+  CHECK_EQ(IdleCalls, 1);
+  CHECK_EQ(IdleUnmasked, 0);
+  CHECK_EQ(HostPrimask, 0);            /* PRIMASK restored after the idle */
+  CHECK_EQ(DispatchNum, 4);
+}
+
+/**
+  * @brief  Events posted by a handler: the higher priority one overtakes the
+  *         events already pending, the lower priority one waits its turn
+  */
+static void TestPostFromHandler(void)
+{
+  Setup(IdleCount);
+
+  Sched_Post(SCHED_EVT_AUDIO_LEVEL);
+  Sched_Post(SCHED_EVT_TAICHI);
+
+  Sched_Run();
+  Sched_Run();
+  Sched_Run();
+  Sched_Run();
+  CHECK_EQ(DispatchNum, 4);
+  CHECK_EQ(DispatchLog[0], SCHED_EVT_TAICHI);
+  CHECK_EQ(DispatchLog[1], SCHED_EVT_HCI);
+  CHECK_EQ(DispatchLog[2], SCHED_EVT_AUDIO_LEVEL);
+  CHECK_EQ(DispatchLog[3], SCHED_EVT_ENV);
+  CHECK_EQ(IdleCalls, 0);
+}
+
+/**
+  * @brief  Main loop driven by the simulated tick: every event is dispatched in
+  *         the tick it is posted, by priority, and the idle handler is entered
+  *         masked and only with nothing pending
+  */
+static void TestSimulatedTick(void)
+{
+  uint32_t Counts[SCHED_EVT_NUMBER] = {0};
+  uint32_t i;
+  uint32_t OrderErrors = 0;
+
+  Setup(IdleWfi);
+
+  /* Tick 0 timers */
+  TickInterrupts();
+
+  while (Tick < 10000U)
+  {
+    Sched_Run();
+  }
+
+  for (i = 0; i < DispatchNum; i++)
+  {
+    Counts[DispatchLog[i]]++;
+
+    /* In the same tick the events come out by priority */
+    if ((i > 0U) && (DispatchTick[i] == DispatchTick[i - 1U]) && (DispatchLog[i] <= DispatchLog[i - 1U]))
+    {
+      OrderErrors++;
+    }
+  }
+
+  CHECK_EQ(OrderErrors, 0);
+  CHECK_EQ(Counts[SCHED_EVT_ACC_GYRO_MAG], 10000U / 20U);
+  CHECK_EQ(Counts[SCHED_EVT_AUDIO_LEVEL], 10000U / 50U);
+  CHECK_EQ(Counts[SCHED_EVT_ENV], 10000U / 500U);
+  /* The 333 ms posts (ticks 0 to 9990) plus tick 5000, tick 0 is coalesced */
+  CHECK_EQ(Counts[SCHED_EVT_BATTERY_INFO], (10000U / 333U) + 2U);
+  CHECK_EQ(Counts[SCHED_EVT_MOTION_ML], (10000U / 333U) + 1U);
+  CHECK_EQ(Counts[SCHED_EVT_HCI], (10000U / 333U) + 1U);
+  CHECK_EQ(MaxLatency, 0);
+
+  /* One idle entry for each tick, always masked and with nothing pending */
+  CHECK_EQ(IdleCalls, 10000);
+  CHECK_EQ(IdleUnmasked, 0);
+  CHECK_EQ(IdleWithPending, 0);
+  CHECK_EQ(HostPrimask, 0);
+}
+
+/**
+  * @brief  Sched_Run called with interrupts already masked keeps them masked
+  */
+static void TestMaskedCaller(void)
+{
+  Setup(IdleCount);
+
+  HostPrimask = 1U;
+  Sched_Post(SCHED_EVT_BUTTON);        /* No handler: nothing dispatched masked */
+  CHECK_EQ(HostPrimask, 1);
+  Sched_Run();
+  CHECK_EQ(HostPrimask, 1);
+  Sched_Run();
+  CHECK_EQ(IdleCalls, 1);
+  CHECK_EQ(HostPrimask, 1);
+  HostPrimask = 0U;
+}
+
+/**
+  * @brief  Main program
+  * @retval 0 if all the checks passed
+  */
+int main(void)
+{
+  TestDispatchOrder();
+  TestPostFromHandler();
+  TestSimulatedTick();
+  TestMaskedCaller();
+
+  return UNIT_TEST_END("test_scheduler");
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
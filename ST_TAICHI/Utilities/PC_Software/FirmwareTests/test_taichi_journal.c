@@ -0,0 +1,517 @@
+/**
+  ******************************************************************************
+  * @file    test_taichi_journal.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host unit test of the TaiChi flash journal (Src/TaiChiJournal.c)
+  *          on the simulated flash, with a power cut at every flash operation
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+
+#include "TaiChiJournal.h"
+#include "flash_sim.h"
+#include "unit_test.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Same layout as TaiChiJournal.c: 32 bytes records */
+#define JOURNAL_RECORD_SIZE     32U
+#define JOURNAL_SLOTS_PER_PAGE  (FLASH_PAGE_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_SLOTS           (TAICHI_JOURNAL_PAGES * JOURNAL_SLOTS_PER_PAGE)
+#define JOURNAL_SLOT_ADD(n)     (TAICHI_JOURNAL_ADD_START + (n) * JOURNAL_RECORD_SIZE)
+
+/* Gestures of the power cut workload: it wraps the journal once */
+#define WORKLOAD_GESTURES       (JOURNAL_SLOTS + JOURNAL_SLOTS_PER_PAGE / 2U)
+/* Gestures kept pending by the workload consumer */
+#define WORKLOAD_BACKLOG        3U
+#define MODEL_MAX_ID            (3U * WORKLOAD_GESTURES)
+
+/* Private variables ---------------------------------------------------------*/
+static CRC_HandleTypeDef hcrc;
+static jmp_buf PowerCutEnv;
+
+/* Reference model of the power cut workload */
+static uint32_t ModelNextId;             /* Next gesture to append */
+static int32_t ModelAppending;           /* Gesture inside TaiChiJournal_Append, -1 if none */
+static uint8_t ModelAcked[MODEL_MAX_ID]; /* TaiChiJournal_Append returned 1 */
+static int32_t ModelLastReleased;        /* Newest gesture released, -1 if none */
+static int32_t ModelReleaseFirst;        /* Gestures inside TaiChiJournal_Release, -1 if none */
+static int32_t ModelReleaseLast;
+static uint32_t ModelErrors;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Append the gesture number Id
+  * @param  Id: gesture number, stored in the type field
+  * @retval TaiChiJournal_Append result
+  */
+static uint8_t AppendId(uint32_t Id)
+{
+  taiChiResult_t Item;
+
+  Item.type = (uint16_t)Id;
+  Item.start = Id * 10U;
+  Item.end = Id * 10U + 5U;
+
+  return TaiChiJournal_Append(&Item);
+}
+
+/**
+  * @brief  Read the Index-th pending gesture number
+  * @param  Index: 0 for the oldest one
+  * @retval Gesture number or -1 if it can not be read
+  */
+static int32_t ReadId(uint32_t Index)
+{
+  taiChiResult_t Item;
+
+  if (!TaiChiJournal_Read(Index, &Item))
+  {
+    return -1;
+  }
+
+  /* The duration survives the timeline shift of a reset */
+  if ((Item.end - Item.start) != 5U)
+  {
+    return -2;
+  }
+
+  return (int32_t)Item.type;
+}
+
+/**
+  * @brief  Restart the firmware on the current flash
+  * @retval None
+  */
+static void Reboot(void)
+{
+  TaiChiJournal_Init(&hcrc);
+}
+
+/**
+  * @brief  Fresh erased journal
+  * @retval None
+  */
+static void FreshJournal(void)
+{
+  FlashSim_Erase();
+  Reboot();
+}
+
+/**
+  * @brief  Gestures come out in order, survive a reset and are released
+  */
+static void TestAppendRead(void)
+{
+  uint32_t i;
+
+  FreshJournal();
+  CHECK_EQ(TaiChiJournal_Count(), 0);
+  CHECK_EQ(ReadId(0), -1);
+
+  for (i = 0; i < 10U; i++)
+  {
+    CHECK_EQ(AppendId(i), 1);
+  }
+  CHECK_EQ(TaiChiJournal_Count(), 10);
+  for (i = 0; i < 10U; i++)
+  {
+    CHECK_EQ(ReadId(i), i);
+  }
+  CHECK_EQ(ReadId(10), -1);
+
+  TaiChiJournal_Release(4);
+  CHECK_EQ(TaiChiJournal_Count(), 6);
+  CHECK_EQ(ReadId(0), 4);
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 6);
+  for (i = 0; i < 6U; i++)
+  {
+    CHECK_EQ(ReadId(i), 4U + i);
+  }
+
+  /* New gestures come after the ones of the previous run */
+  CHECK_EQ(AppendId(10), 1);
+  CHECK_EQ(ReadId(6), 10);
+
+  TaiChiJournal_Release(100);
+  CHECK_EQ(TaiChiJournal_Count(), 0);
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 0);
+  CHECK_EQ(TaiChiJournal_Dropped(), 0);
+}
+
+/**
+  * @brief  Recycling a page drops its pending gestures and moves the cursor
+  *         after it, also when the cursor is in the middle of the page
+  */
+static void TestRecycleCursor(void)
+{
+  uint32_t id;
+
+  FreshJournal();
+
+  for (id = 0; id < JOURNAL_SLOTS; id++)
+  {
+    CHECK_EQ(AppendId(id), 1);
+  }
+  CHECK_EQ(TaiChiJournal_Count(), JOURNAL_SLOTS);
+  CHECK_EQ(TaiChiJournal_Dropped(), 0);
+
+  /* Wrap: page 0 is recycled with all its gestures */
+  CHECK_EQ(AppendId(id), 1);
+  id++;
+  CHECK_EQ(TaiChiJournal_Count(), JOURNAL_SLOTS - JOURNAL_SLOTS_PER_PAGE + 1U);
+  CHECK_EQ(TaiChiJournal_Dropped(), JOURNAL_SLOTS_PER_PAGE);
+  CHECK_EQ(ReadId(0), JOURNAL_SLOTS_PER_PAGE);
+  CHECK_EQ(ReadId(TaiChiJournal_Count() - 1U), JOURNAL_SLOTS);
+
+  /* Cursor in the middle of page 1 */
+  TaiChiJournal_Release(100);
+  CHECK_EQ(ReadId(0), JOURNAL_SLOTS_PER_PAGE + 100U);
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), JOURNAL_SLOTS - JOURNAL_SLOTS_PER_PAGE + 1U - 100U);
+  CHECK_EQ(ReadId(0), JOURNAL_SLOTS_PER_PAGE + 100U);
+
+  /* Fill page 0 again, the next gesture recycles page 1 under the cursor */
+  while (id < (2U * JOURNAL_SLOTS_PER_PAGE + JOURNAL_SLOTS))
+  {
+    CHECK_EQ(AppendId(id), 1);
+    id++;
+  }
+  CHECK_EQ(TaiChiJournal_Dropped(), JOURNAL_SLOTS_PER_PAGE - 100U);
+  CHECK_EQ(ReadId(0), 2U * JOURNAL_SLOTS_PER_PAGE);
+  CHECK_EQ(ReadId(TaiChiJournal_Count() - 1U), id - 1U);
+  CHECK_EQ(TaiChiJournal_Count(), id - 2U * JOURNAL_SLOTS_PER_PAGE);
+
+  Reboot();
+  CHECK_EQ(ReadId(0), 2U * JOURNAL_SLOTS_PER_PAGE);
+  CHECK_EQ(TaiChiJournal_Count(), id - 2U * JOURNAL_SLOTS_PER_PAGE);
+}
+
+/**
+  * @brief  A record torn by a reset is not read back and its slot is skipped
+  */
+static void TestTornRecord(void)
+{
+  uint32_t i;
+  uint32_t ops;
+  const uint32_t *pSeq;
+
+  FreshJournal();
+
+  for (i = 0; i < 5U; i++)
+  {
+    CHECK_EQ(AppendId(i), 1);
+  }
+
+  /* Power lost after the first double word (Seq) of the 6th record */
+  ops = FlashSim_OpCount();
+  FlashSim_PowerCut(ops + 1U, FLASH_SIM_CUT_BEFORE, &PowerCutEnv);
+  if (setjmp(PowerCutEnv) == 0)
+  {
+    (void)AppendId(5);
+    CHECK(0);
+  }
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 5);
+  pSeq = (const uint32_t *)JOURNAL_SLOT_ADD(5);
+  CHECK(*pSeq != 0xFFFFFFFFU);
+
+  /* The torn slot is consumed: the next record goes in slot 6 */
+  CHECK_EQ(AppendId(6), 1);
+  pSeq = (const uint32_t *)JOURNAL_SLOT_ADD(6);
+  CHECK_EQ(*pSeq, *(const uint32_t *)JOURNAL_SLOT_ADD(5) + 1U);
+  CHECK_EQ(TaiChiJournal_Count(), 6);
+  CHECK_EQ(ReadId(4), 4);
+  CHECK_EQ(ReadId(5), 6);
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 6);
+  CHECK_EQ(ReadId(5), 6);
+}
+
+/**
+  * @brief  A slot left dirty in the middle of a page moves the writing to the
+  *         next page
+  */
+static void TestDirtySlot(void)
+{
+  uint32_t i;
+
+  FreshJournal();
+
+  for (i = 0; i < 10U; i++)
+  {
+    CHECK_EQ(AppendId(i), 1);
+  }
+
+  /* Leftover of an interrupted erase after the next free slot */
+  HAL_FLASH_Unlock();
+  CHECK_EQ(HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, JOURNAL_SLOT_ADD(11), 0x0000FFFF00000000ULL), HAL_OK);
+  HAL_FLASH_Lock();
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 10);
+
+  CHECK_EQ(AppendId(10), 1);
+  CHECK_EQ(AppendId(11), 1);
+  CHECK_EQ(*(const uint32_t *)JOURNAL_SLOT_ADD(10), 10);
+  CHECK(*(const uint32_t *)JOURNAL_SLOT_ADD(JOURNAL_SLOTS_PER_PAGE) != 0xFFFFFFFFU);
+  CHECK_EQ(TaiChiJournal_Count(), 12);
+  for (i = 0; i < 12U; i++)
+  {
+    CHECK_EQ(ReadId(i), i);
+  }
+
+  Reboot();
+  CHECK_EQ(TaiChiJournal_Count(), 12);
+  CHECK_EQ(ReadId(11), 11);
+  CHECK_EQ(AppendId(12), 1);
+  CHECK_EQ(ReadId(12), 12);
+  CHECK_EQ(TaiChiJournal_Dropped(), 0);
+}
+
+/**
+  * @brief  Check the model and count the first failures
+  * @param  Cond: condition to check
+  * @param  Msg: description
+  * @param  Op: flash operation cut
+  * @param  Cut: effect of the cut
+  * @retval None
+  */
+static void ModelCheck(int Cond, const char *Msg, uint32_t Op, FlashSim_Cut_t Cut)
+{
+  UnitTestChecks++;
+  if (!Cond)
+  {
+    UnitTestFailures++;
+    if (ModelErrors++ < 20U)
+    {
+      printf("power cut at op %u (cut %d): %s\n", (unsigned)Op, (int)Cut, Msg);
+    }
+  }
+}
+
+/**
+  * @brief  Producer and consumer of the main loop: append the gestures and
+  *         release the oldest ones, keeping a few of them pending
+  * @param  Gestures: gestures to append
+  * @param  Op: flash operation cut (for the messages)
+  * @param  Cut: effect of the cut (for the messages)
+  * @retval None
+  */
+static void Workload(uint32_t Gestures, uint32_t Op, FlashSim_Cut_t Cut)
+{
+  int32_t id;
+  uint32_t i;
+  uint32_t n;
+
+  while (Gestures--)
+  {
+    ModelAppending = (int32_t)ModelNextId;
+    ModelCheck(AppendId(ModelNextId) == 1U, "append failed", Op, Cut);
+    ModelAcked[ModelNextId] = 1;
+    ModelAppending = -1;
+    ModelNextId++;
+
+    n = TaiChiJournal_Count();
+    if (n > WORKLOAD_BACKLOG)
+    {
+      n -= WORKLOAD_BACKLOG;
+
+      /* The oldest gestures come out in order, after the released ones */
+      for (i = 0; i < n; i++)
+      {
+        id = ReadId(i);
+        ModelCheck(id > ModelLastReleased + (int32_t)i, "read out of order", Op, Cut);
+        if (i == (n - 1U))
+        {
+          ModelReleaseFirst = ReadId(0);
+          ModelReleaseLast = id;
+        }
+      }
+
+      TaiChiJournal_Release(n);
+      ModelLastReleased = ModelReleaseLast;
+      ModelReleaseFirst = -1;
+      ModelReleaseLast = -1;
+    }
+  }
+}
+
+/**
+  * @brief  Journal after the reboot: the acknowledged gestures not released
+  *         are all there in order, the released ones are gone
+  * @param  Op: flash operation cut
+  * @param  Cut: effect of the cut
+  * @retval None
+  */
+static void CheckAfterCut(uint32_t Op, FlashSim_Cut_t Cut)
+{
+  uint32_t count = TaiChiJournal_Count();
+  uint32_t i;
+  int32_t id;
+  int32_t prev = ModelLastReleased;
+  int32_t expected;
+  uint8_t inBatch;
+  uint8_t batchSeen = 0;
+
+  expected = ModelLastReleased + 1;
+
+  for (i = 0; i < count; i++)
+  {
+    id = ReadId(i);
+    ModelCheck(id >= 0, "pending gesture can not be read", Op, Cut);
+    ModelCheck(id > prev, "gesture released or out of order", Op, Cut);
+    ModelCheck((id < (int32_t)ModelNextId) || (id == ModelAppending), "unknown gesture", Op, Cut);
+
+    /* Every acknowledged gesture in between must be there, except the ones
+     * whose release was running */
+    while (expected < id)
+    {
+      inBatch = ((ModelReleaseFirst >= 0) && (expected >= ModelReleaseFirst) && (expected <= ModelReleaseLast)) ? 1U : 0U;
+      ModelCheck((ModelAcked[expected] == 0U) || (inBatch != 0U), "acknowledged gesture lost", Op, Cut);
+      /* The release marks the oldest gestures first */
+      ModelCheck((inBatch == 0U) || (batchSeen == 0U), "release not in order", Op, Cut);
+      expected++;
+    }
+    if ((ModelReleaseFirst >= 0) && (id >= ModelReleaseFirst) && (id <= ModelReleaseLast))
+    {
+      batchSeen = 1U;
+    }
+    expected = id + 1;
+    prev = id;
+  }
+
+  while (expected < (int32_t)ModelNextId)
+  {
+    inBatch = ((ModelReleaseFirst >= 0) && (expected >= ModelReleaseFirst) && (expected <= ModelReleaseLast)) ? 1U : 0U;
+    ModelCheck((ModelAcked[expected] == 0U) || (inBatch != 0U), "acknowledged gesture lost", Op, Cut);
+    expected++;
+  }
+
+  /* What is left is the new baseline of the model */
+  if (count != 0U)
+  {
+    id = ReadId(0);
+    if (id > 0)
+    {
+      ModelLastReleased = (id - 1 > ModelLastReleased) ? (id - 1) : ModelLastReleased;
+    }
+  }
+  else if ((int32_t)ModelNextId - 1 > ModelLastReleased)
+  {
+    ModelLastReleased = (int32_t)ModelNextId - 1;
+  }
+  if (ModelAppending >= 0)
+  {
+    ModelNextId = (uint32_t)ModelAppending + 1U;
+  }
+  ModelAppending = -1;
+  ModelReleaseFirst = -1;
+  ModelReleaseLast = -1;
+}
+
+/**
+  * @brief  Run the workload with a power cut at flash operation Op, reboot,
+  *         check the journal and run the workload again on the same flash
+  * @param  Op: flash operation to cut
+  * @param  Cut: effect of the cut
+  * @retval 1 if the cut happened
+  */
+static int PowerCutTrial(uint32_t Op, FlashSim_Cut_t Cut)
+{
+  uint32_t count;
+
+  FreshJournal();
+  memset(ModelAcked, 0, sizeof(ModelAcked));
+  ModelNextId = 0;
+  ModelAppending = -1;
+  ModelLastReleased = -1;
+  ModelReleaseFirst = -1;
+  ModelReleaseLast = -1;
+
+  FlashSim_PowerCut(Op, Cut, &PowerCutEnv);
+  if (setjmp(PowerCutEnv) == 0)
+  {
+    Workload(WORKLOAD_GESTURES, Op, Cut);
+    FlashSim_PowerCut(0, Cut, NULL);
+    return 0;
+  }
+
+  Reboot();
+  CheckAfterCut(Op, Cut);
+
+  /* The journal goes on working across another wrap */
+  Workload(JOURNAL_SLOTS + 1U, Op, Cut);
+
+  count = TaiChiJournal_Count();
+  ModelCheck(ReadId(count - 1U) == (int32_t)ModelNextId - 1, "newest gesture missing", Op, Cut);
+  TaiChiJournal_Release(count);
+  ModelCheck(TaiChiJournal_Count() == 0U, "release all", Op, Cut);
+  ModelCheck(TaiChiJournal_Dropped() == 0U, "pending gesture recycled", Op, Cut);
+
+  Reboot();
+  ModelCheck(TaiChiJournal_Count() == 0U, "released gesture back after reboot", Op, Cut);
+
+  return 1;
+}
+
+/**
+  * @brief  Power cut at every program and erase operation of the workload
+  */
+static void TestPowerCutEverywhere(void)
+{
+  uint32_t Op;
+  uint32_t Trials = 0;
+  FlashSim_Cut_t Cut;
+
+  for (Cut = FLASH_SIM_CUT_BEFORE; Cut < FLASH_SIM_CUT_NUM; Cut++)
+  {
+    for (Op = 0; PowerCutTrial(Op, Cut); Op++)
+    {
+      Trials++;
+    }
+  }
+
+  printf("test_taichi_journal: %u power cuts\n", (unsigned)Trials);
+  CHECK(Trials > (FLASH_SIM_CUT_NUM * WORKLOAD_GESTURES * 3U));
+}
+
+/**
+  * @brief  Main program
+  * @retval 0 if all the checks passed
+  */
+int main(void)
+{
+  if (!FlashSim_Init())
+  {
+    return 1;
+  }
+
+  TestAppendRead();
+  TestRecycleCursor();
+  TestTornRecord();
+  TestDirtySlot();
+  TestPowerCutEverywhere();
+
+  return UNIT_TEST_END("test_taichi_journal");
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
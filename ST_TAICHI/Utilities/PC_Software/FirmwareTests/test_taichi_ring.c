@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    test_taichi_ring.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Host unit test of the TaiChi result ring (Src/TaiChiRing.c)
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "TaiChiRing.h"
+#include "unit_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+static taiChiRing_t Ring;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Push a gesture numbered n
+  * @param  n: gesture number, stored in every field
+  * @retval TaiChiRing_Push result
+  */
+static uint8_t PushNum(uint32_t n)
+{
+  taiChiResult_t Item;
+
+  Item.type = (uint16_t)n;
+  Item.start = n;
+  Item.end = n + 1U;
+
+  return TaiChiRing_Push(&Ring, &Item);
+}
+
+/**
+  * @brief  Empty ring: nothing to peek, release does not underflow
+  */
+static void TestEmpty(void)
+{
+  TaiChiRing_Init(&Ring);
+
+  CHECK_EQ(TaiChiRing_Count(&Ring), 0);
+  CHECK(TaiChiRing_Peek(&Ring, 0) == NULL);
+
+  TaiChiRing_Release(&Ring, 3);
+  CHECK_EQ(TaiChiRing_Count(&Ring), 0);
+  CHECK_EQ(Ring.Tail, Ring.Head);
+}
+
+/**
+  * @brief  Gestures come out in push order, partial releases keep the order
+  */
+static void TestDrainOrder(void)
+{
+  const taiChiResult_t *pItem;
+  uint32_t i;
+
+  TaiChiRing_Init(&Ring);
+
+  for (i = 0; i < 10U; i++)
+  {
+    CHECK_EQ(PushNum(i), 1);
+  }
+  CHECK_EQ(TaiChiRing_Count(&Ring), 10);
+
+  for (i = 0; i < 10U; i++)
+  {
+    pItem = TaiChiRing_Peek(&Ring, i);
+    CHECK(pItem != NULL);
+    if (pItem != NULL)
+    {
+      CHECK_EQ(pItem->start, i);
+      CHECK_EQ(pItem->end, i + 1U);
+    }
+  }
+  CHECK(TaiChiRing_Peek(&Ring, 10) == NULL);
+
+  TaiChiRing_Release(&Ring, 4);
+  CHECK_EQ(TaiChiRing_Count(&Ring), 6);
+  pItem = TaiChiRing_Peek(&Ring, 0);
+  CHECK((pItem != NULL) && (pItem->start == 4U));
+
+  /* A release larger than the content only empties the ring */
+  TaiChiRing_Release(&Ring, 100);
+  CHECK_EQ(TaiChiRing_Count(&Ring), 0);
+  CHECK(TaiChiRing_Peek(&Ring, 0) == NULL);
+}
+
+/**
+  * @brief  A full ring drops the new gestures and keeps the oldest ones
+  */
+static void TestOverflow(void)
+{
+  const taiChiResult_t *pItem;
+  uint32_t i;
+
+  TaiChiRing_Init(&Ring);
+
+  for (i = 0; i < BUFF_TAICHIRESULT_SIZE; i++)
+  {
+    CHECK_EQ(PushNum(i), 1);
+  }
+  CHECK_EQ(TaiChiRing_Count(&Ring), BUFF_TAICHIRESULT_SIZE);
+  CHECK_EQ(Ring.Dropped, 0);
+
+  CHECK_EQ(PushNum(100), 0);
+  CHECK_EQ(PushNum(101), 0);
+  CHECK_EQ(TaiChiRing_Count(&Ring), BUFF_TAICHIRESULT_SIZE);
+  CHECK_EQ(Ring.Dropped, 2);
+
+  pItem = TaiChiRing_Peek(&Ring, 0);
+  CHECK((pItem != NULL) && (pItem->start == 0U));
+  pItem = TaiChiRing_Peek(&Ring, BUFF_TAICHIRESULT_SIZE - 1U);
+  CHECK((pItem != NULL) && (pItem->start == (BUFF_TAICHIRESULT_SIZE - 1U)));
+
+  /* Room for one more after a release */
+  TaiChiRing_Release(&Ring, 1);
+  CHECK_EQ(PushNum(102), 1);
+  pItem = TaiChiRing_Peek(&Ring, BUFF_TAICHIRESULT_SIZE - 1U);
+  CHECK((pItem != NULL) && (pItem->start == 102U));
+  CHECK_EQ(Ring.Dropped, 2);
+
+  /* Init clears the drop counter */
+  TaiChiRing_Init(&Ring);
+  CHECK_EQ(Ring.Dropped, 0);
+}
+
+/**
+  * @brief  The slot index wraps around the storage, the free running indexes
+  *         wrap around 2^32
+  */
+static void TestWraparound(void)
+{
+  const taiChiResult_t *pItem;
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  uint32_t round;
+  uint32_t i;
+
+  TaiChiRing_Init(&Ring);
+
+  /* Uneven push/release steps walk every slot position many times */
+  for (round = 0; round < 5U * BUFF_TAICHIRESULT_SIZE; round++)
+  {
+    for (i = 0; i < 5U; i++)
+    {
+      CHECK_EQ(PushNum(next), 1);
+      next++;
+    }
+    for (i = 0; i < 5U; i++)
+    {
+      pItem = TaiChiRing_Peek(&Ring, 0);
+      CHECK((pItem != NULL) && (pItem->start == expected));
+      TaiChiRing_Release(&Ring, 1);
+      expected++;
+    }
+  }
+  CHECK_EQ(TaiChiRing_Count(&Ring), 0);
+  CHECK_EQ(Ring.Dropped, 0);
+
+  /* Indexes just below 2^32: Count and Peek work across the overflow */
+  Ring.Head = 0xFFFFFFFAU;
+  Ring.Tail = 0xFFFFFFFAU;
+  for (i = 0; i < BUFF_TAICHIRESULT_SIZE; i++)
+  {
+    CHECK_EQ(PushNum(1000U + i), 1);
+  }
+  CHECK(Ring.Head < Ring.Tail);
+  CHECK_EQ(TaiChiRing_Count(&Ring), BUFF_TAICHIRESULT_SIZE);
+  CHECK_EQ(PushNum(2000), 0);
+
+  for (i = 0; i < BUFF_TAICHIRESULT_SIZE; i++)
+  {
+    pItem = TaiChiRing_Peek(&Ring, 0);
+    CHECK((pItem != NULL) && (pItem->start == (1000U + i)));
+    TaiChiRing_Release(&Ring, 1);
+  }
+  CHECK_EQ(TaiChiRing_Count(&Ring), 0);
+  CHECK_EQ(Ring.Tail, Ring.Head);
+}
+
+/**
+  * @brief  Main program
+  * @retval 0 if all the checks passed
+  */
+int main(void)
+{
+  TestEmpty();
+  TestDrainOrder();
+  TestOverflow();
+  TestWraparound();
+
+  return UNIT_TEST_END("test_taichi_ring");
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
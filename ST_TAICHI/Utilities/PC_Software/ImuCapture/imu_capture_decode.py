@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+# ******************************************************************************
+# @file    imu_capture_decode.py
+# @author  System Research & Applications Team - Catania Lab.
+# @version V2.2.0
+# @date    16-March-2020
+# @brief   Decoder for the raw Acc/Gyro/Mag capture streamed by the TaiChi
+#          firmware over the USB CDC (see Inc/ImuCapture.h)
+# ******************************************************************************
+# @attention
+#
+# <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted under the terms of the BSD 3-Clause license
+# reported in the firmware sources.
+# ******************************************************************************
+"""Decode the IMU capture stream into CSV (and NPY) files.
+
+The capture is toggled with the user button. Every frame is 10 bytes:
+    Sync 0xA5 | Type | Seq (uint16 LE) | Data (6 bytes LE)
+
+Usage:
+    imu_capture_decode.py --port COM5 --seconds 30 out/capture
+    imu_capture_decode.py --file capture.bin out/capture
+
+It writes <prefix>_imu.csv (one row for each FIFO batch, with the time
+rebuilt from the ISM330DHCX timestamp) and <prefix>_mag.csv, plus the
+matching .npy files when numpy is available (or --npy is set).
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+FRAME_LEN = 10
+
+TYPE_GYRO = 0x01
+TYPE_ACC = 0x02
+TYPE_TIME = 0x04
+TYPE_MAG = 0x80
+TYPE_CFG_ACC = 0x81
+TYPE_CFG_GYRO = 0x82
+TYPE_CFG_MAG = 0x83
+
+KNOWN_TYPES = (TYPE_GYRO, TYPE_ACC, TYPE_TIME, TYPE_MAG,
+               TYPE_CFG_ACC, TYPE_CFG_GYRO, TYPE_CFG_MAG)
+
+# ISM330DHCX timestamp resolution [s]
+TIMESTAMP_LSB = 25e-6
+
+IMU_COLUMNS = ("seq", "t_s", "acc_x", "acc_y", "acc_z", "gyro_x", "gyro_y", "gyro_z")
+MAG_COLUMNS = ("seq", "t_s", "mag_x", "mag_y", "mag_z")
+
+
+class Decoder:
+    """Frame parser, it resynchronizes on the sync byte after text or garbage."""
+
+    def __init__(self, raw=False):
+        self.raw = raw
+        self.pending = bytearray()
+        self.sens = {TYPE_CFG_ACC: None, TYPE_CFG_GYRO: None, TYPE_CFG_MAG: None}
+        self.odr = {}
+        self.last_seq = None
+        self.frames = 0
+        self.lost = 0
+        self.skipped = 0
+        self.ts_last = None
+        self.ts_high = 0
+        self.time = None
+        self.row = None
+        self.imu = []
+        self.mag = []
+
+    def feed(self, data):
+        buf = self.pending
+        buf += data
+        pos = 0
+        while len(buf) - pos >= FRAME_LEN:
+            if buf[pos] != SYNC or buf[pos + 1] not in KNOWN_TYPES:
+                pos += 1
+                self.skipped += 1
+                continue
+            # After a resync also the next frame must be aligned
+            if self.last_seq is None and len(buf) - pos >= 2 * FRAME_LEN \
+                    and buf[pos + FRAME_LEN] != SYNC:
+                pos += 1
+                self.skipped += 1
+                continue
+            self._frame(bytes(buf[pos:pos + FRAME_LEN]))
+            pos += FRAME_LEN
+        del buf[:pos]
+
+    def _frame(self, frame):
+        ftype = frame[1]
+        seq, = struct.unpack_from("<H", frame, 2)
+        if self.last_seq is not None:
+            self.lost += (seq - self.last_seq - 1) & 0xFFFF
+        self.last_seq = seq
+        self.frames += 1
+
+        if ftype in (TYPE_CFG_ACC, TYPE_CFG_GYRO, TYPE_CFG_MAG):
+            sens, odr = struct.unpack_from("<fH", frame, 4)
+            self.sens[ftype] = sens
+            self.odr[ftype] = odr
+        elif ftype == TYPE_TIME:
+            ticks, = struct.unpack_from("<I", frame, 4)
+            if self.ts_last is not None and ticks < self.ts_last:
+                self.ts_high += 1 << 32
+            self.ts_last = ticks
+            self.time = (self.ts_high + ticks) * TIMESTAMP_LSB
+            self._flush_row()
+            self.row = [seq, self.time] + [None] * 6
+        elif ftype in (TYPE_ACC, TYPE_GYRO):
+            xyz = self._scale(struct.unpack_from("<hhh", frame, 4),
+                              TYPE_CFG_ACC if ftype == TYPE_ACC else TYPE_CFG_GYRO)
+            if self.row is None:
+                self.row = [seq, self.time] + [None] * 6
+            first = 2 if ftype == TYPE_ACC else 5
+            if self.row[first] is not None:
+                # Same sensor twice without timestamp: start a new batch
+                self._flush_row()
+                self.row = [seq, self.time] + [None] * 6
+            self.row[first:first + 3] = xyz
+        elif ftype == TYPE_MAG:
+            xyz = self._scale(struct.unpack_from("<hhh", frame, 4), TYPE_CFG_MAG)
+            self.mag.append([seq, self.time] + list(xyz))
+
+    def _scale(self, xyz, cfg):
+        sens = self.sens[cfg]
+        if self.raw or sens is None:
+            return list(xyz)
+        return [v * sens for v in xyz]
+
+    def _flush_row(self):
+        if self.row is not None and any(v is not None for v in self.row[2:]):
+            self.imu.append(self.row)
+        self.row = None
+
+    def finish(self):
+        self._flush_row()
+
+
+def write_csv(path, columns, rows):
+    with open(path, "w", newline="") as out:
+        writer = csv.writer(out)
+        writer.writerow(columns)
+        for row in rows:
+            writer.writerow(["" if v is None else v for v in row])
+
+
+def write_npy(path, columns, rows):
+    import numpy as np
+    dtype = [(name, "u2" if name == "seq" else "f8") for name in columns]
+    table = np.array([tuple(float("nan") if v is None else v for v in row) for row in rows],
+                     dtype=dtype)
+    np.save(path, table)
+
+
+def read_port(port, seconds, decoder):
+    import serial
+    with serial.Serial(port, 115200, timeout=0.1) as ser:
+        end = time.monotonic() + seconds
+        while time.monotonic() < end:
+            decoder.feed(ser.read(4096))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="USB CDC serial port (needs pyserial)")
+    source.add_argument("--file", help="binary dump of the USB CDC stream")
+    parser.add_argument("--seconds", type=float, default=10.0,
+                        help="capture length when reading from --port")
+    parser.add_argument("--raw", action="store_true",
+                        help="keep the raw LSB values instead of mg/mdps/mgauss")
+    parser.add_argument("--npy", action="store_true", help="write also the .npy files")
+    parser.add_argument("prefix", help="output files prefix")
+    args = parser.parse_args()
+
+    decoder = Decoder(raw=args.raw)
+    if args.port:
+        read_port(args.port, args.seconds, decoder)
+    else:
+        with open(args.file, "rb") as dump:
+            decoder.feed(dump.read())
+    decoder.finish()
+
+    write_csv(args.prefix + "_imu.csv", IMU_COLUMNS, decoder.imu)
+    write_csv(args.prefix + "_mag.csv", MAG_COLUMNS, decoder.mag)
+
+    npy = args.npy
+    if not npy:
+        try:
+            import numpy  # noqa: F401
+            npy = True
+        except ImportError:
+            pass
+    if npy:
+        write_npy(args.prefix + "_imu.npy", IMU_COLUMNS, decoder.imu)
+        write_npy(args.prefix + "_mag.npy", MAG_COLUMNS, decoder.mag)
+
+    odr = ", ".join("%s %d Hz" % (name, decoder.odr[t])
+                    for name, t in (("acc", TYPE_CFG_ACC), ("gyro", TYPE_CFG_GYRO),
+                                    ("mag", TYPE_CFG_MAG)) if t in decoder.odr)
+    print("%d frames (%s), %d IMU rows, %d mag samples, %d frames lost, %d bytes skipped"
+          % (decoder.frames, odr or "no configuration frame", len(decoder.imu),
+             len(decoder.mag), decoder.lost, decoder.skipped))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    arm_bitreversal_host.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   C version of the table based bit reversal of arm_bitreversal2.S,
+  *          used by the CFFT functions of the host build
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/**
+  * @brief  In-place 32 bit reversal, each table entry pair holds the byte
+  *         offsets of two complex values to swap
+  * @param  pSrc Complex data to reorder
+  * @param  bitRevLen Number of table entries
+  * @param  pBitRevTab Bit reversal table
+  * @return None
+  */
+void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTab)
+{
+  uint32_t a, b, i, tmp;
+
+  for (i = 0; i < bitRevLen; i += 2)
+  {
+    a = pBitRevTab[i] >> 2;
+    b = pBitRevTab[i + 1] >> 2;
+
+    tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+
+    tmp = pSrc[a + 1];
+    pSrc[a + 1] = pSrc[b + 1];
+    pSrc[b + 1] = tmp;
+  }
+}
+
+/**
+  * @brief  In-place 16 bit reversal, same table layout of arm_bitreversal_32
+  * @param  pSrc Complex data to reorder
+  * @param  bitRevLen Number of table entries
+  * @param  pBitRevTab Bit reversal table
+  * @return None
+  */
+void arm_bitreversal_16(uint16_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTab)
+{
+  uint32_t a, b, i;
+  uint16_t tmp;
+
+  for (i = 0; i < bitRevLen; i += 2)
+  {
+    a = pBitRevTab[i] >> 2;
+    b = pBitRevTab[i + 1] >> 2;
+
+    tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+
+    tmp = pSrc[a + 1];
+    pSrc[a + 1] = pSrc[b + 1];
+    pSrc[b + 1] = tmp;
+  }
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,1280 @@
+/**
+  ******************************************************************************
+  * @file    motionsp_replay.c
+  * @author  System Research & Applications Team - Catania Lab.
+  * @version V2.2.0
+  * @date    16-March-2020
+  * @brief   Replay of a recorded accelerometer stream through the MotionSP
+  *          time and frequency domain analysis, at the max host speed
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2020 STMicroelectronics</center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted under the terms of the BSD 3-Clause license
+  * reported in the firmware sources.
+  *
+  ******************************************************************************
+  *
+  * The samples are processed as MotionSP_VibrationAnalysis does on the board:
+  * FIFO blocks of the watermark size, DC filter and circular buffer for each
+  * sample, time domain block, one FFT every (100-FftOvl)% of FftSize samples
+  * and the alarms at the end of each acquisition of tacq ms (data time).
+  *
+  * Usage:
+  *   motionsp_replay [options] capture_imu.csv
+  *   motionsp_replay [options] -g 60,500,30
+  *
+  * The input is a text file with one sample for each line, the fields are
+  * separated by commas, semicolons, tabs or spaces and the lines that do not
+  * begin with a number are skipped. The default columns are the ones of the
+  * <prefix>_imu.csv written by ImuCapture/imu_capture_decode.py: time [s] in
+  * column 1, acceleration X-Y-Z [mg] in columns 2-4 (first column is 0).
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MotionSP.h"
+#include "MotionSP_Alarm.h"
+
+/* Private define ------------------------------------------------------------*/
+#define REPLAY_ODR_DEFAULT        6660.0f   //!< Accelerometer ODR [Hz] when the input has no time column
+#define REPLAY_SENS_DEFAULT       0.122f    //!< ISM330DHCX sensitivity at 4 g [mg/LSB]
+#define REPLAY_ACC_COL_DEFAULT    2         //!< First acceleration column of the ImuCapture CSV
+#define REPLAY_TIME_COL_DEFAULT   1         //!< Time column of the ImuCapture CSV
+#define REPLAY_SYNTH_SEC_DEFAULT  30.0f     //!< Length of the synthetic stream [s]
+#define REPLAY_LINE_LEN           1024      //!< Max input line length
+#define REPLAY_FIELDS_MAX         32        //!< Max fields for each input line
+#define ACC_BLOCK_MAX_LEN         FFT_SIZE_MAX  //!< Max samples of a FIFO block, the watermark is 3/4 of the FFT shift at most
+#define REPLAY_TD_CHECK_TOL       1e-3f     //!< Max relative difference of the block and per-sample time domain RMS
+#define REPLAY_TD_CHECK_SPEED_MIN 1e-6f     //!< Speed RMS [m/s] below which the difference is relative to this value
+#define REPLAY_TD_CHECK_ACC_MIN   1e-3f     //!< Acc RMS [m/s^2] below which the difference is relative to this value
+#define REPLAY_FFT_CHECK_TOL      1e-5f     //!< Max difference of the fused and per-axis spectra, relative to the peak
+
+/* The per-axis reference computes the float magnitude spectrum */
+#if !defined(MOTIONSP_USE_Q15) && !defined(MOTIONSP_USE_PSD)
+#define REPLAY_FFT_CHECK
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief  Processing stages measured by the replay
+  */
+typedef enum
+{
+  STAGE_DC_FILTER = 0,    //!< MotionSP_accDelOffset of the block samples
+  STAGE_CIRC_BUFF,        //!< MotionSP_CreateAccCircBuffer (and MotionSP_SdftUpdateBlock) of the block samples
+  STAGE_TIME_DOMAIN,      //!< MotionSP_TimeDomainProcessBlock
+#ifdef MOTIONSP_USE_SDFT
+  STAGE_SDFT_EVAL,        //!< MotionSP_SdftEvalAmplitude and its alarm check
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_ENVELOPE
+  STAGE_ENVELOPE,         //!< MotionSP_EnvelopeProcessBlock and MotionSP_EnvelopeDone
+#endif /* MOTIONSP_USE_ENVELOPE */
+  STAGE_FFT,              //!< MotionSP_FrequencyDomainProcess
+  STAGE_ALARM,            //!< Time and frequency domain alarms
+  STAGE_NUM
+} Replay_Stage_t;
+
+/**
+  * @brief  Time spent inside a processing stage
+  */
+typedef struct
+{
+  const char *Name;       //!< Stage name
+  uint64_t Ns;            //!< Total time [ns]
+  uint32_t Calls;         //!< Number of measures
+} sReplayStage_t;
+
+/**
+  * @brief  Replay options
+  */
+typedef struct
+{
+  const char *InFile;     //!< Input file, NULL for the synthetic stream
+  const char *SpecFile;   //!< Output file for the averaged spectra, NULL if not requested
+  float Odr;              //!< Accelerometer ODR [Hz], 0 to evaluate it from the time column
+  float Sens;             //!< Accelerometer sensitivity [mg/LSB]
+  uint8_t RawLsb;         //!< The input accelerations are in LSB instead of mg
+  int AccCol;             //!< Column of the X acceleration
+  int TimeCol;            //!< Column of the time [s], -1 if not available
+  uint32_t Loops;         //!< Number of replays of the whole stream
+  uint8_t Quiet;          //!< Report the benchmark only
+  uint8_t TdCheck;        //!< Check the time domain block against the per-sample evaluation
+  uint8_t FftCheck;       //!< Check the fused FFT pass against the per-axis pipeline
+  float SynthFreq;        //!< Synthetic stream: frequency [Hz]
+  float SynthAmp;         //!< Synthetic stream: amplitude [mg]
+  float SynthSec;         //!< Synthetic stream: length [s]
+} sReplayOpt_t;
+
+/**
+  * @brief  Differences of MotionSP_TimeDomainProcessBlock from MotionSP_TimeDomainProcess
+  */
+typedef struct
+{
+  uint32_t Blocks;        //!< Blocks compared
+  float PeakDiff;         //!< Max difference of the acceleration peaks [m/s^2]
+  float SpeedRmsDiff;     //!< Max relative difference of the speed RMS
+  float AccRmsDiff;       //!< Max relative difference of the acceleration RMS
+} sReplayTdCheck_t;
+
+#ifdef REPLAY_FFT_CHECK
+/**
+  * @brief  Differences of the fused MotionSP_FrequencyDomainProcess from the per-axis pipeline
+  */
+typedef struct
+{
+  uint32_t Spectra;       //!< Spectra computed by both (3 axes each)
+  uint32_t Averages;      //!< Averaged spectra compared
+  uint32_t PeakMismatch;  //!< Averages with a different peak bin
+  float SpecDiff;         //!< Max difference of the averaged spectra, relative to the axis peak
+  uint64_t RefNs;         //!< Time of the per-axis pipeline [ns]
+} sReplayFftCheck_t;
+#endif /* REPLAY_FFT_CHECK */
+
+/* Private variables ---------------------------------------------------------*/
+static MotionSP_Context_t ReplayCtx;
+
+/* Reference pipelines of the check options, on their own context */
+static MotionSP_Context_t RefCtx;
+static sReplayTdCheck_t TdCheck;
+#ifdef REPLAY_FFT_CHECK
+static sReplayFftCheck_t FftCheck;
+static sAccAxesArray_t FftRefIn;
+static float FftRefWin[FFT_SIZE_MAX];
+static float FftRefMag[FFT_SIZE_MAX];
+#endif /* REPLAY_FFT_CHECK */
+
+static sReplayStage_t Stage[STAGE_NUM] =
+{
+  {"DC filter", 0, 0},
+#ifdef MOTIONSP_USE_SDFT
+  {"Circ buffer+SDFT", 0, 0},
+#else /* MOTIONSP_USE_SDFT */
+  {"Circ buffer", 0, 0},
+#endif /* MOTIONSP_USE_SDFT */
+  {"Time domain", 0, 0},
+#ifdef MOTIONSP_USE_SDFT
+  {"SDFT eval", 0, 0},
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_ENVELOPE
+  {"Envelope", 0, 0},
+#endif /* MOTIONSP_USE_ENVELOPE */
+  {"FFT average", 0, 0},
+  {"Alarms", 0, 0},
+};
+
+static const char *const WindowName[] = {"RECTANGULAR", "HANNING", "HAMMING", "FLAT_TOP"};
+static const char *const TdTypeName[] = {"TD_SPEED", "TD_ACCELERO", "TD_BOTH_TAU"};
+static const char *const AlarmName[] = {"GOOD", "WARNING", "ALARM", "NO_ALARM"};
+
+/* Accelerometer stream in LSB, as read from the FIFO */
+static int16_t (*AccLsb)[NUM_AXES];
+static uint32_t AccLsbNum;
+
+/* Alarm status, as kept by MotionSP_Manager.c for the MotionSP_Alarm.c functions */
+static sTimeDomainAlarm_t sTdAlarm;
+static sAcceleroParam_t sTimeDomainVal;
+static sTimeDomainThresh_t sTdRmsThresholds;
+static sTimeDomainThresh_t sTdPkThresholds;
+static float *FDWarnThresh;
+static float *FDAlarmThresh;
+static sSubrange_t THR_Check;
+static sFreqDomainAlarm_t THR_Fft_Alarms;
+
+#ifdef MOTIONSP_USE_SDFT
+static uint8_t SdftOnly;
+static uint8_t SdftReseedCnt;
+static sSubrange_t SdftAmplitude;
+static sSubrange_t SdftAmplitudeSum;
+static uint16_t SdftAmplitudeCnt;
+#endif /* MOTIONSP_USE_SDFT */
+
+/* Private function prototypes -----------------------------------------------*/
+static void Usage(const char *pName);
+static int ParseOptions(int argc, char **argv, sReplayOpt_t *pOpt);
+static int LoadStream(sReplayOpt_t *pOpt);
+static int SynthStream(sReplayOpt_t *pOpt);
+static int AppendSample(const float *pMg, const sReplayOpt_t *pOpt);
+static uint32_t Replay(const sReplayOpt_t *pOpt, uint8_t Report, FILE *pSpec);
+static void AcquisitionInit(uint8_t *pRestartFlag);
+static void AcquisitionReport(uint32_t AcqId, uint32_t AcqSamples, uint16_t Spectra, FILE *pSpec);
+#ifdef MOTIONSP_USE_SDFT
+static void SdftAcquisitionDone(void);
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_Q15
+static void TdCheckBlock(const SensorVal_q15_t *pAccNoDC, uint32_t BlockLen, uint8_t Restart);
+#else /* MOTIONSP_USE_Q15 */
+static void TdCheckBlock(const SensorVal_f_t *pAccNoDC, uint32_t BlockLen, uint8_t Restart);
+#endif /* MOTIONSP_USE_Q15 */
+static float TdCheckDiff(const SensorVal_f_t *pBlock, const SensorVal_f_t *pRef, float Min);
+#ifdef REPLAY_FFT_CHECK
+static uint8_t FftCheckSpectrum(void);
+static void FftCheckAverage(void);
+#endif /* REPLAY_FFT_CHECK */
+static uint64_t NowNs(void);
+
+/**
+  * @brief  Main program
+  * @param  argc Number of arguments
+  * @param  argv Arguments
+  * @retval 0 in case of success
+  */
+int main(int argc, char **argv)
+{
+  sReplayOpt_t Opt;
+  FILE *pSpec = NULL;
+  uint64_t StartNs, WallNs = 0;
+  uint32_t Spectra = 0;
+  uint32_t Loop;
+  double DataSec, WallSec;
+  int i;
+
+  if (ParseOptions(argc, argv, &Opt) != 0)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  if ((Opt.InFile != NULL) ? LoadStream(&Opt) : SynthStream(&Opt))
+    return 1;
+
+  if (Opt.SpecFile != NULL)
+  {
+    if ((pSpec = fopen(Opt.SpecFile, "w")) == NULL)
+    {
+      fprintf(stderr, "Cannot write %s\n", Opt.SpecFile);
+      return 1;
+    }
+#ifdef MOTIONSP_USE_PSD
+    fprintf(pSpec, "acq,freq_hz,psd_x,psd_y,psd_z\n");
+#else /* MOTIONSP_USE_PSD */
+    fprintf(pSpec, "acq,freq_hz,mag_x,mag_y,mag_z\n");
+#endif /* MOTIONSP_USE_PSD */
+  }
+
+  /* Real accelero ODR, as measured by AccOdrMeas */
+  ReplayCtx.AcceleroODR.Frequency = Opt.Odr;
+  ReplayCtx.AcceleroODR.Period = 1 / ReplayCtx.AcceleroODR.Frequency;
+  ReplayCtx.AcceleroODR.Tau = exp(-(float)(1000 * ReplayCtx.AcceleroODR.Period) / ReplayCtx.Parameters.tau);
+
+  printf("MotionSP replay of %s: %u samples, ODR %.2f Hz, sensitivity %.4f mg/LSB\n",
+         (Opt.InFile != NULL) ? Opt.InFile : "synthetic stream", AccLsbNum, Opt.Odr, Opt.Sens);
+  printf("FFT %u points, %s window, overlap %u%%, tacq %u ms, %u subranges, tau %u ms, %s, %s%s%s\n\n",
+         ReplayCtx.Parameters.FftSize, WindowName[ReplayCtx.Parameters.window], ReplayCtx.Parameters.FftOvl,
+         ReplayCtx.Parameters.tacq, ReplayCtx.Parameters.subrange_num, ReplayCtx.Parameters.tau,
+         TdTypeName[ReplayCtx.Parameters.td_type],
+#ifdef MOTIONSP_USE_Q15
+         "Q15 samples and Q31 FFT",
+#else /* MOTIONSP_USE_Q15 */
+         "float samples and FFT",
+#endif /* MOTIONSP_USE_Q15 */
+#ifdef MOTIONSP_USE_SDFT
+         ", sliding DFT",
+#else /* MOTIONSP_USE_SDFT */
+         "",
+#endif /* MOTIONSP_USE_SDFT */
+#ifdef MOTIONSP_USE_PSD
+         ", Welch PSD in g^2/Hz"
+#else /* MOTIONSP_USE_PSD */
+         ""
+#endif /* MOTIONSP_USE_PSD */
+         );
+
+#ifdef MOTIONSP_USE_ENVELOPE
+  if (MotionSP_EnvelopeInit(&ReplayCtx) == 0)
+    printf("Envelope band %u-%u Hz, decimation %u, envelope spectrum %u points at %.2f Hz\n\n",
+           ReplayCtx.Parameters.env_band_low, ReplayCtx.Parameters.env_band_high, ReplayCtx.Parameters.env_dec,
+           ENV_FFT_SIZE, ReplayCtx.Envelope.Frequency);
+  else
+    printf("Envelope band %u-%u Hz or decimation %u out of range for the ODR, envelope disabled\n\n",
+           ReplayCtx.Parameters.env_band_low, ReplayCtx.Parameters.env_band_high, ReplayCtx.Parameters.env_dec);
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+  /* Each loop replays the whole stream from a new context, the results are reported for the first one */
+  for (Loop = 0; Loop < Opt.Loops; Loop++)
+  {
+    StartNs = NowNs();
+    Spectra += Replay(&Opt, (Loop == 0) && !Opt.Quiet, (Loop == 0) ? pSpec : NULL);
+    WallNs += NowNs() - StartNs;
+  }
+
+  if (pSpec != NULL)
+    fclose(pSpec);
+
+  DataSec = ((double)AccLsbNum * Opt.Loops) / Opt.Odr;
+  WallSec = (double)WallNs * 1e-9;
+  if (WallSec <= 0.0)
+    WallSec = 1e-9;
+
+  printf("Benchmark: %u replays, %.1f s of data processed in %.3f s, %.1f times real time\n",
+         Opt.Loops, DataSec, WallSec, DataSec / WallSec);
+  printf("  %.1f spectra/s (3 axes each), %.0f samples/s\n\n",
+         (double)Spectra / WallSec, ((double)AccLsbNum * Opt.Loops) / WallSec);
+  printf("  %-18s %10s %12s %12s %10s %7s\n", "Stage", "calls", "total [ms]", "ns/call", "ns/sample", "share");
+  for (i = 0; i < STAGE_NUM; i++)
+  {
+    printf("  %-18s %10u %12.3f %12.1f %10.2f %6.1f%%\n", Stage[i].Name, Stage[i].Calls,
+           (double)Stage[i].Ns * 1e-6,
+           (Stage[i].Calls != 0) ? (double)Stage[i].Ns / Stage[i].Calls : 0.0,
+           (double)Stage[i].Ns / ((double)AccLsbNum * Opt.Loops),
+           (100.0 * Stage[i].Ns) / WallNs);
+  }
+
+  free(AccLsb);
+
+  if (Opt.TdCheck)
+  {
+    printf("\nTime domain check, block against per-sample over %u blocks:\n", TdCheck.Blocks);
+    printf("  Acc peak max difference %.3g m/s^2, speed RMS %.3g, acc RMS %.3g (relative)\n",
+           TdCheck.PeakDiff, TdCheck.SpeedRmsDiff, TdCheck.AccRmsDiff);
+
+    if ((TdCheck.Blocks == 0) || (TdCheck.PeakDiff != 0.0f) ||
+        (TdCheck.SpeedRmsDiff > REPLAY_TD_CHECK_TOL) || (TdCheck.AccRmsDiff > REPLAY_TD_CHECK_TOL))
+    {
+      printf("  FAILED, the RMS tolerance is %.3g\n", REPLAY_TD_CHECK_TOL);
+      return 1;
+    }
+    printf("  PASSED\n");
+  }
+
+#ifdef REPLAY_FFT_CHECK
+  if (Opt.FftCheck)
+  {
+    printf("\nFFT check, fused pass against per-axis over %u spectra and %u averages:\n",
+           FftCheck.Spectra, FftCheck.Averages);
+    printf("  Fused %.1f ns/spectrum, per-axis %.1f ns/spectrum (%.2fx)\n",
+           (FftCheck.Spectra != 0) ? (double)Stage[STAGE_FFT].Ns / FftCheck.Spectra : 0.0,
+           (FftCheck.Spectra != 0) ? (double)FftCheck.RefNs / FftCheck.Spectra : 0.0,
+           (Stage[STAGE_FFT].Ns != 0) ? (double)FftCheck.RefNs / Stage[STAGE_FFT].Ns : 0.0);
+    printf("  Averaged spectra max difference %.3g (relative to the peak), %u peak bins differ\n",
+           FftCheck.SpecDiff, FftCheck.PeakMismatch);
+
+    if ((FftCheck.Averages == 0) || (FftCheck.PeakMismatch != 0) || (FftCheck.SpecDiff > REPLAY_FFT_CHECK_TOL))
+    {
+      printf("  FAILED, the tolerance is %.3g\n", REPLAY_FFT_CHECK_TOL);
+      return 1;
+    }
+    printf("  PASSED\n");
+  }
+#endif /* REPLAY_FFT_CHECK */
+
+  return 0;
+}
+
+/**
+  * @brief  Print the command line help
+  * @param  pName Program name
+  * @return None
+  */
+static void Usage(const char *pName)
+{
+  fprintf(stderr,
+          "Usage: %s [options] FILE\n"
+          "       %s [options] -g HZ,MG[,SEC]\n"
+          "Input:\n"
+          "  -g HZ,MG[,SEC]  synthetic stream instead of FILE: sine of MG mg at HZ Hz on X,\n"
+          "                  half amplitude at 2*HZ on Y, gravity and a quarter at 3*HZ on Z,\n"
+          "                  plus noise (default %.0f s)\n"
+          "  -c COL          column of the X acceleration, Y and Z follow (default %d)\n"
+          "  -t COL          column of the time [s] to evaluate the ODR, -1 if missing (default %d)\n"
+          "  -o HZ           accelerometer ODR, overrides the time column (default %.0f Hz)\n"
+          "  -s MG           accelerometer sensitivity [mg/LSB] (default %.3f)\n"
+          "  -R              the input accelerations are in LSB instead of mg\n"
+          "MotionSP parameters:\n"
+          "  -N SIZE         FFT size, 256, 512, 1024 or 2048 (default %u)\n"
+          "  -w WIN          window, 0 RECTANGULAR, 1 HANNING, 2 HAMMING, 3 FLAT_TOP (default %u)\n"
+          "  -O OVL          FFT overlapping %% (%u-%u, default %u)\n"
+          "  -T MS           acquisition time (default %u ms)\n"
+          "  -r NUM          subranges, 8, 16, 32 or 64 (default %u)\n"
+          "  -u MS           moving RMS tau (default %u ms)\n"
+          "  -d TD           time domain, 0 TD_SPEED, 1 TD_ACCELERO, 2 TD_BOTH_TAU (default %u)\n"
+          "Benchmark:\n"
+          "  -n LOOPS        replays of the whole stream (default 1)\n"
+          "  -m FILE         write the averaged spectrum of each acquisition as CSV\n"
+          "  -q              report the benchmark only\n"
+          "  -V              check the time domain block against MotionSP_TimeDomainProcess\n"
+          "                  run on each sample, the exit status is 1 if they differ\n",
+          pName, pName, REPLAY_SYNTH_SEC_DEFAULT, REPLAY_ACC_COL_DEFAULT, REPLAY_TIME_COL_DEFAULT,
+          REPLAY_ODR_DEFAULT, REPLAY_SENS_DEFAULT, FFT_SIZE_DEFAULT, WINDOW_DEFAULT,
+          FFT_OVL_MIN, FFT_OVL_MAX, FFT_OVL_DEFAULT, TACQ_DEFAULT, SUBRANGE_DEFAULT, TAU_DEFAULT, TD_DEFAULT);
+#ifdef REPLAY_FFT_CHECK
+  fprintf(stderr,
+          "  -F              check the fused FFT pass against the per-axis copy, window, FFT,\n"
+          "                  magnitude and average pipeline, the exit status is 1 if they differ\n");
+#endif /* REPLAY_FFT_CHECK */
+#ifdef MOTIONSP_USE_ENVELOPE
+  fprintf(stderr,
+          "Envelope analysis:\n"
+          "  -E LO,HI[,DEC]  band-pass [Hz] and decimation 2, 4, 8 or 16 (default %u,%u,%u)\n",
+          ENV_BAND_LOW_DEFAULT, ENV_BAND_HIGH_DEFAULT, ENV_DEC_DEFAULT);
+#endif /* MOTIONSP_USE_ENVELOPE */
+}
+
+/**
+  * @brief  Parse the command line, the MotionSP parameters are set inside ReplayCtx
+  * @param  argc Number of arguments
+  * @param  argv Arguments
+  * @param  pOpt Replay options
+  * @retval 0 in case of success
+  */
+static int ParseOptions(int argc, char **argv, sReplayOpt_t *pOpt)
+{
+  sMotionSP_Parameter_t *pParam = &ReplayCtx.Parameters;
+  uint8_t Synth = 0;
+#ifdef MOTIONSP_USE_ENVELOPE
+  unsigned int EnvLow, EnvHigh, EnvDec;
+#endif /* MOTIONSP_USE_ENVELOPE */
+  long Val;
+  int c;
+
+  memset(pOpt, 0, sizeof(sReplayOpt_t));
+  pOpt->Sens = REPLAY_SENS_DEFAULT;
+  pOpt->AccCol = REPLAY_ACC_COL_DEFAULT;
+  pOpt->TimeCol = REPLAY_TIME_COL_DEFAULT;
+  pOpt->Loops = 1;
+  pOpt->SynthSec = REPLAY_SYNTH_SEC_DEFAULT;
+
+  /* Default parameters of MotionSP_SetDefaultVibrationParam */
+  pParam->FftSize = FFT_SIZE_DEFAULT;
+  pParam->tau = TAU_DEFAULT;
+  pParam->window = WINDOW_DEFAULT;
+  pParam->td_type = TD_DEFAULT;
+  pParam->tacq = TACQ_DEFAULT;
+  pParam->subrange_num = SUBRANGE_DEFAULT;
+  pParam->FftOvl = FFT_OVL_DEFAULT;
+#ifdef MOTIONSP_USE_ENVELOPE
+  pParam->env_band_low = ENV_BAND_LOW_DEFAULT;
+  pParam->env_band_high = ENV_BAND_HIGH_DEFAULT;
+  pParam->env_dec = ENV_DEC_DEFAULT;
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+  while ((c = getopt(argc, argv, "g:c:t:o:s:RN:w:O:T:r:u:d:E:n:m:qVF")) != -1)
+  {
+    Val = (optarg != NULL) ? strtol(optarg, NULL, 10) : 0;
+
+    switch (c)
+    {
+      case 'g':
+        if (sscanf(optarg, "%f,%f,%f", &pOpt->SynthFreq, &pOpt->SynthAmp, &pOpt->SynthSec) < 2)
+          return 1;
+        Synth = 1;
+        break;
+      case 'c':
+        pOpt->AccCol = (int)Val;
+        break;
+      case 't':
+        pOpt->TimeCol = (int)Val;
+        break;
+      case 'o':
+        pOpt->Odr = strtof(optarg, NULL);
+        break;
+      case 's':
+        pOpt->Sens = strtof(optarg, NULL);
+        break;
+      case 'R':
+        pOpt->RawLsb = 1;
+        break;
+      case 'N':
+        if ((Val != FFT_SIZE_256) && (Val != FFT_SIZE_512) && (Val != FFT_SIZE_1024) && (Val != FFT_SIZE_2048))
+          return 1;
+        pParam->FftSize = (uint16_t)Val;
+        break;
+      case 'w':
+        if ((Val < RECTANGULAR) || (Val > FLAT_TOP))
+          return 1;
+        pParam->window = (uint16_t)Val;
+        break;
+      case 'O':
+        if ((Val < FFT_OVL_MIN) || (Val > FFT_OVL_MAX))
+          return 1;
+        pParam->FftOvl = (uint8_t)Val;
+        break;
+      case 'T':
+        if ((Val <= 0) || (Val > UINT16_MAX))
+          return 1;
+        pParam->tacq = (uint16_t)Val;
+        break;
+      case 'r':
+        if ((Val != 8) && (Val != 16) && (Val != 32) && (Val != 64))
+          return 1;
+        pParam->subrange_num = (uint16_t)Val;
+        break;
+      case 'u':
+        if ((Val <= 0) || (Val > UINT16_MAX))
+          return 1;
+        pParam->tau = (uint16_t)Val;
+        break;
+      case 'd':
+        if ((Val < TD_SPEED) || (Val > TD_BOTH_TAU))
+          return 1;
+        pParam->td_type = (uint16_t)Val;
+        break;
+#ifdef MOTIONSP_USE_ENVELOPE
+      case 'E':
+        EnvDec = pParam->env_dec;
+        if ((sscanf(optarg, "%u,%u,%u", &EnvLow, &EnvHigh, &EnvDec) < 2) ||
+            (EnvLow >= EnvHigh) || (EnvHigh > UINT16_MAX) || (EnvDec > ENV_DEC_MAX))
+          return 1;
+        pParam->env_band_low = (uint16_t)EnvLow;
+        pParam->env_band_high = (uint16_t)EnvHigh;
+        pParam->env_dec = (uint16_t)EnvDec;
+        break;
+#endif /* MOTIONSP_USE_ENVELOPE */
+      case 'n':
+        if (Val <= 0)
+          return 1;
+        pOpt->Loops = (uint32_t)Val;
+        break;
+      case 'm':
+        pOpt->SpecFile = optarg;
+        break;
+      case 'q':
+        pOpt->Quiet = 1;
+        break;
+      case 'V':
+        pOpt->TdCheck = 1;
+        break;
+#ifdef REPLAY_FFT_CHECK
+      case 'F':
+        pOpt->FftCheck = 1;
+        break;
+#endif /* REPLAY_FFT_CHECK */
+      default:
+        return 1;
+    }
+  }
+
+  /* A file or the synthetic stream */
+  if (Synth == (optind < argc))
+    return 1;
+  if (!Synth)
+    pOpt->InFile = argv[optind];
+
+  if ((pOpt->Sens <= 0.0f) || (pOpt->Odr < 0.0f) || (pOpt->AccCol < 0) ||
+      (pOpt->AccCol + NUM_AXES > REPLAY_FIELDS_MAX) || (pOpt->TimeCol >= REPLAY_FIELDS_MAX))
+    return 1;
+
+  strncpy(pParam->window_name, WindowName[pParam->window], sizeof(pParam->window_name) - 1);
+
+  return 0;
+}
+
+/**
+  * @brief  Load the accelerometer stream from the input file
+  * @param  pOpt Replay options, the ODR is evaluated from the time column if not set
+  * @retval 0 in case of success
+  */
+static int LoadStream(sReplayOpt_t *pOpt)
+{
+  char Line[REPLAY_LINE_LEN];
+  double Field[REPLAY_FIELDS_MAX];
+  double TimeFirst = 0.0, TimeLast = 0.0;
+  uint32_t TimeFirstId = 0, TimeLastId = 0;
+  uint8_t TimeValid = 0;
+  float Mg[NUM_AXES];
+  FILE *pIn;
+  char *pPos, *pEnd;
+  int FieldNum, Num, i;
+  uint8_t Csv;
+
+  if ((pIn = fopen(pOpt->InFile, "r")) == NULL)
+  {
+    fprintf(stderr, "Cannot read %s\n", pOpt->InFile);
+    return 1;
+  }
+
+  while (fgets(Line, sizeof(Line), pIn) != NULL)
+  {
+    pPos = Line + strspn(Line, " \t");
+
+    /* Skip the header and the comments */
+    if (strchr("0123456789+-.", *pPos) == NULL || *pPos == '\0')
+      continue;
+
+    /* Empty CSV fields are kept, the spaces are merged */
+    Csv = (strpbrk(pPos, ",;\t") != NULL);
+    for (FieldNum = 0; (FieldNum < REPLAY_FIELDS_MAX) && (*pPos != '\0') && (*pPos != '\n') && (*pPos != '\r'); FieldNum++)
+    {
+      Field[FieldNum] = strtod(pPos, &pEnd);
+      if (pEnd == pPos)
+        Field[FieldNum] = NAN;
+
+      if (Csv)
+      {
+        pPos = pEnd + strcspn(pEnd, ",;\t\r\n");
+        if ((*pPos == ',') || (*pPos == ';') || (*pPos == '\t'))
+          pPos++;
+      }
+      else
+      {
+        pPos = pEnd + strcspn(pEnd, " \r\n");
+        pPos += strspn(pPos, " ");
+      }
+    }
+
+    /* Rows without acceleration (only gyroscope) */
+    if (FieldNum < pOpt->AccCol + NUM_AXES)
+      continue;
+    for (i = 0, Num = 0; i < NUM_AXES; i++)
+    {
+      Mg[i] = (float)Field[pOpt->AccCol + i];
+      Num += !isnan(Mg[i]);
+    }
+    if (Num != NUM_AXES)
+      continue;
+
+    if ((pOpt->TimeCol >= 0) && (pOpt->TimeCol < FieldNum) && !isnan(Field[pOpt->TimeCol]))
+    {
+      if (!TimeValid)
+      {
+        TimeFirst = Field[pOpt->TimeCol];
+        TimeFirstId = AccLsbNum;
+        TimeValid = 1;
+      }
+      TimeLast = Field[pOpt->TimeCol];
+      TimeLastId = AccLsbNum;
+    }
+
+    if (AppendSample(Mg, pOpt))
+    {
+      fclose(pIn);
+      return 1;
+    }
+  }
+
+  fclose(pIn);
+
+  if (AccLsbNum == 0)
+  {
+    fprintf(stderr, "No acceleration inside %s\n", pOpt->InFile);
+    return 1;
+  }
+
+  /* ODR from the time of the samples, as AccOdrMeas counts the samples in a time window */
+  if (pOpt->Odr == 0.0f)
+  {
+    if (TimeValid && (TimeLastId > TimeFirstId) && (TimeLast > TimeFirst))
+      pOpt->Odr = (float)((TimeLastId - TimeFirstId) / (TimeLast - TimeFirst));
+    else
+      pOpt->Odr = REPLAY_ODR_DEFAULT;
+  }
+
+  return 0;
+}
+
+/**
+  * @brief  Build a synthetic accelerometer stream
+  * @param  pOpt Replay options
+  * @retval 0 in case of success
+  */
+static int SynthStream(sReplayOpt_t *pOpt)
+{
+  const float w = 2.0f * PI * pOpt->SynthFreq;
+  uint32_t Seed = 1;
+  uint32_t Num, i;
+  float Mg[NUM_AXES];
+  float t, Noise[NUM_AXES];
+  uint8_t axis;
+
+  if (pOpt->Odr == 0.0f)
+    pOpt->Odr = REPLAY_ODR_DEFAULT;
+
+  Num = (uint32_t)(pOpt->SynthSec * pOpt->Odr);
+
+  for (i = 0; i < Num; i++)
+  {
+    t = (float)i / pOpt->Odr;
+
+    /* Same noise on every run, the results can be compared */
+    for (axis = 0; axis < NUM_AXES; axis++)
+    {
+      Seed = Seed * 1664525u + 1013904223u;
+      Noise[axis] = (pOpt->SynthAmp * 0.05f) * ((float)(Seed >> 8) / (float)(1u << 24) - 0.5f);
+    }
+
+    Mg[0] = pOpt->SynthAmp * sinf(w * t) + Noise[0];
+    Mg[1] = 0.5f * pOpt->SynthAmp * sinf(2.0f * w * t) + Noise[1];
+    Mg[2] = 1000.0f + 0.25f * pOpt->SynthAmp * sinf(3.0f * w * t) + Noise[2];
+
+    if (AppendSample(Mg, pOpt))
+      return 1;
+  }
+
+  if (AccLsbNum == 0)
+  {
+    fprintf(stderr, "Empty synthetic stream\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+  * @brief  Add a sample to the stream, converted to the LSB read from the FIFO
+  * @param  pMg Acceleration X-Y-Z [mg], or [LSB] with the RawLsb option
+  * @param  pOpt Replay options
+  * @retval 0 in case of success
+  */
+static int AppendSample(const float *pMg, const sReplayOpt_t *pOpt)
+{
+  static uint32_t AccLsbSize = 0;
+  void *pNew;
+  long Lsb;
+  uint8_t axis;
+
+  if (AccLsbNum == AccLsbSize)
+  {
+    AccLsbSize = (AccLsbSize != 0) ? 2 * AccLsbSize : 65536;
+    if ((pNew = realloc(AccLsb, AccLsbSize * sizeof(*AccLsb))) == NULL)
+    {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    AccLsb = pNew;
+  }
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    Lsb = lrintf(pOpt->RawLsb ? pMg[axis] : (pMg[axis] / pOpt->Sens));
+    AccLsb[AccLsbNum][axis] = (int16_t)((Lsb > INT16_MAX) ? INT16_MAX : ((Lsb < INT16_MIN) ? INT16_MIN : Lsb));
+  }
+  AccLsbNum++;
+
+  return 0;
+}
+
+/**
+  * @brief  Replay of the whole stream from a new context, as MotionSP_VibrationAnalysis
+  *         with the FFT alarms enabled and no FFT amplitude request
+  * @param  pOpt Replay options
+  * @param  Report Print the results of each acquisition
+  * @param  pSpec Output file of the averaged spectra, NULL if not requested
+  * @return Number of spectra (3 axes each)
+  */
+static uint32_t Replay(const sReplayOpt_t *pOpt, uint8_t Report, FILE *pSpec)
+{
+#define FFTSIZEDELTA  (ReplayCtx.Parameters.FftSize*((100.0-ReplayCtx.Parameters.FftOvl)/100.0))
+  const uint16_t AccFifoSize = (uint16_t)(((float)ReplayCtx.Parameters.FftSize*(1.0f-((float)ReplayCtx.Parameters.FftOvl/100.0f)))*0.75f);
+#ifdef MOTIONSP_USE_Q15
+  static SensorVal_q15_t AccNoDC[ACC_BLOCK_MAX_LEN];
+  SensorVal_q15_t rawAcc;
+#else /* MOTIONSP_USE_Q15 */
+  static SensorVal_f_t AccNoDC[ACC_BLOCK_MAX_LEN];
+  SensorVal_f_t mgAcc;
+#endif /* MOTIONSP_USE_Q15 */
+  uint8_t accCircBuffIndexForFftOvf = 0;
+  uint16_t accCircBuffIndexPre = (uint16_t)(-1);
+  uint16_t accCircBuffIndexTmp;
+  uint16_t accCircBuffIndexForFftTmp;
+  uint8_t RestartFlag;
+  uint8_t Restart;
+  uint32_t AcqId = 0;
+  uint32_t AcqSamples = 0;
+  uint16_t AcqSpectra = 0;
+  uint32_t Spectra = 0;
+  uint32_t Pos, BlockLen, i;
+  uint64_t t0, t1;
+
+#ifdef MOTIONSP_USE_SDFT
+  /* No subrange peak known by the new context */
+  SdftOnly = 0;
+  SdftReseedCnt = 0;
+  memset(&ReplayCtx.State.Sdft, 0, sizeof(ReplayCtx.State.Sdft));
+#endif /* MOTIONSP_USE_SDFT */
+
+  AcquisitionInit(&RestartFlag);
+
+  for (Pos = 0; Pos < AccLsbNum; Pos += BlockLen)
+  {
+    BlockLen = ((AccLsbNum - Pos) < AccFifoSize) ? (AccLsbNum - Pos) : AccFifoSize;
+    Restart = RestartFlag;
+
+    /* ------------------ FIFO block, as FillCircBuffFromFifo -------------------*/
+    t0 = NowNs();
+    for (i = 0; i < BlockLen; i++)
+    {
+#ifdef MOTIONSP_USE_Q15
+      rawAcc.AXIS_X = AccLsb[Pos + i][0];
+      rawAcc.AXIS_Y = AccLsb[Pos + i][1];
+      rawAcc.AXIS_Z = AccLsb[Pos + i][2];
+
+      if (RestartFlag)
+        ReplayCtx.SampleScale = pOpt->Sens * G_CONV;
+
+      MotionSP_accDelOffset_q15(&ReplayCtx, &AccNoDC[i], &rawAcc, DC_SMOOTH_Q15, RestartFlag);
+#else /* MOTIONSP_USE_Q15 */
+      mgAcc.AXIS_X = (float)(AccLsb[Pos + i][0]*pOpt->Sens);
+      mgAcc.AXIS_Y = (float)(AccLsb[Pos + i][1]*pOpt->Sens);
+      mgAcc.AXIS_Z = (float)(AccLsb[Pos + i][2]*pOpt->Sens);
+
+      MotionSP_accDelOffset(&ReplayCtx, &AccNoDC[i], &mgAcc, DC_SMOOTH, RestartFlag);
+#endif /* MOTIONSP_USE_Q15 */
+
+      RestartFlag = 0;
+    }
+    t1 = NowNs();
+    Stage[STAGE_DC_FILTER].Ns += t1 - t0;
+    Stage[STAGE_DC_FILTER].Calls++;
+
+    for (i = 0; i < BlockLen; i++)
+    {
+#ifdef MOTIONSP_USE_Q15
+      MotionSP_CreateAccCircBuffer_q15(&ReplayCtx.AccCircBuffer, AccNoDC[i]);
+#else /* MOTIONSP_USE_Q15 */
+      MotionSP_CreateAccCircBuffer(&ReplayCtx.AccCircBuffer, AccNoDC[i]);
+#endif /* MOTIONSP_USE_Q15 */
+#ifdef MOTIONSP_USE_SDFT
+      /* As FillCircBuffFromFifo, only the acquisitions without the FFT average need the sliding DFT */
+      if (SdftOnly && ((i % SDFT_BLOCK_LEN) == (SDFT_BLOCK_LEN - 1)))
+        MotionSP_SdftUpdateBlock(&ReplayCtx, SDFT_BLOCK_LEN);
+#endif /* MOTIONSP_USE_SDFT */
+    }
+#ifdef MOTIONSP_USE_SDFT
+    if (SdftOnly && ((BlockLen % SDFT_BLOCK_LEN) != 0))
+      MotionSP_SdftUpdateBlock(&ReplayCtx, (uint16_t)(BlockLen % SDFT_BLOCK_LEN));
+#endif /* MOTIONSP_USE_SDFT */
+    t0 = NowNs();
+    Stage[STAGE_CIRC_BUFF].Ns += t0 - t1;
+    Stage[STAGE_CIRC_BUFF].Calls++;
+
+    MotionSP_TimeDomainProcessBlock(&ReplayCtx, (Td_Type_t)ReplayCtx.Parameters.td_type, (uint16_t)BlockLen, Restart);
+    t1 = NowNs();
+    Stage[STAGE_TIME_DOMAIN].Ns += t1 - t0;
+    Stage[STAGE_TIME_DOMAIN].Calls++;
+
+#ifdef MOTIONSP_USE_ENVELOPE
+    MotionSP_EnvelopeProcessBlock(&ReplayCtx, (uint16_t)BlockLen);
+    t0 = NowNs();
+    Stage[STAGE_ENVELOPE].Ns += t0 - t1;
+    Stage[STAGE_ENVELOPE].Calls++;
+    t1 = t0;
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+#ifdef MOTIONSP_USE_SDFT
+    /* Continuous monitoring of the subrange peaks */
+    if (SdftOnly && MotionSP_SdftEvalAmplitude(&ReplayCtx, &SdftAmplitude))
+    {
+      if (SdftAmplitudeCnt == 0)
+      {
+        memcpy(&SdftAmplitudeSum, &SdftAmplitude, sizeof(sSubrange_t));
+      }
+      else
+      {
+        arm_add_f32(SdftAmplitudeSum.AXIS_X, SdftAmplitude.AXIS_X, SdftAmplitudeSum.AXIS_X, ReplayCtx.Parameters.subrange_num);
+        arm_add_f32(SdftAmplitudeSum.AXIS_Y, SdftAmplitude.AXIS_Y, SdftAmplitudeSum.AXIS_Y, ReplayCtx.Parameters.subrange_num);
+        arm_add_f32(SdftAmplitudeSum.AXIS_Z, SdftAmplitude.AXIS_Z, SdftAmplitudeSum.AXIS_Z, ReplayCtx.Parameters.subrange_num);
+      }
+      SdftAmplitudeCnt++;
+
+      MotionSP_FreqDomainAlarm(&SdftAmplitude, FDWarnThresh, FDAlarmThresh, ReplayCtx.Parameters.subrange_num,
+                               &THR_Check, &THR_Fft_Alarms);
+    }
+    t0 = NowNs();
+    Stage[STAGE_SDFT_EVAL].Ns += t0 - t1;
+    Stage[STAGE_SDFT_EVAL].Calls++;
+#endif /* MOTIONSP_USE_SDFT */
+
+    /* Not timed: the reference runs on its own context */
+    if (pOpt->TdCheck)
+      TdCheckBlock(AccNoDC, BlockLen, Restart);
+
+    AcqSamples += BlockLen;
+
+    /* ------------------ Frequency domain, as MotionSP_VibrationAnalysis -------*/
+    if ( (ReplayCtx.AccCircBuffer.IdPos != accCircBuffIndexPre) && (ReplayCtx.AccCircBuffer.IdPos != (uint16_t)(-1)) )
+    {
+      accCircBuffIndexPre = ReplayCtx.AccCircBuffer.IdPos;
+
+      accCircBuffIndexTmp = ReplayCtx.AccCircBuffer.IdPos + (ReplayCtx.AccCircBuffer.Ovf * ReplayCtx.AccCircBuffer.Size);
+      accCircBuffIndexForFftTmp = ReplayCtx.accCircBuffIndexForFft + (accCircBuffIndexForFftOvf * ReplayCtx.AccCircBuffer.Size);
+
+      if (accCircBuffIndexTmp >= accCircBuffIndexForFftTmp)
+      {
+        /* Data time instead of the HAL tick */
+        if ((uint32_t)((AcqSamples * 1000.0) / pOpt->Odr) > ReplayCtx.Parameters.tacq)
+        {
+          ReplayCtx.FinishAvgFlag = 1;
+        }
+
+#ifdef MOTIONSP_USE_SDFT
+        if (!SdftOnly)
+#endif /* MOTIONSP_USE_SDFT */
+        {
+#ifdef REPLAY_FFT_CHECK
+          /* The reference uses its own scratch arrays, it is timed apart */
+          uint8_t FftRef = pOpt->FftCheck && FftCheckSpectrum();
+#endif /* REPLAY_FFT_CHECK */
+
+          t0 = NowNs();
+          MotionSP_FrequencyDomainProcess(&ReplayCtx);
+          t1 = NowNs();
+          Stage[STAGE_FFT].Ns += t1 - t0;
+          Stage[STAGE_FFT].Calls++;
+          AcqSpectra++;
+          Spectra++;
+
+#ifdef REPLAY_FFT_CHECK
+          if (FftRef && ReplayCtx.FinishAvgFlag)
+            FftCheckAverage();
+#endif /* REPLAY_FFT_CHECK */
+        }
+
+        t0 = NowNs();
+        MotionSP_TimeDomainAlarm(&sTdAlarm, &sTimeDomainVal, &sTdRmsThresholds, &sTdPkThresholds,
+                                 &ReplayCtx.TimeDomain);
+        t1 = NowNs();
+        Stage[STAGE_ALARM].Ns += t1 - t0;
+        Stage[STAGE_ALARM].Calls++;
+
+        accCircBuffIndexForFftOvf = 0;
+        ReplayCtx.accCircBuffIndexForFft += FFTSIZEDELTA;
+        if (ReplayCtx.accCircBuffIndexForFft >= ReplayCtx.AccCircBuffer.Size)
+        {
+          ReplayCtx.accCircBuffIndexForFft -= ReplayCtx.AccCircBuffer.Size;
+
+          if (!ReplayCtx.AccCircBuffer.Ovf)
+            accCircBuffIndexForFftOvf = 1;
+        }
+
+        ReplayCtx.AccCircBuffer.Ovf = 0;
+      }
+    }
+
+    /* ------------------ End of the acquisition -------------------------------*/
+    if (ReplayCtx.FinishAvgFlag == 1)
+    {
+      t0 = NowNs();
+#ifdef MOTIONSP_USE_SDFT
+      if (SdftOnly)
+        SdftAcquisitionDone();
+#endif /* MOTIONSP_USE_SDFT */
+
+      MotionSP_FreqDomainAlarm(&ReplayCtx.SRAmplitude, FDWarnThresh, FDAlarmThresh, ReplayCtx.Parameters.subrange_num,
+                               &THR_Check, &THR_Fft_Alarms);
+      t1 = NowNs();
+      Stage[STAGE_ALARM].Ns += t1 - t0;
+      Stage[STAGE_ALARM].Calls++;
+
+#ifdef MOTIONSP_USE_ENVELOPE
+      MotionSP_EnvelopeDone(&ReplayCtx);
+      t0 = NowNs();
+      Stage[STAGE_ENVELOPE].Ns += t0 - t1;
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+      if (Report)
+        AcquisitionReport(AcqId, AcqSamples, AcqSpectra, pSpec);
+      AcqId++;
+
+#ifdef MOTIONSP_USE_SDFT
+      if (SdftOnly)
+      {
+        SdftReseedCnt--;
+      }
+      else
+      {
+        MotionSP_SdftSetBins(&ReplayCtx, &ReplayCtx.SRBinVal, ReplayCtx.Parameters.subrange_num);
+        SdftReseedCnt = SDFT_RESEED_DEFAULT;
+      }
+#endif /* MOTIONSP_USE_SDFT */
+
+      AcquisitionInit(&RestartFlag);
+      accCircBuffIndexForFftOvf = 0;
+      AcqSamples = 0;
+      AcqSpectra = 0;
+    }
+  }
+
+  if (Report)
+  {
+    if (AcqSamples != 0)
+      printf("Last %u samples do not complete an acquisition\n", AcqSamples);
+    printf("\n");
+  }
+
+  return Spectra;
+}
+
+/**
+  * @brief  Start of an acquisition, as MotionSP_VibrationInit and the alarm init
+  * @param  pRestartFlag Restart flag of the DC filter and of the time domain
+  * @return None
+  */
+static void AcquisitionInit(uint8_t *pRestartFlag)
+{
+  MotionSP_ContextInit(&ReplayCtx);
+
+  RefCtx.Parameters = ReplayCtx.Parameters;
+  RefCtx.AcceleroODR = ReplayCtx.AcceleroODR;
+  MotionSP_ContextInit(&RefCtx);
+
+#ifdef MOTIONSP_USE_SDFT
+  SdftAmplitudeCnt = 0;
+  SdftOnly = (MotionSP_SdftIsSeeded(&ReplayCtx) && (SdftReseedCnt != 0));
+#endif /* MOTIONSP_USE_SDFT */
+
+  *pRestartFlag = 1;
+
+  MotionSP_TimeDomainAlarmInit(&sTdAlarm, &sTimeDomainVal, &sTdRmsThresholds, &sTdPkThresholds);
+  MotionSP_FreqDomainAlarmInit(&FDWarnThresh, &FDAlarmThresh, &THR_Fft_Alarms, ReplayCtx.Parameters.subrange_num);
+}
+
+/**
+  * @brief  Print the results of an acquisition and write its averaged spectrum
+  * @param  AcqId Acquisition number
+  * @param  AcqSamples Samples of the acquisition
+  * @param  Spectra FFT inside the average
+  * @param  pSpec Output file of the averaged spectra, NULL if not requested
+  * @return None
+  */
+static void AcquisitionReport(uint32_t AcqId, uint32_t AcqSamples, uint16_t Spectra, FILE *pSpec)
+{
+  const float BinFreqStep = (ReplayCtx.AcceleroODR.Frequency / 2) / ReplayCtx.magSize;
+  const sAxesMagResults_t *pPeak = &ReplayCtx.AccAxesMagResults;
+  const Alarm_Type_t *pStatus[NUM_AXES] = {THR_Fft_Alarms.STATUS_AXIS_X, THR_Fft_Alarms.STATUS_AXIS_Y, THR_Fft_Alarms.STATUS_AXIS_Z};
+  uint16_t Warn[NUM_AXES] = {0, 0, 0};
+  uint16_t Alarm[NUM_AXES] = {0, 0, 0};
+  uint16_t i;
+  uint8_t axis;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    for (i = 0; i < ReplayCtx.Parameters.subrange_num; i++)
+    {
+      Warn[axis] += (pStatus[axis][i] == WARNING);
+      Alarm[axis] += (pStatus[axis][i] == ALARM);
+    }
+  }
+
+  printf("Acquisition %u: %u samples, %u spectra\n", AcqId, AcqSamples, Spectra);
+  printf("  Speed RMS [mm/s]    X %9.4f %-8s Y %9.4f %-8s Z %9.4f %s\n",
+         sTimeDomainVal.SpeedRms.AXIS_X, AlarmName[sTdAlarm.RMS_STATUS_AXIS_X],
+         sTimeDomainVal.SpeedRms.AXIS_Y, AlarmName[sTdAlarm.RMS_STATUS_AXIS_Y],
+         sTimeDomainVal.SpeedRms.AXIS_Z, AlarmName[sTdAlarm.RMS_STATUS_AXIS_Z]);
+  printf("  Acc peak [m/s^2]    X %9.4f %-8s Y %9.4f %-8s Z %9.4f %s\n",
+         sTimeDomainVal.AccPeak.AXIS_X, AlarmName[sTdAlarm.PK_STATUS_AXIS_X],
+         sTimeDomainVal.AccPeak.AXIS_Y, AlarmName[sTdAlarm.PK_STATUS_AXIS_Y],
+         sTimeDomainVal.AccPeak.AXIS_Z, AlarmName[sTdAlarm.PK_STATUS_AXIS_Z]);
+  printf("  FFT peak [m/s^2@Hz] X %9.4f@%-7.1f Y %9.4f@%-7.1f Z %9.4f@%.1f\n",
+         pPeak->X_Value, pPeak->X_Index * BinFreqStep,
+         pPeak->Y_Value, pPeak->Y_Index * BinFreqStep,
+         pPeak->Z_Value, pPeak->Z_Index * BinFreqStep);
+  printf("  Subranges warn/alarm X %u/%u, Y %u/%u, Z %u/%u\n",
+         Warn[0], Alarm[0], Warn[1], Alarm[1], Warn[2], Alarm[2]);
+#ifdef MOTIONSP_USE_ENVELOPE
+  /* Peaks left to zero by MotionSP_EnvelopeInit when no envelope frame has been analyzed */
+  if (ReplayCtx.Envelope.MagResults.X_FFT_AVG != 0)
+  {
+    const float EnvFreqStep = ReplayCtx.Envelope.Frequency / ENV_FFT_SIZE;
+    const sAxesMagResults_t *pEnvPeak = &ReplayCtx.Envelope.MagResults;
+
+    printf("  Envelope [m/s^2@Hz] X %9.4f@%-7.1f Y %9.4f@%-7.1f Z %9.4f@%.1f (%u spectra)\n",
+           pEnvPeak->X_Value, pEnvPeak->X_Index * EnvFreqStep,
+           pEnvPeak->Y_Value, pEnvPeak->Y_Index * EnvFreqStep,
+           pEnvPeak->Z_Value, pEnvPeak->Z_Index * EnvFreqStep, pEnvPeak->X_FFT_AVG);
+  }
+#endif /* MOTIONSP_USE_ENVELOPE */
+
+  if (pSpec != NULL)
+  {
+    for (i = 0; i < ReplayCtx.magSize; i++)
+    {
+      fprintf(pSpec, "%u,%.3f,%.7g,%.7g,%.7g\n", AcqId, i * BinFreqStep,
+              ReplayCtx.AccAxesAvgMagBuff.AXIS_X[i], ReplayCtx.AccAxesAvgMagBuff.AXIS_Y[i],
+              ReplayCtx.AccAxesAvgMagBuff.AXIS_Z[i]);
+    }
+  }
+}
+
+#ifdef MOTIONSP_USE_SDFT
+/**
+  * @brief  Subrange amplitudes and spectrum peaks of an acquisition monitored by the sliding DFT only
+  * @param  None
+  * @return None
+  */
+static void SdftAcquisitionDone(void)
+{
+  float *pSum[3] = {SdftAmplitudeSum.AXIS_X, SdftAmplitudeSum.AXIS_Y, SdftAmplitudeSum.AXIS_Z};
+  float *pAmp[3] = {ReplayCtx.SRAmplitude.AXIS_X, ReplayCtx.SRAmplitude.AXIS_Y, ReplayCtx.SRAmplitude.AXIS_Z};
+  const float *pBin[3] = {ReplayCtx.SRBinVal.AXIS_X, ReplayCtx.SRBinVal.AXIS_Y, ReplayCtx.SRBinVal.AXIS_Z};
+  float *pValue[3] = {&ReplayCtx.AccAxesMagResults.X_Value, &ReplayCtx.AccAxesMagResults.Y_Value, &ReplayCtx.AccAxesMagResults.Z_Value};
+  uint32_t *pIndex[3] = {&ReplayCtx.AccAxesMagResults.X_Index, &ReplayCtx.AccAxesMagResults.Y_Index, &ReplayCtx.AccAxesMagResults.Z_Index};
+  uint32_t MaxId;
+  uint8_t axis;
+
+  /* Acquisition shorter than the DFT: the last amplitudes are kept */
+  if (SdftAmplitudeCnt == 0)
+    return;
+
+  for (axis = 0; axis < 3; axis++)
+  {
+    arm_scale_f32(pSum[axis], 1.0f / (float)SdftAmplitudeCnt, pAmp[axis], ReplayCtx.Parameters.subrange_num);
+    arm_max_f32(pAmp[axis], ReplayCtx.Parameters.subrange_num, pValue[axis], &MaxId);
+    *pIndex[axis] = (uint32_t)pBin[axis][MaxId];
+  }
+}
+#endif /* MOTIONSP_USE_SDFT */
+
+/**
+  * @brief  Time domain of the block samples, as FillCircBuffFromFifo did before the block
+  *         evaluation: MotionSP_TimeDomainProcess after each sample, on a second context
+  * @param  pAccNoDC Samples of the block without DC
+  * @param  BlockLen Number of samples of the block
+  * @param  Restart The block is the first of the acquisition
+  * @return None
+  */
+#ifdef MOTIONSP_USE_Q15
+static void TdCheckBlock(const SensorVal_q15_t *pAccNoDC, uint32_t BlockLen, uint8_t Restart)
+#else /* MOTIONSP_USE_Q15 */
+static void TdCheckBlock(const SensorVal_f_t *pAccNoDC, uint32_t BlockLen, uint8_t Restart)
+#endif /* MOTIONSP_USE_Q15 */
+{
+  const sAcceleroParam_t *pBlock = &ReplayCtx.TimeDomain;
+  const sAcceleroParam_t *pRef = &RefCtx.TimeDomain;
+  float Diff;
+  uint32_t i;
+
+#ifdef MOTIONSP_USE_Q15
+  RefCtx.SampleScale = ReplayCtx.SampleScale;
+#endif /* MOTIONSP_USE_Q15 */
+
+  for (i = 0; i < BlockLen; i++)
+  {
+#ifdef MOTIONSP_USE_Q15
+    MotionSP_CreateAccCircBuffer_q15(&RefCtx.AccCircBuffer, pAccNoDC[i]);
+#else /* MOTIONSP_USE_Q15 */
+    MotionSP_CreateAccCircBuffer(&RefCtx.AccCircBuffer, pAccNoDC[i]);
+#endif /* MOTIONSP_USE_Q15 */
+    MotionSP_TimeDomainProcess(&RefCtx, (Td_Type_t)RefCtx.Parameters.td_type, Restart && (i == 0));
+  }
+
+  /* The peaks are the same samples, the RMS filters are evaluated in a different order */
+  Diff = fmaxf(fmaxf(fabsf(pBlock->AccPeak.AXIS_X - pRef->AccPeak.AXIS_X),
+                     fabsf(pBlock->AccPeak.AXIS_Y - pRef->AccPeak.AXIS_Y)),
+               fabsf(pBlock->AccPeak.AXIS_Z - pRef->AccPeak.AXIS_Z));
+  TdCheck.PeakDiff = fmaxf(TdCheck.PeakDiff, Diff);
+  TdCheck.SpeedRmsDiff = fmaxf(TdCheck.SpeedRmsDiff, TdCheckDiff(&pBlock->SpeedRms, &pRef->SpeedRms, REPLAY_TD_CHECK_SPEED_MIN));
+  TdCheck.AccRmsDiff = fmaxf(TdCheck.AccRmsDiff, TdCheckDiff(&pBlock->AccRms, &pRef->AccRms, REPLAY_TD_CHECK_ACC_MIN));
+  TdCheck.Blocks++;
+}
+
+#ifdef REPLAY_FFT_CHECK
+/**
+  * @brief  Spectrum of the three axes as MotionSP_FrequencyDomainProcess did before the fused pass:
+  *         for each axis copy from the circular buffer, window, FFT, magnitude and average
+  * @param  None
+  * @return 1 if the spectrum has been added to the reference average
+  */
+static uint8_t FftCheckSpectrum(void)
+{
+  float *pSrc[NUM_AXES] = {ReplayCtx.AccCircBuffer.Data.AXIS_X, ReplayCtx.AccCircBuffer.Data.AXIS_Y, ReplayCtx.AccCircBuffer.Data.AXIS_Z};
+  float *pIn[NUM_AXES] = {FftRefIn.AXIS_X, FftRefIn.AXIS_Y, FftRefIn.AXIS_Z};
+  float *pAvg[NUM_AXES] = {RefCtx.AccAxesAvgMagBuff.AXIS_X, RefCtx.AccAxesAvgMagBuff.AXIS_Y, RefCtx.AccAxesAvgMagBuff.AXIS_Z};
+  uint16_t *pCnt[NUM_AXES] = {&RefCtx.AccSumCnt.AXIS_X, &RefCtx.AccSumCnt.AXIS_Y, &RefCtx.AccSumCnt.AXIS_Z};
+  const uint16_t FftSize = ReplayCtx.Parameters.FftSize;
+  uint64_t t0 = NowNs();
+  uint8_t axis;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    if (MotionSP_fftInBuild(pIn[axis], FftSize, pSrc[axis], ReplayCtx.AccCircBuffer.Size, ReplayCtx.accCircBuffIndexForFft))
+      return 0;
+  }
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    motionSP_fftUseWindow(FftRefWin, pIn[axis], FftSize, RefCtx.Filter_Params);
+    MotionSP_fftCalc(&RefCtx, FftRefWin, FftRefMag);
+    MotionSP_fftAverageCalcTime(pAvg[axis], FftRefMag, RefCtx.magSize, pCnt[axis], ReplayCtx.FinishAvgFlag);
+  }
+
+  if (ReplayCtx.FinishAvgFlag)
+  {
+    MotionSP_fftAdapt(&RefCtx.AccAxesAvgMagBuff, RefCtx.magSize, RefCtx.Window_Scale_Factor);
+    MotionSP_fftFindPeak(&RefCtx.AccAxesAvgMagBuff, RefCtx.magSize, &RefCtx.AccAxesMagResults);
+    memset(&RefCtx.AccSumCnt, 0, sizeof(RefCtx.AccSumCnt));
+  }
+
+  FftCheck.RefNs += NowNs() - t0;
+  FftCheck.Spectra++;
+
+  return 1;
+}
+
+/**
+  * @brief  Compare the averaged spectra and their peaks at the end of an average
+  * @param  None
+  * @return None
+  */
+static void FftCheckAverage(void)
+{
+  const float *pFused[NUM_AXES] = {ReplayCtx.AccAxesAvgMagBuff.AXIS_X, ReplayCtx.AccAxesAvgMagBuff.AXIS_Y, ReplayCtx.AccAxesAvgMagBuff.AXIS_Z};
+  const float *pRef[NUM_AXES] = {RefCtx.AccAxesAvgMagBuff.AXIS_X, RefCtx.AccAxesAvgMagBuff.AXIS_Y, RefCtx.AccAxesAvgMagBuff.AXIS_Z};
+  const float RefPeak[NUM_AXES] = {RefCtx.AccAxesMagResults.X_Value, RefCtx.AccAxesMagResults.Y_Value, RefCtx.AccAxesMagResults.Z_Value};
+  float Diff;
+  uint16_t i;
+  uint8_t axis;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+  {
+    for (i = 0; i < ReplayCtx.magSize; i++)
+    {
+      Diff = fabsf(pFused[axis][i] - pRef[axis][i]) / fmaxf(RefPeak[axis], FLT_MIN);
+      FftCheck.SpecDiff = fmaxf(FftCheck.SpecDiff, Diff);
+    }
+  }
+
+  if ((ReplayCtx.AccAxesMagResults.X_Index != RefCtx.AccAxesMagResults.X_Index) ||
+      (ReplayCtx.AccAxesMagResults.Y_Index != RefCtx.AccAxesMagResults.Y_Index) ||
+      (ReplayCtx.AccAxesMagResults.Z_Index != RefCtx.AccAxesMagResults.Z_Index))
+    FftCheck.PeakMismatch++;
+
+  FftCheck.Averages++;
+}
+#endif /* REPLAY_FFT_CHECK */
+
+/**
+  * @brief  Max relative difference of the three axes
+  * @param  pBlock Block evaluation
+  * @param  pRef Per-sample evaluation
+  * @param  Min Reference value below which the difference is relative to Min
+  * @return Max relative difference
+  */
+static float TdCheckDiff(const SensorVal_f_t *pBlock, const SensorVal_f_t *pRef, float Min)
+{
+  const float Block[NUM_AXES] = {pBlock->AXIS_X, pBlock->AXIS_Y, pBlock->AXIS_Z};
+  const float Ref[NUM_AXES] = {pRef->AXIS_X, pRef->AXIS_Y, pRef->AXIS_Z};
+  float Diff = 0.0f;
+  uint8_t axis;
+
+  for (axis = 0; axis < NUM_AXES; axis++)
+    Diff = fmaxf(Diff, fabsf(Block[axis] - Ref[axis]) / fmaxf(fabsf(Ref[axis]), Min));
+
+  return Diff;
+}
+
+/**
+  * @brief  Monotonic time
+  * @param  None
+  * @return Time [ns]
+  */
+static uint64_t NowNs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/